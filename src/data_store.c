@@ -6,13 +6,15 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "mdhim_options.h"
 #include "data_store.h"
+#include "ds_memory.h"
 #ifdef      LEVELDB_SUPPORT
 #include "ds_leveldb.h"
 #endif
 #ifdef      ROCKSDB_SUPPORT
-#include "ds_leveldb.h"
+#include "ds_rocksdb.h"
 #endif
 #ifdef      SOPHIADB_SUPPORT
 #include "ds_sophia.h"
@@ -38,12 +40,30 @@ struct mdhim_store_t *mdhim_db_init(int type) {
 	store->db_handle = NULL;
 	store->db_stats = NULL;
 	store->mdhim_store_stats = NULL;
+	store->stat_accs = NULL;
+	store->num_stat_accs = 0;
+	store->removed_slices = NULL;
+	store->num_removed_slices = 0;
+	store->max_removed_slices = 0;
+	memset(store->bloom, 0, sizeof(store->bloom));
+	store->bloom_level = 0;
+	store->bloom_keys = 0;
+	store->unfiltered_slices = NULL;
+	store->num_unfiltered_slices = 0;
 	store->mdhim_store_stats_lock = malloc(sizeof(pthread_rwlock_t));
 	if (pthread_rwlock_init(store->mdhim_store_stats_lock, NULL) != 0) {	
 		free(store->mdhim_store_stats_lock);
 		return NULL;
 	}
 
+	store->batch_append = NULL;
+	store->batch_get = NULL;
+	store->batch_del = NULL;
+	store->cursor_open = NULL;
+	store->cursor_seek = NULL;
+	store->cursor_get = NULL;
+	store->cursor_close = NULL;
+
 	switch(type) {
 
 #ifdef      LEVELDB_SUPPORT
@@ -51,30 +71,63 @@ struct mdhim_store_t *mdhim_db_init(int type) {
 		store->open = mdhim_leveldb_open;
 		store->put = mdhim_leveldb_put;
 		store->batch_put = mdhim_leveldb_batch_put;
+		store->batch_append = mdhim_leveldb_batch_append;
 		store->get = mdhim_leveldb_get;
+		store->batch_get = mdhim_leveldb_batch_get;
 		store->get_next = mdhim_leveldb_get_next;
 		store->get_prev = mdhim_leveldb_get_prev;
 		store->del = mdhim_leveldb_del;
+		store->batch_del = mdhim_leveldb_batch_del;
 		store->commit = mdhim_leveldb_commit;
 		store->close = mdhim_leveldb_close;
+		store->cursor_open = mdhim_leveldb_cursor_open;
+		store->cursor_seek = mdhim_leveldb_cursor_seek;
+		store->cursor_get = mdhim_leveldb_cursor_get;
+		store->cursor_close = mdhim_leveldb_cursor_close;
 		break;
 
 #endif
 
 #ifdef      ROCKSDB_SUPPORT
 	case ROCKSDB:
-		store->open = mdhim_leveldb_open;
-		store->put = mdhim_leveldb_put;
-		store->batch_put = mdhim_leveldb_batch_put;
-		store->get = mdhim_leveldb_get;
-		store->get_next = mdhim_leveldb_get_next;
-		store->get_prev = mdhim_leveldb_get_prev;
-		store->del = mdhim_leveldb_del;
-		store->commit = mdhim_leveldb_commit;
-		store->close = mdhim_leveldb_close;
+		store->open = mdhim_rocksdb_open;
+		store->put = mdhim_rocksdb_put;
+		store->batch_put = mdhim_rocksdb_batch_put;
+		store->batch_append = mdhim_rocksdb_batch_append;
+		store->get = mdhim_rocksdb_get;
+		store->batch_get = mdhim_rocksdb_batch_get;
+		store->get_next = mdhim_rocksdb_get_next;
+		store->get_prev = mdhim_rocksdb_get_prev;
+		store->del = mdhim_rocksdb_del;
+		store->batch_del = mdhim_rocksdb_batch_del;
+		store->commit = mdhim_rocksdb_commit;
+		store->close = mdhim_rocksdb_close;
+		store->cursor_open = mdhim_rocksdb_cursor_open;
+		store->cursor_seek = mdhim_rocksdb_cursor_seek;
+		store->cursor_get = mdhim_rocksdb_cursor_get;
+		store->cursor_close = mdhim_rocksdb_cursor_close;
 		break;
 #endif
 
+	case MEMORYDB:
+		store->open = mdhim_memory_open;
+		store->put = mdhim_memory_put;
+		store->batch_put = mdhim_memory_batch_put;
+		store->batch_append = mdhim_memory_batch_append;
+		store->get = mdhim_memory_get;
+		store->batch_get = mdhim_memory_batch_get;
+		store->get_next = mdhim_memory_get_next;
+		store->get_prev = mdhim_memory_get_prev;
+		store->del = mdhim_memory_del;
+		store->batch_del = mdhim_memory_batch_del;
+		store->commit = mdhim_memory_commit;
+		store->close = mdhim_memory_close;
+		store->cursor_open = mdhim_memory_cursor_open;
+		store->cursor_seek = mdhim_memory_cursor_seek;
+		store->cursor_get = mdhim_memory_cursor_get;
+		store->cursor_close = mdhim_memory_cursor_close;
+		break;
+
 #ifdef      MYSQLDB_SUPPORT
 	case	MYSQLDB:
 		store->open = mdhim_mysql_open;
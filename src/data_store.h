@@ -14,9 +14,12 @@
 #define LEVELDB 1 //LEVELDB storage method
 #define MYSQLDB 3
 #define ROCKSDB 4 //RocksDB
+#define MEMORYDB 5 //In memory skiplist, kept for the life of the job
 /* mdhim_store_t flags */
 #define MDHIM_CREATE 1 //Implies read/write 
 #define MDHIM_RDONLY 2
+//Most levels of a data store's key filter
+#define MDHIM_STORE_BLOOM_LEVELS 12
 #define MDHIM_RDWR 3
 
 /* Keys for stats database */
@@ -32,7 +35,12 @@ typedef int (*mdhim_store_put_fn_t)(void *db_handle, void *key, int32_t key_len,
 				    void *data, int32_t data_len);
 typedef int (*mdhim_store_batch_put_fn_t)(void *db_handle, void **keys, int32_t *key_lens, 
 					  void **data, int32_t *data_lens, int num_records);
+typedef int (*mdhim_store_batch_append_fn_t)(void *db_handle, void **keys, int32_t *key_lens, 
+					     void **data, int32_t *data_lens, int *exists, 
+					     int num_records);
 typedef int (*mdhim_store_get_fn_t)(void *db_handle, void *key, int key_len, void **data, int32_t *data_len);
+typedef int (*mdhim_store_batch_get_fn_t)(void *db_handle, void **keys, int32_t *key_lens, 
+					  void **data, int32_t *data_lens, int num_records);
 typedef int (*mdhim_store_get_next_fn_t)(void *db_handle, void **key, 
 					 int *key_len, void **data, 
 					 int32_t *data_len);
@@ -40,8 +48,17 @@ typedef int (*mdhim_store_get_prev_fn_t)(void *db_handle, void **key,
 					 int *key_len, void **data, 
 					 int32_t *data_len);
 typedef int (*mdhim_store_del_fn_t)(void *db_handle, void *key, int key_len);
+typedef int (*mdhim_store_batch_del_fn_t)(void *db_handle, void **keys, int32_t *key_lens, 
+					  int *found, int num_records);
 typedef int (*mdhim_store_commit_fn_t)(void *db_handle);
 typedef int (*mdhim_store_close_fn_t)(void *db_handle, void *db_stats);
+/* Cursors keep their position in the store between calls, so a scan does not
+   have to seek again for every page it reads */
+typedef int (*mdhim_store_cursor_open_fn_t)(void *db_handle, void **cursor);
+typedef int (*mdhim_store_cursor_seek_fn_t)(void *cursor, void *key, int key_len, int op);
+typedef int (*mdhim_store_cursor_get_fn_t)(void *cursor, int op, void **key, int *key_len,
+					   void **data, int32_t *data_len);
+typedef void (*mdhim_store_cursor_close_fn_t)(void *cursor);
 
 //Used for storing stats in a hash table
 struct mdhim_stat;
@@ -50,11 +67,31 @@ struct mdhim_stat {
 	void *max;                 //Max key
 	void *min;                 //Min key
 	int dirty;                 //Wether this stat was updated or a new stat
+	int changed;               //Whether this stat changed since the last stat flush
 	uint64_t num;              //Number of keys in this slice
-	struct mdhim_stat *stats;  //Used for local index stats to create a multi-level hash table
+	uint64_t load;             //Number of operations on this slice since the last rebalance
+	UT_hash_handle hh;         /* makes this structure hashable */
+};
+
+//The stats of a slice a worker thread put new keys in since they were last merged
+struct mdhim_stat_acc_entry {
+	int slice;                 //Key (slice number)
+	uint64_t num;              //New keys, 0 once merged.  The entry is kept for the next keys
+	uint64_t load;             //Operations on the slice, 0 once merged
+	uint64_t imin;
+	uint64_t imax;
+	long double dmin;
+	long double dmax;
 	UT_hash_handle hh;         /* makes this structure hashable */
 };
 
+/* Stats a worker thread gathers apart from the other workers.  Only its worker adds to it, 
+   so its lock is only waited on while the stats are merged */
+struct mdhim_stat_acc {
+	pthread_mutex_t lock;
+	struct mdhim_stat_acc_entry *entries;
+	struct mdhim_stat_acc_entry *last; //The entry of the last key, likely the next key's too
+};
 
 //Used for storing stats in the database
 struct mdhim_db_stat {
@@ -93,12 +130,23 @@ struct mdhim_store_t {
 	mdhim_store_open_fn_t open;
 	mdhim_store_put_fn_t put;
 	mdhim_store_batch_put_fn_t batch_put;
+	//NULL if the data store has to read a record to append to it
+	mdhim_store_batch_append_fn_t batch_append;
 	mdhim_store_get_fn_t get;
+	//NULL if the data store doesn't read several keys at once
+	mdhim_store_batch_get_fn_t batch_get;
 	mdhim_store_get_next_fn_t get_next;
 	mdhim_store_get_prev_fn_t get_prev;
 	mdhim_store_del_fn_t del;
+	//NULL if the data store doesn't delete several keys at once
+	mdhim_store_batch_del_fn_t batch_del;
 	mdhim_store_commit_fn_t commit;
 	mdhim_store_close_fn_t close;
+	//Cursor functions, NULL if the data store doesn't support cursors
+	mdhim_store_cursor_open_fn_t cursor_open;
+	mdhim_store_cursor_seek_fn_t cursor_seek;
+	mdhim_store_cursor_get_fn_t cursor_get;
+	mdhim_store_cursor_close_fn_t cursor_close;
 	
 	//Login credentials
 	char *db_user;
@@ -113,6 +161,26 @@ struct mdhim_store_t {
 
 	//Lock to allow concurrent readers and a single writer to the mdhim_store_stats
 	pthread_rwlock_t *mdhim_store_stats_lock;
+
+	/* Accumulators of the worker threads, merged into mdhim_store_stats whenever the 
+	   stats are read */
+	struct mdhim_stat_acc *stat_accs;
+	int num_stat_accs;
+
+	//Slices whose stats were removed since the last stat flush
+	int *removed_slices;
+	int num_removed_slices;
+	int max_removed_slices;
+
+	/* Filter of the keys put in the data store, in levels each twice as large as the one 
+	   before.  A level is added when the last one fills up.  Read and set without a lock */
+	unsigned char *bloom[MDHIM_STORE_BLOOM_LEVELS];
+	int bloom_level;           //The level keys are added to
+	uint64_t bloom_keys;       //The number of keys added to that level
+	/* Sorted slices whose stats were loaded from the database, whose keys aren't in the 
+	   filter.  Only set when the data store is opened */
+	int *unfiltered_slices;
+	int num_unfiltered_slices;
 };
 
 //Initializes the data store based on the type given (i.e., LEVELDB, etc...)
@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include <linux/limits.h>
 #include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
 #include "ds_leveldb.h"
 
 static void cmp_destroy(void* arg) { }
@@ -157,6 +159,554 @@ static const char* cmp_name(void* arg) {
 	return "mdhim_cmp";
 }
 
+//Compares encoded keys like leveldb's own comparator, a prefix sorts first
+static int cmp_bytewise(void* arg, const char* a, size_t alen,
+			const char* b, size_t blen) {
+	int ret;
+
+	ret = memcmp(a, b, alen < blen ? alen : blen);
+	if (ret) {
+		return ret;
+	}
+
+	return (alen > blen) - (alen < blen);
+}
+
+/**
+ * legacy_comparator
+ * Sets the comparator databases made before keys were encoded were opened with
+ *
+ * @param mdhimdb   the leveldb handle
+ * @param key_type  the type of the keys
+ */
+static void legacy_comparator(struct mdhim_leveldb_t *mdhimdb, int key_type) {
+	switch(key_type) {
+	case MDHIM_INT_KEY:
+		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_int_compare, cmp_name);
+		mdhimdb->compare = cmp_int_compare;
+		break;
+	case MDHIM_LONG_INT_KEY:
+		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_lint_compare, cmp_name);
+		mdhimdb->compare = cmp_lint_compare;
+		break;
+	case MDHIM_FLOAT_KEY:
+		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_float_compare, cmp_name);
+		mdhimdb->compare = cmp_float_compare;
+		break;
+	case MDHIM_DOUBLE_KEY:
+		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_double_compare, cmp_name);
+		mdhimdb->compare = cmp_double_compare;
+		break;
+	case MDHIM_STRING_KEY:
+		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_string_compare, cmp_name);
+		mdhimdb->compare = cmp_string_compare;
+		break;
+	default:
+		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_byte_compare, cmp_name);
+		mdhimdb->compare = cmp_byte_compare;
+		break;
+	}
+
+	leveldb_options_set_comparator(mdhimdb->options, mdhimdb->cmp);
+	mdhimdb->encoded = 0;
+}
+
+/**
+ * db_open
+ * Opens a database with encoded keys, or with the old comparator if it was made with it
+ *
+ * @param mdhimdb   the leveldb handle, with its options made
+ * @param path      the path of the database
+ * @param key_type  the type of the keys
+ * @param err       out  the error of leveldb, NULL on success
+ * @return the database
+ */
+static leveldb_t *db_open(struct mdhim_leveldb_t *mdhimdb, char *path, int key_type, 
+			  char **err) {
+	leveldb_t *db;
+
+	mdhimdb->key_type = key_type;
+	mdhimdb->encoded = 1;
+	mdhimdb->compare = cmp_bytewise;
+	db = leveldb_open(mdhimdb->options, path, err);
+	if (*err == NULL || !strstr(*err, "comparator")) {
+		return db;
+	}
+
+	leveldb_free(*err);
+	*err = NULL;
+	legacy_comparator(mdhimdb, key_type);
+
+	return leveldb_open(mdhimdb->options, path, err);
+}
+
+static void put_be(unsigned char *out, uint64_t v, int width) {
+	int i;
+
+	for (i = 0; i < width; i++) {
+		out[i] = (v >> (8 * (width - 1 - i))) & 0xff;
+	}
+}
+
+static uint64_t get_be(const unsigned char *in, int width) {
+	uint64_t v = 0;
+	int i;
+
+	for (i = 0; i < width; i++) {
+		v = (v << 8) | in[i];
+	}
+
+	return v;
+}
+
+/**
+ * key_width
+ * Gets the length numeric keys of a type have
+ *
+ * @param key_type  the type of the keys
+ * @return the length or 0 for keys that are not numbers
+ */
+static int key_width(int key_type) {
+	switch(key_type) {
+	case MDHIM_INT_KEY:
+	case MDHIM_FLOAT_KEY:
+		return 4;
+	case MDHIM_LONG_INT_KEY:
+	case MDHIM_DOUBLE_KEY:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * key_encode
+ * Gets the form of a key stored in the database.  Integers are big endian, floats big 
+ * endian with the sign bit flipped and the other bits too for negative numbers, strings 
+ * end at their first null character followed by a marker that records whether the key had 
+ * one, and byte keys start with their big endian length, so comparing the bytes orders 
+ * the keys like the old comparators did
+ *
+ * @param mdhimdb  the leveldb handle
+ * @param key      the key
+ * @param key_len  the length of the key
+ * @param buf      LEVELDB_KEY_BUF bytes the encoded key is made in if it fits, or NULL
+ * @param len      out  the length of the encoded key
+ * @return the encoded key, which is released with key_release
+ */
+static const char *key_encode(struct mdhim_leveldb_t *mdhimdb, void *key, int key_len, 
+			      char *buf, size_t *len) {
+	unsigned char *out;
+	uint64_t v;
+	int width;
+
+	if (!mdhimdb->encoded || !key) {
+		*len = key_len;
+		return key;
+	}
+
+	width = key_width(mdhimdb->key_type);
+	if (mdhimdb->key_type == MDHIM_STRING_KEY) {
+		*len = strnlen((char *) key, key_len) + 1;
+	} else if (width && key_len == width) {
+		*len = width;
+	} else if (width) {
+		//Numbers of the wrong length are kept as they are
+		*len = key_len;
+		return key;
+	} else {
+		*len = 4 + key_len;
+	}
+
+	out = (unsigned char *) (buf && *len <= LEVELDB_KEY_BUF ? buf : malloc(*len ? *len : 1));
+	switch(mdhimdb->key_type) {
+	case MDHIM_INT_KEY:
+		put_be(out, *(uint32_t *) key, 4);
+		break;
+	case MDHIM_LONG_INT_KEY:
+		put_be(out, *(uint64_t *) key, 8);
+		break;
+	case MDHIM_FLOAT_KEY:
+	case MDHIM_DOUBLE_KEY:
+		v = width == 4 ? *(uint32_t *) key : *(uint64_t *) key;
+		//-0.0 equals 0.0, so it is stored as 0.0
+		if (v == 1ULL << (8 * width - 1)) {
+			v = 0;
+		}
+
+		v = v >> (8 * width - 1) ? ~v : v | 1ULL << (8 * width - 1);
+		put_be(out, v, width);
+		break;
+	case MDHIM_STRING_KEY:
+		/* The markers sort below the characters of the mdhim alphabet, so a string still 
+		   sorts before the strings it is a prefix of and before itself with a null 
+		   character, like compare_keys sorts them */
+		memcpy(out, key, *len - 1);
+		out[*len - 1] = (int) *len - 1 < key_len ? 
+			LEVELDB_STRING_NULL : LEVELDB_STRING_NO_NULL;
+		break;
+	default:
+		put_be(out, key_len, 4);
+		memcpy(out + 4, key, key_len);
+		break;
+	}
+
+	return (const char *) out;
+}
+
+/**
+ * key_release
+ * Frees an encoded key if key_encode allocated it
+ *
+ * @param enc   the encoded key
+ * @param key   the key it was encoded from
+ * @param buf   the buffer passed to key_encode
+ */
+static void key_release(const char *enc, void *key, char *buf) {
+	if (enc != key && enc != buf) {
+		free((char *) enc);
+	}
+}
+
+/**
+ * key_decode
+ * Gets a key from its form in the database.  Strings get their null character back if 
+ * they had one, so the key has the length it was put with
+ *
+ * @param mdhimdb  the leveldb handle
+ * @param res      the encoded key
+ * @param len      the length of the encoded key
+ * @param key      out  the key, which the caller frees
+ * @param key_len  out  the length of the key
+ */
+static void key_decode(struct mdhim_leveldb_t *mdhimdb, const char *res, size_t len,
+		       void **key, int *key_len) {
+	const unsigned char *in = (const unsigned char *) res;
+	uint64_t v;
+	int width;
+
+	width = key_width(mdhimdb->key_type);
+	if (!mdhimdb->encoded || (width && (int) len != width) ||
+	    (mdhimdb->key_type == MDHIM_STRING_KEY && len < 1) ||
+	    (!width && mdhimdb->key_type != MDHIM_STRING_KEY && len < 4)) {
+		*key = malloc(len ? len : 1);
+		memcpy(*key, res, len);
+		*key_len = len;
+		return;
+	}
+
+	switch(mdhimdb->key_type) {
+	case MDHIM_INT_KEY:
+		*key = malloc(4);
+		*(uint32_t *) *key = get_be(in, 4);
+		*key_len = 4;
+		break;
+	case MDHIM_LONG_INT_KEY:
+		*key = malloc(8);
+		*(uint64_t *) *key = get_be(in, 8);
+		*key_len = 8;
+		break;
+	case MDHIM_FLOAT_KEY:
+	case MDHIM_DOUBLE_KEY:
+		v = get_be(in, width);
+		v = v >> (8 * width - 1) ? v & ~(1ULL << (8 * width - 1)) : ~v;
+		*key = malloc(width);
+		if (width == 4) {
+			*(uint32_t *) *key = v;
+		} else {
+			*(uint64_t *) *key = v;
+		}
+
+		*key_len = width;
+		break;
+	case MDHIM_STRING_KEY:
+		*key = malloc(len);
+		memcpy(*key, res, len - 1);
+		((char *) *key)[len - 1] = '\0';
+		*key_len = in[len - 1] == LEVELDB_STRING_NULL ? len : len - 1;
+		break;
+	default:
+		*key_len = len - 4;
+		*key = malloc(*key_len ? *key_len : 1);
+		memcpy(*key, res + 4, *key_len);
+		break;
+	}
+}
+
+/**
+ * delta_key
+ * Makes the key of an append in the delta database
+ *
+ * @param key      the key appended to
+ * @param key_len  the length of the key
+ * @param seq      the sequence number of the append
+ * @param len      out  the length of the delta key
+ * @return the delta key, which the caller frees
+ */
+static char *delta_key(void *key, int key_len, uint64_t seq, size_t *len) {
+	char *dkey;
+	int i;
+
+	//Big endian, so the database's byte order sorts by key and then by sequence number
+	*len = 4 + key_len + 8;
+	dkey = malloc(*len);
+	for (i = 0; i < 4; i++) {
+		dkey[i] = (key_len >> (8 * (3 - i))) & 0xff;
+	}
+	memcpy(dkey + 4, key, key_len);
+	for (i = 0; i < 8; i++) {
+		dkey[4 + key_len + i] = (seq >> (8 * (7 - i))) & 0xff;
+	}
+
+	return dkey;
+}
+
+/**
+ * delta_key_len
+ * Gets the length of the key an append in the delta database was made to
+ *
+ * @param dkey     the delta key
+ * @return the length of the key
+ */
+static int delta_key_len(const char *dkey) {
+	int key_len = 0;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		key_len = (key_len << 8) | (unsigned char) dkey[i];
+	}
+
+	return key_len;
+}
+
+/**
+ * find_deltas
+ * Finds the appends of a key that were not folded yet.  The caller holds the delta lock
+ *
+ * @param iter       an iterator of the delta database
+ * @param enc        the encoded key
+ * @param enc_len    the length of the encoded key
+ * @param value      in/out  the value read from the key's record, which the appends are 
+ *                           added to, or NULL to leave the appends out
+ * @param value_len  in/out  the length of the value
+ * @param batch      a write batch the appends are removed with, or NULL to keep them
+ * @return the number of appends found
+ */
+static int find_deltas(leveldb_iterator_t *iter, const char *enc, size_t enc_len, 
+		       char **value, size_t *value_len, leveldb_writebatch_t *batch) {
+	const char *dkey, *dval;
+	size_t dkey_len, dval_len, prefix_len;
+	char *prefix;
+	int found = 0;
+
+	prefix = delta_key((void *) enc, enc_len, 0, &prefix_len);
+	prefix_len -= 8;
+	for (leveldb_iter_seek(iter, prefix, prefix_len); leveldb_iter_valid(iter); 
+	     leveldb_iter_next(iter)) {
+		dkey = leveldb_iter_key(iter, &dkey_len);
+		if (dkey_len != prefix_len + 8 || memcmp(dkey, prefix, prefix_len)) {
+			break;
+		}
+
+		if (value) {
+			dval = leveldb_iter_value(iter, &dval_len);
+			*value = realloc(*value, *value_len + dval_len);
+			memcpy(*value + *value_len, dval, dval_len);
+			*value_len += dval_len;
+		}
+
+		if (batch) {
+			leveldb_writebatch_delete(batch, dkey, dkey_len);
+		}
+
+		found++;
+	}
+
+	free(prefix);
+
+	return found;
+}
+
+/**
+ * drop_deltas
+ * Removes the appends that were not folded yet of keys that were just overwritten or 
+ * deleted.  The caller holds the delta lock as a writer of the main database
+ *
+ * @param mdhimdb      the leveldb handle
+ * @param keys         the keys
+ * @param key_lens     the lengths of the keys
+ * @param found        set to 1 for each key that had appends, NULL to leave out
+ * @param num_records  the number of keys
+ */
+static void drop_deltas(struct mdhim_leveldb_t *mdhimdb, void **keys, int32_t *key_lens, 
+			int *found, int num_records) {
+	leveldb_writebatch_t *delta_batch;
+	leveldb_iterator_t *iter;
+	char buf[LEVELDB_KEY_BUF];
+	const char *enc;
+	size_t len;
+	char *err = NULL;
+	int i, dropped, num;
+
+	if (!mdhimdb->deltas || !__atomic_load_n(&mdhimdb->num_deltas, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	dropped = 0;
+	delta_batch = leveldb_writebatch_create();
+	iter = leveldb_create_iterator(mdhimdb->deltas, mdhimdb->read_options);
+	for (i = 0; i < num_records; i++) {
+		enc = key_encode(mdhimdb, keys[i], key_lens[i], buf, &len);
+		num = find_deltas(iter, enc, len, NULL, NULL, delta_batch);
+		key_release(enc, keys[i], buf);
+		if (num && found) {
+			found[i] = 1;
+		}
+
+		dropped += num;
+	}
+
+	leveldb_iter_destroy(iter);
+	if (dropped) {
+		leveldb_write(mdhimdb->deltas, mdhimdb->write_options, delta_batch, &err);
+	}
+
+	leveldb_writebatch_destroy(delta_batch);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error removing appends in leveldb");
+		return;
+	}
+
+	__atomic_sub_fetch(&mdhimdb->num_deltas, dropped, __ATOMIC_RELEASE);
+}
+
+/**
+ * fold_deltas
+ * Appends the values of the appends in the delta database to their records and 
+ * removes them from the delta database
+ *
+ * @param mdhimdb  the leveldb handle
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+static int fold_deltas(struct mdhim_leveldb_t *mdhimdb) {
+	leveldb_writebatch_t *write_batch, *delta_batch;
+	leveldb_iterator_t *iter;
+	const char *dkey, *dval;
+	size_t dkey_len, dval_len, value_len;
+	char *prefix, *value, *err = NULL;
+	int key_len, folded, pending, ret = MDHIM_SUCCESS;
+
+	if (!mdhimdb->deltas || !__atomic_load_n(&mdhimdb->num_deltas, __ATOMIC_ACQUIRE)) {
+		return MDHIM_SUCCESS;
+	}
+
+	while (pthread_rwlock_wrlock(&mdhimdb->delta_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	folded = pending = 0;
+	write_batch = leveldb_writebatch_create();
+	delta_batch = leveldb_writebatch_create();
+	iter = leveldb_create_iterator(mdhimdb->deltas, mdhimdb->read_options);
+	leveldb_iter_seek_to_first(iter);
+	while (leveldb_iter_valid(iter)) {
+		//Start from the record as it is and add the key's appends, oldest first
+		dkey = leveldb_iter_key(iter, &dkey_len);
+		key_len = delta_key_len(dkey);
+		prefix = malloc(4 + key_len);
+		memcpy(prefix, dkey, 4 + key_len);
+		value_len = 0;
+		value = leveldb_get(mdhimdb->db, mdhimdb->read_options, prefix + 4, key_len, 
+				    &value_len, &err);
+		if (err != NULL) {
+			//The batches gathered so far are dropped, their appends stay for the next fold
+			leveldb_free(err);
+			free(prefix);
+			ret = MDHIM_DB_ERROR;
+			break;
+		}
+
+		while (leveldb_iter_valid(iter)) {
+			dkey = leveldb_iter_key(iter, &dkey_len);
+			if (dkey_len != 4 + key_len + 8 || memcmp(dkey, prefix, 4 + key_len)) {
+				break;
+			}
+
+			dval = leveldb_iter_value(iter, &dval_len);
+			value = realloc(value, value_len + dval_len);
+			memcpy(value + value_len, dval, dval_len);
+			value_len += dval_len;
+			leveldb_writebatch_delete(delta_batch, dkey, dkey_len);
+			pending++;
+			leveldb_iter_next(iter);
+		}
+
+		leveldb_writebatch_put(write_batch, prefix + 4, key_len, value, value_len);
+		free(value);
+		free(prefix);
+		if (pending < LEVELDB_FOLD_BATCH && leveldb_iter_valid(iter)) {
+			continue;
+		}
+
+		/* The records are written before the appends are removed.  A crash in between 
+		   leaves appends that were already folded in the delta database */
+		leveldb_write(mdhimdb->db, mdhimdb->write_options, write_batch, &err);
+		if (err == NULL) {
+			leveldb_write(mdhimdb->deltas, mdhimdb->write_options, delta_batch, &err);
+		}
+		leveldb_writebatch_clear(write_batch);
+		leveldb_writebatch_clear(delta_batch);
+		if (err != NULL) {
+			leveldb_free(err);
+			ret = MDHIM_DB_ERROR;
+			break;
+		}
+
+		folded += pending;
+		pending = 0;
+	}
+
+	leveldb_iter_destroy(iter);
+	leveldb_writebatch_destroy(write_batch);
+	leveldb_writebatch_destroy(delta_batch);
+	__atomic_sub_fetch(&mdhimdb->num_deltas, folded, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(&mdhimdb->delta_lock);
+	if (ret != MDHIM_SUCCESS) {
+		mlog(MDHIM_SERVER_CRIT, "Error folding appends in leveldb");
+	}
+
+	return ret;
+}
+
+/**
+ * begin_write
+ * Keeps folds from running until end_write is called.  The appends waiting for the 
+ * keys written are dropped with drop_deltas instead of folded
+ *
+ * @param mdhimdb  the leveldb handle
+ */
+static void begin_write(struct mdhim_leveldb_t *mdhimdb) {
+	if (!mdhimdb->deltas) {
+		return;
+	}
+
+	while (pthread_rwlock_rdlock(&mdhimdb->delta_lock) == EBUSY) {
+		usleep(10);
+	}
+}
+
+/**
+ * end_write
+ * Lets folds run again after a write to the main database
+ *
+ * @param mdhimdb  the leveldb handle
+ */
+static void end_write(struct mdhim_leveldb_t *mdhimdb) {
+	if (mdhimdb->deltas) {
+		pthread_rwlock_unlock(&mdhimdb->delta_lock);
+	}
+}
+
 /**
  * mdhim_leveldb_open
  * Opens the database
@@ -174,8 +724,14 @@ int mdhim_leveldb_open(void **dbh, void **dbs, char *path, int flags, int key_ty
 	struct mdhim_leveldb_t *mdhimdb;
 	struct mdhim_leveldb_t *statsdb;
 	leveldb_t *db;
+	leveldb_iterator_t *iter;
+	const char *dkey;
+	size_t dkey_len;
+	uint64_t seq;
 	char *err = NULL;
 	char stats_path[PATH_MAX];
+	char deltas_path[PATH_MAX];
+	int i;
 
 	mdhimdb = malloc(sizeof(struct mdhim_leveldb_t));
 	memset(mdhimdb, 0, sizeof(struct mdhim_leveldb_t));
@@ -213,42 +769,14 @@ int mdhim_leveldb_open(void **dbh, void **dbs, char *path, int flags, int key_ty
 	leveldb_options_set_write_buffer_size(statsdb->options, 1024);
 	leveldb_options_set_env(statsdb->options, statsdb->env);
 
-	switch(key_type) {
-	case MDHIM_INT_KEY:
-		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_int_compare, cmp_name);
-		mdhimdb->compare = cmp_int_compare;
-		break;
-	case MDHIM_LONG_INT_KEY:
-		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_lint_compare, cmp_name);
-		mdhimdb->compare = cmp_lint_compare;
-		break;
-	case MDHIM_FLOAT_KEY:
-		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_float_compare, cmp_name);
-		mdhimdb->compare = cmp_float_compare;
-		break;
-	case MDHIM_DOUBLE_KEY:
-		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_double_compare, cmp_name);
-		mdhimdb->compare = cmp_double_compare;
-		break;
-	case MDHIM_STRING_KEY:
-		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_string_compare, cmp_name);
-		mdhimdb->compare = cmp_string_compare;
-		break;
-	default:
-		mdhimdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_byte_compare, cmp_name);
-		mdhimdb->compare = cmp_byte_compare;
-		break;
-	}
-	
-	leveldb_options_set_comparator(mdhimdb->options, mdhimdb->cmp);
-	//Check to see if the given path + "_stat" and the null char will be more than the max
-	if (strlen(path) + 6 > PATH_MAX) {
+	//Check to see if the given path + "_deltas" and the null char will be more than the max
+	if (strlen(path) + 8 > PATH_MAX) {
 		mlog(MDHIM_SERVER_CRIT, "Error opening leveldb database - path provided is too long");
 		return MDHIM_DB_ERROR;
 	}
 
 	//Open the main database
-	db = leveldb_open(mdhimdb->options, path, &err);
+	db = db_open(mdhimdb, path, key_type, &err);
 	mdhimdb->db = db;
 	//Set the output handle
 	*((struct mdhim_leveldb_t **) dbh) = mdhimdb;
@@ -259,10 +787,7 @@ int mdhim_leveldb_open(void **dbh, void **dbs, char *path, int flags, int key_ty
 
 	//Open the stats database
 	sprintf(stats_path, "%s_stats", path);
-	statsdb->compare = cmp_int_compare;
-	statsdb->cmp = leveldb_comparator_create(NULL, cmp_destroy, cmp_int_compare, cmp_name);
-	leveldb_options_set_comparator(statsdb->options, statsdb->cmp);
-	db = leveldb_open(statsdb->options, stats_path, &err);
+	db = db_open(statsdb, stats_path, MDHIM_INT_KEY, &err);
 	statsdb->db = db;
 	*((struct mdhim_leveldb_t **) dbs) = statsdb;
 
@@ -271,6 +796,37 @@ int mdhim_leveldb_open(void **dbh, void **dbs, char *path, int flags, int key_ty
 		return MDHIM_DB_ERROR;
 	}
 
+	//Open the database of the appends that were not folded into their records yet
+	sprintf(deltas_path, "%s_deltas", path);
+	mdhimdb->delta_options = leveldb_options_create();
+	leveldb_options_set_create_if_missing(mdhimdb->delta_options, 1);
+	leveldb_options_set_env(mdhimdb->delta_options, mdhimdb->env);
+	mdhimdb->deltas = leveldb_open(mdhimdb->delta_options, deltas_path, &err);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error opening leveldb database");
+		mdhimdb->deltas = NULL;
+		return MDHIM_DB_ERROR;
+	}
+
+	pthread_rwlock_init(&mdhimdb->delta_lock, NULL);
+
+	//Appends left from the last run are folded by the first read or write, new ones come after them
+	iter = leveldb_create_iterator(mdhimdb->deltas, mdhimdb->read_options);
+	for (leveldb_iter_seek_to_first(iter); leveldb_iter_valid(iter); leveldb_iter_next(iter)) {
+		dkey = leveldb_iter_key(iter, &dkey_len);
+		seq = 0;
+		for (i = (int) dkey_len - 8; i < (int) dkey_len; i++) {
+			seq = (seq << 8) | (unsigned char) dkey[i];
+		}
+
+		if (seq > mdhimdb->delta_seq) {
+			mdhimdb->delta_seq = seq;
+		}
+		mdhimdb->num_deltas++;
+	}
+
+	leveldb_iter_destroy(iter);
+
 	return MDHIM_SUCCESS;
 }
 
@@ -292,10 +848,21 @@ int mdhim_leveldb_put(void *dbh, void *key, int key_len, void *data, int32_t dat
     char *err = NULL;
     struct mdhim_leveldb_t *mdhimdb = (struct mdhim_leveldb_t *) dbh;
     struct timeval start, end;
+    char buf[LEVELDB_KEY_BUF];
+    const char *enc;
+    size_t len;
     
     gettimeofday(&start, NULL);
     options = mdhimdb->write_options;    	    
-    leveldb_put(mdhimdb->db, options, key, key_len, data, data_len, &err);
+    enc = key_encode(mdhimdb, key, key_len, buf, &len);
+    begin_write(mdhimdb);
+    leveldb_put(mdhimdb->db, options, enc, len, data, data_len, &err);
+    //The record replaces the appends made to the key before
+    if (err == NULL) {
+	    drop_deltas(mdhimdb, &key, &key_len, NULL, 1);
+    }
+    end_write(mdhimdb);
+    key_release(enc, key, buf);
     if (err != NULL) {
 	    mlog(MDHIM_SERVER_CRIT, "Error putting key/value in leveldb");
 	    return MDHIM_DB_ERROR;
@@ -329,17 +896,28 @@ int mdhim_leveldb_batch_put(void *dbh, void **keys, int32_t *key_lens,
 	struct mdhim_leveldb_t *mdhimdb = (struct mdhim_leveldb_t *) dbh;
 	struct timeval start, end;
 	leveldb_writebatch_t* write_batch;
+	char buf[LEVELDB_KEY_BUF];
+	const char *enc;
+	size_t len;
 	int i;
 
 	gettimeofday(&start, NULL);
 	write_batch = leveldb_writebatch_create();
 	options = mdhimdb->write_options;   
 	for (i = 0; i < num_records; i++) {
-		leveldb_writebatch_put(write_batch, keys[i], key_lens[i], 
+		enc = key_encode(mdhimdb, keys[i], key_lens[i], buf, &len);
+		leveldb_writebatch_put(write_batch, enc, len, 
 				       data[i], data_lens[i]);
+		key_release(enc, keys[i], buf);
 	}
 
+	begin_write(mdhimdb);
 	leveldb_write(mdhimdb->db, options, write_batch, &err);
+	//The records replace the appends made to their keys before
+	if (err == NULL) {
+		drop_deltas(mdhimdb, keys, key_lens, NULL, num_records);
+	}
+	end_write(mdhimdb);
 	leveldb_writebatch_destroy(write_batch);
 	if (err != NULL) {
 		mlog(MDHIM_SERVER_CRIT, "Error in batch put in leveldb");
@@ -373,10 +951,35 @@ int mdhim_leveldb_get(void *dbh, void *key, int key_len, void **data, int32_t *d
 	int ret = MDHIM_SUCCESS;
 	void *ldb_data;
 	size_t ldb_data_len = 0;
+	leveldb_iterator_t *iter;
+	char buf[LEVELDB_KEY_BUF];
+	const char *enc;
+	size_t len;
 
 	options = mdhimdb->read_options;
 	*data = NULL;
-	ldb_data = leveldb_get(mdhimdb->db, options, key, key_len, &ldb_data_len, &err);
+	enc = key_encode(mdhimdb, key, key_len, buf, &len);
+	//Folds can't move the key's appends into its record while they are read
+	if (mdhimdb->deltas) {
+		while (pthread_rwlock_rdlock(&mdhimdb->delta_lock) == EBUSY) {
+			usleep(10);
+		}
+	}
+
+	ldb_data = leveldb_get(mdhimdb->db, options, enc, len, &ldb_data_len, &err);
+	//The appends that were not folded yet are added to the value, not written back
+	if (err == NULL && mdhimdb->deltas && 
+	    __atomic_load_n(&mdhimdb->num_deltas, __ATOMIC_ACQUIRE)) {
+		iter = leveldb_create_iterator(mdhimdb->deltas, mdhimdb->read_options);
+		find_deltas(iter, enc, len, (char **) &ldb_data, &ldb_data_len, NULL);
+		leveldb_iter_destroy(iter);
+	}
+
+	if (mdhimdb->deltas) {
+		pthread_rwlock_unlock(&mdhimdb->delta_lock);
+	}
+
+	key_release(enc, key, buf);
 	if (err != NULL) {
 		mlog(MDHIM_SERVER_CRIT, "Error getting value in leveldb");
 		return MDHIM_DB_ERROR;
@@ -395,6 +998,289 @@ int mdhim_leveldb_get(void *dbh, void *key, int key_len, void **data, int32_t *d
 	return ret;
 }
 
+/* A key of a batch get with its position in the batch, sorted in the order of the database */
+struct batch_get_key {
+	const char *key;
+	size_t key_len;
+	int pos;
+	mdhim_store_cmp_fn_t compare;
+};
+
+static int batch_get_key_cmp(const void *a, const void *b) {
+	const struct batch_get_key *ka = (const struct batch_get_key *) a;
+	const struct batch_get_key *kb = (const struct batch_get_key *) b;
+
+	return ka->compare(NULL, ka->key, ka->key_len, kb->key, kb->key_len);
+}
+
+/* Sorts the encoded keys of a batch in the order of the database */
+static struct batch_get_key *batch_sort_keys(struct mdhim_leveldb_t *mdhimdb, void **keys, 
+					     int32_t *key_lens, int num_records) {
+	struct batch_get_key *sorted;
+	int i;
+
+	sorted = malloc(sizeof(struct batch_get_key) * num_records);
+	for (i = 0; i < num_records; i++) {
+		sorted[i].key = key_encode(mdhimdb, keys[i], key_lens[i], NULL, 
+					   &sorted[i].key_len);
+		sorted[i].pos = i;
+		sorted[i].compare = mdhimdb->compare;
+	}
+
+	qsort(sorted, num_records, sizeof(struct batch_get_key), batch_get_key_cmp);
+
+	return sorted;
+}
+
+/* Frees the sorted keys of a batch */
+static void batch_free_keys(struct batch_get_key *sorted, void **keys, int num_records) {
+	int i;
+
+	for (i = 0; i < num_records; i++) {
+		key_release(sorted[i].key, keys[sorted[i].pos], NULL);
+	}
+
+	free(sorted);
+}
+
+/* Positions the iterator on a key of a sorted batch, stepping towards the key while 
+   it is close and seeking to it otherwise.  Returns whether the key was found */
+static int batch_find_key(struct mdhim_leveldb_t *mdhimdb, leveldb_iterator_t *iter, 
+			  struct batch_get_key *bkey, int first) {
+	const char *res;
+	size_t len;
+	int steps, cmp;
+
+	cmp = -1;
+	for (steps = 0; !first && steps < LEVELDB_BATCH_GET_STEPS && 
+		     leveldb_iter_valid(iter); steps++) {
+		res = leveldb_iter_key(iter, &len);
+		cmp = mdhimdb->compare(NULL, res, len, bkey->key, bkey->key_len);
+		if (cmp >= 0) {
+			break;
+		}
+
+		leveldb_iter_next(iter);
+	}
+
+	if (cmp < 0) {
+		leveldb_iter_seek(iter, bkey->key, bkey->key_len);
+	}
+
+	if (!leveldb_iter_valid(iter)) {
+		return 0;
+	}
+
+	res = leveldb_iter_key(iter, &len);
+
+	return mdhimdb->compare(NULL, res, len, bkey->key, bkey->key_len) == 0;
+}
+
+/**
+ * mdhim_leveldb_batch_get
+ * Gets the values of several keys from one snapshot of the data store
+ *
+ * The keys are read in sorted order with one iterator.  The iterator steps to the next 
+ * key when the keys are dense and seeks to it when it is more than a few records away
+ *
+ * @param dbh          in   pointer to the leveldb db handle
+ * @param keys         in   void ** to the keys to retrieve the values of
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         out  void ** to the values of the keys, NULL for keys not found
+ * @param data_lens    out  int32_t * to the lengths of the values, 0 for keys not found
+ * @param num_records  in   the number of keys
+ * 
+ * @return MDHIM_SUCCESS if every key was found or MDHIM_DB_ERROR otherwise
+ */
+int mdhim_leveldb_batch_get(void *dbh, void **keys, int32_t *key_lens, 
+			    void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_leveldb_t *mdhimdb = (struct mdhim_leveldb_t *) dbh;
+	const leveldb_snapshot_t *snapshot, *delta_snapshot;
+	leveldb_readoptions_t *options, *delta_options;
+	leveldb_iterator_t *iter, *delta_iter;
+	struct batch_get_key *sorted;
+	const char *res;
+	char *value;
+	size_t value_len;
+	int ret = MDHIM_SUCCESS;
+	int i;
+
+	for (i = 0; i < num_records; i++) {
+		data[i] = NULL;
+		data_lens[i] = 0;
+	}
+
+	sorted = batch_sort_keys(mdhimdb, keys, key_lens, num_records);
+	//Folds can't move the keys' appends into their records while they are read
+	if (mdhimdb->deltas) {
+		while (pthread_rwlock_rdlock(&mdhimdb->delta_lock) == EBUSY) {
+			usleep(10);
+		}
+	}
+
+	snapshot = leveldb_create_snapshot(mdhimdb->db);
+	options = leveldb_readoptions_create();
+	leveldb_readoptions_set_snapshot(options, snapshot);
+	iter = leveldb_create_iterator(mdhimdb->db, options);
+	//The appends are read from a snapshot of the delta database taken with the other one
+	delta_iter = NULL;
+	delta_snapshot = NULL;
+	delta_options = NULL;
+	if (mdhimdb->deltas && __atomic_load_n(&mdhimdb->num_deltas, __ATOMIC_ACQUIRE)) {
+		delta_snapshot = leveldb_create_snapshot(mdhimdb->deltas);
+		delta_options = leveldb_readoptions_create();
+		leveldb_readoptions_set_snapshot(delta_options, delta_snapshot);
+		delta_iter = leveldb_create_iterator(mdhimdb->deltas, delta_options);
+	}
+
+	for (i = 0; i < num_records; i++) {
+		value = NULL;
+		value_len = 0;
+		//The value is copied once, from the iterator's block
+		if (batch_find_key(mdhimdb, iter, &sorted[i], !i)) {
+			res = leveldb_iter_value(iter, &value_len);
+			value = malloc(value_len ? value_len : 1);
+			memcpy(value, res, value_len);
+		}
+
+		//The appends that were not folded yet are added to the value, not written back
+		if (delta_iter) {
+			find_deltas(delta_iter, sorted[i].key, sorted[i].key_len, 
+				    &value, &value_len, NULL);
+		}
+
+		if (!value_len) {
+			free(value);
+			ret = MDHIM_DB_ERROR;
+			continue;
+		}
+
+		data[sorted[i].pos] = value;
+		data_lens[sorted[i].pos] = value_len;
+	}
+
+	if (delta_iter) {
+		leveldb_iter_destroy(delta_iter);
+		leveldb_readoptions_destroy(delta_options);
+		leveldb_release_snapshot(mdhimdb->deltas, delta_snapshot);
+	}
+
+	leveldb_iter_destroy(iter);
+	leveldb_readoptions_destroy(options);
+	leveldb_release_snapshot(mdhimdb->db, snapshot);
+	if (mdhimdb->deltas) {
+		pthread_rwlock_unlock(&mdhimdb->delta_lock);
+	}
+
+	batch_free_keys(sorted, keys, num_records);
+
+	return ret;
+}
+
+/**
+ * mdhim_leveldb_batch_append
+ * Appends values to the records of several keys without reading the records.  The 
+ * appends are folded into the records by the next read or write of the main database
+ *
+ * @param dbh          in     pointer to the leveldb handle
+ * @param keys         in     void ** to the keys to append to
+ * @param key_lens     in     int32_t * to the lengths of the keys
+ * @param data         in     void ** to the values to append
+ * @param data_lens    in     int32_t * to the lengths of the values
+ * @param exists       in/out int * set to whether each key had a record or appends before, 
+ *                            only looked up for keys it is 1 for.  NULL to look up nothing
+ * @param num_records  in     int for the number of records to append to
+ * 
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_leveldb_batch_append(void *dbh, void **keys, int32_t *key_lens, 
+			       void **data, int32_t *data_lens, int *exists, int num_records) {
+	struct mdhim_leveldb_t *mdhimdb = (struct mdhim_leveldb_t *) dbh;
+	leveldb_writebatch_t *write_batch;
+	leveldb_iterator_t *iter, *delta_iter;
+	struct batch_get_key *sorted;
+	const char *res, *enc;
+	size_t len, dkey_len;
+	char *dkey;
+	char buf[LEVELDB_KEY_BUF];
+	uint64_t seq;
+	char *err = NULL;
+	int i, pos, first;
+
+	if (!mdhimdb->deltas) {
+		return MDHIM_DB_ERROR;
+	}
+
+	//Folds can't move appends out of the delta database while the keys are looked up
+	while (pthread_rwlock_rdlock(&mdhimdb->delta_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	//A key exists if it has a record or appends that were not folded yet
+	if (exists) {
+		sorted = batch_sort_keys(mdhimdb, keys, key_lens, num_records);
+		iter = leveldb_create_iterator(mdhimdb->db, mdhimdb->read_options);
+		delta_iter = leveldb_create_iterator(mdhimdb->deltas, mdhimdb->read_options);
+		first = 1;
+		for (i = 0; i < num_records; i++) {
+			pos = sorted[i].pos;
+			if (!exists[pos]) {
+				continue;
+			}
+
+			exists[pos] = batch_find_key(mdhimdb, iter, &sorted[i], first);
+			first = 0;
+			if (exists[pos] || !__atomic_load_n(&mdhimdb->num_deltas, __ATOMIC_ACQUIRE)) {
+				continue;
+			}
+
+			dkey = delta_key((void *) sorted[i].key, sorted[i].key_len, 0, &dkey_len);
+			leveldb_iter_seek(delta_iter, dkey, dkey_len - 8);
+			if (leveldb_iter_valid(delta_iter)) {
+				res = leveldb_iter_key(delta_iter, &len);
+				exists[pos] = len == dkey_len && !memcmp(res, dkey, dkey_len - 8);
+			}
+
+			free(dkey);
+		}
+
+		leveldb_iter_destroy(delta_iter);
+		leveldb_iter_destroy(iter);
+		batch_free_keys(sorted, keys, num_records);
+	}
+
+	write_batch = leveldb_writebatch_create();
+	seq = __atomic_add_fetch(&mdhimdb->delta_seq, num_records, __ATOMIC_RELAXED) - num_records;
+	for (i = 0; i < num_records; i++) {
+		enc = key_encode(mdhimdb, keys[i], key_lens[i], buf, &len);
+		dkey = delta_key((void *) enc, len, ++seq, &dkey_len);
+		key_release(enc, keys[i], buf);
+		leveldb_writebatch_put(write_batch, dkey, dkey_len, data[i], data_lens[i]);
+		free(dkey);
+	}
+
+	//Counted first, so a read that starts once the appends are written folds them
+	__atomic_add_fetch(&mdhimdb->num_deltas, num_records, __ATOMIC_RELEASE);
+	leveldb_write(mdhimdb->deltas, mdhimdb->write_options, write_batch, &err);
+	leveldb_writebatch_destroy(write_batch);
+	if (err != NULL) {
+		__atomic_sub_fetch(&mdhimdb->num_deltas, num_records, __ATOMIC_RELEASE);
+	}
+
+	pthread_rwlock_unlock(&mdhimdb->delta_lock);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error in batch append in leveldb");
+		return MDHIM_DB_ERROR;
+	}
+
+	//Point reads and writes leave the appends, so they are folded once enough pile up
+	if (__atomic_load_n(&mdhimdb->num_deltas, __ATOMIC_ACQUIRE) >= LEVELDB_FOLD_THRESHOLD) {
+		fold_deltas(mdhimdb);
+	}
+
+	return MDHIM_SUCCESS;
+}
+
 /**
  * mdhim_leveldb_get_next
  * Gets the next key/value from the data store
@@ -417,11 +1303,15 @@ int mdhim_leveldb_get_next(void *dbh, void **key, int *key_len,
 	int len = 0;
 	void *old_key;
 	int old_key_len;
+	char buf[LEVELDB_KEY_BUF];
+	const char *enc;
+	size_t enc_len, klen;
 	struct timeval start, end;
 
 	//Init the data to return
 	*data = NULL;
 	*data_len = 0;
+	fold_deltas(mdhimdb);
 
 	gettimeofday(&start, NULL);
 	//Create the options and iterator
@@ -430,6 +1320,7 @@ int mdhim_leveldb_get_next(void *dbh, void **key, int *key_len,
 	old_key_len = *key_len;
 	*key = NULL;
 	*key_len = 0;
+	enc = key_encode(mdhimdb, old_key, old_key_len, buf, &enc_len);
 
 	iter = leveldb_create_iterator(mdhimdb->db, options);
 
@@ -439,12 +1330,12 @@ int mdhim_leveldb_get_next(void *dbh, void **key, int *key_len,
 	} else {
 		/* Seek to the passed in key.  If that doesn't exist, iterate until we find one greater
 		   or until we exhaust the keys.*/
-		leveldb_iter_seek(iter, old_key, old_key_len);
+		leveldb_iter_seek(iter, enc, enc_len);
 		if (!leveldb_iter_valid(iter)) { 
 			leveldb_iter_seek_to_first(iter);
 			while(leveldb_iter_valid(iter)) {
 				res = leveldb_iter_key(iter, (size_t *) &len);
-				if (mdhimdb->compare(NULL, res, len, old_key, old_key_len) > 0) {
+				if (mdhimdb->compare(NULL, res, len, enc, enc_len) > 0) {
 					break;
 				}
 				
@@ -455,6 +1346,7 @@ int mdhim_leveldb_get_next(void *dbh, void **key, int *key_len,
 		}
 	}
 
+	key_release(enc, old_key, buf);
 	if (!leveldb_iter_valid(iter)) {
 		goto error;
 	}
@@ -469,10 +1361,9 @@ int mdhim_leveldb_get_next(void *dbh, void **key, int *key_len,
 		*data_len = 0;
 	}
 
-	res = leveldb_iter_key(iter, (size_t *) key_len);
+	res = leveldb_iter_key(iter, &klen);
 	if (res) {
-		*key = malloc(*key_len);
-		memcpy(*key, res, *key_len);
+		key_decode(mdhimdb, res, klen, key, key_len);
 	} else {
 		*key = NULL;
 		*key_len = 0;
@@ -522,11 +1413,15 @@ int mdhim_leveldb_get_prev(void *dbh, void **key, int *key_len,
 	int len = 0;
 	void *old_key;
 	int old_key_len;
+	char buf[LEVELDB_KEY_BUF];
+	const char *enc;
+	size_t enc_len, klen;
 	struct timeval start, end;
 
 	//Init the data to return
 	*data = NULL;
 	*data_len = 0;
+	fold_deltas(mdhimdb);
 
 	gettimeofday(&start, NULL);
 
@@ -536,6 +1431,7 @@ int mdhim_leveldb_get_prev(void *dbh, void **key, int *key_len,
 	old_key_len = *key_len;
 	*key = NULL;
 	*key_len = 0;
+	enc = key_encode(mdhimdb, old_key, old_key_len, buf, &enc_len);
 
 	iter = leveldb_create_iterator(mdhimdb->db, options);
 
@@ -543,12 +1439,12 @@ int mdhim_leveldb_get_prev(void *dbh, void **key, int *key_len,
 	if (!old_key || old_key_len == 0) {
 		leveldb_iter_seek_to_last(iter);
 	} else {
-		leveldb_iter_seek(iter, old_key, old_key_len);
+		leveldb_iter_seek(iter, enc, enc_len);
 		if (!leveldb_iter_valid(iter)) { 
 			leveldb_iter_seek_to_last(iter);
 			while(leveldb_iter_valid(iter)) {
 				res = leveldb_iter_key(iter, (size_t *) &len);
-				if (mdhimdb->compare(NULL, res, len, old_key, old_key_len) < 0) {
+				if (mdhimdb->compare(NULL, res, len, enc, enc_len) < 0) {
 					break;
 				}
 				
@@ -559,6 +1455,7 @@ int mdhim_leveldb_get_prev(void *dbh, void **key, int *key_len,
 		}
 	}
 
+	key_release(enc, old_key, buf);
 	if (!leveldb_iter_valid(iter)) {
 		goto error;
 	}
@@ -573,10 +1470,9 @@ int mdhim_leveldb_get_prev(void *dbh, void **key, int *key_len,
 		*data_len = 0;
 	}
 
-	res = leveldb_iter_key(iter, (size_t *) key_len);
+	res = leveldb_iter_key(iter, &klen);
 	if (res) {
-		*key = malloc(*key_len);
-		memcpy(*key, res, *key_len);
+		key_decode(mdhimdb, res, klen, key, key_len);
 	} else {
 		*key = NULL;
 		*key_len = 0;
@@ -618,16 +1514,24 @@ int mdhim_leveldb_close(void *dbh, void *dbs) {
 	struct mdhim_leveldb_t *statsdb = (struct mdhim_leveldb_t *) dbs;
 
 	//Close the databases
+	fold_deltas(mdhimdb);
+	leveldb_close(mdhimdb->deltas);
+	leveldb_options_destroy(mdhimdb->delta_options);
+	pthread_rwlock_destroy(&mdhimdb->delta_lock);
 	leveldb_close(mdhimdb->db);
 	leveldb_close(statsdb->db);
 
 	//Destroy the options
-	leveldb_comparator_destroy(mdhimdb->cmp);
+	if (mdhimdb->cmp) {
+		leveldb_comparator_destroy(mdhimdb->cmp);
+	}
 	leveldb_options_destroy(mdhimdb->options);
 	leveldb_readoptions_destroy(mdhimdb->read_options);
 	leveldb_writeoptions_destroy(mdhimdb->write_options);
 	leveldb_filterpolicy_destroy(mdhimdb->filter);
-	leveldb_comparator_destroy(statsdb->cmp);
+	if (statsdb->cmp) {
+		leveldb_comparator_destroy(statsdb->cmp);
+	}
 	leveldb_options_destroy(statsdb->options);
 	leveldb_readoptions_destroy(statsdb->read_options);
 	leveldb_writeoptions_destroy(statsdb->write_options);
@@ -654,9 +1558,19 @@ int mdhim_leveldb_del(void *dbh, void *key, int key_len) {
 	leveldb_writeoptions_t *options;
 	char *err = NULL;
 	struct mdhim_leveldb_t *mdhimdb = (struct mdhim_leveldb_t *) dbh;
+	char buf[LEVELDB_KEY_BUF];
+	const char *enc;
+	size_t len;
 	
 	options = mdhimdb->write_options;
-	leveldb_delete(mdhimdb->db, options, key, key_len, &err);
+	enc = key_encode(mdhimdb, key, key_len, buf, &len);
+	begin_write(mdhimdb);
+	leveldb_delete(mdhimdb->db, options, enc, len, &err);
+	if (err == NULL) {
+		drop_deltas(mdhimdb, &key, &key_len, NULL, 1);
+	}
+	end_write(mdhimdb);
+	key_release(enc, key, buf);
 	if (err != NULL) {
 		mlog(MDHIM_SERVER_CRIT, "Error deleting key in leveldb");
 		return MDHIM_DB_ERROR;
@@ -665,6 +1579,69 @@ int mdhim_leveldb_del(void *dbh, void *key, int key_len) {
 	return MDHIM_SUCCESS;
 }
 
+/**
+ * mdhim_leveldb_batch_del
+ * Deletes several keys with one write batch
+ *
+ * @param dbh          in   pointer to the leveldb db handle
+ * @param keys         in   void ** to the keys to delete
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param found        out  int * set to whether each key was in the data store before 
+ *                          the delete, NULL to delete without looking the keys up
+ * @param num_records  in   the number of keys
+ * 
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_leveldb_batch_del(void *dbh, void **keys, int32_t *key_lens, 
+			    int *found, int num_records) {
+	struct mdhim_leveldb_t *mdhimdb = (struct mdhim_leveldb_t *) dbh;
+	leveldb_writebatch_t *write_batch;
+	leveldb_iterator_t *iter;
+	struct batch_get_key *sorted;
+	char buf[LEVELDB_KEY_BUF];
+	const char *enc;
+	size_t len;
+	char *err = NULL;
+	int i;
+
+	begin_write(mdhimdb);
+
+	//Find the keys that are there in sorted order, like a batch get
+	if (found) {
+		sorted = batch_sort_keys(mdhimdb, keys, key_lens, num_records);
+		iter = leveldb_create_iterator(mdhimdb->db, mdhimdb->read_options);
+		for (i = 0; i < num_records; i++) {
+			found[sorted[i].pos] = batch_find_key(mdhimdb, iter, &sorted[i], !i);
+		}
+
+		leveldb_iter_destroy(iter);
+		batch_free_keys(sorted, keys, num_records);
+	}
+
+	write_batch = leveldb_writebatch_create();
+	for (i = 0; i < num_records; i++) {
+		if (!found || found[i]) {
+			enc = key_encode(mdhimdb, keys[i], key_lens[i], buf, &len);
+			leveldb_writebatch_delete(write_batch, enc, len);
+			key_release(enc, keys[i], buf);
+		}
+	}
+
+	leveldb_write(mdhimdb->db, mdhimdb->write_options, write_batch, &err);
+	//Keys with only appends that were not folded yet were there too
+	if (err == NULL) {
+		drop_deltas(mdhimdb, keys, key_lens, found, num_records);
+	}
+	end_write(mdhimdb);
+	leveldb_writebatch_destroy(write_batch);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error in batch delete in leveldb");
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
 /**
  * mdhim_leveldb_commit
  * Commits outstanding writes the data store
@@ -676,3 +1653,145 @@ int mdhim_leveldb_del(void *dbh, void *key, int key_len) {
 int mdhim_leveldb_commit(void *dbh) {
 	return MDHIM_SUCCESS;
 }
+
+/**
+ * mdhim_leveldb_cursor_open
+ * Opens a cursor on a snapshot of the data store
+ *
+ * @param dbh     in   pointer to the leveldb handle
+ * @param cursor  out  pointer to the opened cursor
+ * 
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_leveldb_cursor_open(void *dbh, void **cursor) {
+	struct mdhim_leveldb_t *mdhimdb = (struct mdhim_leveldb_t *) dbh;
+	struct mdhim_leveldb_cursor_t *cur;
+
+	*cursor = NULL;
+	cur = malloc(sizeof(struct mdhim_leveldb_cursor_t));
+	if (!cur) {
+		return MDHIM_DB_ERROR;
+	}
+
+	fold_deltas(mdhimdb);
+	cur->mdhimdb = mdhimdb;
+	cur->snapshot = leveldb_create_snapshot(mdhimdb->db);
+	cur->read_options = leveldb_readoptions_create();
+	leveldb_readoptions_set_snapshot(cur->read_options, cur->snapshot);
+	cur->iter = leveldb_create_iterator(mdhimdb->db, cur->read_options);
+	*cursor = cur;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_leveldb_cursor_seek
+ * Positions the cursor on the given key
+ *
+ * @param cursor  in   pointer to the cursor
+ * @param key     in   void * to the key to position the cursor on, NULL for the first key
+ * @param key_len in   int for the length of the key
+ * @param op      in   MDHIM_GET_EQ to position on the key itself or 
+ *                     MDHIM_GET_NEXT to position on the first key not before it
+ * 
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no such key in the snapshot
+ */
+int mdhim_leveldb_cursor_seek(void *cursor, void *key, int key_len, int op) {
+	struct mdhim_leveldb_cursor_t *cur = (struct mdhim_leveldb_cursor_t *) cursor;
+	char buf[LEVELDB_KEY_BUF];
+	const char *res, *enc;
+	size_t len = 0, enc_len;
+	int ret = MDHIM_SUCCESS;
+
+	if (!key || !key_len) {
+		leveldb_iter_seek_to_first(cur->iter);
+		return leveldb_iter_valid(cur->iter) ? MDHIM_SUCCESS : MDHIM_DB_ERROR;
+	}
+
+	enc = key_encode(cur->mdhimdb, key, key_len, buf, &enc_len);
+	leveldb_iter_seek(cur->iter, enc, enc_len);
+	if (!leveldb_iter_valid(cur->iter)) {
+		ret = MDHIM_DB_ERROR;
+	} else if (op == MDHIM_GET_EQ) {
+		res = leveldb_iter_key(cur->iter, &len);
+		if (cur->mdhimdb->compare(NULL, res, len, enc, enc_len) != 0) {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+
+	key_release(enc, key, buf);
+
+	return ret;
+}
+
+/**
+ * mdhim_leveldb_cursor_get
+ * Gets the record under the cursor after moving it as the operation says
+ *
+ * @param cursor   in   pointer to the cursor
+ * @param op       in   MDHIM_GET_EQ to read the current record, MDHIM_GET_NEXT or 
+ *                      MDHIM_GET_PREV to move the cursor first
+ * @param key      out  void ** to the key that we get
+ * @param key_len  out  int * to the length of the key 
+ * @param data     out  void ** to the value belonging to the key
+ * @param data_len out  int * to the length of the value data 
+ * 
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if the cursor ran off the store
+ */
+int mdhim_leveldb_cursor_get(void *cursor, int op, void **key, int *key_len,
+			     void **data, int32_t *data_len) {
+	struct mdhim_leveldb_cursor_t *cur = (struct mdhim_leveldb_cursor_t *) cursor;
+	const char *res;
+	size_t len = 0;
+
+	*key = NULL;
+	*key_len = 0;
+	*data = NULL;
+	*data_len = 0;
+
+	if (!leveldb_iter_valid(cur->iter)) {
+		return MDHIM_DB_ERROR;
+	}
+
+	if (op == MDHIM_GET_NEXT) {
+		leveldb_iter_next(cur->iter);
+	} else if (op == MDHIM_GET_PREV) {
+		leveldb_iter_prev(cur->iter);
+	}
+
+	if (!leveldb_iter_valid(cur->iter)) {
+		return MDHIM_DB_ERROR;
+	}
+
+	res = leveldb_iter_value(cur->iter, &len);
+	if (!res) {
+		return MDHIM_DB_ERROR;
+	}
+
+	*data = malloc(len);
+	memcpy(*data, res, len);
+	*data_len = len;
+	res = leveldb_iter_key(cur->iter, &len);
+	key_decode(cur->mdhimdb, res, len, key, key_len);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_leveldb_cursor_close
+ * Closes the cursor and releases its snapshot
+ *
+ * @param cursor  in   pointer to the cursor
+ */
+void mdhim_leveldb_cursor_close(void *cursor) {
+	struct mdhim_leveldb_cursor_t *cur = (struct mdhim_leveldb_cursor_t *) cursor;
+
+	if (!cur) {
+		return;
+	}
+
+	leveldb_iter_destroy(cur->iter);
+	leveldb_readoptions_destroy(cur->read_options);
+	leveldb_release_snapshot(cur->mdhimdb->db, cur->snapshot);
+	free(cur);
+}
@@ -1,16 +1,25 @@
 #ifndef      __LEVELDB_H
 #define      __LEVELDB_H
 
-#ifndef      LEVELDB_SUPPORT
-#include <rocksdb/c.h>
-#else
 #include <leveldb/c.h>
-#endif
 
 #include "mdhim.h"
 #include "partitioner.h"
 #include "data_store.h"
 
+//Records the iterator of a batch get or delete steps over before it seeks to the next key
+#define LEVELDB_BATCH_GET_STEPS 8
+//Appends folded into their records with each write of a fold
+#define LEVELDB_FOLD_BATCH 1024
+//Appends left unfolded before an append folds them all
+#define LEVELDB_FOLD_THRESHOLD 65536
+//Longest encoded key kept on the stack instead of allocated
+#define LEVELDB_KEY_BUF 64
+//Last byte of an encoded string key that ended without a null character
+#define LEVELDB_STRING_NO_NULL 0
+//Last byte of an encoded string key that had a null character
+#define LEVELDB_STRING_NULL 1
+
 /* Function pointer for comparator in C */
 typedef int (*mdhim_store_cmp_fn_t)(void* arg, const char* a, size_t alen,
 				    const char* b, size_t blen);
@@ -25,17 +34,51 @@ struct mdhim_leveldb_t {
 	leveldb_writeoptions_t *write_options;
 	leveldb_readoptions_t *read_options;
 	mdhim_store_cmp_fn_t compare;
+	int key_type;
+	/* Keys are stored in a byte form that sorts like the keys, so the database's own
+	   bytewise comparator is used.  0 for databases made with the old comparators */
+	int encoded;
+	/* Appends are written to the delta database without reading the records they append 
+	   to.  Delta keys are the key's length, the key and a sequence number, so the appends 
+	   of a key are next to each other in the order they were made.  Gets add a key's appends 
+	   to the value they return and writes drop the appends of the keys they write.  Ordered 
+	   reads fold all the appends into the records, as do appends once there are 
+	   LEVELDB_FOLD_THRESHOLD of them */
+	leveldb_t *deltas;             //NULL for the stats database
+	leveldb_options_t *delta_options;
+	pthread_rwlock_t delta_lock;   //Held to fold, shared by writes so folds don't race them
+	uint64_t delta_seq;            //Sequence number of the last append
+	int num_deltas;                //Number of appends that are not folded yet
+};
+
+//A cursor reads from a snapshot of the database taken when it was opened
+struct mdhim_leveldb_cursor_t {
+	struct mdhim_leveldb_t *mdhimdb;
+	const leveldb_snapshot_t *snapshot;
+	leveldb_readoptions_t *read_options;
+	leveldb_iterator_t *iter;
 };
 int mdhim_leveldb_open(void **dbh, void **dbs, char *path, int flags, int key_type, struct mdhim_options_t	*opts);
 int mdhim_leveldb_put(void *dbh, void *key, int key_len, void *data, int32_t data_len);
 int mdhim_leveldb_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len);
+int mdhim_leveldb_batch_get(void *dbh, void **keys, int32_t *key_lens, 
+			    void **data, int32_t *data_lens, int num_records);
 int mdhim_leveldb_get_next(void *dbh, void **key, int *key_len, 
 			   void **data, int32_t *data_len);
 int mdhim_leveldb_get_prev(void *dbh, void **key, int *key_len, 
 			   void **data, int32_t *data_len);
 int mdhim_leveldb_close(void *dbh, void *dbs);
 int mdhim_leveldb_del(void *dbh, void *key, int key_len);
+int mdhim_leveldb_batch_del(void *dbh, void **keys, int32_t *key_lens, 
+			    int *found, int num_records);
 int mdhim_leveldb_commit(void *dbh);
 int mdhim_leveldb_batch_put(void *dbh, void **key, int32_t *key_lens, 
 			    void **data, int32_t *data_lens, int num_records);
+int mdhim_leveldb_batch_append(void *dbh, void **keys, int32_t *key_lens, 
+			       void **data, int32_t *data_lens, int *exists, int num_records);
+int mdhim_leveldb_cursor_open(void *dbh, void **cursor);
+int mdhim_leveldb_cursor_seek(void *cursor, void *key, int key_len, int op);
+int mdhim_leveldb_cursor_get(void *cursor, int op, void **key, int *key_len,
+			     void **data, int32_t *data_len);
+void mdhim_leveldb_cursor_close(void *cursor);
 #endif
@@ -0,0 +1,856 @@
+/*
+ * MDHIM TNG
+ *
+ * In memory data store
+ *
+ * The records are kept in a skiplist ordered like the keys of the index.  Readers share the
+ * skiplist and writers have it to themselves.  With the db_snapshot option, the records are
+ * written to a file when the data store is closed and read back when it is opened again
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <linux/limits.h>
+#include "ds_memory.h"
+
+/**
+ * node_create
+ * Creates a record of the skiplist without a key or value
+ *
+ * @param height  the number of levels the record is on
+ * @return the record
+ */
+static struct mdhim_memory_node_t *node_create(int height) {
+	struct mdhim_memory_node_t *node;
+
+	node = malloc(sizeof(struct mdhim_memory_node_t) +
+		      height * sizeof(struct mdhim_memory_node_t *));
+	memset(node, 0, sizeof(struct mdhim_memory_node_t) +
+	       height * sizeof(struct mdhim_memory_node_t *));
+	node->height = height;
+
+	return node;
+}
+
+static void node_destroy(struct mdhim_memory_node_t *node) {
+	free(node->key);
+	free(node->data);
+	free(node);
+}
+
+/**
+ * memory_create
+ * Creates an empty skiplist
+ *
+ * @param key_type  the type of the keys, which decides their order
+ * @return the skiplist
+ */
+static struct mdhim_memory_t *memory_create(int key_type) {
+	struct mdhim_memory_t *memdb;
+
+	memdb = malloc(sizeof(struct mdhim_memory_t));
+	memset(memdb, 0, sizeof(struct mdhim_memory_t));
+	memdb->head = node_create(MEMORYDB_MAX_HEIGHT);
+	memdb->height = 1;
+	memdb->key_type = key_type;
+	memdb->seed = (unsigned int) time(NULL) ^ (unsigned int) (unsigned long) memdb;
+	pthread_rwlock_init(&memdb->lock, NULL);
+
+	return memdb;
+}
+
+static void memory_destroy(struct mdhim_memory_t *memdb) {
+	struct mdhim_memory_node_t *node, *next;
+
+	for (node = memdb->head->next[0]; node; node = next) {
+		next = node->next[0];
+		node_destroy(node);
+	}
+
+	free(memdb->head);
+	pthread_rwlock_destroy(&memdb->lock);
+	free(memdb->path);
+	free(memdb);
+}
+
+static void memory_rdlock(struct mdhim_memory_t *memdb) {
+	while (pthread_rwlock_rdlock(&memdb->lock) == EBUSY) {
+		usleep(10);
+	}
+}
+
+static void memory_wrlock(struct mdhim_memory_t *memdb) {
+	while (pthread_rwlock_wrlock(&memdb->lock) == EBUSY) {
+		usleep(10);
+	}
+}
+
+/**
+ * find_ge
+ * Finds the first record not before the key
+ *
+ * @param memdb    the skiplist
+ * @param key      the key
+ * @param key_len  the length of the key
+ * @param prev     out  the last record before the key on each level in use, may be NULL
+ * @return the record or NULL if every record is before the key
+ */
+static struct mdhim_memory_node_t *find_ge(struct mdhim_memory_t *memdb, void *key, int key_len,
+					   struct mdhim_memory_node_t **prev) {
+	struct mdhim_memory_node_t *node;
+	int level;
+
+	node = memdb->head;
+	for (level = memdb->height - 1; level >= 0; level--) {
+		while (node->next[level] &&
+		       compare_keys(memdb->key_type, node->next[level]->key,
+				    node->next[level]->key_len, key, key_len) < 0) {
+			node = node->next[level];
+		}
+
+		if (prev) {
+			prev[level] = node;
+		}
+	}
+
+	return node->next[0];
+}
+
+/**
+ * find_last
+ * Finds the last record of the skiplist
+ *
+ * @param memdb    the skiplist
+ * @return the record or NULL if the skiplist is empty
+ */
+static struct mdhim_memory_node_t *find_last(struct mdhim_memory_t *memdb) {
+	struct mdhim_memory_node_t *node;
+	int level;
+
+	node = memdb->head;
+	for (level = memdb->height - 1; level >= 0; level--) {
+		while (node->next[level]) {
+			node = node->next[level];
+		}
+	}
+
+	return node == memdb->head ? NULL : node;
+}
+
+static int is_key(struct mdhim_memory_t *memdb, struct mdhim_memory_node_t *node,
+		  void *key, int key_len) {
+	return node && !compare_keys(memdb->key_type, node->key, node->key_len, key, key_len);
+}
+
+/**
+ * memory_put
+ * Stores a record in the skiplist.  The caller holds the write lock
+ *
+ * @param memdb     the skiplist
+ * @param key       the key
+ * @param key_len   the length of the key
+ * @param data      the value
+ * @param data_len  the length of the value
+ * @param append    whether to append the value to the record's value if there is one
+ * @return 1 if the key had a record before, 0 otherwise
+ */
+static int memory_put(struct mdhim_memory_t *memdb, void *key, int key_len,
+		      void *data, int32_t data_len, int append) {
+	struct mdhim_memory_node_t *prev[MEMORYDB_MAX_HEIGHT];
+	struct mdhim_memory_node_t *node;
+	void *new_data;
+	int height, level;
+
+	node = find_ge(memdb, key, key_len, prev);
+	if (is_key(memdb, node, key, key_len)) {
+		if (append) {
+			new_data = realloc(node->data, node->data_len + data_len);
+			memcpy((char *) new_data + node->data_len, data, data_len);
+			node->data_len += data_len;
+		} else {
+			new_data = malloc(data_len);
+			memcpy(new_data, data, data_len);
+			free(node->data);
+			node->data_len = data_len;
+		}
+
+		node->data = new_data;
+		return 1;
+	}
+
+	//Each level holds about a quarter of the records of the level under it
+	height = 1;
+	while (height < MEMORYDB_MAX_HEIGHT && !(rand_r(&memdb->seed) & 3)) {
+		height++;
+	}
+
+	for (level = memdb->height; level < height; level++) {
+		prev[level] = memdb->head;
+	}
+	if (height > memdb->height) {
+		memdb->height = height;
+	}
+
+	node = node_create(height);
+	node->key = malloc(key_len);
+	memcpy(node->key, key, key_len);
+	node->key_len = key_len;
+	node->data = malloc(data_len);
+	memcpy(node->data, data, data_len);
+	node->data_len = data_len;
+	for (level = 0; level < height; level++) {
+		node->next[level] = prev[level]->next[level];
+		prev[level]->next[level] = node;
+	}
+
+	return 0;
+}
+
+/**
+ * memory_del
+ * Removes a record from the skiplist.  The caller holds the write lock
+ *
+ * @param memdb     the skiplist
+ * @param key       the key
+ * @param key_len   the length of the key
+ * @return 1 if the key had a record, 0 otherwise
+ */
+static int memory_del(struct mdhim_memory_t *memdb, void *key, int key_len) {
+	struct mdhim_memory_node_t *prev[MEMORYDB_MAX_HEIGHT];
+	struct mdhim_memory_node_t *node;
+	int level;
+
+	node = find_ge(memdb, key, key_len, prev);
+	if (!is_key(memdb, node, key, key_len)) {
+		return 0;
+	}
+
+	for (level = 0; level < node->height; level++) {
+		prev[level]->next[level] = node->next[level];
+	}
+
+	node_destroy(node);
+	while (memdb->height > 1 && !memdb->head->next[memdb->height - 1]) {
+		memdb->height--;
+	}
+
+	return 1;
+}
+
+/**
+ * copy_record
+ * Copies the key and value of a record for the caller
+ *
+ * @param node      the record
+ * @param key       out  copy of the key, NULL if not wanted
+ * @param key_len   out  the length of the key
+ * @param data      out  copy of the value
+ * @param data_len  out  the length of the value
+ */
+static void copy_record(struct mdhim_memory_node_t *node, void **key, int *key_len,
+			void **data, int32_t *data_len) {
+	if (key) {
+		*key = malloc(node->key_len);
+		memcpy(*key, node->key, node->key_len);
+		*key_len = node->key_len;
+	}
+
+	*data = malloc(node->data_len);
+	memcpy(*data, node->data, node->data_len);
+	*data_len = node->data_len;
+}
+
+/**
+ * memory_load
+ * Reads the records written by memory_save, if the file exists
+ *
+ * @param memdb     the skiplist
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+static int memory_load(struct mdhim_memory_t *memdb) {
+	FILE *fp;
+	int32_t lens[2];
+	void *key, *data;
+	int ret = MDHIM_SUCCESS;
+
+	if ((fp = fopen(memdb->path, "r")) == NULL) {
+		return errno == ENOENT ? MDHIM_SUCCESS : MDHIM_DB_ERROR;
+	}
+
+	while (fread(lens, sizeof(int32_t), 2, fp) == 2) {
+		key = malloc(lens[0]);
+		data = malloc(lens[1]);
+		if (fread(key, 1, lens[0], fp) != (size_t) lens[0] ||
+		    fread(data, 1, lens[1], fp) != (size_t) lens[1]) {
+			free(key);
+			free(data);
+			ret = MDHIM_DB_ERROR;
+			break;
+		}
+
+		memory_put(memdb, key, lens[0], data, lens[1], 0);
+		free(key);
+		free(data);
+	}
+
+	fclose(fp);
+
+	return ret;
+}
+
+/**
+ * memory_save
+ * Writes the records to the skiplist's file in key order.  They are written to a
+ * temporary file first, so a failed write leaves the last snapshot as it was
+ *
+ * @param memdb     the skiplist
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+static int memory_save(struct mdhim_memory_t *memdb) {
+	struct mdhim_memory_node_t *node;
+	char tmp_path[PATH_MAX];
+	FILE *fp;
+	int32_t lens[2];
+	int ret = MDHIM_SUCCESS;
+
+	sprintf(tmp_path, "%s.tmp", memdb->path);
+	if ((fp = fopen(tmp_path, "w")) == NULL) {
+		return MDHIM_DB_ERROR;
+	}
+
+	for (node = memdb->head->next[0]; node; node = node->next[0]) {
+		lens[0] = node->key_len;
+		lens[1] = node->data_len;
+		if (fwrite(lens, sizeof(int32_t), 2, fp) != 2 ||
+		    fwrite(node->key, 1, node->key_len, fp) != (size_t) node->key_len ||
+		    fwrite(node->data, 1, node->data_len, fp) != (size_t) node->data_len) {
+			ret = MDHIM_DB_ERROR;
+			break;
+		}
+	}
+
+	if (fclose(fp) != 0) {
+		ret = MDHIM_DB_ERROR;
+	}
+
+	if (ret != MDHIM_SUCCESS || rename(tmp_path, memdb->path) != 0) {
+		unlink(tmp_path);
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_open
+ * Opens the data store
+ *
+ * @param dbh            in   double pointer to the memory handle
+ * @param dbs            in   double pointer to the memory statistics db handle
+ * @param path           in   path of the snapshot files if opts->db_snapshot is set
+ * @param flags          in   flags for opening the data store
+ * @param key_type       in   the type of the keys
+ * @param opts           in   additional options for the data store layer
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_open(void **dbh, void **dbs, char *path, int flags, int key_type,
+		      struct mdhim_options_t *opts) {
+	struct mdhim_memory_t *mdhimdb;
+	struct mdhim_memory_t *statsdb;
+
+	mdhimdb = memory_create(key_type);
+	statsdb = memory_create(MDHIM_INT_KEY);
+	*((struct mdhim_memory_t **) dbh) = mdhimdb;
+	*((struct mdhim_memory_t **) dbs) = statsdb;
+	if (!opts->db_snapshot) {
+		return MDHIM_SUCCESS;
+	}
+
+	//Check to see if the given path + "_stats.tmp" and the null char will be more than the max
+	if (strlen(path) + 11 > PATH_MAX) {
+		mlog(MDHIM_SERVER_CRIT, "Error opening memory database - path provided is too long");
+		return MDHIM_DB_ERROR;
+	}
+
+	mdhimdb->path = malloc(strlen(path) + 1);
+	sprintf(mdhimdb->path, "%s", path);
+	statsdb->path = malloc(strlen(path) + 7);
+	sprintf(statsdb->path, "%s_stats", path);
+	if (memory_load(mdhimdb) != MDHIM_SUCCESS || memory_load(statsdb) != MDHIM_SUCCESS) {
+		mlog(MDHIM_SERVER_CRIT, "Error reading the memory database snapshot: %s", path);
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_put
+ * Stores a single key in the data store
+ *
+ * @param dbh         in   pointer to the memory handle
+ * @param key         in   void * to the key to store
+ * @param key_len     in   length of the key
+ * @param data        in   void * to the value of the key
+ * @param data_len    in   length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_put(void *dbh, void *key, int key_len, void *data, int32_t data_len) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+
+	memory_wrlock(mdhimdb);
+	memory_put(mdhimdb, key, key_len, data, data_len, 0);
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_batch_put
+ * Stores multiple keys in the data store
+ *
+ * @param dbh          in   pointer to the memory handle
+ * @param keys         in   void ** to the key to store
+ * @param key_lens     in   int * to the lengths of the keys
+ * @param data         in   void ** to the values of the keys
+ * @param data_lens    in   int * to the lengths of the value data
+ * @param num_records  in   int for the number of records to insert
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			   void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	int i;
+
+	memory_wrlock(mdhimdb);
+	for (i = 0; i < num_records; i++) {
+		memory_put(mdhimdb, keys[i], key_lens[i], data[i], data_lens[i], 0);
+	}
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_batch_append
+ * Appends values to the records of several keys in place
+ *
+ * @param dbh          in     pointer to the memory handle
+ * @param keys         in     void ** to the keys to append to
+ * @param key_lens     in     int32_t * to the lengths of the keys
+ * @param data         in     void ** to the values to append
+ * @param data_lens    in     int32_t * to the lengths of the values
+ * @param exists       in/out int * set to whether each key had a record before,
+ *                            only for keys it is 1 for.  May be NULL
+ * @param num_records  in     int for the number of records to append to
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			      void **data, int32_t *data_lens, int *exists, int num_records) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	int i, existed;
+
+	memory_wrlock(mdhimdb);
+	for (i = 0; i < num_records; i++) {
+		existed = memory_put(mdhimdb, keys[i], key_lens[i], data[i], data_lens[i], 1);
+		if (exists && exists[i]) {
+			exists[i] = existed;
+		}
+	}
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_get
+ * Gets a value, given a key, from the data store
+ *
+ * @param dbh          in   pointer to the memory db handle
+ * @param key          in   void * to the key to retrieve the value of
+ * @param key_len      in   length of the key
+ * @param data         out  void * to the value of the key
+ * @param data_len     out  pointer to length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if the key was not found
+ */
+int mdhim_memory_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	struct mdhim_memory_node_t *node;
+	int ret = MDHIM_DB_ERROR;
+
+	*data = NULL;
+	memory_rdlock(mdhimdb);
+	node = find_ge(mdhimdb, key, key_len, NULL);
+	if (is_key(mdhimdb, node, key, key_len)) {
+		copy_record(node, NULL, NULL, data, data_len);
+		ret = MDHIM_SUCCESS;
+	}
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return ret;
+}
+
+/**
+ * mdhim_memory_batch_get
+ * Gets the values of several keys
+ *
+ * @param dbh          in   pointer to the memory db handle
+ * @param keys         in   void ** to the keys to retrieve the values of
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         out  void ** to the values of the keys, NULL for keys not found
+ * @param data_lens    out  int32_t * to the lengths of the values, 0 for keys not found
+ * @param num_records  in   the number of keys
+ *
+ * @return MDHIM_SUCCESS if every key was found or MDHIM_DB_ERROR otherwise
+ */
+int mdhim_memory_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			   void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	struct mdhim_memory_node_t *node;
+	int ret = MDHIM_SUCCESS;
+	int i;
+
+	memory_rdlock(mdhimdb);
+	for (i = 0; i < num_records; i++) {
+		data[i] = NULL;
+		data_lens[i] = 0;
+		node = find_ge(mdhimdb, keys[i], key_lens[i], NULL);
+		if (is_key(mdhimdb, node, keys[i], key_lens[i])) {
+			copy_record(node, NULL, NULL, &data[i], &data_lens[i]);
+		} else {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return ret;
+}
+
+/**
+ * mdhim_memory_get_next
+ * Gets the next key/value from the data store
+ *
+ * @param dbh             in   pointer to the memory db handle
+ * @param key             in/out  void ** to the key to start after, NULL for the first key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no next key
+ */
+int mdhim_memory_get_next(void *dbh, void **key, int *key_len,
+			  void **data, int32_t *data_len) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	struct mdhim_memory_node_t *node;
+	int ret = MDHIM_SUCCESS;
+
+	memory_rdlock(mdhimdb);
+	if (!*key || !*key_len) {
+		node = mdhimdb->head->next[0];
+	} else {
+		node = find_ge(mdhimdb, *key, *key_len, NULL);
+		if (is_key(mdhimdb, node, *key, *key_len)) {
+			node = node->next[0];
+		}
+	}
+
+	if (node) {
+		copy_record(node, key, key_len, data, data_len);
+	} else {
+		*key = NULL;
+		*key_len = 0;
+		*data = NULL;
+		*data_len = 0;
+		ret = MDHIM_DB_ERROR;
+	}
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return ret;
+}
+
+/**
+ * mdhim_memory_get_prev
+ * Gets the previous key/value from the data store
+ *
+ * @param dbh             in   pointer to the memory db handle
+ * @param key             in/out  void ** to the key to start before, NULL for the last key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no previous key
+ */
+int mdhim_memory_get_prev(void *dbh, void **key, int *key_len,
+			  void **data, int32_t *data_len) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	struct mdhim_memory_node_t *prev[MEMORYDB_MAX_HEIGHT];
+	struct mdhim_memory_node_t *node;
+	int ret = MDHIM_SUCCESS;
+
+	memory_rdlock(mdhimdb);
+	if (!*key || !*key_len) {
+		node = find_last(mdhimdb);
+	} else {
+		find_ge(mdhimdb, *key, *key_len, prev);
+		node = prev[0] == mdhimdb->head ? NULL : prev[0];
+	}
+
+	if (node) {
+		copy_record(node, key, key_len, data, data_len);
+	} else {
+		*key = NULL;
+		*key_len = 0;
+		*data = NULL;
+		*data_len = 0;
+		ret = MDHIM_DB_ERROR;
+	}
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return ret;
+}
+
+/**
+ * mdhim_memory_del
+ * delete the given key
+ *
+ * @param dbh         in   pointer to the memory db handle
+ * @param key         in   void * for the key to delete
+ * @param key_len     in   int for the length of the key
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_del(void *dbh, void *key, int key_len) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+
+	memory_wrlock(mdhimdb);
+	memory_del(mdhimdb, key, key_len);
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_batch_del
+ * Deletes several keys
+ *
+ * @param dbh          in   pointer to the memory db handle
+ * @param keys         in   void ** to the keys to delete
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param found        out  int * set to whether each key was in the data store before
+ *                          the delete, may be NULL
+ * @param num_records  in   the number of keys
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			   int *found, int num_records) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	int i, deleted;
+
+	memory_wrlock(mdhimdb);
+	for (i = 0; i < num_records; i++) {
+		deleted = memory_del(mdhimdb, keys[i], key_lens[i]);
+		if (found) {
+			found[i] = deleted;
+		}
+	}
+	pthread_rwlock_unlock(&mdhimdb->lock);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_commit
+ * Commits outstanding writes the data store
+ *
+ * @param dbh         in   pointer to the memory handle
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_commit(void *dbh) {
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_memory_close
+ * Closes the data store, writing it to its snapshot file first if it has one
+ *
+ * @param dbh         in   pointer to the memory db handle
+ * @param dbs         in   pointer to the memory statistics db handle
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_close(void *dbh, void *dbs) {
+	struct mdhim_memory_t *mdhimdb = (struct mdhim_memory_t *) dbh;
+	struct mdhim_memory_t *statsdb = (struct mdhim_memory_t *) dbs;
+	int ret = MDHIM_SUCCESS;
+
+	if (mdhimdb->path && (memory_save(mdhimdb) != MDHIM_SUCCESS ||
+			      memory_save(statsdb) != MDHIM_SUCCESS)) {
+		mlog(MDHIM_SERVER_CRIT, "Error writing the memory database snapshot: %s",
+		     mdhimdb->path);
+		ret = MDHIM_DB_ERROR;
+	}
+
+	memory_destroy(mdhimdb);
+	memory_destroy(statsdb);
+
+	return ret;
+}
+
+/**
+ * mdhim_memory_cursor_open
+ * Opens a cursor on the data store.  The cursor sees the writes made after it was opened
+ *
+ * @param dbh     in   pointer to the memory handle
+ * @param cursor  out  pointer to the opened cursor
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_memory_cursor_open(void *dbh, void **cursor) {
+	struct mdhim_memory_cursor_t *cur;
+
+	cur = malloc(sizeof(struct mdhim_memory_cursor_t));
+	if (!cur) {
+		*cursor = NULL;
+		return MDHIM_DB_ERROR;
+	}
+
+	cur->memdb = (struct mdhim_memory_t *) dbh;
+	cur->key = NULL;
+	cur->key_len = 0;
+	*cursor = cur;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * cursor_move
+ * Puts the cursor on a record or takes it off the records.  The caller holds a lock
+ *
+ * @param cur     the cursor
+ * @param node    the record, NULL to take the cursor off the records
+ */
+static void cursor_move(struct mdhim_memory_cursor_t *cur, struct mdhim_memory_node_t *node) {
+	free(cur->key);
+	cur->key = NULL;
+	cur->key_len = 0;
+	if (!node) {
+		return;
+	}
+
+	cur->key = malloc(node->key_len);
+	memcpy(cur->key, node->key, node->key_len);
+	cur->key_len = node->key_len;
+}
+
+/**
+ * mdhim_memory_cursor_seek
+ * Positions the cursor on the given key
+ *
+ * @param cursor  in   pointer to the cursor
+ * @param key     in   void * to the key to position the cursor on, NULL for the first key
+ * @param key_len in   int for the length of the key
+ * @param op      in   MDHIM_GET_EQ to position on the key itself or
+ *                     MDHIM_GET_NEXT to position on the first key not before it
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no such key
+ */
+int mdhim_memory_cursor_seek(void *cursor, void *key, int key_len, int op) {
+	struct mdhim_memory_cursor_t *cur = (struct mdhim_memory_cursor_t *) cursor;
+	struct mdhim_memory_node_t *node;
+	int ret = MDHIM_SUCCESS;
+
+	memory_rdlock(cur->memdb);
+	if (!key || !key_len) {
+		node = cur->memdb->head->next[0];
+	} else {
+		node = find_ge(cur->memdb, key, key_len, NULL);
+	}
+
+	cursor_move(cur, node);
+	if (!node || (op == MDHIM_GET_EQ && key && key_len &&
+		      !is_key(cur->memdb, node, key, key_len))) {
+		ret = MDHIM_DB_ERROR;
+	}
+	pthread_rwlock_unlock(&cur->memdb->lock);
+
+	return ret;
+}
+
+/**
+ * mdhim_memory_cursor_get
+ * Gets the record under the cursor after moving it as the operation says.  If the
+ * record under the cursor was deleted, MDHIM_GET_EQ reads the record after it
+ *
+ * @param cursor   in   pointer to the cursor
+ * @param op       in   MDHIM_GET_EQ to read the current record, MDHIM_GET_NEXT or
+ *                      MDHIM_GET_PREV to move the cursor first
+ * @param key      out  void ** to the key that we get
+ * @param key_len  out  int * to the length of the key
+ * @param data     out  void ** to the value belonging to the key
+ * @param data_len out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if the cursor ran off the store
+ */
+int mdhim_memory_cursor_get(void *cursor, int op, void **key, int *key_len,
+			    void **data, int32_t *data_len) {
+	struct mdhim_memory_cursor_t *cur = (struct mdhim_memory_cursor_t *) cursor;
+	struct mdhim_memory_node_t *prev[MEMORYDB_MAX_HEIGHT];
+	struct mdhim_memory_node_t *node;
+	int ret = MDHIM_SUCCESS;
+
+	*key = NULL;
+	*key_len = 0;
+	*data = NULL;
+	*data_len = 0;
+	if (!cur->key) {
+		return MDHIM_DB_ERROR;
+	}
+
+	memory_rdlock(cur->memdb);
+	node = find_ge(cur->memdb, cur->key, cur->key_len, prev);
+	if (op == MDHIM_GET_NEXT && is_key(cur->memdb, node, cur->key, cur->key_len)) {
+		node = node->next[0];
+	} else if (op == MDHIM_GET_PREV) {
+		node = prev[0] == cur->memdb->head ? NULL : prev[0];
+	}
+
+	cursor_move(cur, node);
+	if (node) {
+		copy_record(node, key, key_len, data, data_len);
+	} else {
+		ret = MDHIM_DB_ERROR;
+	}
+	pthread_rwlock_unlock(&cur->memdb->lock);
+
+	return ret;
+}
+
+/**
+ * mdhim_memory_cursor_close
+ * Closes the cursor
+ *
+ * @param cursor  in   pointer to the cursor
+ */
+void mdhim_memory_cursor_close(void *cursor) {
+	struct mdhim_memory_cursor_t *cur = (struct mdhim_memory_cursor_t *) cursor;
+
+	if (!cur) {
+		return;
+	}
+
+	free(cur->key);
+	free(cur);
+}
@@ -0,0 +1,67 @@
+/*
+ * MDHIM TNG
+ *
+ * In memory data store
+ */
+
+#ifndef      __MEMORYDB_H
+#define      __MEMORYDB_H
+
+#include "mdhim.h"
+#include "partitioner.h"
+#include "data_store.h"
+
+//Most levels of the skiplist, enough for 4^16 records
+#define MEMORYDB_MAX_HEIGHT 16
+
+/* A record of the skiplist.  next has one pointer per level the record is on */
+struct mdhim_memory_node_t {
+	void *key;
+	int key_len;
+	void *data;
+	int32_t data_len;
+	int height;
+	struct mdhim_memory_node_t *next[];
+};
+
+struct mdhim_memory_t {
+	struct mdhim_memory_node_t *head;  //Holds no record, it is on every level
+	int height;                        //Number of levels in use
+	int key_type;
+	unsigned int seed;                 //For the levels of new records
+	pthread_rwlock_t lock;             //Readers share the skiplist, writers have it alone
+	char *path;                        //File the records are written to on close, NULL if none
+};
+
+//A cursor keeps the key it is on, the skiplist can change under it
+struct mdhim_memory_cursor_t {
+	struct mdhim_memory_t *memdb;
+	void *key;                         //NULL if the cursor is not on a record
+	int key_len;
+};
+
+int mdhim_memory_open(void **dbh, void **dbs, char *path, int flags, int key_type,
+		      struct mdhim_options_t *opts);
+int mdhim_memory_put(void *dbh, void *key, int key_len, void *data, int32_t data_len);
+int mdhim_memory_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			   void **data, int32_t *data_lens, int num_records);
+int mdhim_memory_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			      void **data, int32_t *data_lens, int *exists, int num_records);
+int mdhim_memory_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len);
+int mdhim_memory_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			   void **data, int32_t *data_lens, int num_records);
+int mdhim_memory_get_next(void *dbh, void **key, int *key_len,
+			  void **data, int32_t *data_len);
+int mdhim_memory_get_prev(void *dbh, void **key, int *key_len,
+			  void **data, int32_t *data_len);
+int mdhim_memory_del(void *dbh, void *key, int key_len);
+int mdhim_memory_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			   int *found, int num_records);
+int mdhim_memory_commit(void *dbh);
+int mdhim_memory_close(void *dbh, void *dbs);
+int mdhim_memory_cursor_open(void *dbh, void **cursor);
+int mdhim_memory_cursor_seek(void *cursor, void *key, int key_len, int op);
+int mdhim_memory_cursor_get(void *cursor, int op, void **key, int *key_len,
+			    void **data, int32_t *data_len);
+void mdhim_memory_cursor_close(void *cursor);
+#endif
@@ -0,0 +1,1158 @@
+/*
+ * MDHIM TNG
+ *
+ * RocksDB data store
+ *
+ * The indexes of a range server on the same path share one RocksDB database, so they
+ * share its write ahead log and background work.  Every index has a column family for
+ * its records and one for its stats.  All the databases of a process share one block
+ * cache and one write buffer manager, which bound their memory together.  Appends are
+ * merge operands that RocksDB folds into the records when they are read or compacted
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <linux/limits.h>
+#include "ds_rocksdb.h"
+
+//Databases opened by this process, by path
+static struct mdhim_rocksdb_instance_t *instances = NULL;
+static pthread_mutex_t instances_lock = PTHREAD_MUTEX_INITIALIZER;
+//Shared by every database, created with the first one
+static rocksdb_cache_t *shared_cache = NULL;
+static rocksdb_write_buffer_manager_t *shared_buffers = NULL;
+
+static void cmp_destroy(void* arg) { }
+
+static int cmp_empty(const char* a, size_t alen,
+		     const char* b, size_t blen) {
+	int ret = 2;
+	if (a && !b) {
+		return 1;
+	} else if (!a && b) {
+		return -1;
+	} else if (!a && !b) {
+		return 0;
+	}
+
+	if (alen > blen) {
+		return 1;
+	} else if (blen > alen) {
+		return -1;
+	}
+
+	return ret;
+}
+
+static int cmp_int_compare(void* arg, const char* a, size_t alen,
+			   const char* b, size_t blen) {
+	int ret;
+
+	ret = cmp_empty(a, alen, b, blen);
+	if (ret != 2) {
+		return ret;
+	}
+
+	return (*(uint32_t *) a > *(uint32_t *) b) - (*(uint32_t *) a < *(uint32_t *) b);
+}
+
+static int cmp_lint_compare(void* arg, const char* a, size_t alen,
+			    const char* b, size_t blen) {
+	int ret;
+
+	ret = cmp_empty(a, alen, b, blen);
+	if (ret != 2) {
+		return ret;
+	}
+
+	return (*(uint64_t *) a > *(uint64_t *) b) - (*(uint64_t *) a < *(uint64_t *) b);
+}
+
+static int cmp_double_compare(void* arg, const char* a, size_t alen,
+			      const char* b, size_t blen) {
+	int ret;
+
+	ret = cmp_empty(a, alen, b, blen);
+	if (ret != 2) {
+		return ret;
+	}
+
+	return (*(double *) a > *(double *) b) - (*(double *) a < *(double *) b);
+}
+
+static int cmp_float_compare(void* arg, const char* a, size_t alen,
+			     const char* b, size_t blen) {
+	int ret;
+
+	ret = cmp_empty(a, alen, b, blen);
+	if (ret != 2) {
+		return ret;
+	}
+
+	return (*(float *) a > *(float *) b) - (*(float *) a < *(float *) b);
+}
+
+//Strings sort by their characters up to a null character, a prefix sorts first
+static int cmp_string_compare(void* arg, const char* a, size_t alen,
+			      const char* b, size_t blen) {
+	int ret;
+
+	if (a && !b) {
+		return 1;
+	} else if (!a && b) {
+		return -1;
+	} else if (!a && !b) {
+		return 0;
+	}
+
+	ret = strncmp(a, b, alen < blen ? alen : blen);
+	if (ret) {
+		return ret;
+	}
+
+	alen = strnlen(a, alen);
+	blen = strnlen(b, blen);
+
+	return (alen > blen) - (alen < blen);
+}
+
+static int cmp_byte_compare(void* arg, const char* a, size_t alen,
+			    const char* b, size_t blen) {
+	int ret;
+
+	ret = cmp_empty(a, alen, b, blen);
+	if (ret != 2) {
+		return ret;
+	}
+
+	return memcmp(a, b, alen);
+}
+
+static const char* cmp_name(void* arg) {
+	return "mdhim_cmp";
+}
+
+static mdhim_rocksdb_cmp_fn_t cmp_for_key_type(int key_type) {
+	switch(key_type) {
+	case MDHIM_INT_KEY:
+		return cmp_int_compare;
+	case MDHIM_LONG_INT_KEY:
+		return cmp_lint_compare;
+	case MDHIM_FLOAT_KEY:
+		return cmp_float_compare;
+	case MDHIM_DOUBLE_KEY:
+		return cmp_double_compare;
+	case MDHIM_STRING_KEY:
+		return cmp_string_compare;
+	default:
+		return cmp_byte_compare;
+	}
+}
+
+/**
+ * merge_full
+ * Appends the merge operands of a key to its record, oldest first
+ */
+static char *merge_full(void *arg, const char *key, size_t key_len,
+			const char *value, size_t value_len,
+			const char *const *operands, const size_t *operand_lens,
+			int num_operands, unsigned char *success, size_t *new_len) {
+	char *merged;
+	size_t len;
+	int i;
+
+	len = value ? value_len : 0;
+	for (i = 0; i < num_operands; i++) {
+		len += operand_lens[i];
+	}
+
+	merged = malloc(len ? len : 1);
+	len = 0;
+	if (value) {
+		memcpy(merged, value, value_len);
+		len = value_len;
+	}
+
+	for (i = 0; i < num_operands; i++) {
+		memcpy(merged + len, operands[i], operand_lens[i]);
+		len += operand_lens[i];
+	}
+
+	*new_len = len;
+	*success = 1;
+
+	return merged;
+}
+
+static char *merge_partial(void *arg, const char *key, size_t key_len,
+			   const char *const *operands, const size_t *operand_lens,
+			   int num_operands, unsigned char *success, size_t *new_len) {
+	return merge_full(arg, key, key_len, NULL, 0, operands, operand_lens,
+			  num_operands, success, new_len);
+}
+
+static void merge_delete(void *arg, const char *value, size_t value_len) {
+	free((char *) value);
+}
+
+static const char *merge_name(void *arg) {
+	return "mdhim_append";
+}
+
+/**
+ * family_names
+ * Gets the path of the database and the column families of an index from the path
+ * open_db_store gives the index, which ends with "-<index id>-<rank>"
+ *
+ * @param path        the path of the index
+ * @param key_type    the type of the keys of the index
+ * @param db_path     out  the path of the database of the range server
+ * @param name        out  the column family of the records
+ * @param stats_name  out  the column family of the stats
+ * @return MDHIM_SUCCESS or MDHIM_DB_ERROR if the names are too long
+ */
+static int family_names(char *path, int key_type, char *db_path, char *name,
+			char *stats_name) {
+	char *rank, *id;
+	int ret;
+
+	rank = strrchr(path, '-');
+	id = NULL;
+	if (rank) {
+		for (id = rank; id > path && *(id - 1) != '-'; id--);
+	}
+
+	//A path that doesn't name an index gets a database of its own
+	if (!rank || id == path || !rank[1] || id == rank) {
+		ret = snprintf(db_path, PATH_MAX, "%s_rocksdb", path);
+		snprintf(name, ROCKSDB_MAX_FAMILY_NAME, "index-0-%d", key_type);
+		snprintf(stats_name, ROCKSDB_MAX_FAMILY_NAME, "stats-0");
+	} else {
+		ret = snprintf(db_path, PATH_MAX, "%.*s%s_rocksdb", (int) (id - path) - 1, path, rank);
+		snprintf(name, ROCKSDB_MAX_FAMILY_NAME, "index-%.*s-%d", (int) (rank - id), id,
+			 key_type);
+		snprintf(stats_name, ROCKSDB_MAX_FAMILY_NAME, "stats-%.*s", (int) (rank - id), id);
+	}
+
+	return ret < PATH_MAX ? MDHIM_SUCCESS : MDHIM_DB_ERROR;
+}
+
+/**
+ * family_create
+ * Makes the options of a column family from its name
+ *
+ * @param name     the name of the column family
+ * @param opts     the options of MDHIM
+ * @return the column family, without a handle
+ */
+static struct mdhim_rocksdb_family_t *family_create(const char *name,
+						    struct mdhim_options_t *opts) {
+	struct mdhim_rocksdb_family_t *family;
+	rocksdb_block_based_table_options_t *table_options;
+	int key_type;
+
+	family = malloc(sizeof(struct mdhim_rocksdb_family_t));
+	memset(family, 0, sizeof(struct mdhim_rocksdb_family_t));
+	snprintf(family->name, ROCKSDB_MAX_FAMILY_NAME, "%s", name);
+	family->options = rocksdb_options_create();
+
+	//Partitioned Bloom filters, only their top level index stays in the shared cache
+	table_options = rocksdb_block_based_options_create();
+	rocksdb_block_based_options_set_block_cache(table_options, shared_cache);
+	rocksdb_block_based_options_set_filter_policy(table_options,
+						      rocksdb_filterpolicy_create_bloom_full(ROCKSDB_BLOOM_BITS_PER_KEY));
+	rocksdb_block_based_options_set_index_type(table_options,
+						   rocksdb_block_based_table_index_type_two_level_index_search);
+	rocksdb_block_based_options_set_partition_filters(table_options, 1);
+	rocksdb_block_based_options_set_cache_index_and_filter_blocks(table_options, 1);
+	rocksdb_block_based_options_set_pin_top_level_index_and_filter(table_options, 1);
+	rocksdb_options_set_block_based_table_factory(family->options, table_options);
+	rocksdb_block_based_options_destroy(table_options);
+
+	if (sscanf(name, "index-%*d-%d", &key_type) == 1) {
+		family->compare = cmp_for_key_type(key_type);
+		rocksdb_options_set_merge_operator(family->options,
+						   rocksdb_mergeoperator_create(NULL, cmp_destroy,
+										merge_full,
+										merge_partial,
+										merge_delete,
+										merge_name));
+
+		//Only strings sort so that the keys with the same prefix are next to each other
+		if (key_type == MDHIM_STRING_KEY && opts->db_prefix_len > 0) {
+			rocksdb_options_set_prefix_extractor(family->options,
+							     rocksdb_slicetransform_create_fixed_prefix(opts->db_prefix_len));
+		}
+	} else if (!strncmp(name, "stats-", 6)) {
+		family->compare = cmp_int_compare;
+	}
+
+	if (family->compare) {
+		family->cmp = rocksdb_comparator_create(NULL, cmp_destroy, family->compare, cmp_name);
+		rocksdb_options_set_comparator(family->options, family->cmp);
+	}
+
+	return family;
+}
+
+static void family_destroy(struct mdhim_rocksdb_family_t *family) {
+	if (family->handle) {
+		rocksdb_column_family_handle_destroy(family->handle);
+	}
+
+	rocksdb_options_destroy(family->options);
+	if (family->cmp) {
+		rocksdb_comparator_destroy(family->cmp);
+	}
+
+	free(family);
+}
+
+/**
+ * instance_open
+ * Opens the database of a range server with every column family it has
+ *
+ * @param path     the path of the database
+ * @param opts     the options of MDHIM
+ * @return the database or NULL on error
+ */
+static struct mdhim_rocksdb_instance_t *instance_open(char *path, struct mdhim_options_t *opts) {
+	struct mdhim_rocksdb_instance_t *instance;
+	struct mdhim_rocksdb_family_t **families, *family, *tmp;
+	rocksdb_column_family_handle_t **handles;
+	const rocksdb_options_t **family_options;
+	char **names;
+	size_t num_names, i;
+	char *err = NULL;
+
+	if (!shared_cache) {
+		shared_cache = rocksdb_cache_create_lru(opts->db_cache_size);
+		shared_buffers = rocksdb_write_buffer_manager_create(opts->db_write_buffer_size, 0);
+	}
+
+	instance = malloc(sizeof(struct mdhim_rocksdb_instance_t));
+	memset(instance, 0, sizeof(struct mdhim_rocksdb_instance_t));
+	instance->path = malloc(strlen(path) + 1);
+	strcpy(instance->path, path);
+	instance->options = rocksdb_options_create();
+	rocksdb_options_set_create_if_missing(instance->options, 1);
+	rocksdb_options_set_create_missing_column_families(instance->options, 1);
+	rocksdb_options_set_max_open_files(instance->options, 10000);
+	rocksdb_options_set_write_buffer_manager(instance->options, shared_buffers);
+
+	//Every column family has to be opened with the database, a new one has just the default
+	names = rocksdb_list_column_families(instance->options, path, &num_names, &err);
+	if (err != NULL) {
+		free(err);
+		err = NULL;
+		names = NULL;
+		num_names = 0;
+	}
+
+	families = malloc(sizeof(struct mdhim_rocksdb_family_t *) * (num_names + 1));
+	family_options = malloc(sizeof(rocksdb_options_t *) * (num_names + 1));
+	handles = malloc(sizeof(rocksdb_column_family_handle_t *) * (num_names + 1));
+	if (!num_names) {
+		families[0] = family_create("default", opts);
+		num_names = 1;
+	} else {
+		for (i = 0; i < num_names; i++) {
+			families[i] = family_create(names[i], opts);
+		}
+
+		rocksdb_list_column_families_destroy(names, num_names);
+	}
+
+	names = malloc(sizeof(char *) * num_names);
+	for (i = 0; i < num_names; i++) {
+		names[i] = families[i]->name;
+		family_options[i] = families[i]->options;
+	}
+
+	instance->db = rocksdb_open_column_families(instance->options, path, num_names,
+						    (const char *const *) names, family_options,
+						    handles, &err);
+	for (i = 0; i < num_names; i++) {
+		if (err == NULL) {
+			families[i]->handle = handles[i];
+		}
+
+		HASH_ADD_STR(instance->families, name, families[i]);
+	}
+
+	free(names);
+	free(family_options);
+	free(handles);
+	free(families);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error opening rocksdb database: %s - %s", path, err);
+		free(err);
+		HASH_ITER(hh, instance->families, family, tmp) {
+			HASH_DEL(instance->families, family);
+			family_destroy(family);
+		}
+
+		rocksdb_options_destroy(instance->options);
+		free(instance->path);
+		free(instance);
+		return NULL;
+	}
+
+	return instance;
+}
+
+static void instance_close(struct mdhim_rocksdb_instance_t *instance) {
+	struct mdhim_rocksdb_family_t *family, *tmp;
+
+	//The handles go before the database, the comparators after it
+	HASH_ITER(hh, instance->families, family, tmp) {
+		rocksdb_column_family_handle_destroy(family->handle);
+		family->handle = NULL;
+	}
+
+	rocksdb_close(instance->db);
+	HASH_ITER(hh, instance->families, family, tmp) {
+		HASH_DEL(instance->families, family);
+		family_destroy(family);
+	}
+
+	rocksdb_options_destroy(instance->options);
+	free(instance->path);
+	free(instance);
+}
+
+/**
+ * family_get
+ * Gets a column family of the database, creating it if it doesn't exist
+ *
+ * @param instance the database
+ * @param name     the name of the column family
+ * @param opts     the options of MDHIM
+ * @return the column family or NULL on error
+ */
+static struct mdhim_rocksdb_family_t *family_get(struct mdhim_rocksdb_instance_t *instance,
+						 char *name, struct mdhim_options_t *opts) {
+	struct mdhim_rocksdb_family_t *family;
+	char *err = NULL;
+
+	HASH_FIND_STR(instance->families, name, family);
+	if (family) {
+		return family;
+	}
+
+	family = family_create(name, opts);
+	family->handle = rocksdb_create_column_family(instance->db, family->options, name, &err);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error creating rocksdb column family: %s - %s", name, err);
+		free(err);
+		family->handle = NULL;
+		family_destroy(family);
+		return NULL;
+	}
+
+	HASH_ADD_STR(instance->families, name, family);
+
+	return family;
+}
+
+static struct mdhim_rocksdb_t *handle_create(struct mdhim_rocksdb_instance_t *instance,
+					     struct mdhim_rocksdb_family_t *family) {
+	struct mdhim_rocksdb_t *mdhimdb;
+
+	mdhimdb = malloc(sizeof(struct mdhim_rocksdb_t));
+	memset(mdhimdb, 0, sizeof(struct mdhim_rocksdb_t));
+	mdhimdb->instance = instance;
+	mdhimdb->db = instance->db;
+	mdhimdb->family = family->handle;
+	mdhimdb->compare = family->compare;
+	mdhimdb->write_options = rocksdb_writeoptions_create();
+	rocksdb_writeoptions_set_sync(mdhimdb->write_options, 0);
+	mdhimdb->read_options = rocksdb_readoptions_create();
+	mdhimdb->scan_options = rocksdb_readoptions_create();
+	rocksdb_readoptions_set_total_order_seek(mdhimdb->scan_options, 1);
+
+	return mdhimdb;
+}
+
+static void handle_destroy(struct mdhim_rocksdb_t *mdhimdb) {
+	rocksdb_writeoptions_destroy(mdhimdb->write_options);
+	rocksdb_readoptions_destroy(mdhimdb->read_options);
+	rocksdb_readoptions_destroy(mdhimdb->scan_options);
+	free(mdhimdb);
+}
+
+/**
+ * mdhim_rocksdb_open
+ * Opens the column families of an index in the database of the range server
+ *
+ * @param dbh            in   double pointer to the rocksdb handle
+ * @param dbs            in   double pointer to the rocksdb statistics db handle
+ * @param path           in   path of the index
+ * @param flags          in   flags for opening the data store
+ * @param key_type       in   the type of the keys
+ * @param opts           in   additional options for the data store layer
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_open(void **dbh, void **dbs, char *path, int flags, int key_type,
+		       struct mdhim_options_t *opts) {
+	struct mdhim_rocksdb_instance_t *instance;
+	struct mdhim_rocksdb_family_t *family, *stats_family;
+	char db_path[PATH_MAX];
+	char name[ROCKSDB_MAX_FAMILY_NAME];
+	char stats_name[ROCKSDB_MAX_FAMILY_NAME];
+
+	if (family_names(path, key_type, db_path, name, stats_name) != MDHIM_SUCCESS) {
+		mlog(MDHIM_SERVER_CRIT, "Error opening rocksdb database - path provided is too long");
+		return MDHIM_DB_ERROR;
+	}
+
+	pthread_mutex_lock(&instances_lock);
+	HASH_FIND_STR(instances, db_path, instance);
+	if (!instance) {
+		if (!(instance = instance_open(db_path, opts))) {
+			pthread_mutex_unlock(&instances_lock);
+			return MDHIM_DB_ERROR;
+		}
+
+		HASH_ADD_KEYPTR(hh, instances, instance->path, strlen(instance->path), instance);
+	}
+
+	family = family_get(instance, name, opts);
+	stats_family = family_get(instance, stats_name, opts);
+	if (!family || !stats_family) {
+		if (!instance->refs) {
+			HASH_DEL(instances, instance);
+			instance_close(instance);
+		}
+
+		pthread_mutex_unlock(&instances_lock);
+		return MDHIM_DB_ERROR;
+	}
+
+	instance->refs++;
+	pthread_mutex_unlock(&instances_lock);
+
+	*((struct mdhim_rocksdb_t **) dbh) = handle_create(instance, family);
+	*((struct mdhim_rocksdb_t **) dbs) = handle_create(instance, stats_family);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_put
+ * Stores a single key in the data store
+ *
+ * @param dbh         in   pointer to the rocksdb handle
+ * @param key         in   void * to the key to store
+ * @param key_len     in   length of the key
+ * @param data        in   void * to the value of the key
+ * @param data_len    in   length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_put(void *dbh, void *key, int key_len, void *data, int32_t data_len) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	char *err = NULL;
+
+	rocksdb_put_cf(mdhimdb->db, mdhimdb->write_options, mdhimdb->family,
+		       key, key_len, data, data_len, &err);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error putting key/value in rocksdb - %s", err);
+		free(err);
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_batch_put
+ * Stores multiple keys in the data store with one write batch
+ *
+ * @param dbh          in   pointer to the rocksdb handle
+ * @param keys         in   void ** to the keys to store
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         in   void ** to the values of the keys
+ * @param data_lens    in   int32_t * to the lengths of the value data
+ * @param num_records  in   int for the number of records to insert
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			    void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	rocksdb_writebatch_t *write_batch;
+	char *err = NULL;
+	int i;
+
+	write_batch = rocksdb_writebatch_create();
+	for (i = 0; i < num_records; i++) {
+		rocksdb_writebatch_put_cf(write_batch, mdhimdb->family, keys[i], key_lens[i],
+					  data[i], data_lens[i]);
+	}
+
+	rocksdb_write(mdhimdb->db, mdhimdb->write_options, write_batch, &err);
+	rocksdb_writebatch_destroy(write_batch);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error in batch put in rocksdb - %s", err);
+		free(err);
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * multi_get
+ * Reads several keys at once with rocksdb_multi_get_cf
+ *
+ * @param mdhimdb      the rocksdb handle
+ * @param keys         the keys to read
+ * @param key_lens     the lengths of the keys
+ * @param want         whether to read each key, NULL to read them all
+ * @param values       out  the values, NULL for keys that weren't read or found
+ * @param value_lens   out  the lengths of the values
+ * @param num_records  the number of keys
+ * @return MDHIM_SUCCESS or MDHIM_DB_ERROR if a read failed
+ */
+static int multi_get(struct mdhim_rocksdb_t *mdhimdb, void **keys, int32_t *key_lens,
+		     int *want, char **values, size_t *value_lens, int num_records) {
+	const rocksdb_column_family_handle_t **families;
+	const char **read_keys;
+	size_t *read_lens;
+	char **read_values, **errs;
+	int *pos;
+	int i, num, ret = MDHIM_SUCCESS;
+
+	families = malloc(sizeof(rocksdb_column_family_handle_t *) * num_records);
+	read_keys = malloc(sizeof(char *) * num_records);
+	read_lens = malloc(sizeof(size_t) * num_records);
+	read_values = malloc(sizeof(char *) * num_records);
+	errs = malloc(sizeof(char *) * num_records);
+	pos = malloc(sizeof(int) * num_records);
+	num = 0;
+	for (i = 0; i < num_records; i++) {
+		values[i] = NULL;
+		value_lens[i] = 0;
+		if (want && !want[i]) {
+			continue;
+		}
+
+		families[num] = mdhimdb->family;
+		read_keys[num] = keys[i];
+		read_lens[num] = key_lens[i];
+		pos[num] = i;
+		num++;
+	}
+
+	if (num) {
+		rocksdb_multi_get_cf(mdhimdb->db, mdhimdb->read_options, families, num,
+				     read_keys, read_lens, read_values, read_lens, errs);
+	}
+
+	for (i = 0; i < num; i++) {
+		if (errs[i] != NULL) {
+			mlog(MDHIM_SERVER_CRIT, "Error in multi get in rocksdb - %s", errs[i]);
+			free(errs[i]);
+			ret = MDHIM_DB_ERROR;
+			continue;
+		}
+
+		values[pos[i]] = read_values[i];
+		value_lens[pos[i]] = read_values[i] ? read_lens[i] : 0;
+	}
+
+	free(families);
+	free(read_keys);
+	free(read_lens);
+	free(read_values);
+	free(errs);
+	free(pos);
+
+	return ret;
+}
+
+/**
+ * mdhim_rocksdb_batch_append
+ * Appends values to the records of several keys as merge operands, without reading
+ * the records
+ *
+ * @param dbh          in     pointer to the rocksdb handle
+ * @param keys         in     void ** to the keys to append to
+ * @param key_lens     in     int32_t * to the lengths of the keys
+ * @param data         in     void ** to the values to append
+ * @param data_lens    in     int32_t * to the lengths of the values
+ * @param exists       in/out int * set to whether each key had a record before,
+ *                            only looked up for keys it is 1 for.  NULL to look up nothing
+ * @param num_records  in     int for the number of records to append to
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			       void **data, int32_t *data_lens, int *exists, int num_records) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	rocksdb_writebatch_t *write_batch;
+	char **values;
+	size_t *value_lens;
+	char *err = NULL;
+	int i;
+
+	if (exists) {
+		values = malloc(sizeof(char *) * num_records);
+		value_lens = malloc(sizeof(size_t) * num_records);
+		multi_get(mdhimdb, keys, key_lens, exists, values, value_lens, num_records);
+		for (i = 0; i < num_records; i++) {
+			exists[i] = values[i] != NULL;
+			free(values[i]);
+		}
+
+		free(values);
+		free(value_lens);
+	}
+
+	write_batch = rocksdb_writebatch_create();
+	for (i = 0; i < num_records; i++) {
+		rocksdb_writebatch_merge_cf(write_batch, mdhimdb->family, keys[i], key_lens[i],
+					    data[i], data_lens[i]);
+	}
+
+	rocksdb_write(mdhimdb->db, mdhimdb->write_options, write_batch, &err);
+	rocksdb_writebatch_destroy(write_batch);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error in batch append in rocksdb - %s", err);
+		free(err);
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_get
+ * Gets a value, given a key, from the data store
+ *
+ * @param dbh          in   pointer to the rocksdb handle
+ * @param key          in   void * to the key to retrieve the value of
+ * @param key_len      in   length of the key
+ * @param data         out  void ** to the value of the key
+ * @param data_len     out  pointer to length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	size_t len = 0;
+	char *err = NULL;
+
+	*data = rocksdb_get_cf(mdhimdb->db, mdhimdb->read_options, mdhimdb->family,
+			       key, key_len, &len, &err);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error getting value in rocksdb - %s", err);
+		free(err);
+		*data = NULL;
+		return MDHIM_DB_ERROR;
+	}
+
+	if (!*data) {
+		return MDHIM_DB_ERROR;
+	}
+
+	*data_len = len;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_batch_get
+ * Gets the values of several keys with one multi get
+ *
+ * @param dbh          in   pointer to the rocksdb handle
+ * @param keys         in   void ** to the keys to retrieve the values of
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         out  void ** to the values of the keys, NULL for keys not found
+ * @param data_lens    out  int32_t * to the lengths of the values, 0 for keys not found
+ * @param num_records  in   the number of keys
+ *
+ * @return MDHIM_SUCCESS if every key was found or MDHIM_DB_ERROR otherwise
+ */
+int mdhim_rocksdb_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			    void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	size_t *value_lens;
+	int ret;
+	int i;
+
+	value_lens = malloc(sizeof(size_t) * num_records);
+	ret = multi_get(mdhimdb, keys, key_lens, NULL, (char **) data, value_lens, num_records);
+	for (i = 0; i < num_records; i++) {
+		data_lens[i] = value_lens[i];
+		if (!data[i]) {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+
+	free(value_lens);
+
+	return ret;
+}
+
+/**
+ * iter_copy
+ * Copies the record under an iterator for the caller
+ *
+ * @param iter      the iterator
+ * @param key       out  copy of the key
+ * @param key_len   out  the length of the key
+ * @param data      out  copy of the value
+ * @param data_len  out  the length of the value
+ * @return MDHIM_SUCCESS or MDHIM_DB_ERROR if the iterator is not on a record
+ */
+static int iter_copy(rocksdb_iterator_t *iter, void **key, int *key_len,
+		     void **data, int32_t *data_len) {
+	const char *res;
+	size_t len = 0;
+
+	*key = NULL;
+	*key_len = 0;
+	*data = NULL;
+	*data_len = 0;
+	if (!rocksdb_iter_valid(iter)) {
+		return MDHIM_DB_ERROR;
+	}
+
+	res = rocksdb_iter_value(iter, &len);
+	*data = malloc(len);
+	memcpy(*data, res, len);
+	*data_len = len;
+	res = rocksdb_iter_key(iter, &len);
+	*key = malloc(len);
+	memcpy(*key, res, len);
+	*key_len = len;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_get_next
+ * Gets the next key/value from the data store
+ *
+ * @param dbh             in   pointer to the rocksdb handle
+ * @param key             in/out  void ** to the key to start after, NULL for the first key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no next key
+ */
+int mdhim_rocksdb_get_next(void *dbh, void **key, int *key_len,
+			   void **data, int32_t *data_len) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	rocksdb_iterator_t *iter;
+	const char *res;
+	size_t len = 0;
+	int ret;
+
+	iter = rocksdb_create_iterator_cf(mdhimdb->db, mdhimdb->scan_options, mdhimdb->family);
+	if (!*key || !*key_len) {
+		rocksdb_iter_seek_to_first(iter);
+	} else {
+		//Seek to the first key not before the given key and step over the key itself
+		rocksdb_iter_seek(iter, *key, *key_len);
+		if (rocksdb_iter_valid(iter)) {
+			res = rocksdb_iter_key(iter, &len);
+			if (!mdhimdb->compare(NULL, res, len, *key, *key_len)) {
+				rocksdb_iter_next(iter);
+			}
+		}
+	}
+
+	ret = iter_copy(iter, key, key_len, data, data_len);
+	rocksdb_iter_destroy(iter);
+
+	return ret;
+}
+
+/**
+ * mdhim_rocksdb_get_prev
+ * Gets the previous key/value from the data store
+ *
+ * @param dbh             in   pointer to the rocksdb handle
+ * @param key             in/out  void ** to the key to start before, NULL for the last key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no previous key
+ */
+int mdhim_rocksdb_get_prev(void *dbh, void **key, int *key_len,
+			   void **data, int32_t *data_len) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	rocksdb_iterator_t *iter;
+	const char *res;
+	size_t len = 0;
+	int ret;
+
+	iter = rocksdb_create_iterator_cf(mdhimdb->db, mdhimdb->scan_options, mdhimdb->family);
+	if (!*key || !*key_len) {
+		rocksdb_iter_seek_to_last(iter);
+	} else {
+		//Seek to the last key not after the given key and step over the key itself
+		rocksdb_iter_seek_for_prev(iter, *key, *key_len);
+		if (rocksdb_iter_valid(iter)) {
+			res = rocksdb_iter_key(iter, &len);
+			if (!mdhimdb->compare(NULL, res, len, *key, *key_len)) {
+				rocksdb_iter_prev(iter);
+			}
+		}
+	}
+
+	ret = iter_copy(iter, key, key_len, data, data_len);
+	rocksdb_iter_destroy(iter);
+
+	return ret;
+}
+
+/**
+ * mdhim_rocksdb_close
+ * Closes the handles of an index and the database once no index is open on it
+ *
+ * @param dbh         in   pointer to the rocksdb handle
+ * @param dbs         in   pointer to the rocksdb statistics handle
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_close(void *dbh, void *dbs) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	struct mdhim_rocksdb_t *statsdb = (struct mdhim_rocksdb_t *) dbs;
+	struct mdhim_rocksdb_instance_t *instance = mdhimdb->instance;
+
+	handle_destroy(mdhimdb);
+	handle_destroy(statsdb);
+	pthread_mutex_lock(&instances_lock);
+	if (--instance->refs == 0) {
+		HASH_DEL(instances, instance);
+		instance_close(instance);
+	}
+
+	//The shared cache and write buffers go with the last database
+	if (!instances && shared_cache) {
+		rocksdb_cache_destroy(shared_cache);
+		rocksdb_write_buffer_manager_destroy(shared_buffers);
+		shared_cache = NULL;
+		shared_buffers = NULL;
+	}
+	pthread_mutex_unlock(&instances_lock);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_del
+ * delete the given key
+ *
+ * @param dbh         in   pointer to the rocksdb handle
+ * @param key         in   void * for the key to delete
+ * @param key_len     in   int for the length of the key
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_del(void *dbh, void *key, int key_len) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	char *err = NULL;
+
+	rocksdb_delete_cf(mdhimdb->db, mdhimdb->write_options, mdhimdb->family,
+			  key, key_len, &err);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error deleting key in rocksdb - %s", err);
+		free(err);
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_batch_del
+ * Deletes several keys with one write batch
+ *
+ * @param dbh          in   pointer to the rocksdb handle
+ * @param keys         in   void ** to the keys to delete
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param found        out  int * set to whether each key was in the data store before
+ *                          the delete, NULL to delete without looking the keys up
+ * @param num_records  in   the number of keys
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			    int *found, int num_records) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	rocksdb_writebatch_t *write_batch;
+	char **values;
+	size_t *value_lens;
+	char *err = NULL;
+	int i;
+
+	//Find the keys that are there with one multi get
+	if (found) {
+		values = malloc(sizeof(char *) * num_records);
+		value_lens = malloc(sizeof(size_t) * num_records);
+		multi_get(mdhimdb, keys, key_lens, NULL, values, value_lens, num_records);
+		for (i = 0; i < num_records; i++) {
+			found[i] = values[i] != NULL;
+			free(values[i]);
+		}
+
+		free(values);
+		free(value_lens);
+	}
+
+	write_batch = rocksdb_writebatch_create();
+	for (i = 0; i < num_records; i++) {
+		if (!found || found[i]) {
+			rocksdb_writebatch_delete_cf(write_batch, mdhimdb->family,
+						     keys[i], key_lens[i]);
+		}
+	}
+
+	rocksdb_write(mdhimdb->db, mdhimdb->write_options, write_batch, &err);
+	rocksdb_writebatch_destroy(write_batch);
+	if (err != NULL) {
+		mlog(MDHIM_SERVER_CRIT, "Error in batch delete in rocksdb - %s", err);
+		free(err);
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_commit
+ * Commits outstanding writes the data store
+ *
+ * @param dbh         in   pointer to the rocksdb handle
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_commit(void *dbh) {
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_cursor_open
+ * Opens a cursor on a snapshot of the data store
+ *
+ * @param dbh     in   pointer to the rocksdb handle
+ * @param cursor  out  pointer to the opened cursor
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_rocksdb_cursor_open(void *dbh, void **cursor) {
+	struct mdhim_rocksdb_t *mdhimdb = (struct mdhim_rocksdb_t *) dbh;
+	struct mdhim_rocksdb_cursor_t *cur;
+
+	*cursor = NULL;
+	cur = malloc(sizeof(struct mdhim_rocksdb_cursor_t));
+	if (!cur) {
+		return MDHIM_DB_ERROR;
+	}
+
+	cur->mdhimdb = mdhimdb;
+	cur->snapshot = rocksdb_create_snapshot(mdhimdb->db);
+	cur->read_options = rocksdb_readoptions_create();
+	rocksdb_readoptions_set_snapshot(cur->read_options, cur->snapshot);
+	rocksdb_readoptions_set_total_order_seek(cur->read_options, 1);
+	cur->iter = rocksdb_create_iterator_cf(mdhimdb->db, cur->read_options, mdhimdb->family);
+	*cursor = cur;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_cursor_seek
+ * Positions the cursor on the given key
+ *
+ * @param cursor  in   pointer to the cursor
+ * @param key     in   void * to the key to position the cursor on, NULL for the first key
+ * @param key_len in   int for the length of the key
+ * @param op      in   MDHIM_GET_EQ to position on the key itself or
+ *                     MDHIM_GET_NEXT to position on the first key not before it
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no such key in the snapshot
+ */
+int mdhim_rocksdb_cursor_seek(void *cursor, void *key, int key_len, int op) {
+	struct mdhim_rocksdb_cursor_t *cur = (struct mdhim_rocksdb_cursor_t *) cursor;
+	const char *res;
+	size_t len = 0;
+
+	if (!key || !key_len) {
+		rocksdb_iter_seek_to_first(cur->iter);
+	} else {
+		rocksdb_iter_seek(cur->iter, key, key_len);
+	}
+
+	if (!rocksdb_iter_valid(cur->iter)) {
+		return MDHIM_DB_ERROR;
+	} else if (op != MDHIM_GET_EQ || !key || !key_len) {
+		return MDHIM_SUCCESS;
+	}
+
+	res = rocksdb_iter_key(cur->iter, &len);
+	if (cur->mdhimdb->compare(NULL, res, len, key, key_len) != 0) {
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_rocksdb_cursor_get
+ * Gets the record under the cursor after moving it as the operation says
+ *
+ * @param cursor   in   pointer to the cursor
+ * @param op       in   MDHIM_GET_EQ to read the current record, MDHIM_GET_NEXT or
+ *                      MDHIM_GET_PREV to move the cursor first
+ * @param key      out  void ** to the key that we get
+ * @param key_len  out  int * to the length of the key
+ * @param data     out  void ** to the value belonging to the key
+ * @param data_len out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if the cursor ran off the store
+ */
+int mdhim_rocksdb_cursor_get(void *cursor, int op, void **key, int *key_len,
+			     void **data, int32_t *data_len) {
+	struct mdhim_rocksdb_cursor_t *cur = (struct mdhim_rocksdb_cursor_t *) cursor;
+
+	if (rocksdb_iter_valid(cur->iter)) {
+		if (op == MDHIM_GET_NEXT) {
+			rocksdb_iter_next(cur->iter);
+		} else if (op == MDHIM_GET_PREV) {
+			rocksdb_iter_prev(cur->iter);
+		}
+	}
+
+	return iter_copy(cur->iter, key, key_len, data, data_len);
+}
+
+/**
+ * mdhim_rocksdb_cursor_close
+ * Closes the cursor and releases its snapshot
+ *
+ * @param cursor  in   pointer to the cursor
+ */
+void mdhim_rocksdb_cursor_close(void *cursor) {
+	struct mdhim_rocksdb_cursor_t *cur = (struct mdhim_rocksdb_cursor_t *) cursor;
+
+	if (!cur) {
+		return;
+	}
+
+	rocksdb_iter_destroy(cur->iter);
+	rocksdb_readoptions_destroy(cur->read_options);
+	rocksdb_release_snapshot(cur->mdhimdb->db, cur->snapshot);
+	free(cur);
+}
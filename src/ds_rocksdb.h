@@ -0,0 +1,91 @@
+/*
+ * MDHIM TNG
+ *
+ * RocksDB data store
+ */
+
+#ifndef      __ROCKSDB_H
+#define      __ROCKSDB_H
+
+#include <pthread.h>
+#include <rocksdb/c.h>
+#include "uthash.h"
+#include "mdhim.h"
+#include "partitioner.h"
+#include "data_store.h"
+
+//Longest name of a column family
+#define ROCKSDB_MAX_FAMILY_NAME 64
+//Bits of the Bloom filters per key
+#define ROCKSDB_BLOOM_BITS_PER_KEY 10
+
+/* Function pointer for comparator in C */
+typedef int (*mdhim_rocksdb_cmp_fn_t)(void* arg, const char* a, size_t alen,
+				      const char* b, size_t blen);
+
+/* A column family of a database.  The records of an index are in "index-<id>-<key type>"
+   and its stats in "stats-<id>", so the comparator of each family is known from its name
+   when the database is opened again */
+struct mdhim_rocksdb_family_t {
+	char name[ROCKSDB_MAX_FAMILY_NAME];
+	rocksdb_column_family_handle_t *handle;
+	rocksdb_options_t *options;
+	rocksdb_comparator_t *cmp;       //NULL for the default family
+	mdhim_rocksdb_cmp_fn_t compare;
+	UT_hash_handle hh;
+};
+
+/* The database of a range server, shared by all of its indexes on the same path */
+struct mdhim_rocksdb_instance_t {
+	char *path;
+	rocksdb_t *db;
+	rocksdb_options_t *options;
+	struct mdhim_rocksdb_family_t *families;
+	int refs;                        //Number of indexes open on the database
+	UT_hash_handle hh;
+};
+
+/* Handle of the records or the stats of an index */
+struct mdhim_rocksdb_t {
+	struct mdhim_rocksdb_instance_t *instance;
+	rocksdb_t *db;
+	rocksdb_column_family_handle_t *family;
+	rocksdb_writeoptions_t *write_options;
+	rocksdb_readoptions_t *read_options;
+	rocksdb_readoptions_t *scan_options;   //Iterators read in key order, not by prefix
+	mdhim_rocksdb_cmp_fn_t compare;
+};
+
+//A cursor reads from a snapshot of the database taken when it was opened
+struct mdhim_rocksdb_cursor_t {
+	struct mdhim_rocksdb_t *mdhimdb;
+	const rocksdb_snapshot_t *snapshot;
+	rocksdb_readoptions_t *read_options;
+	rocksdb_iterator_t *iter;
+};
+
+int mdhim_rocksdb_open(void **dbh, void **dbs, char *path, int flags, int key_type,
+		       struct mdhim_options_t *opts);
+int mdhim_rocksdb_put(void *dbh, void *key, int key_len, void *data, int32_t data_len);
+int mdhim_rocksdb_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			    void **data, int32_t *data_lens, int num_records);
+int mdhim_rocksdb_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			       void **data, int32_t *data_lens, int *exists, int num_records);
+int mdhim_rocksdb_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len);
+int mdhim_rocksdb_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			    void **data, int32_t *data_lens, int num_records);
+int mdhim_rocksdb_get_next(void *dbh, void **key, int *key_len,
+			   void **data, int32_t *data_len);
+int mdhim_rocksdb_get_prev(void *dbh, void **key, int *key_len,
+			   void **data, int32_t *data_len);
+int mdhim_rocksdb_del(void *dbh, void *key, int key_len);
+int mdhim_rocksdb_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			    int *found, int num_records);
+int mdhim_rocksdb_commit(void *dbh);
+int mdhim_rocksdb_close(void *dbh, void *dbs);
+int mdhim_rocksdb_cursor_open(void *dbh, void **cursor);
+int mdhim_rocksdb_cursor_seek(void *cursor, void *key, int key_len, int op);
+int mdhim_rocksdb_cursor_get(void *cursor, int op, void **key, int *key_len,
+			     void **data, int32_t *data_len);
+void mdhim_rocksdb_cursor_close(void *cursor);
+#endif
@@ -0,0 +1,1102 @@
+/*
+ * MDHIM TNG
+ *
+ * Immutable sorted runs served from a memory mapped file
+ *
+ * Every opened data store is wrapped by a run handle.  Freezing an index writes the
+ * records of the data store to a run file next to it: the values back to back, then the
+ * keys in fixed width slots in key order with their lengths and value offsets, a fence
+ * index holding every RUN_FENCE_INTERVAL'th key and a Bloom filter of the keys.  The file
+ * is mapped and reads are served from it until the index is thawed or written to, which
+ * drops the run.  A run left by an earlier job is mapped again when the data store is
+ * opened, so a read only index needs no work to be served again.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+#include "ds_run.h"
+
+//Initial number of records read from the data store before growing the arrays
+#define RUN_INITIAL_KEYS 1024
+
+static struct mdhim_run_map_t *run_current(struct mdhim_run_t *run) {
+	return __atomic_load_n(&run->map, __ATOMIC_ACQUIRE);
+}
+
+static char *run_key(struct mdhim_run_map_t *map, uint64_t i) {
+	return map->keys + i * map->header->key_width;
+}
+
+/**
+ * run_hash
+ * Gets the hash of a key for the Bloom filter.  Keys that compare equal get the same hash
+ *
+ * @param key_type  the type of the keys
+ * @param key       the key
+ * @param key_len   the length of the key
+ * @param hash      out  the hash
+ * @return 1 if the key has a hash or 0 if keys of this type can't use the filter
+ */
+static int run_hash(int key_type, void *key, int key_len, uint64_t *hash) {
+	unsigned char *bytes = (unsigned char *) key;
+	int i;
+
+	//Floats compare by value, so -0.0 and 0.0 are the same key with different bytes
+	if (key_type == MDHIM_FLOAT_KEY || key_type == MDHIM_DOUBLE_KEY) {
+		return 0;
+	}
+
+	//Strings compare up to their first null character
+	if (key_type == MDHIM_STRING_KEY) {
+		key_len = strnlen((char *) key, key_len);
+	}
+
+	*hash = 14695981039346656037ULL;
+	for (i = 0; i < key_len; i++) {
+		*hash ^= bytes[i];
+		*hash *= 1099511628211ULL;
+	}
+
+	//Mix the high bits down, the second hash of the filter is taken from them
+	*hash ^= *hash >> 33;
+	*hash *= 0xff51afd7ed558ccdULL;
+	*hash ^= *hash >> 33;
+
+	return 1;
+}
+
+/**
+ * bloom_test
+ * Tests or sets the bits of a hash in a Bloom filter
+ *
+ * @param bloom     the filter
+ * @param bits      the number of bits of the filter, a power of 2
+ * @param hash      the hash of the key
+ * @param add       1 to set the bits of the hash
+ * @return 0 if the key is not in the filter, 1 if it may be
+ */
+static int bloom_test(unsigned char *bloom, uint64_t bits, uint64_t hash, int add) {
+	uint64_t h2, bit;
+	int i;
+
+	h2 = (hash >> 32) | 1;
+	for (i = 0; i < RUN_BLOOM_HASHES; i++) {
+		bit = (hash + i * h2) & (bits - 1);
+		if (add) {
+			bloom[bit >> 3] |= 1 << (bit & 7);
+		} else if (!(bloom[bit >> 3] & (1 << (bit & 7)))) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * run_find_ge
+ * Finds the first record of the run not before the key.  The fences are searched first,
+ * then the records between the fence found and the next one
+ *
+ * @param run       the run handle
+ * @param map       the run
+ * @param key       the key
+ * @param key_len   the length of the key
+ * @return the number of the record or the number of records if every record is before the key
+ */
+static uint64_t run_find_ge(struct mdhim_run_t *run, struct mdhim_run_map_t *map,
+			    void *key, int key_len) {
+	struct mdhim_run_header_t *header = map->header;
+	uint64_t lo, hi, mid;
+
+	//Number of fences not after the key
+	lo = 0;
+	hi = header->num_fences;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (compare_keys(run->key_type, map->fences + mid * header->key_width,
+				 map->key_lens[mid * header->fence_interval], key, key_len) <= 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (!lo) {
+		return 0;
+	}
+
+	//The record is between the last of those fences and the next fence
+	lo = (lo - 1) * header->fence_interval;
+	hi = lo + header->fence_interval;
+	if (hi > header->num_records) {
+		hi = header->num_records;
+	}
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (compare_keys(run->key_type, run_key(map, mid), map->key_lens[mid],
+				 key, key_len) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static int run_is_key(struct mdhim_run_t *run, struct mdhim_run_map_t *map, uint64_t i,
+		      void *key, int key_len) {
+	return i < map->header->num_records &&
+		!compare_keys(run->key_type, run_key(map, i), map->key_lens[i], key, key_len);
+}
+
+/**
+ * copy_record
+ * Copies the key and value of a record of the run for the caller
+ *
+ * @param map       the run
+ * @param i         the number of the record
+ * @param key       out  copy of the key, NULL if not wanted
+ * @param key_len   out  the length of the key
+ * @param data      out  copy of the value
+ * @param data_len  out  the length of the value
+ */
+static void copy_record(struct mdhim_run_map_t *map, uint64_t i, void **key, int *key_len,
+			void **data, int32_t *data_len) {
+	if (key) {
+		*key_len = map->key_lens[i];
+		*key = malloc(*key_len);
+		memcpy(*key, run_key(map, i), *key_len);
+	}
+
+	*data_len = map->value_offs[i + 1] - map->value_offs[i];
+	*data = malloc(*data_len);
+	memcpy(*data, map->values + map->value_offs[i], *data_len);
+}
+
+/**
+ * run_lookup
+ * Finds a key in the run
+ *
+ * @param run       the run handle
+ * @param map       the run
+ * @param key       the key
+ * @param key_len   the length of the key
+ * @return the number of the record or the number of records if the key is not in the run
+ */
+static uint64_t run_lookup(struct mdhim_run_t *run, struct mdhim_run_map_t *map,
+			   void *key, int key_len) {
+	uint64_t hash, i;
+
+	if (run_hash(run->key_type, key, key_len, &hash) &&
+	    !bloom_test(map->bloom, map->header->bloom_bits, hash, 0)) {
+		return map->header->num_records;
+	}
+
+	i = run_find_ge(run, map, key, key_len);
+	if (!run_is_key(run, map, i, key, key_len)) {
+		return map->header->num_records;
+	}
+
+	return i;
+}
+
+static void map_free(struct mdhim_run_map_t *map) {
+	munmap(map->base, map->size);
+	free(map);
+}
+
+/**
+ * run_map
+ * Maps a run file in memory and checks its sections are inside the file
+ *
+ * @param path      the run file
+ * @param key_type  the type of the keys the run must have
+ * @return the mapped run or NULL if there is no usable run file
+ */
+static struct mdhim_run_map_t *run_map(char *path, int key_type) {
+	struct mdhim_run_map_t *map;
+	struct mdhim_run_header_t *header;
+	struct stat st;
+	char *base;
+	uint64_t num;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return NULL;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(struct mdhim_run_header_t)) {
+		close(fd);
+		return NULL;
+	}
+
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		mlog(MDHIM_SERVER_CRIT, "Error mapping the run file: %s - %s", path, strerror(errno));
+		return NULL;
+	}
+
+	header = (struct mdhim_run_header_t *) base;
+	num = header->num_records;
+	if (header->magic != RUN_MAGIC || header->version != RUN_VERSION ||
+	    header->key_type != key_type || header->size != (uint64_t) st.st_size ||
+	    !header->fence_interval || num > header->size ||
+	    header->num_fences != (num + header->fence_interval - 1) / header->fence_interval ||
+	    header->bloom_bits < 8 || (header->bloom_bits & (header->bloom_bits - 1)) ||
+	    header->keys_off + num * header->key_width > header->size ||
+	    header->key_lens_off + num * sizeof(uint32_t) > header->size ||
+	    header->value_offs_off + (num + 1) * sizeof(uint64_t) > header->size ||
+	    header->fences_off + header->num_fences * header->key_width > header->size ||
+	    header->bloom_off + header->bloom_bits / 8 > header->size ||
+	    header->values_off +
+	    ((uint64_t *) (base + header->value_offs_off))[num] > header->size) {
+		mlog(MDHIM_SERVER_CRIT, "Error: the run file: %s is not a run of this index", path);
+		munmap(base, st.st_size);
+		return NULL;
+	}
+
+	map = malloc(sizeof(struct mdhim_run_map_t));
+	memset(map, 0, sizeof(struct mdhim_run_map_t));
+	map->base = base;
+	map->size = st.st_size;
+	map->header = header;
+	map->values = base + header->values_off;
+	map->keys = base + header->keys_off;
+	map->key_lens = (uint32_t *) (base + header->key_lens_off);
+	map->value_offs = (uint64_t *) (base + header->value_offs_off);
+	map->fences = base + header->fences_off;
+	map->bloom = (unsigned char *) (base + header->bloom_off);
+
+	return map;
+}
+
+/**
+ * run_write
+ * Writes a section of a run file and pads it to 8 bytes
+ *
+ * @param fp        the run file
+ * @param buf       the section
+ * @param len       the length of the section
+ * @param pos       in/out  the offset in the file the section is written at
+ * @return MDHIM_SUCCESS or MDHIM_DB_ERROR on error
+ */
+static int run_write(FILE *fp, void *buf, uint64_t len, uint64_t *pos) {
+	static const char zeros[8];
+	uint64_t pad;
+
+	if (len && fwrite(buf, len, 1, fp) != 1) {
+		return MDHIM_DB_ERROR;
+	}
+
+	*pos += len;
+	pad = (8 - (*pos & 7)) & 7;
+	if (pad && fwrite(zeros, pad, 1, fp) != 1) {
+		return MDHIM_DB_ERROR;
+	}
+
+	*pos += pad;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * run_build
+ * Writes the records of the wrapped data store to the run file
+ *
+ * @param run       the run handle
+ * @return MDHIM_SUCCESS or MDHIM_DB_ERROR on error
+ */
+static int run_build(struct mdhim_run_t *run) {
+	struct mdhim_run_header_t header;
+	char tmp[PATH_MAX];
+	FILE *fp;
+	void **keys;
+	uint32_t *key_lens;
+	uint64_t *value_offs;
+	unsigned char *bloom;
+	char *slot;
+	void *key, *value;
+	int key_len;
+	int32_t value_len;
+	uint64_t num, max, i, hash, writes, pos;
+	int ret = MDHIM_DB_ERROR;
+
+	sprintf(tmp, "%s.tmp", run->path);
+	if (!(fp = fopen(tmp, "w"))) {
+		mlog(MDHIM_SERVER_CRIT, "Error opening the run file: %s - %s", tmp, strerror(errno));
+		return MDHIM_DB_ERROR;
+	}
+
+	//Write the values as the records are read, the keys are kept to be put in slots
+	writes = __atomic_load_n(&run->writes, __ATOMIC_ACQUIRE);
+	num = 0;
+	max = RUN_INITIAL_KEYS;
+	keys = malloc(sizeof(void *) * max);
+	key_lens = malloc(sizeof(uint32_t) * max);
+	value_offs = malloc(sizeof(uint64_t) * (max + 1));
+	value_offs[0] = 0;
+	slot = NULL;
+	bloom = NULL;
+
+	//The header is written again once the sections are placed
+	memset(&header, 0, sizeof(struct mdhim_run_header_t));
+	pos = 0;
+	if (run_write(fp, &header, sizeof(struct mdhim_run_header_t), &pos) != MDHIM_SUCCESS) {
+		goto done;
+	}
+
+	header.values_off = pos;
+	key = NULL;
+	key_len = 0;
+	while (1) {
+		value = NULL;
+		value_len = 0;
+		if (run->base.get_next(run->inner, &key, &key_len,
+				       &value, &value_len) != MDHIM_SUCCESS || !key) {
+			break;
+		}
+
+		if (num == max) {
+			max *= 2;
+			keys = realloc(keys, sizeof(void *) * max);
+			key_lens = realloc(key_lens, sizeof(uint32_t) * max);
+			value_offs = realloc(value_offs, sizeof(uint64_t) * (max + 1));
+		}
+
+		keys[num] = key;
+		key_lens[num] = key_len;
+		if ((uint32_t) key_len > header.key_width) {
+			header.key_width = key_len;
+		}
+
+		value_offs[num + 1] = value_offs[num] + value_len;
+		num++;
+		if (value_len && fwrite(value, value_len, 1, fp) != 1) {
+			free(value);
+			goto done;
+		}
+
+		free(value);
+	}
+
+	if (header.key_width > RUN_MAX_KEY_WIDTH) {
+		mlog(MDHIM_SERVER_CRIT, "Error: keys of %u bytes are too wide for a run",
+		     header.key_width);
+		goto done;
+	}
+
+	pos += value_offs[num];
+	if (run_write(fp, NULL, 0, &pos) != MDHIM_SUCCESS) {
+		goto done;
+	}
+
+	header.magic = RUN_MAGIC;
+	header.version = RUN_VERSION;
+	header.key_type = run->key_type;
+	header.num_records = num;
+	header.fence_interval = RUN_FENCE_INTERVAL;
+	header.num_fences = (num + RUN_FENCE_INTERVAL - 1) / RUN_FENCE_INTERVAL;
+
+	//Keys in slots of the same width, so the n'th key is found without reading the others
+	slot = malloc(header.key_width + 1);
+	header.keys_off = pos;
+	for (i = 0; i < num; i++) {
+		memset(slot, 0, header.key_width);
+		memcpy(slot, keys[i], key_lens[i]);
+		if (header.key_width && fwrite(slot, header.key_width, 1, fp) != 1) {
+			goto done;
+		}
+	}
+
+	pos += num * header.key_width;
+	if (run_write(fp, NULL, 0, &pos) != MDHIM_SUCCESS) {
+		goto done;
+	}
+
+	header.key_lens_off = pos;
+	if (run_write(fp, key_lens, num * sizeof(uint32_t), &pos) != MDHIM_SUCCESS) {
+		goto done;
+	}
+
+	header.value_offs_off = pos;
+	if (run_write(fp, value_offs, (num + 1) * sizeof(uint64_t), &pos) != MDHIM_SUCCESS) {
+		goto done;
+	}
+
+	//The fences are the keys the lookups start with, together they are few pages
+	header.fences_off = pos;
+	for (i = 0; i < num; i += RUN_FENCE_INTERVAL) {
+		memset(slot, 0, header.key_width);
+		memcpy(slot, keys[i], key_lens[i]);
+		if (header.key_width && fwrite(slot, header.key_width, 1, fp) != 1) {
+			goto done;
+		}
+	}
+
+	pos += header.num_fences * header.key_width;
+	if (run_write(fp, NULL, 0, &pos) != MDHIM_SUCCESS) {
+		goto done;
+	}
+
+	header.bloom_bits = 64;
+	while (header.bloom_bits < num * RUN_BLOOM_BITS_PER_KEY) {
+		header.bloom_bits <<= 1;
+	}
+
+	bloom = malloc(header.bloom_bits / 8);
+	memset(bloom, 0, header.bloom_bits / 8);
+	for (i = 0; i < num; i++) {
+		if (run_hash(run->key_type, keys[i], key_lens[i], &hash)) {
+			bloom_test(bloom, header.bloom_bits, hash, 1);
+		}
+	}
+
+	header.bloom_off = pos;
+	if (run_write(fp, bloom, header.bloom_bits / 8, &pos) != MDHIM_SUCCESS) {
+		goto done;
+	}
+
+	header.size = pos;
+	if (fseek(fp, 0, SEEK_SET) != 0 ||
+	    fwrite(&header, sizeof(struct mdhim_run_header_t), 1, fp) != 1 ||
+	    fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+		goto done;
+	}
+
+	//A write while the records were read makes the run stale
+	if (__atomic_load_n(&run->writes, __ATOMIC_ACQUIRE) != writes) {
+		mlog(MDHIM_SERVER_CRIT, "Error: the data store was written while making its run");
+		goto done;
+	}
+
+	ret = MDHIM_SUCCESS;
+
+done:
+	if (fclose(fp) != 0) {
+		ret = MDHIM_DB_ERROR;
+	}
+
+	if (ret == MDHIM_SUCCESS && rename(tmp, run->path) != 0) {
+		mlog(MDHIM_SERVER_CRIT, "Error renaming the run file: %s - %s",
+		     tmp, strerror(errno));
+		ret = MDHIM_DB_ERROR;
+	}
+
+	if (ret != MDHIM_SUCCESS) {
+		unlink(tmp);
+	}
+
+	for (i = 0; i < num; i++) {
+		free(keys[i]);
+	}
+
+	free(keys);
+	free(key_lens);
+	free(value_offs);
+	free(slot);
+	free(bloom);
+
+	return ret;
+}
+
+/**
+ * run_drop
+ * Drops the run before the wrapped data store is written to.  Cursors may still be on the
+ * run, so it stays mapped until the data store is closed
+ *
+ * @param run       the run handle
+ */
+static void run_drop(struct mdhim_run_t *run) {
+	struct mdhim_run_map_t *map;
+
+	__atomic_add_fetch(&run->writes, 1, __ATOMIC_ACQ_REL);
+	if (!run_current(run)) {
+		return;
+	}
+
+	pthread_mutex_lock(&run->lock);
+	if ((map = run->map)) {
+		__atomic_store_n(&run->map, NULL, __ATOMIC_RELEASE);
+		map->next = run->retired;
+		run->retired = map;
+		unlink(run->path);
+	}
+	pthread_mutex_unlock(&run->lock);
+}
+
+static struct mdhim_run_t *run_create(struct mdhim_store_t *store, void *inner, int key_type) {
+	struct mdhim_run_t *run;
+
+	run = malloc(sizeof(struct mdhim_run_t));
+	memset(run, 0, sizeof(struct mdhim_run_t));
+	run->base = *store;
+	run->inner = inner;
+	run->key_type = key_type;
+	pthread_mutex_init(&run->lock, NULL);
+
+	return run;
+}
+
+static void run_destroy(struct mdhim_run_t *run) {
+	struct mdhim_run_map_t *map, *next;
+
+	if (run->map) {
+		map_free(run->map);
+	}
+
+	for (map = run->retired; map; map = next) {
+		next = map->next;
+		map_free(map);
+	}
+
+	pthread_mutex_destroy(&run->lock);
+	free(run->path);
+	free(run);
+}
+
+/**
+ * mdhim_run_wrap
+ * Wraps an opened data store with a run handle and maps the run left by an earlier job
+ *
+ * @param store      in   the opened data store
+ * @param path       in   path of the data store, the run file is path + "_run"
+ * @param key_type   in   the type of the keys
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_wrap(struct mdhim_store_t *store, char *path, int key_type) {
+	struct mdhim_run_t *run;
+	void *key, *data;
+	int key_len;
+	int32_t data_len;
+
+	//Check to see if the given path + "_run.tmp" and the null char will be more than the max
+	if (strlen(path) + 9 > PATH_MAX) {
+		mlog(MDHIM_SERVER_CRIT, "Error wrapping the data store - path provided is too long");
+		return MDHIM_DB_ERROR;
+	}
+
+	run = run_create(store, store->db_handle, key_type);
+	run->stats = run_create(store, store->db_stats, MDHIM_INT_KEY);
+	run->path = malloc(strlen(path) + 5);
+	sprintf(run->path, "%s_run", path);
+	run->map = run_map(run->path, key_type);
+
+	//A data store that lost its records, like an in memory one, is newer than its run
+	key = data = NULL;
+	key_len = data_len = 0;
+	if (run->map && run->map->header->num_records &&
+	    (store->get_next(store->db_handle, &key, &key_len,
+			     &data, &data_len) != MDHIM_SUCCESS || !key)) {
+		unlink(run->path);
+		map_free(run->map);
+		run->map = NULL;
+	}
+
+	free(key);
+	free(data);
+
+	store->db_handle = run;
+	store->db_stats = run->stats;
+	store->put = mdhim_run_put;
+	store->batch_put = mdhim_run_batch_put;
+	store->batch_append = store->batch_append ? mdhim_run_batch_append : NULL;
+	store->get = mdhim_run_get;
+	store->batch_get = store->batch_get ? mdhim_run_batch_get : NULL;
+	store->get_next = mdhim_run_get_next;
+	store->get_prev = mdhim_run_get_prev;
+	store->del = mdhim_run_del;
+	store->batch_del = store->batch_del ? mdhim_run_batch_del : NULL;
+	store->commit = mdhim_run_commit;
+	store->close = mdhim_run_close;
+	if (store->cursor_open) {
+		store->cursor_open = mdhim_run_cursor_open;
+		store->cursor_seek = mdhim_run_cursor_seek;
+		store->cursor_get = mdhim_run_cursor_get;
+		store->cursor_close = mdhim_run_cursor_close;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_freeze
+ * Makes a run of the records of the data store and serves reads from it
+ *
+ * @param store      in   the data store wrapped by mdhim_run_wrap
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_freeze(struct mdhim_store_t *store) {
+	struct mdhim_run_t *run;
+	struct mdhim_run_map_t *map;
+	int ret = MDHIM_SUCCESS;
+
+	if (store->close != mdhim_run_close) {
+		return MDHIM_DB_ERROR;
+	}
+
+	run = (struct mdhim_run_t *) store->db_handle;
+	pthread_mutex_lock(&run->lock);
+	if (!run->map && (ret = run_build(run)) == MDHIM_SUCCESS) {
+		if ((map = run_map(run->path, run->key_type))) {
+			__atomic_store_n(&run->map, map, __ATOMIC_RELEASE);
+		} else {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+	pthread_mutex_unlock(&run->lock);
+
+	return ret;
+}
+
+/**
+ * mdhim_run_thaw
+ * Drops the run of the data store, reads go to the data store again
+ *
+ * @param store      in   the data store wrapped by mdhim_run_wrap
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_thaw(struct mdhim_store_t *store) {
+	if (store->close != mdhim_run_close) {
+		return MDHIM_DB_ERROR;
+	}
+
+	run_drop((struct mdhim_run_t *) store->db_handle);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_put
+ * Stores a single key in the data store
+ *
+ * @param dbh         in   pointer to the run handle
+ * @param key         in   void * to the key to store
+ * @param key_len     in   length of the key
+ * @param data        in   void * to the value of the key
+ * @param data_len    in   length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_put(void *dbh, void *key, int key_len, void *data, int32_t data_len) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+
+	run_drop(run);
+
+	return run->base.put(run->inner, key, key_len, data, data_len);
+}
+
+/**
+ * mdhim_run_batch_put
+ * Stores multiple keys in the data store
+ *
+ * @param dbh          in   pointer to the run handle
+ * @param keys         in   void ** to the keys to store
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         in   void ** to the values of the keys
+ * @param data_lens    in   int32_t * to the lengths of the value data
+ * @param num_records  in   int for the number of records to store
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+
+	run_drop(run);
+
+	return run->base.batch_put(run->inner, keys, key_lens, data, data_lens, num_records);
+}
+
+/**
+ * mdhim_run_batch_append
+ * Appends the values to the values of the keys in the data store
+ *
+ * @param dbh          in   pointer to the run handle
+ * @param keys         in   void ** to the keys to append to
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         in   void ** to the values to append
+ * @param data_lens    in   int32_t * to the lengths of the values
+ * @param exists       in/out  int * whether each key may already be in the data store
+ * @param num_records  in   int for the number of records
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			   void **data, int32_t *data_lens, int *exists, int num_records) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+
+	run_drop(run);
+
+	return run->base.batch_append(run->inner, keys, key_lens, data, data_lens,
+				      exists, num_records);
+}
+
+/**
+ * mdhim_run_get
+ * Gets a value, given a key, from the run or the data store
+ *
+ * @param dbh         in   pointer to the run handle
+ * @param key         in   void * to the key to retrieve the value of
+ * @param key_len     in   length of the key
+ * @param data        out  void ** to the value of the key
+ * @param data_len    out  pointer to length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+	struct mdhim_run_map_t *map;
+	uint64_t i;
+
+	if (!(map = run_current(run))) {
+		return run->base.get(run->inner, key, key_len, data, data_len);
+	}
+
+	*data = NULL;
+	i = run_lookup(run, map, key, key_len);
+	if (i == map->header->num_records) {
+		return MDHIM_DB_ERROR;
+	}
+
+	copy_record(map, i, NULL, NULL, data, data_len);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_batch_get
+ * Gets the values of several keys
+ *
+ * @param dbh          in   pointer to the run handle
+ * @param keys         in   void ** to the keys to retrieve the values of
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         out  void ** to the values, NULL for keys that weren't found
+ * @param data_lens    out  int32_t * to the lengths of the values
+ * @param num_records  in   int for the number of keys
+ *
+ * @return MDHIM_SUCCESS if every key was found or MDHIM_DB_ERROR otherwise
+ */
+int mdhim_run_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+	struct mdhim_run_map_t *map;
+	uint64_t j;
+	int ret = MDHIM_SUCCESS;
+	int i;
+
+	if (!(map = run_current(run))) {
+		return run->base.batch_get(run->inner, keys, key_lens, data, data_lens, num_records);
+	}
+
+	for (i = 0; i < num_records; i++) {
+		data[i] = NULL;
+		data_lens[i] = 0;
+		j = run_lookup(run, map, keys[i], key_lens[i]);
+		if (j < map->header->num_records) {
+			copy_record(map, j, NULL, NULL, &data[i], &data_lens[i]);
+		} else {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * mdhim_run_get_next
+ * Gets the next key/value from the run or the data store
+ *
+ * @param dbh             in   pointer to the run handle
+ * @param key             in/out  void ** to the key to start after, NULL for the first key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no next key
+ */
+int mdhim_run_get_next(void *dbh, void **key, int *key_len,
+		       void **data, int32_t *data_len) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+	struct mdhim_run_map_t *map;
+	uint64_t i;
+
+	if (!(map = run_current(run))) {
+		return run->base.get_next(run->inner, key, key_len, data, data_len);
+	}
+
+	if (!*key || !*key_len) {
+		i = 0;
+	} else {
+		i = run_find_ge(run, map, *key, *key_len);
+		if (run_is_key(run, map, i, *key, *key_len)) {
+			i++;
+		}
+	}
+
+	if (i >= map->header->num_records) {
+		*key = NULL;
+		*key_len = 0;
+		*data = NULL;
+		*data_len = 0;
+		return MDHIM_DB_ERROR;
+	}
+
+	copy_record(map, i, key, key_len, data, data_len);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_get_prev
+ * Gets the previous key/value from the run or the data store
+ *
+ * @param dbh             in   pointer to the run handle
+ * @param key             in/out  void ** to the key to start before, NULL for the last key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no previous key
+ */
+int mdhim_run_get_prev(void *dbh, void **key, int *key_len,
+		       void **data, int32_t *data_len) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+	struct mdhim_run_map_t *map;
+	uint64_t i;
+
+	if (!(map = run_current(run))) {
+		return run->base.get_prev(run->inner, key, key_len, data, data_len);
+	}
+
+	if (!*key || !*key_len) {
+		i = map->header->num_records;
+	} else {
+		i = run_find_ge(run, map, *key, *key_len);
+	}
+
+	if (!i) {
+		*key = NULL;
+		*key_len = 0;
+		*data = NULL;
+		*data_len = 0;
+		return MDHIM_DB_ERROR;
+	}
+
+	copy_record(map, i - 1, key, key_len, data, data_len);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_del
+ * delete the given key
+ *
+ * @param dbh         in   pointer to the run handle
+ * @param key         in   void * for the key to delete
+ * @param key_len     in   int for the length of the key
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_del(void *dbh, void *key, int key_len) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+
+	run_drop(run);
+
+	return run->base.del(run->inner, key, key_len);
+}
+
+/**
+ * mdhim_run_batch_del
+ * Deletes several keys
+ *
+ * @param dbh          in   pointer to the run handle
+ * @param keys         in   void ** to the keys to delete
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param found        out  int * set to whether each key was in the data store
+ * @param num_records  in   int for the number of keys
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			int *found, int num_records) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+
+	run_drop(run);
+
+	return run->base.batch_del(run->inner, keys, key_lens, found, num_records);
+}
+
+/**
+ * mdhim_run_commit
+ * Write pending records of the data store to disk
+ *
+ * @param dbh         in   pointer to the run handle
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_commit(void *dbh) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+
+	return run->base.commit(run->inner);
+}
+
+/**
+ * mdhim_run_close
+ * Closes the data store and unmaps its runs.  The run file is kept for the next job
+ *
+ * @param dbh         in   pointer to the run handle
+ * @param dbs         in   pointer to the run handle of the stats
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_close(void *dbh, void *dbs) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+	struct mdhim_run_t *stats = (struct mdhim_run_t *) dbs;
+	int ret;
+
+	ret = run->base.close(run->inner, stats->inner);
+	run_destroy(stats);
+	run_destroy(run);
+
+	return ret;
+}
+
+/**
+ * mdhim_run_cursor_open
+ * Opens a cursor on the run, or on the data store if there is no run
+ *
+ * @param dbh     in   pointer to the run handle
+ * @param cursor  out  pointer to the new cursor
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_run_cursor_open(void *dbh, void **cursor) {
+	struct mdhim_run_t *run = (struct mdhim_run_t *) dbh;
+	struct mdhim_run_cursor_t *cur;
+	int ret;
+
+	cur = malloc(sizeof(struct mdhim_run_cursor_t));
+	memset(cur, 0, sizeof(struct mdhim_run_cursor_t));
+	cur->run = run;
+	cur->pos = -1;
+	if (!(cur->map = run_current(run)) &&
+	    (ret = run->base.cursor_open(run->inner, &cur->inner)) != MDHIM_SUCCESS) {
+		free(cur);
+		return ret;
+	}
+
+	*cursor = cur;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_cursor_seek
+ * Positions the cursor on the given key
+ *
+ * @param cursor  in   pointer to the cursor
+ * @param key     in   void * to the key to position the cursor on, NULL for the first key
+ * @param key_len in   int for the length of the key
+ * @param op      in   MDHIM_GET_EQ to position on the key itself or
+ *                     MDHIM_GET_NEXT to position on the first key not before it
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no such key
+ */
+int mdhim_run_cursor_seek(void *cursor, void *key, int key_len, int op) {
+	struct mdhim_run_cursor_t *cur = (struct mdhim_run_cursor_t *) cursor;
+
+	if (!cur->map) {
+		return cur->run->base.cursor_seek(cur->inner, key, key_len, op);
+	}
+
+	cur->pos = key && key_len ? run_find_ge(cur->run, cur->map, key, key_len) : 0;
+	if ((uint64_t) cur->pos >= cur->map->header->num_records ||
+	    (op == MDHIM_GET_EQ && key && key_len &&
+	     !run_is_key(cur->run, cur->map, cur->pos, key, key_len))) {
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_cursor_get
+ * Gets the record under the cursor after moving it as the operation says
+ *
+ * @param cursor   in   pointer to the cursor
+ * @param op       in   MDHIM_GET_EQ to read the current record, MDHIM_GET_NEXT or
+ *                      MDHIM_GET_PREV to move the cursor first
+ * @param key      out  void ** to the key that we get
+ * @param key_len  out  int * to the length of the key
+ * @param data     out  void ** to the value belonging to the key
+ * @param data_len out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if the cursor ran off the run
+ */
+int mdhim_run_cursor_get(void *cursor, int op, void **key, int *key_len,
+			 void **data, int32_t *data_len) {
+	struct mdhim_run_cursor_t *cur = (struct mdhim_run_cursor_t *) cursor;
+	int64_t num;
+
+	if (!cur->map) {
+		return cur->run->base.cursor_get(cur->inner, op, key, key_len, data, data_len);
+	}
+
+	*key = NULL;
+	*key_len = 0;
+	*data = NULL;
+	*data_len = 0;
+	num = cur->map->header->num_records;
+	if (cur->pos < 0 || cur->pos >= num) {
+		return MDHIM_DB_ERROR;
+	}
+
+	if (op == MDHIM_GET_NEXT) {
+		cur->pos++;
+	} else if (op == MDHIM_GET_PREV) {
+		cur->pos--;
+	}
+
+	if (cur->pos < 0 || cur->pos >= num) {
+		return MDHIM_DB_ERROR;
+	}
+
+	copy_record(cur->map, cur->pos, key, key_len, data, data_len);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_run_cursor_close
+ * Closes the cursor
+ *
+ * @param cursor  in   pointer to the cursor
+ */
+void mdhim_run_cursor_close(void *cursor) {
+	struct mdhim_run_cursor_t *cur = (struct mdhim_run_cursor_t *) cursor;
+
+	if (!cur) {
+		return;
+	}
+
+	if (cur->inner) {
+		cur->run->base.cursor_close(cur->inner);
+	}
+
+	free(cur);
+}
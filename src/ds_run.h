@@ -0,0 +1,107 @@
+/*
+ * MDHIM TNG
+ *
+ * Immutable sorted runs served from a memory mapped file
+ */
+
+#ifndef      __RUN_H
+#define      __RUN_H
+
+#include <pthread.h>
+#include "mdhim.h"
+#include "partitioner.h"
+#include "data_store.h"
+
+//"MDHIMRUN" in the first bytes of a run file
+#define RUN_MAGIC 0x4e55524d4948444dULL
+#define RUN_VERSION 1
+//Number of records between two keys of the fence index
+#define RUN_FENCE_INTERVAL 64
+//Bits of the Bloom filter per record and number of bits set per key
+#define RUN_BLOOM_BITS_PER_KEY 10
+#define RUN_BLOOM_HASHES 6
+//Widest key slot a run is made with, longer keys keep the index on its data store
+#define RUN_MAX_KEY_WIDTH 4096
+
+/* Start of a run file.  The sections it points to are 8 byte aligned and
+   written in the byte order of the machine that made the run */
+struct mdhim_run_header_t {
+	uint64_t magic;
+	uint32_t version;
+	int32_t key_type;
+	uint64_t num_records;
+	uint32_t key_width;          //Bytes of each key slot, keys are padded with zeros
+	uint32_t fence_interval;
+	uint64_t num_fences;
+	uint64_t bloom_bits;         //A power of 2
+	uint64_t values_off;         //Values of the records, back to back
+	uint64_t keys_off;           //num_records key slots
+	uint64_t key_lens_off;       //num_records uint32_t
+	uint64_t value_offs_off;     //num_records + 1 uint64_t offsets into the values
+	uint64_t fences_off;         //The key slot of every fence_interval'th record
+	uint64_t bloom_off;
+	uint64_t size;               //Size of the whole file
+};
+
+/* A run file mapped in memory */
+struct mdhim_run_map_t {
+	char *base;
+	size_t size;
+	struct mdhim_run_header_t *header;
+	char *values;
+	char *keys;
+	uint32_t *key_lens;
+	uint64_t *value_offs;
+	char *fences;
+	unsigned char *bloom;
+	struct mdhim_run_map_t *next;  //Next retired map
+};
+
+/* Handle of a data store with a run in front of it.  Reads are served from the run while
+   there is one, everything else goes to the wrapped data store */
+struct mdhim_run_t {
+	struct mdhim_store_t base;     //Functions of the wrapped data store
+	void *inner;                   //Handle of the wrapped data store
+	struct mdhim_run_map_t *map;   //The run, NULL if there is none
+	struct mdhim_run_map_t *retired; //Runs dropped while cursors may still read them
+	pthread_mutex_t lock;          //Held while the run is made or dropped
+	uint64_t writes;               //Number of writes started, a run read while it changed is stale
+	int key_type;
+	char *path;                    //The run file, NULL for the stats handle
+	struct mdhim_run_t *stats;     //The stats handle, NULL for the stats handle itself
+};
+
+//A cursor reads the run it was opened on until it is closed
+struct mdhim_run_cursor_t {
+	struct mdhim_run_t *run;
+	struct mdhim_run_map_t *map;   //NULL if the cursor is on the wrapped data store
+	void *inner;                   //Cursor of the wrapped data store
+	int64_t pos;                   //Record of the run the cursor is on
+};
+
+int mdhim_run_wrap(struct mdhim_store_t *store, char *path, int key_type);
+int mdhim_run_freeze(struct mdhim_store_t *store);
+int mdhim_run_thaw(struct mdhim_store_t *store);
+int mdhim_run_put(void *dbh, void *key, int key_len, void *data, int32_t data_len);
+int mdhim_run_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			void **data, int32_t *data_lens, int num_records);
+int mdhim_run_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			   void **data, int32_t *data_lens, int *exists, int num_records);
+int mdhim_run_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len);
+int mdhim_run_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			void **data, int32_t *data_lens, int num_records);
+int mdhim_run_get_next(void *dbh, void **key, int *key_len,
+		       void **data, int32_t *data_len);
+int mdhim_run_get_prev(void *dbh, void **key, int *key_len,
+		       void **data, int32_t *data_len);
+int mdhim_run_del(void *dbh, void *key, int key_len);
+int mdhim_run_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			int *found, int num_records);
+int mdhim_run_commit(void *dbh);
+int mdhim_run_close(void *dbh, void *dbs);
+int mdhim_run_cursor_open(void *dbh, void **cursor);
+int mdhim_run_cursor_seek(void *cursor, void *key, int key_len, int op);
+int mdhim_run_cursor_get(void *cursor, int op, void **key, int *key_len,
+			 void **data, int32_t *data_len);
+void mdhim_run_cursor_close(void *cursor);
+#endif
@@ -0,0 +1,965 @@
+/*
+ * MDHIM TNG
+ *
+ * Data stores split into shards by slice
+ *
+ * With db_num_shards above 1, a range server keeps each index in that many data stores
+ * of the index's type instead of one.  A record goes to the shard its slice hashes to, so
+ * every shard has its own memtable and log, and worker threads writing to different
+ * shards don't wait on each other.  The first shard is opened at the path an index with
+ * a single data store has, the others at "<path prefix>_shard<n>-<index id>-<rank>".
+ * Reads of a key go to its shard, while ordered reads merge the records of every shard.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <linux/limits.h>
+#include "ds_shard.h"
+
+/**
+ * shard_of
+ * Gets the shard holding a key
+ *
+ * @param shard    the shard handle
+ * @param key      the key
+ * @param key_len  the length of the key
+ * @return the number of the shard
+ */
+static int shard_of(struct mdhim_shard_t *shard, void *key, int key_len) {
+	int slice;
+
+	if (shard->num_shards == 1) {
+		return 0;
+	}
+
+	//The slices of a range server are strided by the number of range servers, so hash them
+	if ((slice = get_slice_num(shard->md, shard->index, key, key_len)) < 0) {
+		return 0;
+	}
+
+	return (int) ((((uint64_t) slice * 0x9e3779b97f4a7c15ULL) >> 32) % shard->num_shards);
+}
+
+/**
+ * shard_split
+ * Orders the records of a batch by the shard they go to
+ *
+ * @param shard        the shard handle
+ * @param keys         the keys of the batch
+ * @param key_lens     the lengths of the keys
+ * @param num_records  the number of records
+ * @param starts       out  num_shards + 1 offsets into the order where each shard's records start
+ * @return the records of the batch ordered by shard
+ */
+static int *shard_split(struct mdhim_shard_t *shard, void **keys, int32_t *key_lens,
+			int num_records, int *starts) {
+	int *order, *which;
+	int i;
+
+	order = malloc(sizeof(int) * num_records);
+	which = malloc(sizeof(int) * num_records);
+	memset(starts, 0, sizeof(int) * (shard->num_shards + 1));
+	for (i = 0; i < num_records; i++) {
+		which[i] = shard_of(shard, keys[i], key_lens[i]);
+		starts[which[i] + 1]++;
+	}
+
+	for (i = 0; i < shard->num_shards; i++) {
+		starts[i + 1] += starts[i];
+	}
+
+	//Fill each shard's part of the order, then move the offsets back to where they started
+	for (i = 0; i < num_records; i++) {
+		order[starts[which[i]]++] = i;
+	}
+
+	for (i = shard->num_shards; i > 0; i--) {
+		starts[i] = starts[i - 1];
+	}
+
+	starts[0] = 0;
+	free(which);
+
+	return order;
+}
+
+/* The records of one shard's part of a batch */
+struct shard_batch_t {
+	void **keys;
+	int32_t *key_lens;
+	void **data;
+	int32_t *data_lens;
+	int *flags;
+};
+
+/**
+ * shard_batch_init
+ * Makes the arrays to pass a shard its part of a batch in
+ *
+ * @param batch        the batch to make
+ * @param num_records  the number of records of the whole batch
+ */
+static void shard_batch_init(struct shard_batch_t *batch, int num_records) {
+	batch->keys = malloc(sizeof(void *) * num_records);
+	batch->key_lens = malloc(sizeof(int32_t) * num_records);
+	batch->data = malloc(sizeof(void *) * num_records);
+	batch->data_lens = malloc(sizeof(int32_t) * num_records);
+	batch->flags = malloc(sizeof(int) * num_records);
+}
+
+/**
+ * shard_batch_fill
+ * Copies a shard's part of a batch into the arrays passed to the shard
+ *
+ * @param batch    the batch to fill
+ * @param order    the records ordered by shard
+ * @param start    the first record of the shard in the order
+ * @param num      the number of records of the shard
+ * @param keys     the keys of the whole batch
+ * @param key_lens the lengths of the keys
+ * @param data     the values of the whole batch, NULL if there are none
+ * @param data_lens the lengths of the values
+ */
+static void shard_batch_fill(struct shard_batch_t *batch, int *order, int start, int num,
+			     void **keys, int32_t *key_lens, void **data, int32_t *data_lens) {
+	int i, j;
+
+	for (i = 0; i < num; i++) {
+		j = order[start + i];
+		batch->keys[i] = keys[j];
+		batch->key_lens[i] = key_lens[j];
+		batch->data[i] = data ? data[j] : NULL;
+		batch->data_lens[i] = data_lens ? data_lens[j] : 0;
+		batch->flags[i] = 0;
+	}
+}
+
+static void shard_batch_free(struct shard_batch_t *batch) {
+	free(batch->keys);
+	free(batch->key_lens);
+	free(batch->data);
+	free(batch->data_lens);
+	free(batch->flags);
+}
+
+/**
+ * shard_create
+ * Makes a shard handle with the functions of the data store it wraps
+ *
+ * @param md          the main MDHIM structure
+ * @param index       the index the keys are sliced by, NULL for a stats handle
+ * @param store       the data store with the functions of the shards
+ * @param num_shards  the number of shards
+ * @return the handle
+ */
+static struct mdhim_shard_t *shard_create(struct mdhim_t *md, struct index_t *index,
+					  struct mdhim_store_t *store, int num_shards) {
+	struct mdhim_shard_t *shard;
+
+	shard = malloc(sizeof(struct mdhim_shard_t));
+	memset(shard, 0, sizeof(struct mdhim_shard_t));
+	shard->base = *store;
+	shard->num_shards = num_shards;
+	shard->inner = malloc(sizeof(void *) * num_shards);
+	shard->inner_stats = malloc(sizeof(void *) * num_shards);
+	memset(shard->inner, 0, sizeof(void *) * num_shards);
+	memset(shard->inner_stats, 0, sizeof(void *) * num_shards);
+	shard->md = md;
+	shard->index = index;
+
+	return shard;
+}
+
+static void shard_destroy(struct mdhim_shard_t *shard) {
+	free(shard->inner);
+	free(shard->inner_stats);
+	free(shard);
+}
+
+/**
+ * mdhim_shard_wrap
+ * Opens the other shards of an index and wraps them with its opened data store
+ *
+ * @param md         the main MDHIM structure
+ * @param index      the index the data store is of
+ * @param store      the data store, opened at prefix + suffix
+ * @param prefix     path of the data store up to the index id
+ * @param suffix     "-<index id>-<rank>" ending the path of the data store
+ * @param flags      the flags the data store was opened with
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_wrap(struct mdhim_t *md, struct index_t *index, struct mdhim_store_t *store,
+		     char *prefix, char *suffix, int flags) {
+	struct mdhim_shard_t *shard, *stats;
+	char path[PATH_MAX];
+	int i, j;
+
+	//A single data store is used as it is
+	if (index->num_shards <= 1) {
+		return MDHIM_SUCCESS;
+	}
+
+	shard = shard_create(md, index, store, index->num_shards);
+	shard->inner[0] = store->db_handle;
+	shard->inner_stats[0] = store->db_stats;
+	for (i = 1; i < shard->num_shards; i++) {
+		if (snprintf(path, PATH_MAX, "%s_shard%d%s", prefix, i, suffix) >= PATH_MAX) {
+			mlog(MDHIM_SERVER_CRIT, "Error opening shard %d - path provided is too long", i);
+			goto error;
+		}
+
+		if (store->open(&shard->inner[i], &shard->inner_stats[i], path, flags,
+				index->key_type, md->db_opts) != MDHIM_SUCCESS) {
+			mlog(MDHIM_SERVER_CRIT, "Error opening shard: %s", path);
+			goto error;
+		}
+	}
+
+	//The stats are only kept by the first shard
+	stats = shard_create(md, NULL, store, 1);
+	stats->inner[0] = store->db_stats;
+	shard->stats = stats;
+
+	store->db_handle = shard;
+	store->db_stats = stats;
+	store->put = mdhim_shard_put;
+	store->batch_put = mdhim_shard_batch_put;
+	store->batch_append = store->batch_append ? mdhim_shard_batch_append : NULL;
+	store->get = mdhim_shard_get;
+	store->batch_get = store->batch_get ? mdhim_shard_batch_get : NULL;
+	store->get_next = mdhim_shard_get_next;
+	store->get_prev = mdhim_shard_get_prev;
+	store->del = mdhim_shard_del;
+	store->batch_del = store->batch_del ? mdhim_shard_batch_del : NULL;
+	store->commit = mdhim_shard_commit;
+	store->close = mdhim_shard_close;
+	if (store->cursor_open) {
+		store->cursor_open = mdhim_shard_cursor_open;
+		store->cursor_seek = mdhim_shard_cursor_seek;
+		store->cursor_get = mdhim_shard_cursor_get;
+		store->cursor_close = mdhim_shard_cursor_close;
+	}
+
+	return MDHIM_SUCCESS;
+
+error:
+	for (j = 1; j < i; j++) {
+		store->close(shard->inner[j], shard->inner_stats[j]);
+	}
+
+	shard_destroy(shard);
+
+	return MDHIM_DB_ERROR;
+}
+
+/**
+ * mdhim_shard_put
+ * Stores a single key in the shard of its slice
+ *
+ * @param dbh         in   pointer to the shard handle
+ * @param key         in   void * to the key to store
+ * @param key_len     in   length of the key
+ * @param data        in   void * to the value of the key
+ * @param data_len    in   length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_put(void *dbh, void *key, int key_len, void *data, int32_t data_len) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+
+	return shard->base.put(shard->inner[shard_of(shard, key, key_len)],
+			       key, key_len, data, data_len);
+}
+
+/**
+ * mdhim_shard_batch_put
+ * Stores multiple keys, each shard gets its records in one batch
+ *
+ * @param dbh         in   pointer to the shard handle
+ * @param keys        in   void ** to the keys to store
+ * @param key_lens    in   int32_t * to the lengths of the keys
+ * @param data        in   void ** to the values of the keys
+ * @param data_lens   in   int32_t * to the lengths of the values
+ * @param num_records in   int for the number of records to store
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			  void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+	struct shard_batch_t batch;
+	int starts[MDHIM_MAX_SHARDS + 1];
+	int *order;
+	int ret = MDHIM_SUCCESS;
+	int i, num;
+
+	if (shard->num_shards == 1) {
+		return shard->base.batch_put(shard->inner[0], keys, key_lens, data, data_lens,
+					     num_records);
+	}
+
+	order = shard_split(shard, keys, key_lens, num_records, starts);
+	shard_batch_init(&batch, num_records);
+	for (i = 0; i < shard->num_shards; i++) {
+		if (!(num = starts[i + 1] - starts[i])) {
+			continue;
+		}
+
+		shard_batch_fill(&batch, order, starts[i], num, keys, key_lens, data, data_lens);
+		if (shard->base.batch_put(shard->inner[i], batch.keys, batch.key_lens,
+					  batch.data, batch.data_lens, num) != MDHIM_SUCCESS) {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+
+	shard_batch_free(&batch);
+	free(order);
+
+	return ret;
+}
+
+/**
+ * mdhim_shard_batch_append
+ * Appends values to the values of multiple keys, each shard gets its records in one batch
+ *
+ * @param dbh         in   pointer to the shard handle
+ * @param keys        in   void ** to the keys to append to
+ * @param key_lens    in   int32_t * to the lengths of the keys
+ * @param data        in   void ** to the values to append
+ * @param data_lens   in   int32_t * to the lengths of the values
+ * @param exists      out  int * set to whether each key had a value
+ * @param num_records in   int for the number of records
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			     void **data, int32_t *data_lens, int *exists, int num_records) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+	struct shard_batch_t batch;
+	int starts[MDHIM_MAX_SHARDS + 1];
+	int *order;
+	int ret = MDHIM_SUCCESS;
+	int i, j, num;
+
+	if (shard->num_shards == 1) {
+		return shard->base.batch_append(shard->inner[0], keys, key_lens, data, data_lens,
+						exists, num_records);
+	}
+
+	order = shard_split(shard, keys, key_lens, num_records, starts);
+	shard_batch_init(&batch, num_records);
+	for (i = 0; i < shard->num_shards; i++) {
+		if (!(num = starts[i + 1] - starts[i])) {
+			continue;
+		}
+
+		shard_batch_fill(&batch, order, starts[i], num, keys, key_lens, data, data_lens);
+		if (shard->base.batch_append(shard->inner[i], batch.keys, batch.key_lens,
+					     batch.data, batch.data_lens, batch.flags,
+					     num) != MDHIM_SUCCESS) {
+			ret = MDHIM_DB_ERROR;
+		}
+
+		for (j = 0; j < num; j++) {
+			exists[order[starts[i] + j]] = batch.flags[j];
+		}
+	}
+
+	shard_batch_free(&batch);
+	free(order);
+
+	return ret;
+}
+
+/**
+ * mdhim_shard_get
+ * Gets the value of a key from the shard of its slice
+ *
+ * @param dbh       in   pointer to the shard handle
+ * @param key       in   void * to the key to retrieve the value of
+ * @param key_len   in   length of the key
+ * @param data      out  void ** to the value
+ * @param data_len  out  int32_t * to the length of the value
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+
+	return shard->base.get(shard->inner[shard_of(shard, key, key_len)],
+			       key, key_len, data, data_len);
+}
+
+/**
+ * mdhim_shard_batch_get
+ * Gets the values of several keys, each shard gets its keys in one batch
+ *
+ * @param dbh          in   pointer to the shard handle
+ * @param keys         in   void ** to the keys to retrieve the values of
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param data         out  void ** to the values, NULL for keys that weren't found
+ * @param data_lens    out  int32_t * to the lengths of the values
+ * @param num_records  in   int for the number of keys
+ *
+ * @return MDHIM_SUCCESS if every key was found or MDHIM_DB_ERROR otherwise
+ */
+int mdhim_shard_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			  void **data, int32_t *data_lens, int num_records) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+	struct shard_batch_t batch;
+	int starts[MDHIM_MAX_SHARDS + 1];
+	int *order;
+	int ret = MDHIM_SUCCESS;
+	int i, j, num;
+
+	if (shard->num_shards == 1) {
+		return shard->base.batch_get(shard->inner[0], keys, key_lens, data, data_lens,
+					     num_records);
+	}
+
+	order = shard_split(shard, keys, key_lens, num_records, starts);
+	shard_batch_init(&batch, num_records);
+	for (i = 0; i < shard->num_shards; i++) {
+		if (!(num = starts[i + 1] - starts[i])) {
+			continue;
+		}
+
+		shard_batch_fill(&batch, order, starts[i], num, keys, key_lens, NULL, NULL);
+		if (shard->base.batch_get(shard->inner[i], batch.keys, batch.key_lens,
+					  batch.data, batch.data_lens, num) != MDHIM_SUCCESS) {
+			ret = MDHIM_DB_ERROR;
+		}
+
+		for (j = 0; j < num; j++) {
+			data[order[starts[i] + j]] = batch.data[j];
+			data_lens[order[starts[i] + j]] = batch.data_lens[j];
+		}
+	}
+
+	shard_batch_free(&batch);
+	free(order);
+
+	return ret;
+}
+
+/**
+ * shard_get_adjacent
+ * Gets the record of any shard closest to a key in the given direction
+ *
+ * @param shard     the shard handle
+ * @param dir       1 for the next record, -1 for the previous one
+ * @param key       in/out  the key to start from, NULL to start from the end.
+ *                          Set to the key that we get
+ * @param key_len   in/out  the length of the key
+ * @param data      out  the value belonging to the key
+ * @param data_len  out  the length of the value
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if no shard has such a record
+ */
+static int shard_get_adjacent(struct mdhim_shard_t *shard, int dir, void **key, int *key_len,
+			      void **data, int32_t *data_len) {
+	void *start, *best_key, *best_data, *next_key, *next_data;
+	int start_len, best_key_len, next_key_len;
+	int32_t best_data_len, next_data_len;
+	int i, ret;
+
+	start = *key;
+	start_len = *key_len;
+	best_key = best_data = NULL;
+	best_key_len = best_data_len = 0;
+	for (i = 0; i < shard->num_shards; i++) {
+		next_key = start;
+		next_key_len = start_len;
+		next_data = NULL;
+		next_data_len = 0;
+		ret = dir > 0 ?
+			shard->base.get_next(shard->inner[i], &next_key, &next_key_len,
+					     &next_data, &next_data_len) :
+			shard->base.get_prev(shard->inner[i], &next_key, &next_key_len,
+					     &next_data, &next_data_len);
+		if (ret != MDHIM_SUCCESS || !next_key) {
+			continue;
+		}
+
+		//Keep the record closest to the start
+		if (!best_key ||
+		    dir * compare_keys(shard->index->key_type, next_key, next_key_len,
+				       best_key, best_key_len) < 0) {
+			free(best_key);
+			free(best_data);
+			best_key = next_key;
+			best_key_len = next_key_len;
+			best_data = next_data;
+			best_data_len = next_data_len;
+		} else {
+			free(next_key);
+			free(next_data);
+		}
+	}
+
+	*key = best_key;
+	*key_len = best_key_len;
+	*data = best_data;
+	*data_len = best_data_len;
+
+	return best_key ? MDHIM_SUCCESS : MDHIM_DB_ERROR;
+}
+
+/**
+ * mdhim_shard_get_next
+ * Gets the next key/value of all the shards
+ *
+ * @param dbh             in   pointer to the shard handle
+ * @param key             in/out  void ** to the key to start after, NULL for the first key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_get_next(void *dbh, void **key, int *key_len,
+			 void **data, int32_t *data_len) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+
+	if (shard->num_shards == 1) {
+		return shard->base.get_next(shard->inner[0], key, key_len, data, data_len);
+	}
+
+	return shard_get_adjacent(shard, 1, key, key_len, data, data_len);
+}
+
+/**
+ * mdhim_shard_get_prev
+ * Gets the previous key/value of all the shards
+ *
+ * @param dbh             in   pointer to the shard handle
+ * @param key             in/out  void ** to the key to start before, NULL for the last key.
+ *                                Set to the key that we get
+ * @param key_len         in/out  int * to the length of the key
+ * @param data            out  void ** to the value belonging to the key
+ * @param data_len        out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_get_prev(void *dbh, void **key, int *key_len,
+			 void **data, int32_t *data_len) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+
+	if (shard->num_shards == 1) {
+		return shard->base.get_prev(shard->inner[0], key, key_len, data, data_len);
+	}
+
+	return shard_get_adjacent(shard, -1, key, key_len, data, data_len);
+}
+
+/**
+ * mdhim_shard_del
+ * Deletes a key from the shard of its slice
+ *
+ * @param dbh       in   pointer to the shard handle
+ * @param key       in   void * to the key to delete
+ * @param key_len   in   length of the key
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_del(void *dbh, void *key, int key_len) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+
+	return shard->base.del(shard->inner[shard_of(shard, key, key_len)], key, key_len);
+}
+
+/**
+ * mdhim_shard_batch_del
+ * Deletes several keys, each shard gets its keys in one batch
+ *
+ * @param dbh          in   pointer to the shard handle
+ * @param keys         in   void ** to the keys to delete
+ * @param key_lens     in   int32_t * to the lengths of the keys
+ * @param found        out  int * set to whether each key was found
+ * @param num_records  in   int for the number of keys
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			  int *found, int num_records) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+	struct shard_batch_t batch;
+	int starts[MDHIM_MAX_SHARDS + 1];
+	int *order;
+	int ret = MDHIM_SUCCESS;
+	int i, j, num;
+
+	if (shard->num_shards == 1) {
+		return shard->base.batch_del(shard->inner[0], keys, key_lens, found, num_records);
+	}
+
+	order = shard_split(shard, keys, key_lens, num_records, starts);
+	shard_batch_init(&batch, num_records);
+	for (i = 0; i < shard->num_shards; i++) {
+		if (!(num = starts[i + 1] - starts[i])) {
+			continue;
+		}
+
+		shard_batch_fill(&batch, order, starts[i], num, keys, key_lens, NULL, NULL);
+		if (shard->base.batch_del(shard->inner[i], batch.keys, batch.key_lens,
+					  batch.flags, num) != MDHIM_SUCCESS) {
+			ret = MDHIM_DB_ERROR;
+		}
+
+		for (j = 0; j < num; j++) {
+			found[order[starts[i] + j]] = batch.flags[j];
+		}
+	}
+
+	shard_batch_free(&batch);
+	free(order);
+
+	return ret;
+}
+
+/**
+ * mdhim_shard_commit
+ * Commits every shard
+ *
+ * @param dbh      in   pointer to the shard handle
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_commit(void *dbh) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+	int ret = MDHIM_SUCCESS;
+	int i;
+
+	for (i = 0; i < shard->num_shards; i++) {
+		if (shard->base.commit(shard->inner[i]) != MDHIM_SUCCESS) {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * mdhim_shard_close
+ * Closes every shard
+ *
+ * @param dbh      in   pointer to the shard handle
+ * @param dbs      in   pointer to the stats handle
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_close(void *dbh, void *dbs) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+	struct mdhim_shard_t *stats = (struct mdhim_shard_t *) dbs;
+	int ret = MDHIM_SUCCESS;
+	int i;
+
+	for (i = 0; i < shard->num_shards; i++) {
+		if (shard->base.close(shard->inner[i], shard->inner_stats[i]) != MDHIM_SUCCESS) {
+			ret = MDHIM_DB_ERROR;
+		}
+	}
+
+	shard_destroy(stats);
+	shard_destroy(shard);
+
+	return ret;
+}
+
+static void head_clear(struct mdhim_shard_head_t *head) {
+	free(head->key);
+	free(head->data);
+	memset(head, 0, sizeof(struct mdhim_shard_head_t));
+}
+
+/**
+ * head_read
+ * Reads the record of a shard's cursor after moving it as the operation says
+ *
+ * @param cur  the cursor
+ * @param i    the shard
+ * @param op   MDHIM_GET_EQ, MDHIM_GET_NEXT or MDHIM_GET_PREV
+ */
+static void head_read(struct mdhim_shard_cursor_t *cur, int i, int op) {
+	struct mdhim_shard_head_t *head = &cur->heads[i];
+
+	head_clear(head);
+	head->valid = cur->shard->base.cursor_get(cur->inner[i], op, &head->key, &head->key_len,
+						  &head->data, &head->data_len) == MDHIM_SUCCESS &&
+		head->key;
+}
+
+/**
+ * head_seek
+ * Positions a shard's cursor on its first key not before the given one
+ *
+ * @param cur      the cursor
+ * @param i        the shard
+ * @param key      the key, NULL for the first key
+ * @param key_len  the length of the key
+ */
+static void head_seek(struct mdhim_shard_cursor_t *cur, int i, void *key, int key_len) {
+	head_clear(&cur->heads[i]);
+	if (cur->shard->base.cursor_seek(cur->inner[i], key, key_len,
+					 MDHIM_GET_NEXT) == MDHIM_SUCCESS) {
+		head_read(cur, i, MDHIM_GET_EQ);
+	}
+}
+
+/**
+ * head_seek_before
+ * Positions a shard's cursor on its last key before the given one
+ *
+ * @param cur      the cursor
+ * @param i        the shard
+ * @param key      the key
+ * @param key_len  the length of the key
+ */
+static void head_seek_before(struct mdhim_shard_cursor_t *cur, int i, void *key, int key_len) {
+	struct mdhim_shard_head_t *head = &cur->heads[i];
+
+	//Cursors only seek forward, so find the key before and seek to it
+	head_clear(head);
+	head->key = key;
+	head->key_len = key_len;
+	if (cur->shard->base.get_prev(cur->shard->inner[i], &head->key, &head->key_len,
+				      &head->data, &head->data_len) != MDHIM_SUCCESS ||
+	    !head->key) {
+		head->key = NULL;
+		head_clear(head);
+		return;
+	}
+
+	head->valid = cur->shard->base.cursor_seek(cur->inner[i], head->key, head->key_len,
+						   MDHIM_GET_EQ) == MDHIM_SUCCESS;
+	if (!head->valid) {
+		head_clear(head);
+	}
+}
+
+/**
+ * head_pick
+ * Sets the current shard of the cursor to the one with the closest record
+ *
+ * @param cur  the cursor
+ */
+static void head_pick(struct mdhim_shard_cursor_t *cur) {
+	struct mdhim_shard_head_t *head, *best;
+	int i;
+
+	cur->current = -1;
+	best = NULL;
+	for (i = 0; i < cur->shard->num_shards; i++) {
+		head = &cur->heads[i];
+		if (!head->valid) {
+			continue;
+		}
+
+		if (!best ||
+		    cur->dir * compare_keys(cur->shard->index->key_type, head->key, head->key_len,
+					    best->key, best->key_len) < 0) {
+			best = head;
+			cur->current = i;
+		}
+	}
+}
+
+/**
+ * mdhim_shard_cursor_open
+ * Opens a cursor on every shard
+ *
+ * @param dbh     in   pointer to the shard handle
+ * @param cursor  out  pointer to the new cursor
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR on failure
+ */
+int mdhim_shard_cursor_open(void *dbh, void **cursor) {
+	struct mdhim_shard_t *shard = (struct mdhim_shard_t *) dbh;
+	struct mdhim_shard_cursor_t *cur;
+	int ret;
+	int i;
+
+	cur = malloc(sizeof(struct mdhim_shard_cursor_t));
+	memset(cur, 0, sizeof(struct mdhim_shard_cursor_t));
+	cur->shard = shard;
+	cur->current = -1;
+	cur->dir = 1;
+	cur->inner = malloc(sizeof(void *) * shard->num_shards);
+	memset(cur->inner, 0, sizeof(void *) * shard->num_shards);
+	cur->heads = malloc(sizeof(struct mdhim_shard_head_t) * shard->num_shards);
+	memset(cur->heads, 0, sizeof(struct mdhim_shard_head_t) * shard->num_shards);
+	for (i = 0; i < shard->num_shards; i++) {
+		if ((ret = shard->base.cursor_open(shard->inner[i], &cur->inner[i])) != MDHIM_SUCCESS) {
+			mdhim_shard_cursor_close(cur);
+			return ret;
+		}
+	}
+
+	*cursor = cur;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_shard_cursor_seek
+ * Positions the cursor on the given key
+ *
+ * @param cursor  in   pointer to the cursor
+ * @param key     in   void * to the key to position the cursor on, NULL for the first key
+ * @param key_len in   int for the length of the key
+ * @param op      in   MDHIM_GET_EQ to position on the key itself or
+ *                     MDHIM_GET_NEXT to position on the first key not before it
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if there is no such key
+ */
+int mdhim_shard_cursor_seek(void *cursor, void *key, int key_len, int op) {
+	struct mdhim_shard_cursor_t *cur = (struct mdhim_shard_cursor_t *) cursor;
+	struct mdhim_shard_head_t *head;
+	int i;
+
+	//A key is only in the shard of its slice
+	if (op == MDHIM_GET_EQ && key && key_len) {
+		for (i = 0; i < cur->shard->num_shards; i++) {
+			head_clear(&cur->heads[i]);
+		}
+
+		cur->dir = 1;
+		cur->current = shard_of(cur->shard, key, key_len);
+		if (cur->shard->base.cursor_seek(cur->inner[cur->current], key, key_len,
+						 MDHIM_GET_EQ) != MDHIM_SUCCESS) {
+			cur->current = -1;
+			return MDHIM_DB_ERROR;
+		}
+
+		head_read(cur, cur->current, MDHIM_GET_EQ);
+		if (!cur->heads[cur->current].valid) {
+			cur->current = -1;
+			return MDHIM_DB_ERROR;
+		}
+
+		//The other shards are positioned on the first key after it
+		for (i = 0; i < cur->shard->num_shards; i++) {
+			if (i != cur->current) {
+				head_seek(cur, i, key, key_len);
+			}
+		}
+
+		return MDHIM_SUCCESS;
+	}
+
+	cur->dir = 1;
+	for (i = 0; i < cur->shard->num_shards; i++) {
+		head_seek(cur, i, key, key_len);
+	}
+
+	head_pick(cur);
+	if (cur->current < 0) {
+		return MDHIM_DB_ERROR;
+	}
+
+	head = &cur->heads[cur->current];
+	if (op == MDHIM_GET_EQ && key && key_len &&
+	    compare_keys(cur->shard->index->key_type, head->key, head->key_len, key, key_len)) {
+		return MDHIM_DB_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_shard_cursor_get
+ * Gets the record under the cursor after moving it as the operation says
+ *
+ * @param cursor   in   pointer to the cursor
+ * @param op       in   MDHIM_GET_EQ to read the current record, MDHIM_GET_NEXT or
+ *                      MDHIM_GET_PREV to move the cursor first
+ * @param key      out  void ** to the key that we get
+ * @param key_len  out  int * to the length of the key
+ * @param data     out  void ** to the value belonging to the key
+ * @param data_len out  int * to the length of the value data
+ *
+ * @return MDHIM_SUCCESS on success or MDHIM_DB_ERROR if the cursor ran off the shards
+ */
+int mdhim_shard_cursor_get(void *cursor, int op, void **key, int *key_len,
+			   void **data, int32_t *data_len) {
+	struct mdhim_shard_cursor_t *cur = (struct mdhim_shard_cursor_t *) cursor;
+	struct mdhim_shard_head_t *head;
+	int dir, i;
+
+	*key = NULL;
+	*key_len = 0;
+	*data = NULL;
+	*data_len = 0;
+	if (cur->current < 0) {
+		return MDHIM_DB_ERROR;
+	}
+
+	if (op == MDHIM_GET_NEXT || op == MDHIM_GET_PREV) {
+		dir = op == MDHIM_GET_NEXT ? 1 : -1;
+		head = &cur->heads[cur->current];
+
+		//Turning around, the other shards are on the wrong side of the current key
+		if (dir != cur->dir) {
+			for (i = 0; i < cur->shard->num_shards; i++) {
+				if (i == cur->current) {
+					continue;
+				}
+
+				if (dir > 0) {
+					head_seek(cur, i, head->key, head->key_len);
+				} else {
+					head_seek_before(cur, i, head->key, head->key_len);
+				}
+			}
+
+			cur->dir = dir;
+		}
+
+		head_read(cur, cur->current, op);
+		head_pick(cur);
+		if (cur->current < 0) {
+			return MDHIM_DB_ERROR;
+		}
+	}
+
+	head = &cur->heads[cur->current];
+	*key = malloc(head->key_len);
+	memcpy(*key, head->key, head->key_len);
+	*key_len = head->key_len;
+	if (head->data) {
+		*data = malloc(head->data_len);
+		memcpy(*data, head->data, head->data_len);
+		*data_len = head->data_len;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * mdhim_shard_cursor_close
+ * Closes the cursor of every shard
+ *
+ * @param cursor  in   pointer to the cursor
+ */
+void mdhim_shard_cursor_close(void *cursor) {
+	struct mdhim_shard_cursor_t *cur = (struct mdhim_shard_cursor_t *) cursor;
+	int i;
+
+	if (!cur) {
+		return;
+	}
+
+	for (i = 0; i < cur->shard->num_shards; i++) {
+		if (cur->inner[i]) {
+			cur->shard->base.cursor_close(cur->inner[i]);
+		}
+
+		head_clear(&cur->heads[i]);
+	}
+
+	free(cur->inner);
+	free(cur->heads);
+	free(cur);
+}
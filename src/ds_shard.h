@@ -0,0 +1,69 @@
+/*
+ * MDHIM TNG
+ *
+ * Data stores split into shards by slice
+ */
+
+#ifndef      __SHARD_H
+#define      __SHARD_H
+
+#include "mdhim.h"
+#include "partitioner.h"
+#include "data_store.h"
+
+/* Handle of an index split into several data stores of the same type.  A record is in
+   the shard its slice hashes to, the stats are in the stats data store of shard 0 */
+struct mdhim_shard_t {
+	struct mdhim_store_t base;     //Functions of the wrapped data stores
+	int num_shards;
+	void **inner;                  //Handle of each shard
+	void **inner_stats;            //Stats handle of each shard, only the first is used
+	struct mdhim_t *md;
+	struct index_t *index;         //Index the keys are sliced by
+	struct mdhim_shard_t *stats;   //The stats handle, NULL for the stats handle itself
+};
+
+//The next record a shard has for a cursor
+struct mdhim_shard_head_t {
+	void *key;
+	int key_len;
+	void *data;
+	int32_t data_len;
+	int valid;                     //0 if the shard has no more records this way
+};
+
+/* A cursor keeps one cursor on each shard and returns the smallest of their records
+   going forward, the largest going backward */
+struct mdhim_shard_cursor_t {
+	struct mdhim_shard_t *shard;
+	void **inner;                  //Cursor of each shard
+	struct mdhim_shard_head_t *heads;
+	int current;                   //Shard of the record the cursor is on, -1 if none
+	int dir;                       //1 going forward, -1 going backward
+};
+
+int mdhim_shard_wrap(struct mdhim_t *md, struct index_t *index, struct mdhim_store_t *store,
+		     char *prefix, char *suffix, int flags);
+int mdhim_shard_put(void *dbh, void *key, int key_len, void *data, int32_t data_len);
+int mdhim_shard_batch_put(void *dbh, void **keys, int32_t *key_lens,
+			  void **data, int32_t *data_lens, int num_records);
+int mdhim_shard_batch_append(void *dbh, void **keys, int32_t *key_lens,
+			     void **data, int32_t *data_lens, int *exists, int num_records);
+int mdhim_shard_get(void *dbh, void *key, int key_len, void **data, int32_t *data_len);
+int mdhim_shard_batch_get(void *dbh, void **keys, int32_t *key_lens,
+			  void **data, int32_t *data_lens, int num_records);
+int mdhim_shard_get_next(void *dbh, void **key, int *key_len,
+			 void **data, int32_t *data_len);
+int mdhim_shard_get_prev(void *dbh, void **key, int *key_len,
+			 void **data, int32_t *data_len);
+int mdhim_shard_del(void *dbh, void *key, int key_len);
+int mdhim_shard_batch_del(void *dbh, void **keys, int32_t *key_lens,
+			  int *found, int num_records);
+int mdhim_shard_commit(void *dbh);
+int mdhim_shard_close(void *dbh, void *dbs);
+int mdhim_shard_cursor_open(void *dbh, void **cursor);
+int mdhim_shard_cursor_seek(void *cursor, void *key, int key_len, int op);
+int mdhim_shard_cursor_get(void *cursor, int op, void **key, int *key_len,
+			   void **data, int32_t *data_len);
+void mdhim_shard_cursor_close(void *cursor);
+#endif
@@ -0,0 +1,407 @@
+/*
+ * MDHIM TNG
+ *
+ * One-sided reads of frozen (read only) indexes
+ *
+ * Freezing an index makes every range server copy its records into an MPI window:
+ * an open addressing hash table of buckets followed by a heap with the keys and values.
+ * Until the index is thawed, MDHIM_GET_EQ lookups are done by the clients themselves
+ * with MPI_Get: they fetch a few buckets starting at the key's hash, linear probing
+ * until an empty bucket, then fetch the key and value of a bucket with a matching hash.
+ * The range servers' threads don't take part in these reads.  The range servers also
+ * compact their data stores into mapped runs (ds_run.c) for the reads they still serve.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "frozen_index.h"
+#include "partitioner.h"
+#include "ds_run.h"
+
+//Initial number of records read from the data store before growing the arrays
+#define FROZEN_INITIAL_KEYS 1024
+
+/**
+ * frozen_hash
+ * Gets the hash of a key used to place it in the frozen buckets, 0 marks an empty bucket
+ *
+ * @param index     The index the key belongs to
+ * @param key       The key
+ * @param key_len   The length of the key
+ * @return the hash of the key, never 0
+ */
+static uint64_t frozen_hash(struct index_t *index, void *key, int key_len) {
+	uint64_t hash;
+
+	hash = get_key_hash(index, key, key_len);
+
+	return hash ? hash : 1;
+}
+
+/**
+ * freeze_index
+ * Copies this range server's records of an index into a window the clients read from
+ * Writes to the index are refused until it is thawed - collective call
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index to freeze
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int freeze_index(struct mdhim_t *md, struct index_t *index) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	frozen_bucket_t *buckets;
+	void **keys, **values;
+	int *key_lens;
+	int32_t *value_lens;
+	void *key, *value;
+	int key_len;
+	int32_t value_len;
+	int num_keys, max_keys;
+	uint64_t num_buckets, heap_size, offset, pos, hash;
+	char *base, *heap;
+	int i;
+
+	if (index->frozen) {
+		return MDHIM_SUCCESS;
+	}
+
+	//Lookups on a local index go to every range server, so they gain nothing from this
+	if (index->type == LOCAL_INDEX) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Local indexes can't be frozen", md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	//Compact the records into a mapped run, they are read from it until the index is thawed
+	if (index->myinfo.rangesrv_num > 0 && store &&
+	    mdhim_run_freeze(store) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Error making the run of index: %d, reads will go to its data store",
+		     md->mdhim_rank, index->id);
+	}
+
+	//Read every record this range server has for the index
+	num_keys = 0;
+	max_keys = 0;
+	heap_size = 0;
+	keys = values = NULL;
+	key_lens = NULL;
+	value_lens = NULL;
+	key = NULL;
+	key_len = 0;
+	while (index->myinfo.rangesrv_num > 0 && store) {
+		value = NULL;
+		value_len = 0;
+		if (store->get_next(store->db_handle, &key, &key_len,
+				    &value, &value_len) != MDHIM_SUCCESS || !key) {
+			break;
+		}
+
+		if (num_keys == max_keys) {
+			max_keys = max_keys ? max_keys * 2 : FROZEN_INITIAL_KEYS;
+			keys = realloc(keys, sizeof(void *) * max_keys);
+			key_lens = realloc(key_lens, sizeof(int) * max_keys);
+			values = realloc(values, sizeof(void *) * max_keys);
+			value_lens = realloc(value_lens, sizeof(int32_t) * max_keys);
+		}
+
+		keys[num_keys] = key;
+		key_lens[num_keys] = key_len;
+		values[num_keys] = value;
+		value_lens[num_keys] = value_len;
+		heap_size += key_len + value_len;
+		num_keys++;
+	}
+
+	//Keep the table at most half full so probes stay short
+	num_buckets = 0;
+	if (num_keys) {
+		num_buckets = 1;
+		while (num_buckets < (uint64_t) num_keys * 2) {
+			num_buckets <<= 1;
+		}
+	}
+
+	if (MPI_Win_allocate(num_buckets * sizeof(frozen_bucket_t) + heap_size, 1,
+			     MPI_INFO_NULL, md->mdhim_client_comm, &base,
+			     &index->frozen_win) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Error allocating the window to freeze index: %d",
+		     md->mdhim_rank, index->id);
+		for (i = 0; i < num_keys; i++) {
+			free(keys[i]);
+			free(values[i]);
+		}
+
+		free(keys);
+		free(key_lens);
+		free(values);
+		free(value_lens);
+		return MDHIM_ERROR;
+	}
+
+	//Place the records in the buckets and copy their keys and values to the heap
+	buckets = (frozen_bucket_t *) base;
+	heap = base + num_buckets * sizeof(frozen_bucket_t);
+	memset(buckets, 0, num_buckets * sizeof(frozen_bucket_t));
+	offset = 0;
+	for (i = 0; i < num_keys; i++) {
+		hash = frozen_hash(index, keys[i], key_lens[i]);
+		pos = hash & (num_buckets - 1);
+		while (buckets[pos].hash) {
+			pos = (pos + 1) & (num_buckets - 1);
+		}
+
+		buckets[pos].hash = hash;
+		buckets[pos].offset = offset;
+		buckets[pos].key_len = key_lens[i];
+		buckets[pos].value_len = value_lens[i];
+		memcpy(heap + offset, keys[i], key_lens[i]);
+		offset += key_lens[i];
+		if (value_lens[i]) {
+			memcpy(heap + offset, values[i], value_lens[i]);
+			offset += value_lens[i];
+		}
+
+		free(keys[i]);
+		free(values[i]);
+	}
+
+	free(keys);
+	free(key_lens);
+	free(values);
+	free(value_lens);
+
+	//The window stays open for reads until the index is thawed
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, index->frozen_win);
+	MPI_Win_sync(index->frozen_win);
+
+	//Every client needs the size of each range server's table to probe it
+	index->frozen_buckets = malloc(sizeof(uint64_t) * md->mdhim_comm_size);
+	if (MPI_Allgather(&num_buckets, 1, MPI_UINT64_T, index->frozen_buckets, 1,
+			  MPI_UINT64_T, md->mdhim_client_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Error gathering the frozen tables of index: %d",
+		     md->mdhim_rank, index->id);
+		MPI_Win_unlock_all(index->frozen_win);
+		MPI_Win_free(&index->frozen_win);
+		free(index->frozen_buckets);
+		index->frozen_buckets = NULL;
+		return MDHIM_ERROR;
+	}
+
+	index->frozen = 1;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * thaw_index
+ * Frees the window of a frozen index so it can be written again - collective call
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index to thaw
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int thaw_index(struct mdhim_t *md, struct index_t *index) {
+	if (!index->frozen) {
+		return MDHIM_SUCCESS;
+	}
+
+	index->frozen = 0;
+	MPI_Win_unlock_all(index->frozen_win);
+	if (MPI_Win_free(&index->frozen_win) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Error freeing the window of index: %d",
+		     md->mdhim_rank, index->id);
+		return MDHIM_ERROR;
+	}
+
+	free(index->frozen_buckets);
+	index->frozen_buckets = NULL;
+
+	//The writes to come would make the run stale
+	if (index->myinfo.rangesrv_num > 0 && index->mdhim_store) {
+		mdhim_run_thaw(index->mdhim_store);
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * frozen_get
+ * Looks a key up in the frozen table of a range server with MPI_Get
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The frozen index
+ * @param rank      The rank of the range server that has the key
+ * @param key       The key to get
+ * @param key_len   The length of the key
+ * @param value     out: a copy of the value
+ * @param value_len out: the length of the value
+ * @return MDHIM_SUCCESS, MDHIM_DB_ERROR if the key doesn't exist or MDHIM_ERROR on error
+ */
+int frozen_get(struct mdhim_t *md, struct index_t *index, int rank,
+	       void *key, int key_len, void **value, int32_t *value_len) {
+	frozen_bucket_t buckets[MDHIM_FROZEN_PROBE];
+	uint64_t num_buckets, hash, pos, probed, count;
+	MPI_Aint heap_disp;
+	char *record;
+	int i;
+
+	*value = NULL;
+	*value_len = 0;
+	num_buckets = index->frozen_buckets[rank];
+	if (!num_buckets) {
+		return MDHIM_DB_ERROR;
+	}
+
+	hash = frozen_hash(index, key, key_len);
+	pos = hash & (num_buckets - 1);
+	heap_disp = num_buckets * sizeof(frozen_bucket_t);
+	for (probed = 0; probed < num_buckets; probed += count) {
+		//Fetch the next few buckets at once, stopping at the end of the table
+		count = MDHIM_FROZEN_PROBE;
+		if (count > num_buckets - pos) {
+			count = num_buckets - pos;
+		}
+
+		if (MPI_Get(buckets, count * sizeof(frozen_bucket_t), MPI_BYTE, rank,
+			    pos * sizeof(frozen_bucket_t), count * sizeof(frozen_bucket_t),
+			    MPI_BYTE, index->frozen_win) != MPI_SUCCESS ||
+		    MPI_Win_flush(rank, index->frozen_win) != MPI_SUCCESS) {
+			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+			     "Error reading the frozen buckets of rank: %d",
+			     md->mdhim_rank, rank);
+			return MDHIM_ERROR;
+		}
+
+		for (i = 0; i < count; i++) {
+			//An empty bucket ends the probe sequence
+			if (!buckets[i].hash) {
+				return MDHIM_DB_ERROR;
+			}
+
+			if (buckets[i].hash != hash || buckets[i].key_len != key_len) {
+				continue;
+			}
+
+			//The value follows the key, so both are fetched together
+			record = malloc(key_len + buckets[i].value_len);
+			if (MPI_Get(record, key_len + buckets[i].value_len, MPI_BYTE, rank,
+				    heap_disp + buckets[i].offset, key_len + buckets[i].value_len,
+				    MPI_BYTE, index->frozen_win) != MPI_SUCCESS ||
+			    MPI_Win_flush(rank, index->frozen_win) != MPI_SUCCESS) {
+				mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+				     "Error reading a frozen record of rank: %d",
+				     md->mdhim_rank, rank);
+				free(record);
+				return MDHIM_ERROR;
+			}
+
+			if (memcmp(record, key, key_len)) {
+				free(record);
+				continue;
+			}
+
+			*value_len = buckets[i].value_len;
+			*value = malloc(*value_len);
+			memcpy(*value, record + key_len, *value_len);
+			free(record);
+
+			return MDHIM_SUCCESS;
+		}
+
+		pos = (pos + count) & (num_buckets - 1);
+	}
+
+	return MDHIM_DB_ERROR;
+}
+
+/**
+ * frozen_bget
+ * Gets the values of keys from a frozen index without involving the range servers
+ * Returns one message per range server, as if the range servers had answered
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The frozen index
+ * @param keys      The keys to get
+ * @param key_lens  The lengths of the keys
+ * @param num_keys  The number of keys
+ * @param rs_idx    The range server number - 1 of each key
+ * @return the list of messages or NULL if there were no keys
+ */
+struct mdhim_bgetrm_t *frozen_bget(struct mdhim_t *md, struct index_t *index,
+				   void **keys, int *key_lens, int num_keys, int *rs_idx) {
+	struct mdhim_bgetrm_t **bgrms, *bgrm, *bgrm_head, *bgrm_tail;
+	int *counts;
+	int32_t value_len;
+	int i, n, ret;
+
+	counts = malloc(sizeof(int) * index->num_rangesrvs);
+	memset(counts, 0, sizeof(int) * index->num_rangesrvs);
+	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
+		if (rs_idx[i] >= 0) {
+			counts[rs_idx[i]]++;
+		}
+	}
+
+	bgrms = malloc(sizeof(struct mdhim_bgetrm_t *) * index->num_rangesrvs);
+	memset(bgrms, 0, sizeof(struct mdhim_bgetrm_t *) * index->num_rangesrvs);
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!counts[i]) {
+			continue;
+		}
+
+		bgrm = malloc(sizeof(struct mdhim_bgetrm_t));
+		memset(bgrm, 0, sizeof(struct mdhim_bgetrm_t));
+		bgrm->basem.mtype = MDHIM_RECV_BULK_GET;
+		bgrm->basem.server_rank = index->rangesrvs_arr[i]->rank;
+		bgrm->basem.index = index->id;
+		bgrm->basem.index_type = index->type;
+		bgrm->keys = malloc(sizeof(void *) * counts[i]);
+		bgrm->key_lens = malloc(sizeof(int) * counts[i]);
+		bgrm->values = malloc(sizeof(void *) * counts[i]);
+		bgrm->value_lens = malloc(sizeof(int) * counts[i]);
+		bgrms[i] = bgrm;
+	}
+
+	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
+		if (rs_idx[i] < 0) {
+			continue;
+		}
+
+		bgrm = bgrms[rs_idx[i]];
+		n = bgrm->num_keys++;
+		bgrm->keys[n] = malloc(key_lens[i]);
+		memcpy(bgrm->keys[n], keys[i], key_lens[i]);
+		bgrm->key_lens[n] = key_lens[i];
+		if ((ret = frozen_get(md, index, bgrm->basem.server_rank, keys[i], key_lens[i],
+				      &bgrm->values[n], &value_len)) != MDHIM_SUCCESS) {
+			bgrm->error = ret;
+		}
+
+		bgrm->value_lens[n] = value_len;
+	}
+
+	//Build the linked list to return
+	bgrm_head = bgrm_tail = NULL;
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!bgrms[i]) {
+			continue;
+		}
+
+		if (!bgrm_head) {
+			bgrm_head = bgrms[i];
+		} else {
+			bgrm_tail->next = bgrms[i];
+		}
+
+		bgrm_tail = bgrms[i];
+	}
+
+	free(bgrms);
+	free(counts);
+
+	return bgrm_head;
+}
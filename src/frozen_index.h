@@ -0,0 +1,23 @@
+/*
+ * MDHIM TNG
+ *
+ * One-sided reads of frozen (read only) indexes
+ */
+
+#ifndef      __FROZEN_INDEX_H
+#define      __FROZEN_INDEX_H
+
+#include "mdhim.h"
+#include "indexes.h"
+
+//Number of buckets fetched with each MPI_Get while probing for a key
+#define MDHIM_FROZEN_PROBE 4
+
+int freeze_index(struct mdhim_t *md, struct index_t *index);
+int thaw_index(struct mdhim_t *md, struct index_t *index);
+int frozen_get(struct mdhim_t *md, struct index_t *index, int rank,
+	       void *key, int key_len, void **value, int32_t *value_len);
+struct mdhim_bgetrm_t *frozen_bget(struct mdhim_t *md, struct index_t *index,
+				   void **keys, int *key_lens, int num_keys, int *rs_idx);
+
+#endif
@@ -0,0 +1,691 @@
+/*
+ * MDHIM TNG
+ *
+ * Hot key detection and read replication
+ *
+ * Range servers count the MDHIM_GET_EQ reads of their keys in a count-min sketch.
+ * Keys whose count crosses the hot key threshold are nominated and, on the next
+ * replication, copied to the range servers that follow the owner.  Every rank then
+ * spreads its reads of a hot key over the owner and its replicas, and sends writes
+ * of a hot key to all of them so the copies stay current.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "hot_keys.h"
+#include "partitioner.h"
+
+/**
+ * free_hot_keys
+ * Frees every entry of a hot key hash table
+ *
+ * @param table     the hash table to free
+ */
+static void free_hot_keys(hot_key_t **table) {
+	hot_key_t *hk, *tmp;
+
+	HASH_ITER(hh, *table, hk, tmp) {
+		HASH_DEL(*table, hk);
+		free(hk->key);
+		if (hk->value) {
+			free(hk->value);
+		}
+		if (hk->replicas) {
+			free(hk->replicas);
+		}
+
+		free(hk);
+	}
+
+	*table = NULL;
+}
+
+/**
+ * hot_keys_init
+ * Initializes the hot key tracking of an index
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index to initialize
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int hot_keys_init(struct mdhim_t *md, struct index_t *index) {
+	index->hot_keys = NULL;
+	index->hot_candidates = NULL;
+	index->read_sketch = NULL;
+	index->hot_keys_lock = malloc(sizeof(pthread_rwlock_t));
+	if (pthread_rwlock_init(index->hot_keys_lock, NULL) != 0) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error initializing the hot keys lock",
+		     md->mdhim_rank);
+		free(index->hot_keys_lock);
+		index->hot_keys_lock = NULL;
+		return MDHIM_ERROR;
+	}
+
+	//Only range servers count reads
+	if (index->myinfo.rangesrv_num > 0 && md->db_opts &&
+	    md->db_opts->db_hot_key_threshold > 0) {
+		index->read_sketch = malloc(sizeof(uint32_t) * MDHIM_HOT_KEY_SKETCH_DEPTH *
+					    MDHIM_HOT_KEY_SKETCH_WIDTH);
+		memset(index->read_sketch, 0, sizeof(uint32_t) * MDHIM_HOT_KEY_SKETCH_DEPTH *
+		       MDHIM_HOT_KEY_SKETCH_WIDTH);
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * hot_keys_release
+ * Frees the hot key tracking of an index
+ *
+ * @param index     The index to release
+ */
+void hot_keys_release(struct index_t *index) {
+	free_hot_keys(&index->hot_keys);
+	free_hot_keys(&index->hot_candidates);
+	if (index->read_sketch) {
+		free(index->read_sketch);
+		index->read_sketch = NULL;
+	}
+	if (index->hot_keys_lock) {
+		pthread_rwlock_destroy(index->hot_keys_lock);
+		free(index->hot_keys_lock);
+		index->hot_keys_lock = NULL;
+	}
+}
+
+/**
+ * hot_keys_clear
+ * Drops all the replicated hot keys of an index, e.g., when their owners change
+ *
+ * @param index     The index to clear the hot keys of
+ */
+void hot_keys_clear(struct index_t *index) {
+	if (!index->hot_keys_lock) {
+		return;
+	}
+
+	while (pthread_rwlock_wrlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	free_hot_keys(&index->hot_keys);
+	pthread_rwlock_unlock(index->hot_keys_lock);
+}
+
+/**
+ * record_key_reads
+ * Counts reads of the keys given and nominates the ones that crossed the hot key threshold
+ * The sketch is counted in under the read lock, the write lock is only taken to add candidates
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index the keys were read from
+ * @param keys      The keys that were read
+ * @param key_lens  The lengths of the keys
+ * @param num_keys  The number of keys
+ */
+void record_key_reads(struct mdhim_t *md, struct index_t *index,
+		      void **keys, int *key_lens, int num_keys) {
+	uint64_t *hashes;
+	uint32_t h1, h2, min, count, *cell;
+	uint32_t threshold;
+	hot_key_t *hk;
+	int *nominated;
+	int i, r, num_nominated;
+
+	if (!index->read_sketch || num_keys <= 0) {
+		return;
+	}
+
+	//Hash the keys before taking the lock
+	threshold = md->db_opts->db_hot_key_threshold;
+	hashes = malloc(sizeof(uint64_t) * num_keys);
+	for (i = 0; i < num_keys; i++) {
+		hashes[i] = keys[i] ? get_key_hash(index, keys[i], key_lens[i]) : 0;
+	}
+
+	nominated = NULL;
+	num_nominated = 0;
+	while (pthread_rwlock_rdlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	for (i = 0; i < num_keys; i++) {
+		if (!keys[i] || key_lens[i] <= 0) {
+			continue;
+		}
+
+		//Each row of the sketch uses a different combination of the two halves of the hash
+		h1 = hashes[i];
+		h2 = (hashes[i] >> 32) | 1;
+		min = UINT32_MAX;
+		for (r = 0; r < MDHIM_HOT_KEY_SKETCH_DEPTH; r++) {
+			cell = &index->read_sketch[r * MDHIM_HOT_KEY_SKETCH_WIDTH +
+						   (h1 + r * h2) % MDHIM_HOT_KEY_SKETCH_WIDTH];
+			count = __atomic_load_n(cell, __ATOMIC_RELAXED);
+			if (count < UINT32_MAX) {
+				count = __atomic_add_fetch(cell, 1, __ATOMIC_RELAXED);
+			}
+			if (count < min) {
+				min = count;
+			}
+		}
+
+		if (min < threshold || HASH_COUNT(index->hot_candidates) >= MDHIM_MAX_HOT_KEYS) {
+			continue;
+		}
+
+		HASH_FIND(hh, index->hot_candidates, keys[i], key_lens[i], hk);
+		if (hk) {
+			continue;
+		}
+
+		if (!nominated) {
+			nominated = malloc(sizeof(int) * num_keys);
+		}
+		nominated[num_nominated++] = i;
+	}
+
+	pthread_rwlock_unlock(index->hot_keys_lock);
+	free(hashes);
+	if (!num_nominated) {
+		return;
+	}
+
+	//Another thread may have added the same keys since the read lock was released
+	while (pthread_rwlock_wrlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	for (r = 0; r < num_nominated; r++) {
+		i = nominated[r];
+		if (HASH_COUNT(index->hot_candidates) >= MDHIM_MAX_HOT_KEYS) {
+			break;
+		}
+
+		HASH_FIND(hh, index->hot_candidates, keys[i], key_lens[i], hk);
+		if (hk) {
+			continue;
+		}
+
+		hk = malloc(sizeof(hot_key_t));
+		memset(hk, 0, sizeof(hot_key_t));
+		hk->key = malloc(key_lens[i]);
+		memcpy(hk->key, keys[i], key_lens[i]);
+		hk->key_len = key_lens[i];
+		HASH_ADD_KEYPTR(hh, index->hot_candidates, hk->key, hk->key_len, hk);
+	}
+
+	pthread_rwlock_unlock(index->hot_keys_lock);
+	free(nominated);
+}
+
+/**
+ * find_hot_keys
+ * Finds keys in the replicated hot keys of an index and copies out the range servers
+ * holding them, so nothing of the hot key table is used once the lock is released
+ *
+ * @param index        The index to look in
+ * @param keys         The keys to find, NULL keys are skipped
+ * @param key_lens     The lengths of the keys
+ * @param num_keys     The number of keys
+ * @param num_replicas out: the number of range servers holding each key, 0 if it isn't hot
+ * @param replicas     out: MDHIM_HOT_KEY_HOLDERS range server numbers for each key, 
+ *                     the owner first
+ * @return the number of keys that are hot
+ */
+int find_hot_keys(struct index_t *index, void **keys, int *key_lens, int num_keys,
+		  int *num_replicas, uint32_t *replicas) {
+	hot_key_t *hk;
+	int i, found;
+
+	memset(num_replicas, 0, sizeof(int) * num_keys);
+	if (!index->hot_keys_lock) {
+		return 0;
+	}
+
+	found = 0;
+	while (pthread_rwlock_rdlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	for (i = 0; index->hot_keys && i < num_keys; i++) {
+		if (!keys[i] || key_lens[i] <= 0) {
+			continue;
+		}
+
+		HASH_FIND(hh, index->hot_keys, keys[i], key_lens[i], hk);
+		if (!hk) {
+			continue;
+		}
+
+		num_replicas[i] = hk->num_replicas;
+		memcpy(replicas + i * MDHIM_HOT_KEY_HOLDERS, hk->replicas,
+		       sizeof(uint32_t) * hk->num_replicas);
+		found++;
+	}
+
+	pthread_rwlock_unlock(index->hot_keys_lock);
+
+	return found;
+}
+
+/**
+ * find_hot_key
+ * Finds a key in the replicated hot keys of an index
+ *
+ * @param index     The index to look in
+ * @param key       The key to find
+ * @param key_len   The length of the key
+ * @param replicas  out: MDHIM_HOT_KEY_HOLDERS range server numbers holding the key, 
+ *                  the owner first
+ * @return the number of range servers holding the key or 0 if the key isn't hot
+ */
+int find_hot_key(struct index_t *index, void *key, int key_len, uint32_t *replicas) {
+	int num_replicas;
+
+	find_hot_keys(index, &key, &key_len, 1, &num_replicas, replicas);
+
+	return num_replicas;
+}
+
+/**
+ * get_hot_key_replica
+ * Picks the range server this rank reads a hot key from, so the ranks spread their reads
+ * A copy on this rank's own node is preferred over the others
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index the key belongs to
+ * @param key       The key to read
+ * @param key_len   The length of the key
+ * @return the range server number - 1 to read from or -1 if the key isn't hot
+ */
+int get_hot_key_replica(struct mdhim_t *md, struct index_t *index, void *key, int key_len) {
+	uint32_t replicas[MDHIM_HOT_KEY_HOLDERS];
+	int i, start, rangesrv_num, num_replicas;
+
+	if ((num_replicas = find_hot_key(index, key, key_len, replicas)) == 0) {
+		return -1;
+	}
+
+	start = md->mdhim_rank % num_replicas;
+	for (i = 0; i < num_replicas; i++) {
+		rangesrv_num = replicas[(start + i) % num_replicas];
+		if (md->rank_nodes[index->rangesrvs_arr[rangesrv_num - 1]->rank] == 
+		    md->rank_nodes[md->mdhim_rank]) {
+			return rangesrv_num - 1;
+		}
+	}
+
+	return replicas[start] - 1;
+}
+
+/**
+ * get_replica_value
+ * Copies the value of a hot key if this range server holds a copy of it
+ *
+ * @param index     The index the key belongs to
+ * @param key       The key to get
+ * @param key_len   The length of the key
+ * @param value     out: a copy of the value or NULL if the key was deleted
+ * @param value_len out: the length of the value
+ * @return 1 if this range server holds a copy of the key, 0 otherwise
+ */
+int get_replica_value(struct index_t *index, void *key, int key_len,
+		      void **value, int32_t *value_len) {
+	hot_key_t *hk;
+
+	if (!index->hot_keys_lock) {
+		return 0;
+	}
+
+	while (pthread_rwlock_rdlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	HASH_FIND(hh, index->hot_keys, key, key_len, hk);
+	if (!hk || !hk->replica) {
+		pthread_rwlock_unlock(index->hot_keys_lock);
+		return 0;
+	}
+
+	if (hk->value_len) {
+		*value = malloc(hk->value_len);
+		memcpy(*value, hk->value, hk->value_len);
+	} else {
+		*value = NULL;
+	}
+	*value_len = hk->value_len;
+	pthread_rwlock_unlock(index->hot_keys_lock);
+
+	return 1;
+}
+
+/**
+ * find_replica
+ * Takes the write lock of the hot keys if this range server holds a copy of a key
+ * Most keys aren't hot, so they are looked for under the read lock first
+ *
+ * @param index     The index the key belongs to
+ * @param key       The key to find
+ * @param key_len   The length of the key
+ * @return the copy of the key, with the write lock held, or NULL, with no lock held
+ */
+static hot_key_t *find_replica(struct index_t *index, void *key, int key_len) {
+	hot_key_t *hk;
+
+	if (!index->hot_keys_lock) {
+		return NULL;
+	}
+
+	while (pthread_rwlock_rdlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	HASH_FIND(hh, index->hot_keys, key, key_len, hk);
+	pthread_rwlock_unlock(index->hot_keys_lock);
+	if (!hk || !hk->replica) {
+		return NULL;
+	}
+
+	//The table may have been replaced in between, so the key is looked for again
+	while (pthread_rwlock_wrlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	HASH_FIND(hh, index->hot_keys, key, key_len, hk);
+	if (!hk || !hk->replica) {
+		pthread_rwlock_unlock(index->hot_keys_lock);
+		return NULL;
+	}
+
+	return hk;
+}
+
+/**
+ * update_replica
+ * Updates the copy of a hot key if this range server holds one
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index the key belongs to
+ * @param key       The key to update
+ * @param key_len   The length of the key
+ * @param value     The new value
+ * @param value_len The length of the new value
+ * @param append    MDHIM_DB_APPEND to append the value to the copy or MDHIM_DB_OVERWRITE
+ * @return 1 if this range server holds a copy of the key, 0 otherwise
+ */
+int update_replica(struct mdhim_t *md, struct index_t *index, void *key, int key_len,
+		   void *value, int32_t value_len, int append) {
+	hot_key_t *hk;
+	void *new_value;
+	int32_t new_value_len;
+
+	if ((hk = find_replica(index, key, key_len)) == NULL) {
+		return 0;
+	}
+
+	//Follow the same append semantics as the owner's data store
+	new_value_len = value_len;
+	if (hk->value_len && append == MDHIM_DB_APPEND) {
+		new_value_len += hk->value_len;
+	}
+
+	new_value = malloc(new_value_len);
+	if (new_value_len != value_len) {
+		memcpy(new_value, hk->value, hk->value_len);
+		memcpy(new_value + hk->value_len, value, value_len);
+	} else {
+		memcpy(new_value, value, value_len);
+	}
+
+	if (hk->value) {
+		free(hk->value);
+	}
+	hk->value = new_value;
+	hk->value_len = new_value_len;
+	pthread_rwlock_unlock(index->hot_keys_lock);
+
+	return 1;
+}
+
+/**
+ * delete_replica
+ * Marks the copy of a hot key as deleted if this range server holds one
+ *
+ * @param index     The index the key belongs to
+ * @param key       The key to delete
+ * @param key_len   The length of the key
+ * @return 1 if this range server holds a copy of the key, 0 otherwise
+ */
+int delete_replica(struct index_t *index, void *key, int key_len) {
+	hot_key_t *hk;
+
+	if ((hk = find_replica(index, key, key_len)) == NULL) {
+		return 0;
+	}
+
+	if (hk->value) {
+		free(hk->value);
+	}
+	hk->value = NULL;
+	hk->value_len = 0;
+	pthread_rwlock_unlock(index->hot_keys_lock);
+
+	return 1;
+}
+
+/**
+ * delete_replica_range
+ * Marks the copies of the hot keys this range server holds between two keys as deleted
+ *
+ * @param index         The index the keys belong to
+ * @param start_key     The first key of the range, NULL for no lower bound
+ * @param start_key_len The length of the first key
+ * @param end_key       The last key of the range, NULL for no upper bound
+ * @param end_key_len   The length of the last key
+ */
+void delete_replica_range(struct index_t *index, void *start_key, int start_key_len,
+			  void *end_key, int end_key_len) {
+	hot_key_t *hk, *tmp;
+
+	if (!index->hot_keys_lock) {
+		return;
+	}
+
+	while (pthread_rwlock_wrlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	HASH_ITER(hh, index->hot_keys, hk, tmp) {
+		if (!hk->replica || 
+		    (start_key && compare_keys(index->key_type, hk->key, hk->key_len, 
+					       start_key, start_key_len) < 0) ||
+		    (end_key && compare_keys(index->key_type, hk->key, hk->key_len, 
+					     end_key, end_key_len) > 0)) {
+			continue;
+		}
+
+		if (hk->value) {
+			free(hk->value);
+		}
+		hk->value = NULL;
+		hk->value_len = 0;
+	}
+
+	pthread_rwlock_unlock(index->hot_keys_lock);
+}
+
+/**
+ * replicate_hot_keys
+ * Replaces the replicated hot keys of an index with the keys nominated by the range servers
+ * since the last replication.  The owners send the keys and values to every rank, ranks
+ * that replicate a key keep a copy of its value.  Must be called by every rank
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index to replicate the hot keys of
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int replicate_hot_keys(struct mdhim_t *md, struct index_t *index) {
+	hot_key_t *hk, *tmp, *new_keys;
+	rangesrv_list *rl, *rlp;
+	char *buf, *all_bufs;
+	int size, total_size, pos;
+	int *recvcounts, *displs;
+	int header[3];
+	int num_replicas;
+	void *value;
+	int32_t value_len;
+	int i, j;
+
+	if (index->type == LOCAL_INDEX || !index->hot_keys_lock) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Hot keys can only be replicated for global indexes",
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	//A single range server has nowhere to replicate to
+	if (index->num_rangesrvs < 2) {
+		return MDHIM_SUCCESS;
+	}
+
+	num_replicas = index->num_rangesrvs - 1 < MDHIM_HOT_KEY_REPLICAS ?
+		index->num_rangesrvs : MDHIM_HOT_KEY_REPLICAS + 1;
+
+	//Pack the nominated keys we own with their values: owner, key length, value length, key, value
+	size = 0;
+	buf = NULL;
+	if (index->read_sketch) {
+		while (pthread_rwlock_wrlock(index->hot_keys_lock) == EBUSY) {
+			usleep(10);
+		}
+
+		HASH_ITER(hh, index->hot_candidates, hk, tmp) {
+			HASH_DEL(index->hot_candidates, hk);
+			rl = get_range_servers(md, index, hk->key, hk->key_len);
+			value = NULL;
+			value_len = 0;
+			if (rl && rl->ri->rangesrv_num == index->myinfo.rangesrv_num) {
+				index->mdhim_store->get(index->mdhim_store->db_handle,
+							hk->key, hk->key_len, &value, &value_len);
+			}
+
+			if (value && value_len) {
+				buf = realloc(buf, size + sizeof(header) + hk->key_len + value_len);
+				header[0] = index->myinfo.rangesrv_num;
+				header[1] = hk->key_len;
+				header[2] = value_len;
+				memcpy(buf + size, header, sizeof(header));
+				memcpy(buf + size + sizeof(header), hk->key, hk->key_len);
+				memcpy(buf + size + sizeof(header) + hk->key_len, value, value_len);
+				size += sizeof(header) + hk->key_len + value_len;
+			}
+
+			if (value) {
+				free(value);
+			}
+			while (rl) {
+				rlp = rl;
+				rl = rl->next;
+				free(rlp);
+			}
+
+			free(hk->key);
+			free(hk);
+		}
+
+		//Start counting over for the next period
+		memset(index->read_sketch, 0, sizeof(uint32_t) * MDHIM_HOT_KEY_SKETCH_DEPTH *
+		       MDHIM_HOT_KEY_SKETCH_WIDTH);
+		pthread_rwlock_unlock(index->hot_keys_lock);
+	}
+
+	//Send every rank the hot keys
+	recvcounts = malloc(sizeof(int) * md->mdhim_comm_size);
+	displs = malloc(sizeof(int) * md->mdhim_comm_size);
+	if (MPI_Allgather(&size, 1, MPI_INT, recvcounts, 1, MPI_INT,
+			  md->mdhim_client_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error while gathering the size of the hot keys",
+		     md->mdhim_rank);
+		free(buf);
+		free(recvcounts);
+		free(displs);
+		return MDHIM_ERROR;
+	}
+
+	total_size = 0;
+	for (i = 0; i < md->mdhim_comm_size; i++) {
+		displs[i] = total_size;
+		total_size += recvcounts[i];
+	}
+
+	all_bufs = malloc(total_size + 1);
+	if (MPI_Allgatherv(buf, size, MPI_BYTE, all_bufs, recvcounts, displs, MPI_BYTE,
+			   md->mdhim_client_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error while gathering the hot keys",
+		     md->mdhim_rank);
+		free(buf);
+		free(all_bufs);
+		free(recvcounts);
+		free(displs);
+		return MDHIM_ERROR;
+	}
+
+	free(buf);
+	free(recvcounts);
+	free(displs);
+
+	//Build the new hot key table, the replicas of a key are the range servers after its owner
+	new_keys = NULL;
+	pos = 0;
+	while (pos < total_size) {
+		memcpy(header, all_bufs + pos, sizeof(header));
+		pos += sizeof(header);
+		HASH_FIND(hh, new_keys, all_bufs + pos, header[1], hk);
+		if (hk) {
+			pos += header[1] + header[2];
+			continue;
+		}
+
+		hk = malloc(sizeof(hot_key_t));
+		memset(hk, 0, sizeof(hot_key_t));
+		hk->key = malloc(header[1]);
+		memcpy(hk->key, all_bufs + pos, header[1]);
+		hk->key_len = header[1];
+		pos += header[1];
+		hk->num_replicas = num_replicas;
+		hk->replicas = malloc(sizeof(uint32_t) * num_replicas);
+		for (j = 0; j < num_replicas; j++) {
+			hk->replicas[j] = (header[0] - 1 + j) % index->num_rangesrvs + 1;
+			if (j && hk->replicas[j] == index->myinfo.rangesrv_num) {
+				hk->replica = 1;
+			}
+		}
+
+		if (hk->replica) {
+			hk->value = malloc(header[2]);
+			memcpy(hk->value, all_bufs + pos, header[2]);
+			hk->value_len = header[2];
+		}
+
+		pos += header[2];
+		HASH_ADD_KEYPTR(hh, new_keys, hk->key, hk->key_len, hk);
+	}
+
+	free(all_bufs);
+
+	//Swap in the new hot keys
+	while (pthread_rwlock_wrlock(index->hot_keys_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	free_hot_keys(&index->hot_keys);
+	index->hot_keys = new_keys;
+	pthread_rwlock_unlock(index->hot_keys_lock);
+	mlog(MDHIM_CLIENT_DBG, "MDHIM Rank: %d - Replicating %u hot keys",
+	     md->mdhim_rank, HASH_COUNT(new_keys));
+
+	return MDHIM_SUCCESS;
+}
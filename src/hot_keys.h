@@ -0,0 +1,41 @@
+/*
+ * MDHIM TNG
+ *
+ * Hot key detection and read replication
+ */
+
+#ifndef      __HOT_KEYS_H
+#define      __HOT_KEYS_H
+
+#include "mdhim.h"
+#include "indexes.h"
+
+//Rows and columns of the count-min sketch used to count the reads of each key
+#define MDHIM_HOT_KEY_SKETCH_DEPTH 4
+#define MDHIM_HOT_KEY_SKETCH_WIDTH 2048
+//Maximum number of hot keys a range server nominates between replications
+#define MDHIM_MAX_HOT_KEYS 64
+//Number of range servers, besides the owner, that hold a copy of a hot key
+#define MDHIM_HOT_KEY_REPLICAS 2
+//Number of range servers, the owner included, that hold a hot key at most
+#define MDHIM_HOT_KEY_HOLDERS (MDHIM_HOT_KEY_REPLICAS + 1)
+
+int hot_keys_init(struct mdhim_t *md, struct index_t *index);
+void hot_keys_release(struct index_t *index);
+void hot_keys_clear(struct index_t *index);
+void record_key_reads(struct mdhim_t *md, struct index_t *index,
+		      void **keys, int *key_lens, int num_keys);
+int find_hot_keys(struct index_t *index, void **keys, int *key_lens, int num_keys,
+		  int *num_replicas, uint32_t *replicas);
+int find_hot_key(struct index_t *index, void *key, int key_len, uint32_t *replicas);
+int get_hot_key_replica(struct mdhim_t *md, struct index_t *index, void *key, int key_len);
+int get_replica_value(struct index_t *index, void *key, int key_len,
+		      void **value, int32_t *value_len);
+int update_replica(struct mdhim_t *md, struct index_t *index, void *key, int key_len,
+		   void *value, int32_t value_len, int append);
+int delete_replica(struct index_t *index, void *key, int key_len);
+void delete_replica_range(struct index_t *index, void *start_key, int start_key_len,
+			  void *end_key, int end_key_len);
+int replicate_hot_keys(struct mdhim_t *md, struct index_t *index);
+
+#endif
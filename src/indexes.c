@@ -11,6 +11,10 @@
 #include <ctype.h>
 #include "mdhim.h"
 #include "indexes.h"
+#include "hot_keys.h"
+#include "frozen_index.h"
+#include "ds_run.h"
+#include "ds_shard.h"
 
 /**
  * to_lower
@@ -73,8 +77,11 @@ int open_manifest(struct mdhim_t *md, struct index_t *index, int flags) {
  */
 void write_manifest(struct mdhim_t *md, struct index_t *index) {
 	index_manifest_t manifest;
+	slice_owner_t *owner, *tmp;
+	int *owners;
 	int fd;
 	int ret;
+	int i;
 
 	//Range server with range server number 1, for the primary index, is in charge of the manifest
 	if (index->type != LOCAL_INDEX && 
@@ -89,18 +96,51 @@ void write_manifest(struct mdhim_t *md, struct index_t *index) {
 	}
 	
 	//Populate the manifest structure
+	memset(&manifest, 0, sizeof(manifest));
 	manifest.num_rangesrvs = index->num_rangesrvs;
 	manifest.key_type = index->key_type;
 	manifest.db_type = index->db_type;
 	manifest.rangesrv_factor = index->range_server_factor;
 	manifest.slice_size = index->mdhim_max_recs_per_slice;
 	manifest.num_nodes = md->mdhim_comm_size;       
+	manifest.partition_type = index->partition_type;
+	manifest.num_splitters = index->num_splitters;
+	manifest.routing_epoch = index->routing_epoch;
+	manifest.num_slice_owners = HASH_COUNT(index->slice_owners);
+	manifest.placement = index->placement;
+	manifest.num_hosts = md->num_nodes;
+	manifest.num_shards = index->num_shards;
 	
 	if ((ret = write(fd, &manifest, sizeof(manifest))) < 0) {
 		mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error writing manifest file", 
 		     md->mdhim_rank);
 	}
 
+	//The splitters follow the manifest structure
+	if (index->num_splitters && 
+	    (ret = write(fd, index->splitters, sizeof(int) * index->num_splitters)) < 0) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error writing splitters to the manifest file", 
+		     md->mdhim_rank);
+	}
+
+	//The migrated slices follow the splitters as slice and range server number pairs
+	if (manifest.num_slice_owners) {
+		owners = malloc(sizeof(int) * 2 * manifest.num_slice_owners);
+		i = 0;
+		HASH_ITER(hh, index->slice_owners, owner, tmp) {
+			owners[i * 2] = owner->slice;
+			owners[i * 2 + 1] = owner->rangesrv_num;
+			i++;
+		}
+
+		if ((ret = write(fd, owners, sizeof(int) * 2 * manifest.num_slice_owners)) < 0) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error writing slice owners to the manifest file", 
+			     md->mdhim_rank);
+		}
+
+		free(owners);
+	}
+
 	close(fd);
 }
 
@@ -112,10 +152,13 @@ void write_manifest(struct mdhim_t *md, struct index_t *index) {
  * @return MDHIM_SUCCESS or MDHIM_ERROR on error
  */
 int read_manifest(struct mdhim_t *md, struct index_t *index) {
+	int *owners;
 	int fd;
 	int ret;
+	int i;
 	index_manifest_t manifest;
 
+	memset(&manifest, 0, sizeof(manifest));
 	if ((fd = open_manifest(md, index, O_RDWR)) < 0) {
 		mlog(MDHIM_SERVER_DBG, "Rank: %d - Couldn't open manifest file", 
 		     md->mdhim_rank);
@@ -166,117 +209,565 @@ int read_manifest(struct mdhim_t *md, struct index_t *index) {
 		     md->mdhim_rank);
 		ret = MDHIM_ERROR;
 	}
+	//Manifests written before the partition type was recorded are range partitioned
+	if (!manifest.partition_type) {
+		manifest.partition_type = MDHIM_RANGE_PARTITION;
+	}
+	if (manifest.partition_type != index->partition_type) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - The partition type in the manifest file" 
+		     " doesn't match the current partition type", 
+		     md->mdhim_rank);
+		ret = MDHIM_ERROR;
+	}
+
+	if (manifest.placement != index->placement) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - The range server placement in the manifest file" 
+		     " doesn't match the current range server placement", 
+		     md->mdhim_rank);
+		ret = MDHIM_ERROR;
+	}
+	//With node placement, the range server numbers depend on how the ranks share nodes
+	if (index->placement == MDHIM_NODE_PLACEMENT && manifest.num_hosts != md->num_nodes) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - The number of hosts in this MDHIM instance" 
+		     " doesn't match the number used previously", 
+		     md->mdhim_rank);
+		ret = MDHIM_ERROR;
+	}
+
+	//Manifests written before the number of shards was recorded have one data store
+	if (!manifest.num_shards) {
+		manifest.num_shards = 1;
+	}
+	if (manifest.num_shards != index->num_shards) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - The number of shards in the manifest file" 
+		     " doesn't match the current number of shards", 
+		     md->mdhim_rank);
+		ret = MDHIM_ERROR;
+	}
+
+	//Read in the splitters that were computed for this index
+	if (ret == MDHIM_SUCCESS && manifest.num_splitters > 0) {
+		index->splitters = malloc(sizeof(int) * manifest.num_splitters);
+		if (read(fd, index->splitters, sizeof(int) * manifest.num_splitters) != 
+		    sizeof(int) * manifest.num_splitters) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Couldn't read the splitters from" 
+			     " the manifest file", 
+			     md->mdhim_rank);
+			free(index->splitters);
+			index->splitters = NULL;
+			ret = MDHIM_ERROR;
+		} else {
+			index->num_splitters = manifest.num_splitters;
+		}
+	}
+
+	//Read in the slices that were migrated to other range servers
+	if (ret == MDHIM_SUCCESS && manifest.num_slice_owners > 0) {
+		owners = malloc(sizeof(int) * 2 * manifest.num_slice_owners);
+		if (read(fd, owners, sizeof(int) * 2 * manifest.num_slice_owners) != 
+		    sizeof(int) * 2 * manifest.num_slice_owners) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Couldn't read the slice owners from" 
+			     " the manifest file", 
+			     md->mdhim_rank);
+			ret = MDHIM_ERROR;
+		} else {
+			for (i = 0; i < manifest.num_slice_owners; i++) {
+				set_slice_owner(index, owners[i * 2], owners[i * 2 + 1]);
+			}
+		}
+
+		free(owners);
+	}
+
+	index->routing_epoch = manifest.routing_epoch;
 	
 	close(fd);
 	return ret;
 }
 
 /**
- * update_stat
- * Adds or updates the given stat to the hash table
+ * stat_bloom_bits
+ * Gets the number of bits of a level of a data store's key filter
  *
- * @param md       pointer to the main MDHIM structure
- * @param key      pointer to the key we are examining
- * @param key_len  the key's length
- * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ * @param level    the level
+ * @return the number of bits, a power of 2
  */
-int update_stat(struct mdhim_t *md, struct index_t *index, void *key, uint32_t key_len) {
-	int slice_num;
-	void *val1, *val2;
-	int float_type = 0;
-	struct mdhim_stat *os, *stat;
+static uint64_t stat_bloom_bits(int level) {
+	return (uint64_t) MDHIM_STAT_BLOOM_MIN_BITS << level;
+}
 
-	//Acquire the lock to update the stats
-	while (pthread_rwlock_wrlock(index->mdhim_store->mdhim_store_stats_lock) == EBUSY) {
-		usleep(10);
+/**
+ * stat_bloom_level_test
+ * Checks a key against a level of a data store's key filter, or adds the key to it
+ *
+ * @param bloom    the level
+ * @param bits     the number of bits of the level
+ * @param hash     the hash of the key
+ * @param add      whether to add the key to the level
+ * @return 1 if the key may have been added before, 0 if it was not
+ */
+static int stat_bloom_level_test(unsigned char *bloom, uint64_t bits, uint64_t hash, int add) {
+	uint64_t mask, h1, h2, bit;
+	int found, i;
+
+	mask = bits - 1;
+	h1 = hash;
+	h2 = (hash >> 32) | 1;
+	found = 1;
+	for (i = 0; i < MDHIM_STAT_BLOOM_HASHES; i++) {
+		bit = (h1 + i * h2) & mask;
+		//Workers add keys to the filter at the same time without a lock
+		if (!(__atomic_load_n(&bloom[bit / 8], __ATOMIC_RELAXED) & (1 << (bit % 8)))) {
+			found = 0;
+			if (!add) {
+				break;
+			}
+		}
+
+		if (add) {
+			__atomic_fetch_or(&bloom[bit / 8], 1 << (bit % 8), __ATOMIC_RELAXED);
+		}
 	}
 
-	if ((float_type = is_float_key(index->key_type)) == 1) {
-		val1 = (void *) malloc(sizeof(long double));
-		val2 = (void *) malloc(sizeof(long double));
-	} else {
-		val1 = (void *) malloc(sizeof(uint64_t));
-		val2 = (void *) malloc(sizeof(uint64_t));
+	return found;
+}
+
+/**
+ * stat_bloom_add
+ * Adds a key to the last level of a data store's key filter.  The key that fills the level 
+ * adds the next one, unless the levels would grow past MDHIM_STAT_BLOOM_MAX_BITS, after which 
+ * the last level takes every key and its false positives go up
+ *
+ * @param store    the data store the key was put in
+ * @param hash     the hash of the key
+ */
+static void stat_bloom_add(struct mdhim_store_t *store, uint64_t hash) {
+	unsigned char *bloom, *expected;
+	uint64_t bits, keys;
+	int level;
+
+	level = __atomic_load_n(&store->bloom_level, __ATOMIC_ACQUIRE);
+	bits = stat_bloom_bits(level);
+	stat_bloom_level_test(store->bloom[level], bits, hash, 1);
+	keys = __atomic_add_fetch(&store->bloom_keys, 1, __ATOMIC_RELAXED);
+	//The levels up to the next one would hold bits * 4 - MDHIM_STAT_BLOOM_MIN_BITS bits
+	if (keys != bits / MDHIM_STAT_BLOOM_BITS_PER_KEY || level + 1 >= MDHIM_STORE_BLOOM_LEVELS ||
+	    bits * 4 - MDHIM_STAT_BLOOM_MIN_BITS > MDHIM_STAT_BLOOM_MAX_BITS) {
+		return;
+	}
+
+	//Only one worker may add the level, the others free theirs
+	bloom = malloc(stat_bloom_bits(level + 1) / 8);
+	memset(bloom, 0, stat_bloom_bits(level + 1) / 8);
+	expected = NULL;
+	if (!__atomic_compare_exchange_n(&store->bloom[level + 1], &expected, bloom, 0, 
+					 __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		free(bloom);
+		return;
+	}
+
+	__atomic_store_n(&store->bloom_keys, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&store->bloom_level, level + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * stat_bloom_test
+ * Checks a key against every level of a data store's key filter
+ *
+ * @param store    the data store
+ * @param hash     the hash of the key
+ * @return 1 if the key may have been added before, 0 if it was not
+ */
+static int stat_bloom_test(struct mdhim_store_t *store, uint64_t hash) {
+	int level, i;
+
+	level = __atomic_load_n(&store->bloom_level, __ATOMIC_ACQUIRE);
+	for (i = 0; i <= level; i++) {
+		if (stat_bloom_level_test(store->bloom[i], stat_bloom_bits(i), hash, 0)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+//Number of the calling thread's accumulator, handed out the first time it puts a key
+static __thread int stat_acc_id = -1;
+static int stat_acc_ids = 0;
+
+/**
+ * stat_acc_lock
+ * Locks the calling thread's accumulator of a data store's stats
+ *
+ * @param store    the data store
+ * @return the locked accumulator
+ */
+static struct mdhim_stat_acc *stat_acc_lock(struct mdhim_store_t *store) {
+	struct mdhim_stat_acc *acc;
+
+	if (stat_acc_id < 0) {
+		stat_acc_id = __atomic_fetch_add(&stat_acc_ids, 1, __ATOMIC_RELAXED);
+	}
+
+	acc = &store->stat_accs[stat_acc_id % store->num_stat_accs];
+	pthread_mutex_lock(&acc->lock);
+
+	return acc;
+}
+
+/**
+ * stat_acc_entry
+ * Gets the entry of a slice in a locked accumulator.  Entries are kept once merged, 
+ * so a worker only allocates one the first time it sees a slice
+ *
+ * @param acc      the accumulator
+ * @param slice    the slice number
+ * @return the entry of the slice
+ */
+static struct mdhim_stat_acc_entry *stat_acc_entry(struct mdhim_stat_acc *acc, int slice) {
+	struct mdhim_stat_acc_entry *entry;
+
+	entry = acc->last;
+	if (!entry || entry->slice != slice) {
+		HASH_FIND_INT(acc->entries, &slice, entry);
+	}
+
+	if (!entry) {
+		entry = malloc(sizeof(struct mdhim_stat_acc_entry));
+		memset(entry, 0, sizeof(struct mdhim_stat_acc_entry));
+		entry->slice = slice;
+		HASH_ADD_INT(acc->entries, slice, entry);
 	}
 
+	acc->last = entry;
+
+	return entry;
+}
+
+/**
+ * stat_key_value
+ * Gets the number a key is counted as in the min and max of its slice's stat
+ *
+ * @param index    the index of the key
+ * @param key      the key
+ * @param key_len  the length of the key
+ * @param ival     out  the number of an integer key
+ * @param dval     out  the number of a key of any other type
+ */
+static void stat_key_value(struct index_t *index, void *key, uint32_t key_len, 
+			   uint64_t *ival, long double *dval) {
+	*ival = 0;
+	*dval = 0;
 	if (index->key_type == MDHIM_STRING_KEY) {
-		*(long double *)val1 = get_str_num(key, key_len);
-		*(long double *)val2 = *(long double *)val1;
+		*dval = get_str_num(key, key_len);
 	} else if (index->key_type == MDHIM_FLOAT_KEY) {
-		*(long double *)val1 = *(float *) key;
-		*(long double *)val2 = *(float *) key;
+		*dval = *(float *) key;
 	} else if (index->key_type == MDHIM_DOUBLE_KEY) {
-		*(long double *)val1 = *(double *) key;
-		*(long double *)val2 = *(double *) key;
+		*dval = *(double *) key;
 	} else if (index->key_type == MDHIM_INT_KEY) {
-		*(uint64_t *)val1 = *(uint32_t *) key;
-		*(uint64_t *)val2 = *(uint32_t *) key;
+		*ival = *(uint32_t *) key;
 	} else if (index->key_type == MDHIM_LONG_INT_KEY) {
-		*(uint64_t *)val1 = *(uint64_t *) key;
-		*(uint64_t *)val2 = *(uint64_t *) key;
+		*ival = *(uint64_t *) key;
 	} else if (index->key_type == MDHIM_BYTE_KEY) {
-		*(long double *)val1 = get_byte_num(key, key_len);
-		*(long double *)val2 = *(long double *)val1;
+		*dval = get_byte_num(key, key_len);
 	} 
+}
 
-	slice_num = get_slice_num(md, index, key, key_len);
-
-	HASH_FIND_INT(index->mdhim_store->mdhim_store_stats, &slice_num, os);
+/**
+ * stat_create
+ * Adds an empty stat of a slice to the data store's stats.  The caller holds the write lock
+ *
+ * @param index    the index of the slice
+ * @param slice    the slice number
+ * @return the stat
+ */
+static struct mdhim_stat *stat_create(struct index_t *index, int slice) {
+	struct mdhim_stat *stat;
 
 	stat = malloc(sizeof(struct mdhim_stat));
-	stat->min = val1;
-	stat->max = val2;
-	stat->num = 1;
-	stat->key = slice_num;
+	memset(stat, 0, sizeof(struct mdhim_stat));
+	if (is_float_key(index->key_type)) {
+		stat->min = malloc(sizeof(long double));
+		stat->max = malloc(sizeof(long double));
+	} else {
+		stat->min = malloc(sizeof(uint64_t));
+		stat->max = malloc(sizeof(uint64_t));
+	}
+
+	stat->key = slice;
 	stat->dirty = 1;
+	stat->changed = 1;
 
-	if (float_type && os) {
-		if (*(long double *)os->min > *(long double *)val1) {
-			free(os->min);
-			stat->min = val1;
-		} else {
-			free(val1);
-			stat->min = os->min;
-		}
+	HASH_ADD_INT(index->mdhim_store->mdhim_store_stats, key, stat);
 
-		if (*(long double *)os->max < *(long double *)val2) {
-			free(os->max);
-			stat->max = val2;
-		} else {
-			free(val2);
-			stat->max = os->max;
+	return stat;
+}
+
+/**
+ * merge_stat_accs
+ * Merges the keys and the loads the worker threads counted into the data store's stats.  
+ * The caller holds the write lock of the stats
+ *
+ * @param index    the index whose stats are merged
+ */
+void merge_stat_accs(struct index_t *index) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	struct mdhim_stat_acc_entry *entry, *tmp;
+	struct mdhim_stat *stat;
+	int float_type;
+	int i;
+
+	float_type = is_float_key(index->key_type);
+	for (i = 0; i < store->num_stat_accs; i++) {
+		pthread_mutex_lock(&store->stat_accs[i].lock);
+		HASH_ITER(hh, store->stat_accs[i].entries, entry, tmp) {
+			if (!entry->num && !entry->load) {
+				continue;
+			}
+
+			//Slices without records don't have a stat and have nothing to migrate
+			HASH_FIND_INT(store->mdhim_store_stats, &entry->slice, stat);
+			if (!stat && !entry->num) {
+				entry->load = 0;
+				continue;
+			} else if (!stat) {
+				stat = stat_create(index, entry->slice);
+			}
+
+			stat->load += entry->load;
+			entry->load = 0;
+			if (!entry->num) {
+				continue;
+			}
+
+			if (float_type) {
+				if (!stat->num || *(long double *)stat->min > entry->dmin) {
+					*(long double *)stat->min = entry->dmin;
+				}
+				if (!stat->num || *(long double *)stat->max < entry->dmax) {
+					*(long double *)stat->max = entry->dmax;
+				}
+			} else {
+				if (!stat->num || *(uint64_t *)stat->min > entry->imin) {
+					*(uint64_t *)stat->min = entry->imin;
+				}
+				if (!stat->num || *(uint64_t *)stat->max < entry->imax) {
+					*(uint64_t *)stat->max = entry->imax;
+				}
+			}
+
+			stat->num += entry->num;
+			stat->dirty = 1;
+			stat->changed = 1;
+			entry->num = 0;
 		}
+
+		pthread_mutex_unlock(&store->stat_accs[i].lock);
+	}
+}
+
+/**
+ * mark_stat_removed
+ * Remembers that the stat of a slice was removed, so the next stat flush removes it 
+ * from the clients' stats.  The caller holds the write lock of the stats
+ *
+ * @param index    the index of the slice
+ * @param slice    the slice number
+ */
+void mark_stat_removed(struct index_t *index, int slice) {
+	struct mdhim_store_t *store = index->mdhim_store;
+
+	if (store->num_removed_slices == store->max_removed_slices) {
+		store->max_removed_slices = store->max_removed_slices ? 
+			store->max_removed_slices * 2 : 16;
+		store->removed_slices = realloc(store->removed_slices, 
+						sizeof(int) * store->max_removed_slices);
+	}
+
+	store->removed_slices[store->num_removed_slices++] = slice;
+}
+
+/**
+ * update_stat
+ * Counts a new key in the calling worker's accumulator and adds it to the data store's filter.
+ * The stats lock isn't taken: the stat of a new slice is made when the workers are merged
+ *
+ * @param md       pointer to the main MDHIM structure
+ * @param key      pointer to the key we are examining
+ * @param key_len  the key's length
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int update_stat(struct mdhim_t *md, struct index_t *index, void *key, uint32_t key_len) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	struct mdhim_stat_acc *acc;
+	struct mdhim_stat_acc_entry *entry;
+	uint64_t ival, hash;
+	long double dval;
+	int slice_num;
+
+	stat_key_value(index, key, key_len, &ival, &dval);
+	slice_num = get_slice_num(md, index, key, key_len);
+	hash = get_key_hash(index, key, key_len);
+	if (!store->num_stat_accs) {
+		return MDHIM_ERROR;
+	}
+
+	//Count the key in this thread's accumulator, which the other workers don't touch
+	acc = stat_acc_lock(store);
+	entry = stat_acc_entry(acc, slice_num);
+	if (!entry->num || entry->imin > ival) {
+		entry->imin = ival;
+	}
+	if (!entry->num || entry->imax < ival) {
+		entry->imax = ival;
+	}
+	if (!entry->num || entry->dmin > dval) {
+		entry->dmin = dval;
+	}
+	if (!entry->num || entry->dmax < dval) {
+		entry->dmax = dval;
 	}
-	if (!float_type && os) {
-		if (*(uint64_t *)os->min > *(uint64_t *)val1) {
-			free(os->min);
-			stat->min = val1;
+
+	entry->num++;
+	pthread_mutex_unlock(&acc->lock);
+	stat_bloom_add(store, hash);
+
+	return MDHIM_SUCCESS;
+}
+
+static int cmp_slice(const void *a, const void *b) {
+	int sa = *(const int *) a;
+	int sb = *(const int *) b;
+
+	return sa < sb ? -1 : sa > sb;
+}
+
+/**
+ * find_new_keys
+ * Finds the keys that may already be in the data store, using the data store's key filter.  
+ * The keys of slices whose stats were loaded from the database aren't in the filter and 
+ * all of them may be in the data store.  No lock is taken
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index the keys are put in
+ * @param keys      The keys
+ * @param key_lens  The lengths of the keys
+ * @param num_keys  The number of keys
+ * @param maybe     Set to 1 for each key that may be in the data store, 0 for new keys
+ */
+void find_new_keys(struct mdhim_t *md, struct index_t *index, 
+		   void **keys, int *key_lens, int num_keys, int *maybe) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	int slice;
+	int i;
+
+	for (i = 0; i < num_keys; i++) {
+		slice = get_slice_num(md, index, keys[i], key_lens[i]);
+		//The unfiltered slices are only set when the data store is opened
+		if (store->num_unfiltered_slices && 
+		    bsearch(&slice, store->unfiltered_slices, store->num_unfiltered_slices, 
+			    sizeof(int), cmp_slice)) {
+			maybe[i] = 1;
 		} else {
-			free(val1);
-			stat->min = os->min;
+			maybe[i] = stat_bloom_test(store, get_key_hash(index, keys[i], key_lens[i]));
 		}
+	}
+}
 
-		if (*(uint64_t *)os->max < *(uint64_t *)val2) {
-			free(os->max);
-			stat->max = val2;
-		} else {
-			free(val2);
-			stat->max = os->max;
-		}		
+/**
+ * remove_stats
+ * Takes deleted keys out of the counts of their slices' stats.  A slice's stat is 
+ * removed when its last key is deleted.  The min and max of a slice are left as they are, 
+ * they still bound the keys that are left
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index the keys were deleted from
+ * @param keys      The keys that were deleted
+ * @param key_lens  The lengths of the keys
+ * @param num_keys  The number of keys
+ */
+void remove_stats(struct mdhim_t *md, struct index_t *index, 
+		  void **keys, int *key_lens, int num_keys) {
+	struct mdhim_stat *stat;
+	int *slices;
+	int i;
+
+	if (num_keys <= 0) {
+		return;
+	}
+
+	//Find the slices before taking the lock
+	slices = malloc(sizeof(int) * num_keys);
+	for (i = 0; i < num_keys; i++) {
+		slices[i] = get_slice_num(md, index, keys[i], key_lens[i]);
+	}
+
+	//Acquire the lock to update the stats
+	while (pthread_rwlock_wrlock(index->mdhim_store->mdhim_store_stats_lock) == EBUSY) {
+		usleep(10);
 	}
 
-	if (!os) {
-		HASH_ADD_INT(index->mdhim_store->mdhim_store_stats, key, stat);    
-	} else {	
-		stat->num = os->num + 1;
-		//Replace the existing stat
-		HASH_REPLACE_INT(index->mdhim_store->mdhim_store_stats, key, stat, os);  
-		free(os);
+	//The counts of the keys the workers put have to be in the stats to take keys out of them
+	merge_stat_accs(index);
+	for (i = 0; i < num_keys; i++) {
+		HASH_FIND_INT(index->mdhim_store->mdhim_store_stats, &slices[i], stat);
+		if (!stat) {
+			continue;
+		}
+
+		stat->dirty = 1;
+		stat->changed = 1;
+		if (stat->num > 1) {
+			stat->num--;
+			continue;
+		}
+
+		HASH_DEL(index->mdhim_store->mdhim_store_stats, stat);
+		mark_stat_removed(index, slices[i]);
+		free(stat->max);
+		free(stat->min);
+		free(stat);
+		index->mdhim_store->del(index->mdhim_store->db_stats, &slices[i], sizeof(int));
 	}
 
 	//Release the stats lock
 	pthread_rwlock_unlock(index->mdhim_store->mdhim_store_stats_lock);
-	return MDHIM_SUCCESS;
+	free(slices);
+}
+
+/**
+ * update_slice_load
+ * Counts operations on the slices of the keys given, so hot slices can be found by the rebalancer
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param index     The index the keys belong to
+ * @param keys      The keys that were operated on
+ * @param key_lens  The lengths of the keys
+ * @param num_keys  The number of keys
+ */
+void update_slice_load(struct mdhim_t *md, struct index_t *index, 
+		       void **keys, int *key_lens, int num_keys) {
+	struct mdhim_stat_acc *acc;
+	int slice;
+	int i;
+
+	//Only slices of range and splitter partitioned global indexes can be migrated
+	if (index->type == LOCAL_INDEX || index->partition_type == MDHIM_HASH_PARTITION || 
+	    num_keys <= 0 || !index->mdhim_store->num_stat_accs) {
+		return;
+	}
+
+	//The loads are counted in this thread's accumulator and merged into the stats
+	acc = stat_acc_lock(index->mdhim_store);
+	for (i = 0; i < num_keys; i++) {
+		if ((slice = get_slice_num(md, index, keys[i], key_lens[i])) == MDHIM_ERROR) {
+			continue;
+		}
+
+		stat_acc_entry(acc, slice)->load++;
+	}
+
+	pthread_mutex_unlock(&acc->lock);
 }
 
 /**
@@ -346,13 +837,27 @@ int load_stats(struct mdhim_t *md, struct index_t *index) {
 		stat->min = min;
 		stat->max = max;
 		stat->num = (*(struct mdhim_db_stat **)val)->num;
+		stat->load = 0;
 		stat->key = **slice;
 		stat->dirty = 0;
+		//The clients haven't seen the stats of an earlier run
+		stat->changed = 1;
 		old_slice = *slice;
+		//The keys of the slice from an earlier run aren't in the data store's filter
+		if (index->mdhim_store->num_unfiltered_slices % 64 == 0) {
+			index->mdhim_store->unfiltered_slices = 
+				realloc(index->mdhim_store->unfiltered_slices, sizeof(int) * 
+					(index->mdhim_store->num_unfiltered_slices + 64));
+		}
+
+		index->mdhim_store->unfiltered_slices[index->mdhim_store->num_unfiltered_slices++] = 
+			stat->key;
 		HASH_ADD_INT(index->mdhim_store->mdhim_store_stats, key, stat); 
 		free(*val);
 	}
 
+	qsort(index->mdhim_store->unfiltered_slices, index->mdhim_store->num_unfiltered_slices, 
+	      sizeof(int), cmp_slice);
 	if (old_slice) {
 		free(old_slice);
 	}
@@ -378,6 +883,11 @@ int write_stats(struct mdhim_t *md, struct index_t *bi) {
 	int float_type = 0;
 
 	float_type = is_float_key(bi->key_type);
+	while (pthread_rwlock_wrlock(bi->mdhim_store->mdhim_store_stats_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	merge_stat_accs(bi);
 
 	//Iterate through the stat hash entries
 	HASH_ITER(hh, bi->mdhim_store->mdhim_store_stats, stat, tmp) {	
@@ -418,6 +928,8 @@ int write_stats(struct mdhim_t *md, struct index_t *bi) {
 		free(stat);
 	}
 
+	pthread_rwlock_unlock(bi->mdhim_store->mdhim_store_stats_lock);
+
 	return MDHIM_SUCCESS;
 }
 
@@ -432,26 +944,29 @@ int write_stats(struct mdhim_t *md, struct index_t *bi) {
 
 int open_db_store(struct mdhim_t *md, struct index_t *index) {
 	char filename[PATH_MAX] = {'\0'};
+	char prefix[PATH_MAX] = {'\0'};
+	char suffix[64] = {'\0'};
 	int flags = MDHIM_CREATE;
 	int path_num;
-	int ret;
+	int ret, i;
 
 	//Database filename is dependent on ranges.  This needs to be configurable and take a prefix
 	if (!md->db_opts->db_paths) {
-		sprintf(filename, "%s%s-%d-%d", md->db_opts->db_path, md->db_opts->db_name, 
-			index->id, md->mdhim_rank);
+		sprintf(prefix, "%s%s", md->db_opts->db_path, md->db_opts->db_name);
 	} else {
 		path_num = index->myinfo.rangesrv_num/((double) index->num_rangesrvs/(double) md->db_opts->num_paths);
 		path_num = path_num >= md->db_opts->num_paths ? md->db_opts->num_paths - 1 : path_num;
 		if (path_num < 0) {
-			sprintf(filename, "%s%s-%d-%d", md->db_opts->db_path, md->db_opts->db_name, index->id, 
-				md->mdhim_rank);
+			sprintf(prefix, "%s%s", md->db_opts->db_path, md->db_opts->db_name);
 		} else {
-			sprintf(filename, "%s%s-%d-%d", md->db_opts->db_paths[path_num], 
-				md->db_opts->db_name, index->id, md->mdhim_rank);
+			sprintf(prefix, "%s%s", md->db_opts->db_paths[path_num], 
+				md->db_opts->db_name);
 		}
 	}
 
+	sprintf(suffix, "-%d-%d", index->id, md->mdhim_rank);
+	sprintf(filename, "%s%s", prefix, suffix);
+
 	//Initialize data store
 	index->mdhim_store = mdhim_db_init(index->db_type);
 	if (!index->mdhim_store) {
@@ -462,6 +977,21 @@ int open_db_store(struct mdhim_t *md, struct index_t *index) {
 		return MDHIM_ERROR;
 	}
 
+	//Each worker thread counts the keys it puts in its own accumulator
+	index->mdhim_store->num_stat_accs = md->db_opts->num_wthreads > 0 ? 
+		md->db_opts->num_wthreads : 1;
+	index->mdhim_store->stat_accs = malloc(sizeof(struct mdhim_stat_acc) * 
+					       index->mdhim_store->num_stat_accs);
+	for (i = 0; i < index->mdhim_store->num_stat_accs; i++) {
+		pthread_mutex_init(&index->mdhim_store->stat_accs[i].lock, NULL);
+		index->mdhim_store->stat_accs[i].entries = NULL;
+		index->mdhim_store->stat_accs[i].last = NULL;
+	}
+
+	//The key filter starts with its smallest level and grows with the keys put
+	index->mdhim_store->bloom[0] = malloc(stat_bloom_bits(0) / 8);
+	memset(index->mdhim_store->bloom[0], 0, stat_bloom_bits(0) / 8);
+
 	//Open the main database and the stats database
 	if ((ret = index->mdhim_store->open(&index->mdhim_store->db_handle,
 					    &index->mdhim_store->db_stats,
@@ -471,6 +1001,23 @@ int open_db_store(struct mdhim_t *md, struct index_t *index) {
 		     md->mdhim_rank);
 		return MDHIM_ERROR;
 	}
+
+	//Split the index into the other shards, if there are several
+	if ((ret = mdhim_shard_wrap(md, index, index->mdhim_store, prefix, suffix, 
+				    flags)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - " 
+		     "Error while opening the shards of the database", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	//Serve reads from the run of a frozen index, which may be left by an earlier job
+	if ((ret = mdhim_run_wrap(index->mdhim_store, filename, index->key_type)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - " 
+		     "Error while wrapping the database with its run", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
 	
 	//Load the stats from the database
 	if ((ret = load_stats(md, index)) != MDHIM_SUCCESS) {
@@ -483,6 +1030,20 @@ int open_db_store(struct mdhim_t *md, struct index_t *index) {
 	return MDHIM_SUCCESS;
 }
 
+/**
+ * get_node_num_range_servers
+ * Gets the number of range servers placed on a node with MDHIM_NODE_PLACEMENT
+ *
+ * @param md       main MDHIM struct
+ * @param index    pointer to a index_t struct
+ * @param node     the node index
+ * @return         the number of range servers on the node
+ */
+static int get_node_num_range_servers(struct mdhim_t *md, struct index_t *index, int node) {
+	return (md->node_sizes[node] + index->range_server_factor - 1) / 
+		index->range_server_factor;
+}
+
 /**
  * get_num_range_servers
  * Gets the number of range servers for an index
@@ -503,7 +1064,16 @@ uint32_t get_num_range_servers(struct mdhim_t *md, struct index_t *rindex) {
 		return MDHIM_ERROR;
 	}
 
-	/* Get the number of range servers */
+	//Every node gets at least one range server, details are in is_range_server
+	if (rindex->placement == MDHIM_NODE_PLACEMENT) {
+		for (i = 0; i < md->num_nodes; i++) {
+			num_servers += get_node_num_range_servers(md, rindex, i);
+		}
+
+		return num_servers;
+	}
+
+	/* Get the number of range servers */
 	if (size - 1 < rindex->range_server_factor) {
 		//The size of the communicator is less than the RANGE_SERVER_FACTOR
 		return 1;
@@ -557,6 +1127,8 @@ struct index_t *create_local_index(struct mdhim_t *md, int db_type, int key_type
 	memset(li, 0, sizeof(struct index_t));
 	li->id = HASH_COUNT(md->indexes);
 	li->range_server_factor = md->primary_index->range_server_factor;
+	li->placement = md->primary_index->placement;
+	li->num_shards = md->primary_index->num_shards;
 	li->mdhim_max_recs_per_slice = MDHIM_MAX_SLICES;
 	li->type = LOCAL_INDEX;
 	li->key_type = key_type;
@@ -564,7 +1136,16 @@ struct index_t *create_local_index(struct mdhim_t *md, int db_type, int key_type
 	li->myinfo.rangesrv_num = 0;
 	li->myinfo.rank = md->mdhim_rank;
 	li->primary_id = md->primary_index->id;
+	li->partition_type = MDHIM_RANGE_PARTITION;
 	li->stats = NULL;
+	li->stats_stale = 0;
+	li->stats_lock = malloc(sizeof(pthread_rwlock_t));
+	pthread_rwlock_init(li->stats_lock, NULL);
+	li->routing_lock = malloc(sizeof(pthread_rwlock_t));
+	pthread_rwlock_init(li->routing_lock, NULL);
+	li->moving_slice = -1;
+	li->moved_keys_lock = malloc(sizeof(pthread_mutex_t));
+	pthread_mutex_init(li->moved_keys_lock, NULL);
 
     if (index_name != NULL) {
         size_t name_len = strlen(index_name)+1;
@@ -672,12 +1253,15 @@ done:
  * @param md                 main MDHIM struct
  * @param server_factor      used in calculating the number of range servers
  * @param max_recs_per_slice the number of records per slice
+ * @param partition_type     MDHIM_RANGE_PARTITION, MDHIM_HASH_PARTITION or 
+ *                           MDHIM_SPLITTER_PARTITION
  * @return                   MDHIM_ERROR on error, otherwise the index identifier
  */
 
 struct index_t *create_global_index(struct mdhim_t *md, int server_factor, 
 				    uint64_t max_recs_per_slice, 
-				    int db_type, int key_type, char *index_name) {
+				    int db_type, int key_type, int partition_type, 
+				    char *index_name) {
 	struct index_t *gi;
 	struct index_t *check = NULL;
 	uint32_t rangesrv_num;
@@ -691,6 +1275,13 @@ struct index_t *create_global_index(struct mdhim_t *md, int server_factor,
 		return NULL;
 	}
 
+	//Check that the partition type makes sense
+	if (partition_type != MDHIM_RANGE_PARTITION && partition_type != MDHIM_HASH_PARTITION && 
+	    partition_type != MDHIM_SPLITTER_PARTITION) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM - Invalid partition type specified");
+		return NULL;
+	}
+
 	//Acquire the lock to update indexes
 	while (pthread_rwlock_wrlock(md->indexes_lock) == EBUSY) {
 		usleep(10);
@@ -706,6 +1297,8 @@ struct index_t *create_global_index(struct mdhim_t *md, int server_factor,
 	memset(gi, 0, sizeof(struct index_t));
 	gi->id = HASH_COUNT(md->indexes);
 	gi->range_server_factor = server_factor;
+	gi->placement = md->db_opts->rserver_placement;
+	gi->num_shards = md->db_opts->db_num_shards > 0 ? md->db_opts->db_num_shards : 1;
 	gi->mdhim_max_recs_per_slice = max_recs_per_slice;
 	gi->type = gi->id > 0 ? SECONDARY_INDEX : PRIMARY_INDEX;
 	gi->key_type = key_type;
@@ -713,7 +1306,16 @@ struct index_t *create_global_index(struct mdhim_t *md, int server_factor,
 	gi->myinfo.rangesrv_num = 0;
 	gi->myinfo.rank = md->mdhim_rank;
 	gi->primary_id = gi->type == SECONDARY_INDEX ? md->primary_index->id : -1;
+	gi->partition_type = partition_type;
 	gi->stats = NULL;
+	gi->stats_stale = 0;
+	gi->stats_lock = malloc(sizeof(pthread_rwlock_t));
+	pthread_rwlock_init(gi->stats_lock, NULL);
+	gi->routing_lock = malloc(sizeof(pthread_rwlock_t));
+	pthread_rwlock_init(gi->routing_lock, NULL);
+	gi->moving_slice = -1;
+	gi->moved_keys_lock = malloc(sizeof(pthread_mutex_t));
+	pthread_mutex_init(gi->moved_keys_lock, NULL);
 
     if (gi->id > 0) {
 
@@ -770,6 +1372,12 @@ struct index_t *create_global_index(struct mdhim_t *md, int server_factor,
 		gi->myinfo.rangesrv_num = rangesrv_num;
 	}
 
+	//Initialize the hot key tracking and replication
+	if ((ret = hot_keys_init(md, gi)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error initializing the hot keys", 
+		     md->mdhim_rank);
+	}
+
 	//Initialize the communicator for this index
 	if ((ret = index_init_comm(md, gi)) != MDHIM_SUCCESS) {
 		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error creating the index communicator", 
@@ -777,11 +1385,6 @@ struct index_t *create_global_index(struct mdhim_t *md, int server_factor,
 		goto done;
 	}
 
-	//If not a range server, our work here is done
-	if (!rangesrv_num) {
-		goto done;
-	}	
-
 	//Read in the manifest file if the rangesrv_num is 1 for the primary index
 	if (rangesrv_num == 1 && 
 	    (ret = read_manifest(md, gi)) != MDHIM_SUCCESS) {
@@ -791,6 +1394,32 @@ struct index_t *create_global_index(struct mdhim_t *md, int server_factor,
 		MPI_Abort(md->mdhim_comm, 0);
 	}        
 
+	//Send the splitters read from the manifest to every rank
+	if (gi->partition_type == MDHIM_SPLITTER_PARTITION) {
+		MPI_Bcast(&gi->num_splitters, 1, MPI_INT, gi->rangesrvs_arr[0]->rank, 
+			  md->mdhim_client_comm);
+		if (gi->num_splitters > 0) {
+			if (!gi->splitters) {
+				gi->splitters = malloc(sizeof(int) * gi->num_splitters);
+			}
+
+			MPI_Bcast(gi->splitters, gi->num_splitters, MPI_INT, 
+				  gi->rangesrvs_arr[0]->rank, md->mdhim_client_comm);
+		}
+	}
+
+	//Send the slices migrated in previous runs to every rank
+	if (gi->partition_type != MDHIM_HASH_PARTITION && 
+	    (ret = bcast_slice_owners(md, gi, gi->rangesrvs_arr[0]->rank)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error receiving the migrated slices", 
+		     md->mdhim_rank);
+	}
+
+	//If not a range server, our work here is done
+	if (!rangesrv_num) {
+		goto done;
+	}	
+
 	//Open the data store
 	ret = open_db_store(md, (struct index_t *) gi);
 	if (ret != MDHIM_SUCCESS) {
@@ -836,6 +1465,10 @@ int get_rangesrvs(struct mdhim_t *md, struct index_t *index) {
 	uint32_t rangesrv_num;
 	int i;
 
+	//Flat array of the range servers used for routing without a hash lookup
+	index->rangesrvs_arr = malloc(sizeof(rangesrv_info *) * index->num_rangesrvs);
+	memset(index->rangesrvs_arr, 0, sizeof(rangesrv_info *) * index->num_rangesrvs);
+
 	//Iterate through the ranks to determine which ones are range servers
 	for (i = 0; i < md->mdhim_comm_size; i++) {
 		//Test if the rank is range server for this index
@@ -860,6 +1493,7 @@ int get_rangesrvs(struct mdhim_t *md, struct index_t *index) {
 		//Add it to the hash tables
 		HASH_ADD_INT(index->rangesrvs_by_num, rangesrv_num, rs_entry_num);     
 		HASH_ADD_INT(index->rangesrvs_by_rank, rank, rs_entry_rank);                 
+		index->rangesrvs_arr[rangesrv_num - 1] = rs_entry_num;
 	}
 
 	return MDHIM_SUCCESS;
@@ -876,6 +1510,7 @@ int get_rangesrvs(struct mdhim_t *md, struct index_t *index) {
 uint32_t is_range_server(struct mdhim_t *md, int rank, struct index_t *index) {
 	int size;
 	int ret;
+	int i, nth, node_servers;
 	uint64_t rangesrv_num = 0;
 
 	//If a local index, check to see if the rank is a range server for the primary index
@@ -891,6 +1526,37 @@ uint32_t is_range_server(struct mdhim_t *md, int rank, struct index_t *index) {
 		return MDHIM_ERROR;
 	}
 
+	/* With node placement, the RANGE_SERVER_FACTOR applies to the ranks of each node, 
+	   so every node gets servers in proportion to its ranks and at least one server.
+	   
+	   The range server numbers go round robin over the nodes: the first server of every node,
+	   then the second server of every node and so on.  Consecutive slices are then 
+	   served from different nodes.
+
+	   For example, with 2 nodes of 4 ranks and a RANGE_SERVER_FACTOR of 2, 
+	   the node ranks 0 and 2 of each node are range servers numbered: 
+	   node 0 rank 0 -> 1, node 1 rank 0 -> 2, node 0 rank 2 -> 3, node 1 rank 2 -> 4
+	*/
+	if (index->placement == MDHIM_NODE_PLACEMENT) {
+		if (md->rank_node_ranks[rank] % index->range_server_factor) {
+			return 0;
+		}
+
+		nth = md->rank_node_ranks[rank] / index->range_server_factor;
+		rangesrv_num = 1;
+		for (i = 0; i < md->num_nodes; i++) {
+			node_servers = get_node_num_range_servers(md, index, i);
+			//Every node's servers that come before the nth ones
+			rangesrv_num += node_servers < nth ? node_servers : nth;
+			//The nth servers of the nodes before ours
+			if (i < md->rank_nodes[rank] && node_servers > nth) {
+				rangesrv_num++;
+			}
+		}
+
+		return rangesrv_num;
+	}
+
 	/* Get the range server number, which is just a number from 1 onward
 	   It represents the ranges the server serves and is calculated with the RANGE_SERVER_FACTOR
 	   
@@ -1060,8 +1726,9 @@ return index;
 void indexes_release(struct mdhim_t *md) {
 	struct index_t *cur_indx, *tmp_indx;
 	struct rangesrv_info *cur_rs, *tmp_rs;
-	int ret;
-	struct mdhim_stat *stat, *tmp;
+	int ret, i;
+	struct mdhim_stat_acc_entry *acc_entry, *tmp_acc_entry;
+	slice_owner_t *owner, *tmp_owner;
 
 	HASH_ITER(hh, md->indexes, cur_indx, tmp_indx) {
 		HASH_DELETE(hh, md->indexes, cur_indx); 
@@ -1075,6 +1742,9 @@ void indexes_release(struct mdhim_t *md) {
 			HASH_DEL(cur_indx->rangesrvs_by_rank, cur_rs); 
 			free(cur_rs);
 		}
+
+		//The entries of the flat array were freed with the rangesrvs_by_num hash
+		free(cur_indx->rangesrvs_arr);
 		
 		//Clean up the storage if I'm a range server for this index
 		if (cur_indx->myinfo.rangesrv_num > 0) {
@@ -1100,6 +1770,23 @@ void indexes_release(struct mdhim_t *md) {
 			
 			pthread_rwlock_destroy(cur_indx->mdhim_store->mdhim_store_stats_lock);
 			free(cur_indx->mdhim_store->mdhim_store_stats_lock);
+			for (i = 0; i < cur_indx->mdhim_store->num_stat_accs; i++) {
+				HASH_ITER(hh, cur_indx->mdhim_store->stat_accs[i].entries, 
+					  acc_entry, tmp_acc_entry) {
+					HASH_DEL(cur_indx->mdhim_store->stat_accs[i].entries, acc_entry);
+					free(acc_entry);
+				}
+
+				pthread_mutex_destroy(&cur_indx->mdhim_store->stat_accs[i].lock);
+			}
+
+			free(cur_indx->mdhim_store->stat_accs);
+			free(cur_indx->mdhim_store->removed_slices);
+			free(cur_indx->mdhim_store->unfiltered_slices);
+			for (i = 0; i < MDHIM_STORE_BLOOM_LEVELS; i++) {
+				free(cur_indx->mdhim_store->bloom[i]);
+			}
+
 			if (cur_indx->type != LOCAL_INDEX) {
 				MPI_Comm_free(&cur_indx->rs_comm);
 			}
@@ -1107,49 +1794,101 @@ void indexes_release(struct mdhim_t *md) {
 		}
 	
 		
-		//Iterate through the stat hash entries to free them
-		HASH_ITER(hh, cur_indx->stats, stat, tmp) {	
-			if (!stat) {
-				continue;
-			}
-			
-			HASH_DEL(cur_indx->stats, stat); 
-			free(stat->max);
-			free(stat->min);
-			free(stat);
-		}			
-	
+		if (cur_indx->stats) {
+			free(cur_indx->stats);
+		}
+		pthread_rwlock_destroy(cur_indx->stats_lock);
+		free(cur_indx->stats_lock);
+		pthread_rwlock_destroy(cur_indx->routing_lock);
+		free(cur_indx->routing_lock);
+		pthread_mutex_destroy(cur_indx->moved_keys_lock);
+		free(cur_indx->moved_keys_lock);
+		if (cur_indx->splitters) {
+			free(cur_indx->splitters);
+		}
+		if (cur_indx->fences) {
+			free(cur_indx->fences);
+		}
+
+		hot_keys_release(cur_indx);
+		if (cur_indx->frozen) {
+			thaw_index(md, cur_indx);
+		}
+		HASH_ITER(hh, cur_indx->slice_owners, owner, tmp_owner) {
+			HASH_DEL(cur_indx->slice_owners, owner); 
+			free(owner);
+		}
+
 		free(cur_indx);
 	}
 }
 
+/**
+ * stat_sent
+ * Tells whether a stat flush sends a stat
+ *
+ * @param stat    the stat
+ * @param full    1 if the stat flush sends all the stats
+ * @return 1 if the stat is sent, 0 if not
+ */
+static int stat_sent(struct mdhim_stat *stat, int full) {
+	return full || stat->changed;
+}
+
+/**
+ * removed_stat_sent
+ * Tells whether a stat flush sends that a slice was removed, which it does
+ * for a slice that doesn't have a new stat
+ *
+ * @param index   the index of the slice
+ * @param i       the position of the slice in the removed slices
+ * @param full    1 if the stat flush sends all the stats
+ * @return 1 if the removal is sent, 0 if not
+ */
+static int removed_stat_sent(struct index_t *index, int i, int full) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	struct mdhim_stat *stat;
+
+	if (full) {
+		return 0;
+	}
+
+	HASH_FIND_INT(store->mdhim_store_stats, &store->removed_slices[i], stat);
+
+	return !stat;
+}
+
 int pack_stats(struct index_t *index, void *buf, int size, 
-	       int float_type, int stat_size, MPI_Comm comm) {
-	
+	       int float_type, int stat_size, int full, MPI_Comm comm) {
+	struct mdhim_store_t *store = index->mdhim_store;
 	struct mdhim_stat *stat, *tmp;
+	struct mdhim_db_istat istat;
+	struct mdhim_db_fstat fstat;
 	void *tstat;
-	struct mdhim_db_istat *istat;
-	struct mdhim_db_fstat *fstat;
 	int ret = MPI_SUCCESS;
 	int sendidx = 0;
+	int i;
+
+	memset(&istat, 0, sizeof(struct mdhim_db_istat));
+	memset(&fstat, 0, sizeof(struct mdhim_db_fstat));
+	tstat = float_type ? (void *) &fstat : (void *) &istat;
+
+	//Pack the stats that changed since the last stat flush, or all of them
+	HASH_ITER(hh, store->mdhim_store_stats, stat, tmp) {
+		if (!stat_sent(stat, full)) {
+			continue;
+		}
 
-	//Pack the stat data I have by iterating through the stats hash
-	HASH_ITER(hh, index->mdhim_store->mdhim_store_stats, stat, tmp) {
-		//Get the appropriate struct to send
 		if (float_type) {
-			fstat = malloc(sizeof(struct mdhim_db_fstat));
-			fstat->slice = stat->key;
-			fstat->num = stat->num;
-			fstat->dmin = *(long double *) stat->min;
-			fstat->dmax = *(long double *) stat->max;
-			tstat = fstat;
+			fstat.slice = stat->key;
+			fstat.num = stat->num;
+			fstat.dmin = *(long double *) stat->min;
+			fstat.dmax = *(long double *) stat->max;
 		} else {
-			istat = malloc(sizeof(struct mdhim_db_istat));
-			istat->slice = stat->key;
-			istat->num = stat->num;
-			istat->imin = *(uint64_t *) stat->min;
-			istat->imax = *(uint64_t *) stat->max;
-			tstat = istat;
+			istat.slice = stat->key;
+			istat.num = stat->num;
+			istat.imin = *(uint64_t *) stat->min;
+			istat.imax = *(uint64_t *) stat->max;
 		}
 		  
 		//Pack the struct
@@ -1158,420 +1897,567 @@ int pack_stats(struct index_t *index, void *buf, int size,
 			mlog(MPI_CRIT, "Error packing buffer when sending stat info" 
 			     " to master range server");
 			free(buf);
-			free(tstat);
 			return ret;
 		}
+	}
+
+	//A removed slice is sent without any keys
+	for (i = 0; i < store->num_removed_slices; i++) {
+		if (!removed_stat_sent(index, i, full)) {
+			continue;
+		}
+
+		memset(tstat, 0, stat_size);
+		if (float_type) {
+			fstat.slice = store->removed_slices[i];
+		} else {
+			istat.slice = store->removed_slices[i];
+		}
 
-		free(tstat);
+		if ((ret = MPI_Pack(tstat, stat_size, MPI_CHAR, buf, size, &sendidx, 
+				    comm)) != MPI_SUCCESS) {
+			mlog(MPI_CRIT, "Error packing buffer when sending stat info" 
+			     " to master range server");
+			free(buf);
+			return ret;
+		}
 	}
 
 	return ret;
 }
 
-int get_stat_flush_global(struct mdhim_t *md, struct index_t *index) {
-	char *sendbuf;
-	int sendsize = 0;
-	int recvidx = 0;
-	char *recvbuf;
-	int *recvcounts;
-	int *displs;
-	int recvsize;
-	int ret = 0;
-	int i = 0;
-	int float_type = 0;
+/**
+ * count_stat_changes
+ * Merges the keys the workers counted into the stats and counts the stats a stat flush 
+ * sends.  The caller holds the write lock of the stats
+ *
+ * @param index       the index whose stats are counted
+ * @param full        1 if the stat flush sends all the stats
+ * @return the number of stats sent
+ */
+static int count_stat_changes(struct index_t *index, int full) {
+	struct mdhim_store_t *store = index->mdhim_store;
 	struct mdhim_stat *stat, *tmp;
-	void *tstat;
-	int stat_size = 0;
-	int master;
-	int num_items = 0;
-	
-	//Determine the size of the buffers to send based on the number and type of stats
-	if ((ret = is_float_key(index->key_type)) == 1) {
-		float_type = 1;
-		stat_size = sizeof(struct mdhim_db_fstat);
-	} else {
-		float_type = 0;
-		stat_size = sizeof(struct mdhim_db_istat);
-	}
+	int num_items;
+	int i, j;
 
-	recvbuf = NULL;
-	if (index->myinfo.rangesrv_num > 0) {
-		//Get the number stats in our hash table
-		if (index->mdhim_store->mdhim_store_stats) {
-			num_items = HASH_COUNT(index->mdhim_store->mdhim_store_stats);
-		} else {
-			num_items = 0;
-		}
-		if ((ret = is_float_key(index->key_type)) == 1) {
-			sendsize = num_items * sizeof(struct mdhim_db_fstat);
-		} else {
-			sendsize = num_items * sizeof(struct mdhim_db_istat);
+	merge_stat_accs(index);
+
+	//A slice removed several times is sent once
+	qsort(store->removed_slices, store->num_removed_slices, sizeof(int), cmp_slice);
+	for (i = j = 0; i < store->num_removed_slices; i++) {
+		if (!j || store->removed_slices[j - 1] != store->removed_slices[i]) {
+			store->removed_slices[j++] = store->removed_slices[i];
 		}
 	}
+	store->num_removed_slices = j;
 
-	if (index->myinfo.rangesrv_num > 0) {	
-		//Get the master range server rank according the range server comm
-		if ((ret = MPI_Comm_size(index->rs_comm, &master)) != MPI_SUCCESS) {
-			mlog(MPI_CRIT, "Rank: %d - " 
-			     "Error getting size of comm", 
-			     md->mdhim_rank);			
-		}		
-		//The master rank is the last rank in range server comm
-		master--;
-
-		//First we send the number of items that we are going to send
-		//Allocate the receive buffer size
-		recvsize = index->num_rangesrvs * sizeof(int);
-		recvbuf = malloc(recvsize);
-		memset(recvbuf, 0, recvsize);
-		MPI_Barrier(index->rs_comm);
-		//The master server will receive the number of stats each server has
-		if ((ret = MPI_Gather(&num_items, 1, MPI_UNSIGNED, recvbuf, 1,
-				      MPI_INT, master, index->rs_comm)) != MPI_SUCCESS) {
-			mlog(MDHIM_SERVER_CRIT, "Rank: %d - " 
-			     "Error while receiving the number of statistics from each range server", 
-			     md->mdhim_rank);
-			free(recvbuf);
-			goto error;
-		}
-		
-		num_items = 0;
-		displs = malloc(sizeof(int) * index->num_rangesrvs);
-		recvcounts = malloc(sizeof(int) * index->num_rangesrvs);
-		for (i = 0; i < index->num_rangesrvs; i++) {
-			displs[i] = num_items * stat_size;
-			num_items += ((int *)recvbuf)[i];
-			recvcounts[i] = ((int *)recvbuf)[i] * stat_size;
-		}
-		
-		free(recvbuf);
-		recvbuf = NULL;
+	num_items = 0;
+	HASH_ITER(hh, store->mdhim_store_stats, stat, tmp) {
+		num_items += stat_sent(stat, full);
+	}
+	for (i = 0; i < store->num_removed_slices; i++) {
+		num_items += removed_stat_sent(index, i, full);
+	}
 
-		//Allocate send buffer
-		sendbuf = malloc(sendsize);		  
+	return num_items;
+}
 
-		//Pack the stat data I have by iterating through the stats hash table
-		ret =  pack_stats(index, sendbuf, sendsize,
-				  float_type, stat_size, index->rs_comm);
-		if (ret != MPI_SUCCESS) {
-			free(recvbuf);
-			goto error;
-		}	
+/**
+ * snapshot_stats
+ * Merges the keys the workers counted into the stats and packs the ones that changed
+ * since the last stat flush, so the stats sent are the same ones that were counted
+ *
+ * @param index       the index whose stats are packed
+ * @param buf         out  the packed stats, NULL if there are none
+ * @param size        out  the size of the packed stats
+ * @param float_type  1 if the stats have float mins and maxes
+ * @param stat_size   the size of a packed stat
+ * @param full        1 to pack all the stats
+ * @param comm        the communicator the stats are sent on
+ * @return the number of stats packed or MDHIM_ERROR on error
+ */
+static int snapshot_stats(struct index_t *index, char **buf, int *size, 
+			  int float_type, int stat_size, int full, MPI_Comm comm) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	struct mdhim_stat *stat, *tmp;
+	int num_items;
 
-		//Allocate the recv buffer for the master range server
-		if (md->mdhim_rank == index->rangesrv_master) {
-			recvsize = num_items * stat_size;
-			recvbuf = malloc(recvsize);
-			memset(recvbuf, 0, recvsize);		
-		} else {
-			recvbuf = NULL;
-			recvsize = 0;
-		}
+	while (pthread_rwlock_wrlock(store->mdhim_store_stats_lock) == EBUSY) {
+		usleep(10);
+	}
 
-		MPI_Barrier(index->rs_comm);
-		//The master server will receive the stat info from each rank in the range server comm
-		if ((ret = MPI_Gatherv(sendbuf, sendsize, MPI_PACKED, recvbuf, recvcounts, displs,
-				       MPI_PACKED, master, index->rs_comm)) != MPI_SUCCESS) {
-			mlog(MDHIM_SERVER_CRIT, "Rank: %d - " 
-			     "Error while receiving range server info", 
-			     md->mdhim_rank);			
-			goto error;
+	num_items = count_stat_changes(index, full);
+	*size = num_items * stat_size;
+	*buf = NULL;
+	if (num_items) {
+		*buf = malloc(*size);
+		if (pack_stats(index, *buf, *size, float_type, 
+			       stat_size, full, comm) != MPI_SUCCESS) {
+			//pack_stats frees the buffer when it fails, the stats are sent next time
+			*buf = NULL;
+			*size = 0;
+			pthread_rwlock_unlock(store->mdhim_store_stats_lock);
+			return MDHIM_ERROR;
 		}
+	}
 
-		free(recvcounts);
-		free(displs);
-		free(sendbuf);	
-	} 
+	//The next stat flush only sends what changes from now on
+	HASH_ITER(hh, store->mdhim_store_stats, stat, tmp) {
+		stat->changed = 0;
+	}
+	store->num_removed_slices = 0;
 
-	MPI_Barrier(md->mdhim_client_comm);
-	//The master range server broadcasts the number of stats it is going to send
-	if ((ret = MPI_Bcast(&num_items, 1, MPI_UNSIGNED, index->rangesrv_master,
-			     md->mdhim_comm)) != MPI_SUCCESS) {
-		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - " 
-		     "Error while receiving the number of stats to receive", 
-		     md->mdhim_rank);
-		goto error;
+	pthread_rwlock_unlock(store->mdhim_store_stats_lock);
+
+	return num_items;
+}
+
+//Where a stat received in a stat flush goes in the stat table
+typedef struct stat_order_t {
+	uint32_t rangesrv_num;
+	int slice;
+	uint64_t num;              //0 if the slice was removed
+	int pos;                   //The position of the stat in the stats received
+} stat_order_t;
+
+static int cmp_stat_order(const void *a, const void *b) {
+	const stat_order_t *oa = (const stat_order_t *) a;
+	const stat_order_t *ob = (const stat_order_t *) b;
+
+	if (oa->rangesrv_num != ob->rangesrv_num) {
+		return oa->rangesrv_num < ob->rangesrv_num ? -1 : 1;
+	} else if (oa->slice != ob->slice) {
+		return oa->slice < ob->slice ? -1 : 1;
 	}
 
-	MPI_Barrier(md->mdhim_client_comm);
+	return oa->pos < ob->pos ? -1 : oa->pos > ob->pos;
+}
 
-	recvsize = num_items * stat_size;
-	//Allocate the receive buffer size for clients
-	if (md->mdhim_rank != index->rangesrv_master) {
-		recvbuf = malloc(recvsize);
-		memset(recvbuf, 0, recvsize);
+/**
+ * stat_table_create
+ * Allocates a stat table and its arrays in one block
+ *
+ * @param num  the number of stats the table holds
+ * @return the stat table or NULL on error
+ */
+static stat_table_t *stat_table_create(int num) {
+	stat_table_t *table;
+	size_t head;
+	char *arr;
+
+	//The bounds come first after the table as they need the widest alignment
+	head = (sizeof(stat_table_t) + sizeof(stat_bound_t) - 1) / 
+		sizeof(stat_bound_t) * sizeof(stat_bound_t);
+	table = malloc(head + num * (2 * sizeof(stat_bound_t) + sizeof(uint64_t) + 
+				     sizeof(int) + sizeof(uint32_t)));
+	if (!table) {
+		return NULL;
 	}
-	
-	//The master range server broadcasts the receive buffer to the mdhim_comm
-	if ((ret = MPI_Bcast(recvbuf, recvsize, MPI_PACKED, index->rangesrv_master,
-			     md->mdhim_comm)) != MPI_SUCCESS) {
-		mlog(MPI_CRIT, "Rank: %d - " 
-		     "Error while receiving range server info", 
-		     md->mdhim_rank);
-		goto error;
+
+	arr = (char *) table + head;
+	table->num = num;
+	table->mins = (stat_bound_t *) arr;
+	table->maxs = table->mins + num;
+	table->nums = (uint64_t *) (table->maxs + num);
+	table->slices = (int *) (table->nums + num);
+	table->rangesrv_nums = (uint32_t *) (table->slices + num);
+
+	return table;
+}
+
+/**
+ * stat_table_build
+ * Builds the stat table of the stats received in a stat flush
+ *
+ * @param stats          the stats received, mdhim_db_fstat or mdhim_db_istat structs
+ * @param num            the number of stats received
+ * @param rangesrv_nums  the range server each stat came from, NULL if the stats 
+ *                       aren't kept per range server
+ * @param float_type     1 if the stats are mdhim_db_fstat structs
+ * @return the stat table or NULL on error
+ */
+static stat_table_t *stat_table_build(void *stats, int num, uint32_t *rangesrv_nums, 
+				      int float_type) {
+	struct mdhim_db_fstat *fstats = (struct mdhim_db_fstat *) stats;
+	struct mdhim_db_istat *istats = (struct mdhim_db_istat *) stats;
+	stat_table_t *table;
+	stat_order_t *order;
+	int i, j, best, num_stats, pos;
+
+	order = malloc(sizeof(stat_order_t) * (num + 1));
+	for (i = 0; i < num; i++) {
+		order[i].rangesrv_num = rangesrv_nums ? rangesrv_nums[i] : 0;
+		order[i].slice = float_type ? fstats[i].slice : istats[i].slice;
+		order[i].num = float_type ? fstats[i].num : istats[i].num;
+		order[i].pos = i;
+	}
+
+	qsort(order, num, sizeof(stat_order_t), cmp_stat_order);
+
+	/* A slice sent twice keeps the stat sent last.  A slice that moved is removed from 
+	   one range server and sent by another, so a removal loses to a stat of the slice */
+	num_stats = 0;
+	for (i = 0; i < num; i = j) {
+		best = i;
+		for (j = i + 1; j < num && order[j].rangesrv_num == order[i].rangesrv_num && 
+			     order[j].slice == order[i].slice; j++) {
+			if (order[j].num || !order[best].num) {
+				best = j;
+			}
+		}
+
+		order[num_stats++] = order[best];
 	}
 
-	//Unpack the receive buffer and populate our index->stats hash table
-	recvidx = 0;
-	for (i = 0; i < recvsize; i+=stat_size) {
-		tstat = malloc(stat_size);
-		memset(tstat, 0, stat_size);
-		if ((ret = MPI_Unpack(recvbuf, recvsize, &recvidx, tstat, stat_size, 
-				      MPI_CHAR, md->mdhim_comm)) != MPI_SUCCESS) {
-			mlog(MPI_CRIT, "Rank: %d - " 
-			     "Error while unpacking stat data", 
-			     md->mdhim_rank);
-			free(tstat);
-			goto error;
-		}	
+	if (!(table = stat_table_create(num_stats))) {
+		free(order);
+		return NULL;
+	}
 
-		stat = malloc(sizeof(struct mdhim_stat));
-		stat->dirty = 0;
+	for (i = 0; i < num_stats; i++) {
+		pos = order[i].pos;
+		table->slices[i] = order[i].slice;
+		table->rangesrv_nums[i] = order[i].rangesrv_num;
 		if (float_type) {
-			stat->min = (void *) malloc(sizeof(long double));
-			stat->max = (void *) malloc(sizeof(long double));
-			*(long double *)stat->min = ((struct mdhim_db_fstat *)tstat)->dmin;
-			*(long double *)stat->max = ((struct mdhim_db_fstat *)tstat)->dmax;
-			stat->key = ((struct mdhim_db_fstat *)tstat)->slice;
-			stat->num = ((struct mdhim_db_fstat *)tstat)->num;
+			table->nums[i] = fstats[pos].num;
+			table->mins[i].f = fstats[pos].dmin;
+			table->maxs[i].f = fstats[pos].dmax;
 		} else {
-			stat->min = (void *) malloc(sizeof(uint64_t));
-			stat->max = (void *) malloc(sizeof(uint64_t));
-			*(uint64_t *)stat->min = ((struct mdhim_db_istat *)tstat)->imin;
-			*(uint64_t *)stat->max = ((struct mdhim_db_istat *)tstat)->imax;
-			stat->key = ((struct mdhim_db_istat *)tstat)->slice;
-			stat->num = ((struct mdhim_db_istat *)tstat)->num;
+			table->nums[i] = istats[pos].num;
+			table->mins[i].i = istats[pos].imin;
+			table->maxs[i].i = istats[pos].imax;
 		}
-		  
-		HASH_FIND_INT(index->stats, &stat->key, tmp);
-		if (!tmp) {
-			HASH_ADD_INT(index->stats, key, stat); 
-		} else {	
-			//Replace the existing stat
-			HASH_REPLACE_INT(index->stats, key, stat, tmp);  
-			free(tmp);
-		}
-		free(tstat);
 	}
 
-	free(recvbuf);
-	return MDHIM_SUCCESS;
+	free(order);
 
-error:
-	if (recvbuf) {
-		free(recvbuf);
+	return table;
+}
+
+/**
+ * stat_table_merge
+ * Merges the stats that changed since the last stat flush into a stat table
+ *
+ * @param merged  the table to merge into, NULL to count the stats of the merged table
+ * @param table   the stat table of the last stat flush
+ * @param delta   the stats that changed, removed slices have no keys
+ * @return the number of stats of the merged table
+ */
+static int stat_table_merge(stat_table_t *merged, stat_table_t *table, stat_table_t *delta) {
+	stat_table_t *from;
+	int i, j, k, cmp, pos;
+
+	i = j = k = 0;
+	while (i < table->num || j < delta->num) {
+		if (i == table->num) {
+			cmp = 1;
+		} else if (j == delta->num) {
+			cmp = -1;
+		} else if (table->rangesrv_nums[i] != delta->rangesrv_nums[j]) {
+			cmp = table->rangesrv_nums[i] < delta->rangesrv_nums[j] ? -1 : 1;
+		} else if (table->slices[i] != delta->slices[j]) {
+			cmp = table->slices[i] < delta->slices[j] ? -1 : 1;
+		} else {
+			cmp = 0;
+		}
+
+		//The delta replaces the stat of a slice in the table
+		if (cmp < 0) {
+			from = table;
+			pos = i++;
+		} else {
+			if (!cmp) {
+				i++;
+			}
+
+			from = delta;
+			pos = j++;
+			if (!delta->nums[pos]) {
+				continue;
+			}
+		}
+
+		if (merged) {
+			merged->mins[k] = from->mins[pos];
+			merged->maxs[k] = from->maxs[pos];
+			merged->nums[k] = from->nums[pos];
+			merged->slices[k] = from->slices[pos];
+			merged->rangesrv_nums[k] = from->rangesrv_nums[pos];
+		}
+		k++;
 	}
 
-	return MDHIM_ERROR;
+	return k;
 }
 
-int get_stat_flush_local(struct mdhim_t *md, struct index_t *index) {
-	char *sendbuf;
-	int sendsize = 0;
-	int recvidx = 0;
-	char *recvbuf;
-	int *num_items_to_recv;
-	int *recvcounts;
-	int *displs;
-	int recvsize;
-	int ret = 0;
-	int i = 0, j;
-	int float_type = 0;
-	struct mdhim_stat *stat, *tmp, *rank_stat;
-	void *tstat;
-	int stat_size = 0;
-	int num_items = 0;
-	
-	//Determine the size of the buffers to send based on the number and type of stats
-	if ((ret = is_float_key(index->key_type)) == 1) {
-		float_type = 1;
-		stat_size = sizeof(struct mdhim_db_fstat);
-	} else {
-		float_type = 0;
-		stat_size = sizeof(struct mdhim_db_istat);
-	}
+/**
+ * stat_wait
+ * Waits for a nonblocking collective of a stat flush to finish
+ *
+ * @param req     the request of the collective
+ * @param lock    the lock of the communicator, NULL if it has none
+ * @return MPI_SUCCESS or the MPI error
+ */
+static int stat_wait(MPI_Request *req, pthread_mutex_t *lock) {
+	MPI_Status status;
+	int flag = 0;
+	int ret;
 
-	recvbuf = NULL;
-	if (index->myinfo.rangesrv_num > 0) {
-		//Get the number stats in our hash table
-		if (index->mdhim_store->mdhim_store_stats) {
-			num_items = HASH_COUNT(index->mdhim_store->mdhim_store_stats);
-		} else {
-			num_items = 0;
+	while (1) {
+		if (lock) {
+			pthread_mutex_lock(lock);
 		}
-		if ((ret = is_float_key(index->key_type)) == 1) {
-			sendsize = num_items * sizeof(struct mdhim_db_fstat);
-		} else {
-			sendsize = num_items * sizeof(struct mdhim_db_istat);
+		ret = MPI_Test(req, &flag, &status);
+		if (lock) {
+			pthread_mutex_unlock(lock);
+		}
+
+		if (ret != MPI_SUCCESS || flag) {
+			return ret;
+		}
+
+		usleep(100);
+	}
+}
+
+/**
+ * publish_stats
+ * Sends the stats that changed since the last stat flush to all the ranks of a 
+ * communicator and applies the ones received to index->stats.  All the stats are sent 
+ * if a rank doesn't have the ones flushed before.  Every rank of the communicator calls
+ * this for the same index at the same time
+ *
+ * @param md         main MDHIM struct
+ * @param index      the index whose stats are flushed
+ * @param comm       the communicator of all the ranks of mdhim_comm in the same order
+ * @param lock       the lock of the communicator, NULL if it has none
+ * @param threshold  the number of changed stats, summed over all the range servers, 
+ *                   that have to be waiting for them to be sent.  0 always sends them
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int publish_stats(struct mdhim_t *md, struct index_t *index, MPI_Comm comm, 
+		  pthread_mutex_t *lock, int threshold) {
+	char *sendbuf, *recvbuf;
+	void *tstat;
+	int sendsize, recvsize, recvidx;
+	int *num_items_to_recv, *recvcounts, *displs;
+	int float_type, stat_size, per_rank, any_full;
+	int num_items, num_stats, pos;
+	int i, j, ret;
+	long counts[2], total[2];
+	MPI_Request req;
+	rangesrv_info *ri;
+	uint32_t *rangesrv_nums;
+	stat_table_t *delta, *table;
+
+	float_type = is_float_key(index->key_type);
+	stat_size = float_type ? sizeof(struct mdhim_db_fstat) : sizeof(struct mdhim_db_istat);
+
+	/* Slices of a hash partitioned index are spread over all the range servers, 
+	   so its stats are kept per range server like those of a local index */
+	per_rank = index->type == LOCAL_INDEX || index->partition_type == MDHIM_HASH_PARTITION;
+
+	sendbuf = recvbuf = NULL;
+	tstat = NULL;
+	num_items_to_recv = recvcounts = displs = NULL;
+	rangesrv_nums = NULL;
+
+	/* Sum the ranks without the stats flushed before and the stats that changed.  Every
+	   rank gets all the stats if one of them doesn't have the ones flushed before */
+	counts[0] = !index->stats || index->stats_stale;
+	counts[1] = 0;
+	if (threshold > 0 && index->myinfo.rangesrv_num > 0) {
+		while (pthread_rwlock_wrlock(index->mdhim_store->mdhim_store_stats_lock) == EBUSY) {
+			usleep(10);
 		}
+
+		counts[1] = count_stat_changes(index, 0);
+		pthread_rwlock_unlock(index->mdhim_store->mdhim_store_stats_lock);
 	}
 
-	//First we send the number of items that we are going to send
-	//Allocate the receive buffer size
-	recvsize = md->mdhim_comm_size * sizeof(int);
-	recvbuf = malloc(recvsize);
-	memset(recvbuf, 0, recvsize);
-	MPI_Barrier(md->mdhim_client_comm);
-	//All gather the number of items to send
-	if ((ret = MPI_Allgather(&num_items, 1, MPI_UNSIGNED, recvbuf, 1,
-				 MPI_INT, md->mdhim_comm)) != MPI_SUCCESS) {
-		mlog(MDHIM_SERVER_CRIT, "Rank: %d - " 
+	if (lock) {
+		pthread_mutex_lock(lock);
+	}
+	ret = MPI_Iallreduce(counts, total, 2, MPI_LONG, MPI_SUM, comm, &req);
+	if (lock) {
+		pthread_mutex_unlock(lock);
+	}
+	if (ret != MPI_SUCCESS || (ret = stat_wait(&req, lock)) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - " 
+		     "Error while agreeing on the stats to flush", 
+		     md->mdhim_rank);
+		goto error;
+	}
+
+	//Wait for more changes
+	any_full = total[0] > 0;
+	if (!any_full && total[1] < threshold) {
+		return MDHIM_SUCCESS;
+	}
+
+	//Pack my stats that changed, they stay changed if they can't be packed
+	num_items = 0;
+	sendsize = 0;
+	if (index->myinfo.rangesrv_num > 0 && 
+	    (num_items = snapshot_stats(index, &sendbuf, &sendsize, float_type, 
+					stat_size, any_full, comm)) < 0) {
+		num_items = 0;
+	}
+
+	//All gather the number of stats every rank sends
+	num_items_to_recv = malloc(sizeof(int) * md->mdhim_comm_size);
+	if (lock) {
+		pthread_mutex_lock(lock);
+	}
+	ret = MPI_Iallgather(&num_items, 1, MPI_INT, num_items_to_recv, 1,
+			     MPI_INT, comm, &req);
+	if (lock) {
+		pthread_mutex_unlock(lock);
+	}
+	if (ret != MPI_SUCCESS || (ret = stat_wait(&req, lock)) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - " 
 		     "Error while receiving the number of statistics from each range server", 
 		     md->mdhim_rank);
-		free(recvbuf);
 		goto error;
 	}
-		
+
 	num_items = 0;
 	displs = malloc(sizeof(int) * md->mdhim_comm_size);
 	recvcounts = malloc(sizeof(int) * md->mdhim_comm_size);
 	for (i = 0; i < md->mdhim_comm_size; i++) {
 		displs[i] = num_items * stat_size;
-		num_items += ((int *)recvbuf)[i];
-		recvcounts[i] = ((int *)recvbuf)[i] * stat_size;
-	}
-
-	num_items_to_recv = (int *)recvbuf;
-	recvbuf = NULL;
-
-	if (sendsize) {
-		//Allocate send buffer
-		sendbuf = malloc(sendsize);		  
-	
-		//Pack the stat data I have by iterating through the stats hash table
-		ret =  pack_stats(index, sendbuf, sendsize,
-				  float_type, stat_size, md->mdhim_comm);
-		if (ret != MPI_SUCCESS) {
-			free(recvbuf);
-			goto error;
-		}	
-	} else {
-		sendbuf = NULL;
+		num_items += num_items_to_recv[i];
+		recvcounts[i] = num_items_to_recv[i] * stat_size;
 	}
 
+	//All gather the stats themselves
 	recvsize = num_items * stat_size;
-	recvbuf = malloc(recvsize);
-	memset(recvbuf, 0, recvsize);		
-
-	MPI_Barrier(md->mdhim_client_comm);
-	//The master server will receive the stat info from each rank in the range server comm
-	if ((ret = MPI_Allgatherv(sendbuf, sendsize, MPI_PACKED, recvbuf, recvcounts, displs,
-				   MPI_PACKED, md->mdhim_comm)) != MPI_SUCCESS) {
-		mlog(MDHIM_SERVER_CRIT, "Rank: %d - " 
+	recvbuf = malloc(recvsize + stat_size);
+	if (lock) {
+		pthread_mutex_lock(lock);
+	}
+	ret = MPI_Iallgatherv(sendbuf, sendsize, MPI_PACKED, recvbuf, recvcounts, displs,
+			      MPI_PACKED, comm, &req);
+	if (lock) {
+		pthread_mutex_unlock(lock);
+	}
+	if (ret != MPI_SUCCESS || (ret = stat_wait(&req, lock)) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - " 
 		     "Error while receiving range server info", 
 		     md->mdhim_rank);			
 		goto error;
 	}
 
-	free(recvcounts);
-	free(displs);
-	free(sendbuf);	
-
-
-	MPI_Barrier(md->mdhim_client_comm);
-
-	//Unpack the receive buffer and populate our index->stats hash table
+	//Unpack the receive buffer, the stats of each rank follow those of the rank before it
+	tstat = malloc(recvsize + stat_size);
 	recvidx = 0;
-	for (i = 0; i < md->mdhim_comm_size; i++) {
-		if ((ret = is_range_server(md, i, index)) < 1) {
-			continue;
-		}
+	if (recvsize && (ret = MPI_Unpack(recvbuf, recvsize, &recvidx, tstat, recvsize, 
+					  MPI_CHAR, comm)) != MPI_SUCCESS) {
+		mlog(MPI_CRIT, "Rank: %d - " 
+		     "Error while unpacking stat data", 
+		     md->mdhim_rank);
+		goto error;
+	}	
 
-		HASH_FIND_INT(index->stats, &i, tmp);
-		if (!tmp) {
-			mlog(MPI_CRIT, "Rank: %d - " 
-			     "Adding rank: %d to local index stat data", 
-			     md->mdhim_rank, i);
-			rank_stat = malloc(sizeof(struct mdhim_stat));
-			memset(rank_stat, 0, sizeof(struct mdhim_stat));
-			rank_stat->key = i;
-			rank_stat->stats = NULL;
-			HASH_ADD_INT(index->stats, key, rank_stat); 
-		} else {		
-			rank_stat = tmp;	       
+	//Stats kept per range server are kept for the ranks that are range servers of the index
+	if (per_rank) {
+		rangesrv_nums = malloc(sizeof(uint32_t) * (num_items + 1));
+		num_stats = pos = 0;
+		for (i = 0; i < md->mdhim_comm_size; i++) {
+			HASH_FIND_INT(index->rangesrvs_by_rank, &i, ri);
+			for (j = 0; j < num_items_to_recv[i]; j++, pos++) {
+				if (!ri) {
+					continue;
+				}
+
+				if (num_stats != pos) {
+					memmove((char *) tstat + num_stats * stat_size, 
+						(char *) tstat + pos * stat_size, stat_size);
+				}
+				rangesrv_nums[num_stats++] = ri->rangesrv_num;
+			}
 		}
 
-		for (j = 0; j < num_items_to_recv[i]; j++) {
-			tstat = malloc(stat_size);
-			memset(tstat, 0, stat_size);
-			if ((ret = MPI_Unpack(recvbuf, recvsize, &recvidx, tstat, stat_size, 
-					      MPI_CHAR, md->mdhim_comm)) != MPI_SUCCESS) {
-				mlog(MPI_CRIT, "Rank: %d - " 
-				     "Error while unpacking stat data", 
-				     md->mdhim_rank);
-				free(tstat);
-				goto error;
-			}	
+		num_items = num_stats;
+	}
 
-			stat = malloc(sizeof(struct mdhim_stat));
-			stat->dirty = 0;
-			if (float_type) {
-				stat->min = (void *) malloc(sizeof(long double));
-				stat->max = (void *) malloc(sizeof(long double));
-				*(long double *)stat->min = ((struct mdhim_db_fstat *)tstat)->dmin;
-				*(long double *)stat->max = ((struct mdhim_db_fstat *)tstat)->dmax;
-				stat->key = ((struct mdhim_db_fstat *)tstat)->slice;
-				stat->num = ((struct mdhim_db_fstat *)tstat)->num;
-			} else {
-				stat->min = (void *) malloc(sizeof(uint64_t));
-				stat->max = (void *) malloc(sizeof(uint64_t));
-				*(uint64_t *)stat->min = ((struct mdhim_db_istat *)tstat)->imin;
-				*(uint64_t *)stat->max = ((struct mdhim_db_istat *)tstat)->imax;
-				stat->key = ((struct mdhim_db_istat *)tstat)->slice;
-				stat->num = ((struct mdhim_db_istat *)tstat)->num;
-			}
-		  
-			mlog(MPI_CRIT, "Rank: %d - " 
-			     "Adding rank: %d with stat min: %lu, stat max: %lu, stat key: %u num: %lu" 
-			     "to local index stat data", 
-			     md->mdhim_rank, i, *(uint64_t *)stat->min, *(uint64_t *)stat->max, 
-			     stat->key, stat->num);
-			HASH_FIND_INT(rank_stat->stats, &stat->key, tmp);
-			if (!tmp) {
-				HASH_ADD_INT(rank_stat->stats, key, stat); 
-			} else {	
-				//Replace the existing stat
-				HASH_REPLACE_INT(rank_stat->stats, key, stat, tmp);
-				free(tmp);
-			}
+	if (!(delta = stat_table_build(tstat, num_items, rangesrv_nums, float_type))) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - " 
+		     "Error allocating memory for the stat table", 
+		     md->mdhim_rank);
+		goto error;
+	}
 
-			free(tstat);
+	//Apply the changed stats to the ones of the last stat flush, routing waits meanwhile
+	while (pthread_rwlock_wrlock(index->stats_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	if (any_full) {
+		table = delta;
+	} else if (!delta->num) {
+		table = index->stats;
+		free(delta);
+	} else {
+		table = stat_table_create(stat_table_merge(NULL, index->stats, delta));
+		if (table) {
+			stat_table_merge(table, index->stats, delta);
 		}
+
+		free(delta);
+		if (!table) {
+			pthread_rwlock_unlock(index->stats_lock);
+			mlog(MDHIM_CLIENT_CRIT, "Rank: %d - " 
+			     "Error allocating memory for the stat table", 
+			     md->mdhim_rank);
+			goto error;
+		}
+	}
+
+	if (table != index->stats) {
+		free(index->stats);
+		index->stats = table;
 	}
+	index->stats_stale = 0;
+
+	//Rebuild the routing fences from the new stats
+	ret = build_stat_fences(md, index);
+	pthread_rwlock_unlock(index->stats_lock);
 
+	free(sendbuf);
 	free(recvbuf);
+	free(tstat);
+	free(rangesrv_nums);
 	free(num_items_to_recv);
+	free(recvcounts);
+	free(displs);
 
-	return MDHIM_SUCCESS;
+	return ret;
 
 error:
-	if (recvbuf) {
-		free(recvbuf);
-	}
+	//This rank may have missed stats, the next stat flush sends all of them again
+	index->stats_stale = 1;
+	free(sendbuf);
+	free(recvbuf);
+	free(tstat);
+	free(rangesrv_nums);
+	free(num_items_to_recv);
+	free(recvcounts);
+	free(displs);
 
 	return MDHIM_ERROR;
 }
 
 /**
  * get_stat_flush
- * Receives stat data from all the range servers and populates md->stats
+ * Receives the stats that changed since the last stat flush from all the range servers 
+ * and populates index->stats
  *
  * @param md      in   main MDHIM struct
  * @return MDHIM_SUCCESS or MDHIM_ERROR on error
  */
 int get_stat_flush(struct mdhim_t *md, struct index_t *index) {
-	int ret;
-
-	pthread_mutex_lock(md->mdhim_comm_lock);
-
-	if (index->type != LOCAL_INDEX) {
-		ret = get_stat_flush_global(md, index);
-	} else {
-		ret = get_stat_flush_local(md, index);
-	}
-
-	pthread_mutex_unlock(md->mdhim_comm_lock);
-
-	return ret;
+	return publish_stats(md, index, md->mdhim_comm, md->mdhim_comm_lock, 0);
 }
 
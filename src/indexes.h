@@ -15,6 +15,15 @@
 #define LOCAL_INDEX 3
 #define REMOTE_INDEX 4
 
+//Bits of a level of a data store's key filter per key the level holds before the next is added
+#define MDHIM_STAT_BLOOM_BITS_PER_KEY 10
+//Bits of the first level of a data store's key filter
+#define MDHIM_STAT_BLOOM_MIN_BITS (1 << 16)
+//Most bits of all the levels of a data store's key filter together (32 MB)
+#define MDHIM_STAT_BLOOM_MAX_BITS ((uint64_t) 1 << 28)
+//Number of bits set for each key in a level of a data store's key filter
+#define MDHIM_STAT_BLOOM_HASHES 6
+
 typedef struct rangesrv_info rangesrv_info;
 /* 
  * Range server info  
@@ -28,6 +37,84 @@ struct rangesrv_info {
 	UT_hash_handle hh;         /* makes this structure hashable */
 };
 
+/* 
+ * Slice owner
+ * Records the range server a slice was migrated to, overriding the normal placement
+ */
+typedef struct slice_owner_t {
+	int slice;                 //The slice number (hash key)
+	uint32_t rangesrv_num;     //The range server that now serves the slice
+	UT_hash_handle hh;         /* makes this structure hashable */
+} slice_owner_t;
+
+/*
+ * Slice key
+ * A key of a migrating slice that was written while the slice was copied
+ */
+typedef struct slice_key_t {
+	void *key;                 //The key (hash key)
+	int key_len;               //The length of the key
+	UT_hash_handle hh;         /* makes this structure hashable */
+} slice_key_t;
+
+/* 
+ * Stat fence
+ * The key range of a slice, from the stats of the last stat flush, used for routing
+ */
+typedef union stat_bound_t {
+	uint64_t i;                //For integer keys
+	long double f;             //For float, string and byte keys
+} stat_bound_t;
+
+typedef struct stat_fence_t {
+	stat_bound_t min;          //The smallest key in the slice
+	stat_bound_t max;          //The largest key in the slice
+	stat_bound_t max_before;   /* The largest max of this fence and the ones before it,
+				      lets searches of overlapping fences stop early */
+	int slice;                 //The slice number
+	uint32_t rangesrv_num;     //The range server with the slice, for stats kept per range server
+} stat_fence_t;
+
+/*
+ * The stats of the slices from the last stat flush, held as arrays in one allocation and 
+ * sorted by slice.  Stats kept per range server are sorted by range server, then slice
+ */
+typedef struct stat_table_t {
+	int num;                   //The number of stats in the table
+	stat_bound_t *mins;        //The smallest key of each slice
+	stat_bound_t *maxs;        //The largest key of each slice
+	uint64_t *nums;            //The number of keys in each slice
+	int *slices;               //The slice numbers
+	uint32_t *rangesrv_nums;   //The range server with each slice, for stats kept per range server
+} stat_table_t;
+
+/* 
+ * Hot key
+ * A key read often enough to be replicated on more than one range server
+ */
+typedef struct hot_key_t {
+	void *key;                 //The key (hash key)
+	int key_len;               //The length of the key
+	uint32_t *replicas;        /* The range server numbers holding the key, 
+				      the range server that owns it is first */
+	int num_replicas;          //The number of range servers holding the key
+	int replica;               //Whether this rank holds a copy of the key's value
+	void *value;               //The copy of the value, if this rank holds one
+	int32_t value_len;         //The length of the value or 0 if the key was deleted
+	UT_hash_handle hh;         /* makes this structure hashable */
+} hot_key_t;
+
+/* 
+ * Frozen bucket
+ * A slot of the open addressing hash table a range server exposes while its index is frozen
+ */
+typedef struct frozen_bucket_t {
+	uint64_t hash;             //The hash of the key or 0 if the bucket is empty
+	uint64_t offset;           //The offset of the key in the heap, the value follows the key
+	int32_t key_len;           //The length of the key
+	int32_t value_len;         //The length of the value
+} frozen_bucket_t;
+
 /* 
  * Remote Index info  
  * Contains information about a remote index
@@ -46,13 +133,46 @@ struct index_t {
 	int type;                 /* The type of index 
 				     (PRIMARY_INDEX, SECONDARY_INDEX, LOCAL_INDEX) */
 	int primary_id;           /* The primary index id if this is a secondary index */
+	int partition_type;       /* How keys are placed on the range servers 
+				     (MDHIM_RANGE_PARTITION, MDHIM_HASH_PARTITION, 
+				     MDHIM_SPLITTER_PARTITION) */
+	int *splitters;           /* Sorted slice numbers where each range server after the first 
+				     starts serving, used by MDHIM_SPLITTER_PARTITION */
+	int num_splitters;        //The number of splitters (num_rangesrvs - 1 once computed)
+	slice_owner_t *slice_owners; /* Hash table of the slices that were migrated away 
+					from their normal range server.  Key is the slice number */
+	uint32_t routing_epoch;   //Incremented every time a slice changes range servers
+	//Lock for the splitters, migrated slices and routing epoch, which collectives replace
+	pthread_rwlock_t *routing_lock;
+	int moving_slice;         //The slice this range server is migrating, -1 if none
+	uint32_t moving_to;       /* The range server serving the moving slice, 0 while the 
+				     source still copies it */
+	slice_key_t *moved_keys;  //Keys of the moving slice written during the copy
+	pthread_mutex_t *moved_keys_lock; //Lock for the moved keys
+	uint32_t *read_sketch;    /* Count-min sketch of the reads of each key, 
+				     used by range servers to find hot keys */
+	hot_key_t *hot_candidates; //Keys this range server found hot since the last replication
+	hot_key_t *hot_keys;      //Hash table of the replicated hot keys.  Key is the key
+	int frozen;               //Whether the index is read only and read with MPI_Get
+	MPI_Win frozen_win;       //Window over the frozen buckets and heap of each range server
+	uint64_t *frozen_buckets; //The number of buckets in each rank's window.  Indexed by rank
+	int scan_cursor;          //The range server cursor left open by the last NEXT/PREV scan
+	int scan_cursor_rank;     //The rank of the range server holding scan_cursor
+	int scan_cursor_op;       //The operation of the scan that opened scan_cursor
+	pthread_rwlock_t *hot_keys_lock; //Lock for the sketch, candidates and replica values
 	rangesrv_info *rangesrvs_by_num; /* Hash table of the range servers 
 					    serving this index.  Key is range server number */
 	rangesrv_info *rangesrvs_by_rank; /* Hash table of the range servers 
 					     serving this index.  Key is the rank */
+	rangesrv_info **rangesrvs_arr; /* Flat array of the range servers serving this index.
+					  Indexed by range server number - 1 */
         //Used to determine the number of range servers which is based in  
         //if myrank % RANGE_SERVER_FACTOR == 0, then myrank is a server
 	int range_server_factor;
+	//MDHIM_RANK_PLACEMENT or MDHIM_NODE_PLACEMENT
+	int placement;
+	//Number of data stores the index is split into by slice on each range server
+	int num_shards;
 	
         //Maximum size of a slice. A range server may serve several slices.
 	uint64_t mdhim_max_recs_per_slice; 
@@ -69,8 +189,16 @@ struct index_t {
 	//The rank's range server information, if it is a range server for this index
 	rangesrv_info myinfo;
 
-	//Statistics retrieved from the mdhimStatFlush operation
-	struct mdhim_stat *stats;
+	//Statistics retrieved from the mdhimStatFlush operation, NULL before the first one
+	stat_table_t *stats;
+	//1 if a stat flush failed on this rank, so the next one sends all the stats again
+	int stats_stale;
+	//Lock for the stats and fences, which the stat propagation thread replaces while routing
+	pthread_rwlock_t *stats_lock;
+	/* Sorted fences built from the stats for routing.  Sorted by slice for global indexes
+	   and by minimum key when the stats are kept per range server */
+	stat_fence_t *fences;
+	int num_fences;
 
 	UT_hash_handle hh;         /* makes this structure hashable */
 	UT_hash_handle hh_name;    /* makes this structure hashable by name */
@@ -89,9 +217,26 @@ typedef struct index_manifest_t {
 	uint64_t slice_size; 
 	int num_nodes;
 	int local_server_rank;
+	int partition_type;
+	int num_splitters; /* The number of splitters written after the manifest */
+	uint32_t routing_epoch;
+	int num_slice_owners; /* The number of slice and range server number pairs 
+				 written after the splitters */
+	int placement;
+	int num_hosts; //The number of nodes the range servers were placed on
+	int num_shards; //The number of data stores of each range server, 0 in older manifests
 } index_manifest_t;
 
+void write_manifest(struct mdhim_t *md, struct index_t *index);
 int update_stat(struct mdhim_t *md, struct index_t *bi, void *key, uint32_t key_len);
+void merge_stat_accs(struct index_t *index);
+void mark_stat_removed(struct index_t *index, int slice);
+void remove_stats(struct mdhim_t *md, struct index_t *index, 
+		  void **keys, int *key_lens, int num_keys);
+void find_new_keys(struct mdhim_t *md, struct index_t *index, 
+		   void **keys, int *key_lens, int num_keys, int *maybe);
+void update_slice_load(struct mdhim_t *md, struct index_t *index, 
+		       void **keys, int *key_lens, int num_keys);
 int load_stats(struct mdhim_t *md, struct index_t *bi);
 int write_stats(struct mdhim_t *md, struct index_t *bi);
 int open_db_store(struct mdhim_t *md, struct index_t *index);
@@ -99,11 +244,13 @@ uint32_t get_num_range_servers(struct mdhim_t *md, struct index_t *index);
 struct index_t *create_local_index(struct mdhim_t *md, int db_type, int key_type, char *index_name);
 struct index_t *create_global_index(struct mdhim_t *md, int server_factor, 
 				    uint64_t max_recs_per_slice, int db_type, 
-				    int key_type, char *index_name);
+				    int key_type, int partition_type, char *index_name);
 int get_rangesrvs(struct mdhim_t *md, struct index_t *index);
 uint32_t is_range_server(struct mdhim_t *md, int rank, struct index_t *index);
 int index_init_comm(struct mdhim_t *md, struct index_t *bi);
 int get_stat_flush(struct mdhim_t *md, struct index_t *index);
+int publish_stats(struct mdhim_t *md, struct index_t *index, MPI_Comm comm, 
+		  pthread_mutex_t *lock, int threshold);
 struct index_t *get_index(struct mdhim_t *md, int index_id);
 struct index_t *get_index_by_name(struct mdhim_t *md, char *index_name);
 void indexes_release(struct mdhim_t *md);
@@ -15,6 +15,9 @@
 #include "mdhim_options.h"
 #include "indexes.h"
 #include "mdhim_private.h"
+#include "hot_keys.h"
+#include "frozen_index.h"
+#include "scan.h"
 
 /*! \mainpage MDHIM TNG
  *
@@ -161,6 +164,22 @@ struct mdhim_t *mdhimInit(void *appComm, struct mdhim_options_t *opts) {
 		return NULL;
 	}
 
+	//Find out which ranks share a node, used to place the range servers
+	if ((ret = _init_topology(md)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while discovering the node topology", 
+		     md->mdhim_rank);
+		return NULL;
+	}
+
+	//Use shared memory for the messages between ranks on the same node
+	if ((ret = shm_init(md)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while initializing the shared memory transport", 
+		     md->mdhim_rank);
+		return NULL;
+	}
+
 	//Initialize the partitioner
 	partitioner_init();
 
@@ -177,7 +196,8 @@ struct mdhim_t *mdhimInit(void *appComm, struct mdhim_options_t *opts) {
 
 	//Create the default remote primary index
 	primary_index = create_global_index(md, opts->rserver_factor, opts->max_recs_per_slice, 
-					    opts->db_type, opts->db_key_type, NULL);
+					    opts->db_type, opts->db_key_type, 
+					    opts->db_partition_type, NULL);
 	if (!primary_index) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
 		     "Couldn't create the default index", 
@@ -188,6 +208,14 @@ struct mdhim_t *mdhimInit(void *appComm, struct mdhim_options_t *opts) {
 	
 	//Set the local receive queue to NULL - used for sending and receiving to/from ourselves
 	md->receive_msg = NULL;
+
+	//Publish the stats in the background if a stat interval was set
+	if ((ret = stat_sync_start(md)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Couldn't start the stat propagation", 
+		     md->mdhim_rank);
+		return NULL;
+	}
 	MPI_Barrier(md->mdhim_client_comm);
 
 	return md;
@@ -209,6 +237,9 @@ int mdhimClose(struct mdhim_t *md) {
 	gettimeofday(&end, NULL);
 	printf("Took: %lu seconds to complete first close barrier\n", end.tv_sec - start.tv_sec);
 
+	//Stop publishing the stats before the range servers and indexes go away
+	stat_sync_stop(md);
+
 	gettimeofday(&start, NULL);
 	//Stop range server if I'm a range server	
 	if (md->mdhim_rs && (ret = range_server_stop(md)) != MDHIM_SUCCESS) {
@@ -252,6 +283,11 @@ int mdhimClose(struct mdhim_t *md) {
 	printf("Took: %lu seconds to complete the second close barrier\n", end.tv_sec - start.tv_sec);
 	mlog(MDHIM_CLIENT_DBG, "MDHIM Rank %d: Finished close", md->mdhim_rank);
 
+	shm_release(md);
+	MPI_Comm_free(&md->mdhim_node_comm);
+	free(md->rank_nodes);
+	free(md->rank_node_ranks);
+	free(md->node_sizes);
 	MPI_Comm_free(&md->mdhim_client_comm);
 	MPI_Comm_free(&md->mdhim_comm);
         free(md);
@@ -280,6 +316,8 @@ int mdhimCommit(struct mdhim_t *md, struct index_t *index) {
 		cm->mtype = MDHIM_COMMIT;
 		cm->index = index->id;
 		cm->index_type = index->type;
+		cm->routing_epoch = 0;
+		cm->forwarded = 0;
 		rm = local_client_commit(md, cm);
 		if (!rm || rm->error) {
 			ret = MDHIM_ERROR;
@@ -334,7 +372,8 @@ struct mdhim_brm_t *mdhimPut(struct mdhim_t *md,
 		return NULL;
 	}
 
-	rm = _put_record(md, md->primary_index, primary_key, primary_key_len, value, value_len);
+	rm = _put_record(md, md->primary_index, primary_key, primary_key_len, value, value_len,
+			 md->db_opts->db_value_append);
 	if (!rm || rm->error) {
 		return head;
 	}
@@ -358,7 +397,8 @@ struct mdhim_brm_t *mdhimPut(struct mdhim_t *md,
 				    secondary_local_info->secondary_keys, 
 				    secondary_local_info->secondary_key_lens, 
 				    primary_keys, primary_key_lens, 
-				    secondary_local_info->num_keys);
+				    secondary_local_info->num_keys, 
+				    md->db_opts->db_value_append);
 
 		free(primary_keys);
 		free(primary_key_lens);
@@ -384,7 +424,8 @@ struct mdhim_brm_t *mdhimPut(struct mdhim_t *md,
 				    secondary_global_info->secondary_keys, 
 				    secondary_global_info->secondary_key_lens, 
 				    primary_keys, primary_key_lens,
-				    secondary_global_info->num_keys);
+				    secondary_global_info->num_keys, 
+				    md->db_opts->db_value_append);
 
 		free(primary_keys);
 		free(primary_key_lens);
@@ -429,7 +470,7 @@ struct mdhim_brm_t *mdhimPutSecondary(struct mdhim_t *md,
 	}
 
 	rm = _put_record(md, secondary_index, secondary_key, secondary_key_len, 
-			 primary_key, primary_key_len);
+			 primary_key, primary_key_len, md->db_opts->db_value_append);
 	if (!rm || rm->error) {
 		return head;
 	}
@@ -465,7 +506,8 @@ struct mdhim_brm_t *_bput_secondary_keys_from_info(struct mdhim_t *md,
 				    secondary_info->secondary_keys[i], 
 				    secondary_info->secondary_key_lens[i], 
 				    primary_keys_to_send, primary_key_lens_to_send, 
-				    secondary_info->num_keys[i]);
+				    secondary_info->num_keys[i], 
+				    md->db_opts->db_value_append);
 		if (!head) {
 			head = new;
 		} else if (new) {
@@ -505,7 +547,8 @@ struct mdhim_brm_t *mdhimBPut(struct mdhim_t *md,
 	}
 
 	head = _bput_records(md, md->primary_index, primary_keys, primary_key_lens, 
-			     primary_values, primary_value_lens, num_records);
+			     primary_values, primary_value_lens, num_records, 
+			     md->db_opts->db_value_append);
 	if (!head || head->error) {
 		return head;
 	}
@@ -560,7 +603,8 @@ struct mdhim_brm_t *mdhimBPutSecondary(struct mdhim_t *md, struct index_t *secon
 	}
 
 	head = _bput_records(md, secondary_index, secondary_keys, secondary_key_lens, 
-			     primary_keys, primary_key_lens, num_records);
+			     primary_keys, primary_key_lens, num_records, 
+			     md->db_opts->db_value_append);
 	if (!head || head->error) {
 		return head;
 	}
@@ -568,6 +612,81 @@ struct mdhim_brm_t *mdhimBPutSecondary(struct mdhim_t *md, struct index_t *secon
 	return head;
 }
 
+/**
+ * Inserts a single record into an MDHIM index, appending the value to the record 
+ * that is there or replacing it whatever the db_value_append option is
+ * 
+ * @param md           main MDHIM struct
+ * @param index        the index to put the record in
+ * @param key          pointer to the key to store
+ * @param key_len      the length of the key
+ * @param value        pointer to the value to store
+ * @param value_len    the length of the value
+ * @param append       MDHIM_DB_APPEND to append the value or MDHIM_DB_OVERWRITE to replace it
+ * @return mdhim_brm_t * or NULL on error
+ */
+struct mdhim_brm_t *mdhimPutOp(struct mdhim_t *md, struct index_t *index,
+			       void *key, int key_len, 
+			       void *value, int value_len, 
+			       int append) {
+	struct mdhim_brm_t *head;
+	struct mdhim_rm_t *rm;
+
+	if (!key || !key_len || !value || !value_len) {
+		return NULL;
+	}
+
+	if (append != MDHIM_DB_APPEND && append != MDHIM_DB_OVERWRITE) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Invalid append specified for mdhimPutOp", 
+		     md->mdhim_rank);
+		return NULL;
+	}
+
+	rm = _put_record(md, index, key, key_len, value, value_len, append);
+	if (!rm) {
+		return NULL;
+	}
+
+	head = _create_brm(rm);
+	mdhim_full_release_msg(rm);
+
+	return head;
+}
+
+/**
+ * Inserts multiple records into an MDHIM index, appending the values to the records
+ * that are there or replacing them whatever the db_value_append option is
+ * 
+ * @param md           main MDHIM struct
+ * @param index        the index to put the records in
+ * @param keys         pointer to array of keys to store
+ * @param key_lens     array with lengths of each key in keys
+ * @param values       pointer to array of values to store
+ * @param value_lens   array with lengths of each value
+ * @param num_records  the number of records to store (i.e., the number of keys in keys array)
+ * @param append       MDHIM_DB_APPEND to append the values or MDHIM_DB_OVERWRITE to replace them
+ * @return mdhim_brm_t * or NULL on error
+ */
+struct mdhim_brm_t *mdhimBPutOp(struct mdhim_t *md, struct index_t *index,
+				void **keys, int *key_lens, 
+				void **values, int *value_lens, 
+				int num_records, int append) {
+	if (!keys || !key_lens || !values || !value_lens) {
+		return NULL;
+	}
+
+	if (append != MDHIM_DB_APPEND && append != MDHIM_DB_OVERWRITE) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Invalid append specified for mdhimBPutOp", 
+		     md->mdhim_rank);
+		return NULL;
+	}
+
+	return _bput_records(md, index, keys, key_lens, values, value_lens, 
+			     num_records, append);
+}
+
 /**
  * Retrieves a single record from MDHIM
  *
@@ -754,7 +873,7 @@ struct mdhim_bgetrm_t *mdhimBGetOp(struct mdhim_t *md, struct index_t *index,
 		return NULL;
 	}
 
-	if (op == MDHIM_GET_EQ || op == MDHIM_GET_PRIMARY_EQ) {
+	if (op == MDHIM_GET_EQ || op == MDHIM_GET_PRIMARY_EQ || op == MDHIM_GET_RANGE) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
 		     "Invalid op specified for mdhimGet", 
 		     md->mdhim_rank);
@@ -777,6 +896,52 @@ struct mdhim_bgetrm_t *mdhimBGetOp(struct mdhim_t *md, struct index_t *index,
 	return bgrm_head;
 }
 
+/**
+ * Starts a scan of the records between two keys in key order
+ *
+ * The scan reads pages of records from every range server of the index and 
+ * merges them, so the records of all the range servers come back in key order
+ *
+ * @param md             main MDHIM struct
+ * @param index          the index to scan (the primary index if NULL)
+ * @param start_key      pointer to the first key of the scan, NULL to start at the first key
+ * @param start_key_len  the length of the start key
+ * @param end_key        pointer to the last key of the scan, NULL to go to the last key
+ * @param end_key_len    the length of the end key
+ * @param limit          the maximum number of records the scan returns, 0 for no limit
+ * @return mdhim_scan_t * to pass to mdhimScanNext or NULL on error
+ */
+struct mdhim_scan_t *mdhimScan(struct mdhim_t *md, struct index_t *index, 
+			       void *start_key, int start_key_len,
+			       void *end_key, int end_key_len, int limit) {
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	return scan_open(md, index, start_key, start_key_len, end_key, end_key_len, limit);
+}
+
+/**
+ * Gets the next page of records of a scan
+ *
+ * @param md       main MDHIM struct
+ * @param scan     the scan from mdhimScan
+ * @return mdhim_bgetrm_t * with the records or NULL if the scan is done or on error
+ */
+struct mdhim_bgetrm_t *mdhimScanNext(struct mdhim_t *md, struct mdhim_scan_t *scan) {
+	return scan_next(md, scan);
+}
+
+/**
+ * Ends a scan
+ *
+ * @param md       main MDHIM struct
+ * @param scan     the scan from mdhimScan
+ */
+void mdhimScanClose(struct mdhim_t *md, struct mdhim_scan_t *scan) {
+	scan_close(md, scan);
+}
+
 /**
  * Deletes a single record from MDHIM
  *
@@ -832,6 +997,30 @@ struct mdhim_brm_t *mdhimBDelete(struct mdhim_t *md, struct index_t *index,
 	return brm_head;
 }
 
+/**
+ * Deletes the records between two keys
+ *
+ * Every range server of the index sweeps its records in the range with a cursor and 
+ * deletes them in batches, taking them out of its stats as well
+ *
+ * @param md             main MDHIM struct
+ * @param index          the index to delete the records from (the primary index if NULL)
+ * @param start_key      pointer to the first key to delete, NULL to start at the first key
+ * @param start_key_len  the length of the first key
+ * @param end_key        pointer to the last key to delete, NULL to go to the last key
+ * @param end_key_len    the length of the last key
+ * @return mdhim_brm_t * or NULL on error
+ */
+struct mdhim_brm_t *mdhimDeleteRange(struct mdhim_t *md, struct index_t *index,
+				     void *start_key, int start_key_len,
+				     void *end_key, int end_key_len) {
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	return _del_range(md, index, start_key, start_key_len, end_key, end_key_len);
+}
+
 /**
  * Retrieves statistics from all the range servers - collective call
  *
@@ -842,7 +1031,15 @@ int mdhimStatFlush(struct mdhim_t *md, struct index_t *index) {
 	int ret;
 
 	MPI_Barrier(md->mdhim_client_comm);	
-	if ((ret = get_stat_flush(md, index)) != MDHIM_SUCCESS) {
+
+	//The stat propagation thread publishes the stats of every index in its next round
+	if (md->stat_sync) {
+		ret = stat_sync_flush(md);
+	} else {
+		ret = get_stat_flush(md, index);
+	}
+
+	if (ret != MDHIM_SUCCESS) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
 		     "Error while getting MDHIM stat data in mdhimStatFlush", 
 		     md->mdhim_rank);
@@ -852,6 +1049,189 @@ int mdhimStatFlush(struct mdhim_t *md, struct index_t *index) {
 	return ret;
 }
 
+/**
+ * Computes the splitters of an index created with MDHIM_SPLITTER_PARTITION - collective call
+ *
+ * Each rank passes in a sample of the keys it will insert (e.g., the keys of its first 
+ * bulk put).  If no rank passes in keys, the records already in the range servers' stats 
+ * are used.  The splitters are saved in the manifest and used for all later operations, 
+ * so they should be computed before the index is loaded.  Records aren't moved: slices 
+ * that already have records stay on their range servers until they are migrated with 
+ * mdhimMigrateSlice or mdhimRebalance.
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to compute the splitters of
+ * @param keys      sample keys from this rank
+ * @param key_lens  array with lengths of each key in keys
+ * @param num_keys  the number of keys in keys (may be 0)
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int mdhimComputeSplitters(struct mdhim_t *md, struct index_t *index, 
+			  void **keys, int *key_lens, int num_keys) {
+	int ret;
+
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	MPI_Barrier(md->mdhim_client_comm);	
+	if ((ret = compute_splitters(md, index, keys, key_lens, num_keys)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while computing the splitters in mdhimComputeSplitters", 
+		     md->mdhim_rank);
+	}
+	MPI_Barrier(md->mdhim_client_comm);	
+
+	return ret;
+}
+
+/**
+ * Moves a slice of an index to another range server - collective call
+ *
+ * The slice's records are copied from the range server serving it to the new one while 
+ * it keeps serving them.  The records written during the copy are then sent again and 
+ * the old range server forwards the slice's puts, gets and deletes to the new one until 
+ * every rank routes the slice there, so other threads and ranks can keep issuing requests.
+ * Scans running meanwhile may see the slice's records on both range servers.  The new 
+ * routing is saved in the manifest.  Call mdhimStatFlush afterwards to refresh the stats
+ *
+ * @param md           main MDHIM struct
+ * @param index        the index the slice belongs to (the primary index if NULL)
+ * @param slice        the slice to move
+ * @param rangesrv_num the range server number that will serve the slice
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int mdhimMigrateSlice(struct mdhim_t *md, struct index_t *index, 
+		      int slice, uint32_t rangesrv_num) {
+	int ret;
+
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	if ((ret = _migrate_slice(md, index, slice, rangesrv_num)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while migrating slice: %d in mdhimMigrateSlice", 
+		     md->mdhim_rank, slice);
+	}
+
+	return ret;
+}
+
+/**
+ * Rebalances an index using the range servers' per slice load counters - collective call
+ *
+ * The hottest slice of the busiest range server is moved to the least busy range server
+ * if that lowers the busiest load.  The load counters start over after every call, so 
+ * calling this periodically keeps hot slices from pinning one range server.  The slice 
+ * is moved like mdhimMigrateSlice moves it, while requests keep flowing
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to rebalance (the primary index if NULL)
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int mdhimRebalance(struct mdhim_t *md, struct index_t *index) {
+	int ret;
+
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	if ((ret = _rebalance_index(md, index)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while rebalancing in mdhimRebalance", 
+		     md->mdhim_rank);
+	}
+
+	return ret;
+}
+
+/**
+ * Replicates the hot keys of an index - collective call
+ *
+ * Range servers count the MDHIM_GET_EQ reads of their keys when the hot key threshold
+ * option is set.  The keys read more than the threshold since the last call are copied 
+ * to the range servers that follow their owner.  Afterwards, reads of those keys are 
+ * spread over the owner and the copies, and writes and deletes of those keys go to all 
+ * of them.  Keys that aren't hot anymore stop being replicated
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to replicate the hot keys of (the primary index if NULL)
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int mdhimReplicateHotKeys(struct mdhim_t *md, struct index_t *index) {
+	int ret;
+
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	MPI_Barrier(md->mdhim_client_comm);	
+	if ((ret = replicate_hot_keys(md, index)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while replicating hot keys in mdhimReplicateHotKeys", 
+		     md->mdhim_rank);
+	}
+	MPI_Barrier(md->mdhim_client_comm);	
+
+	return ret;
+}
+
+/**
+ * Freezes an index for a read only phase - collective call
+ *
+ * Each range server copies its records of the index into an MPI window.  Until the 
+ * index is thawed, mdhimGet and mdhimBGet equality lookups read the windows with 
+ * MPI_Get, so the range servers' threads aren't involved.  Puts and deletes on the 
+ * index fail while it is frozen.  Other operations still go to the range servers
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to freeze (the primary index if NULL)
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int mdhimFreeze(struct mdhim_t *md, struct index_t *index) {
+	int ret;
+
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	MPI_Barrier(md->mdhim_client_comm);	
+	if ((ret = freeze_index(md, index)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while freezing the index in mdhimFreeze", 
+		     md->mdhim_rank);
+	}
+	MPI_Barrier(md->mdhim_client_comm);	
+
+	return ret;
+}
+
+/**
+ * Thaws a frozen index so it can be written again - collective call
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to thaw (the primary index if NULL)
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int mdhimThaw(struct mdhim_t *md, struct index_t *index) {
+	int ret;
+
+	if (!index) {
+		index = md->primary_index;
+	}
+
+	MPI_Barrier(md->mdhim_client_comm);	
+	if ((ret = thaw_index(md, index)) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while thawing the index in mdhimThaw", 
+		     md->mdhim_rank);
+	}
+	MPI_Barrier(md->mdhim_client_comm);	
+
+	return ret;
+}
+
 /**
  * Sets the secondary_info structure used in mdhimPut
  *
@@ -19,6 +19,8 @@
 #include "mdhim_options.h"
 #include "indexes.h"
 #include "mdhim_private.h"
+#include "shm_transport.h"
+#include "stat_sync.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -51,6 +53,18 @@ struct mdhim_t {
 	int mdhim_rank;
 	//The size of mdhim_comm
 	int mdhim_comm_size;
+	//The number of nodes (shared memory domains) the ranks of mdhim_comm run on
+	int num_nodes;
+	//The node index of each rank, nodes are numbered in the order of their lowest rank
+	int *rank_nodes;
+	//The rank of each rank within its node
+	int *rank_node_ranks;
+	//The number of ranks on each node
+	int *node_sizes;
+	//This communicator includes the ranks of mdhim_comm on this node
+	MPI_Comm mdhim_node_comm;
+	//The shared memory transport to the ranks on this node, NULL if it isn't used
+	struct mdhim_shm_t *shm;
 	//Flag to indicate mdhimClose was called
 	volatile int shutdown;
 	//A pointer to the primary index
@@ -74,6 +88,8 @@ struct mdhim_t {
 	void *receive_msg;
         //Options for DB creation
         mdhim_options_t *db_opts;
+	//The stat propagation thread, NULL if the stats are published in mdhimStatFlush only
+	struct mdhim_stat_sync_t *stat_sync;
 };
 
 struct secondary_info {
@@ -84,6 +100,8 @@ struct secondary_info {
 	int info_type;
 };
 
+struct mdhim_scan_t;
+
 struct secondary_bulk_info {
 	struct index_t *secondary_index;
 	void ***secondary_keys;
@@ -96,6 +114,14 @@ struct mdhim_t *mdhimInit(void *appComm, struct mdhim_options_t *opts);
 int mdhimClose(struct mdhim_t *md);
 int mdhimCommit(struct mdhim_t *md, struct index_t *index);
 int mdhimStatFlush(struct mdhim_t *md, struct index_t *index);
+int mdhimComputeSplitters(struct mdhim_t *md, struct index_t *index, 
+			  void **keys, int *key_lens, int num_keys);
+int mdhimMigrateSlice(struct mdhim_t *md, struct index_t *index, 
+		      int slice, uint32_t rangesrv_num);
+int mdhimRebalance(struct mdhim_t *md, struct index_t *index);
+int mdhimReplicateHotKeys(struct mdhim_t *md, struct index_t *index);
+int mdhimFreeze(struct mdhim_t *md, struct index_t *index);
+int mdhimThaw(struct mdhim_t *md, struct index_t *index);
 struct mdhim_brm_t *mdhimPut(struct mdhim_t *md,
 			     void *key, int key_len,  
 			     void *value, int value_len,  
@@ -113,6 +139,14 @@ struct mdhim_brm_t *mdhimBPut(struct mdhim_t *md,
 			      int num_records,
 			      struct secondary_bulk_info *secondary_global_info,
 			      struct secondary_bulk_info *secondary_local_info);
+struct mdhim_brm_t *mdhimPutOp(struct mdhim_t *md, struct index_t *index,
+			       void *key, int key_len, 
+			       void *value, int value_len, 
+			       int append);
+struct mdhim_brm_t *mdhimBPutOp(struct mdhim_t *md, struct index_t *index,
+				void **keys, int *key_lens, 
+				void **values, int *value_lens, 
+				int num_records, int append);
 struct mdhim_bgetrm_t *mdhimGet(struct mdhim_t *md, struct index_t *index,
 			       void *key, int key_len, 
 			       int op);
@@ -122,11 +156,19 @@ struct mdhim_bgetrm_t *mdhimBGet(struct mdhim_t *md, struct index_t *index,
 struct mdhim_bgetrm_t *mdhimBGetOp(struct mdhim_t *md, struct index_t *index,
 				   void *key, int key_len, 
 				   int num_records, int op);
+struct mdhim_scan_t *mdhimScan(struct mdhim_t *md, struct index_t *index, 
+			       void *start_key, int start_key_len,
+			       void *end_key, int end_key_len, int limit);
+struct mdhim_bgetrm_t *mdhimScanNext(struct mdhim_t *md, struct mdhim_scan_t *scan);
+void mdhimScanClose(struct mdhim_t *md, struct mdhim_scan_t *scan);
 struct mdhim_brm_t *mdhimDelete(struct mdhim_t *md, struct index_t *index,
 			       void *key, int key_len);
 struct mdhim_brm_t *mdhimBDelete(struct mdhim_t *md, struct index_t *index,
 				 void **keys, int *key_lens,
 				 int num_keys);
+struct mdhim_brm_t *mdhimDeleteRange(struct mdhim_t *md, struct index_t *index,
+				     void *start_key, int start_key_len,
+				     void *end_key, int end_key_len);
 void mdhim_release_recv_msg(void *msg);
 struct secondary_info *mdhimCreateSecondaryInfo(struct index_t *secondary_index,
 						void **secondary_keys, int *secondary_key_lens,
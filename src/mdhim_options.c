@@ -7,6 +7,7 @@
 #include <string.h>
 #include <limits.h>
 #include "mdhim_options.h"
+#include "partitioner.h"
 
 // Default path to a local path and name, levelDB=2, int_key_type=1, yes_create_new=1
 // and debug=1 (mlog_CRIT)
@@ -40,6 +41,19 @@ struct mdhim_options_t *mdhim_options_init()
 	opts->db_paths = NULL;
 	opts->num_paths = 0;
 	opts->num_wthreads = 1;
+	opts->db_partition_type = MDHIM_RANGE_PARTITION;
+	opts->db_hot_key_threshold = 0;
+	opts->rserver_placement = 0;
+	opts->shm_ring_size = 65536;
+	opts->db_max_cursors = 64;
+	opts->db_cursor_timeout = 60;
+	opts->db_snapshot = 0;
+	opts->db_cache_size = 268435456;
+	opts->db_write_buffer_size = 268435456;
+	opts->db_prefix_len = 0;
+	opts->db_num_shards = 1;
+	opts->db_stat_interval = 0;
+	opts->db_stat_threshold = 1;
 
 	set_manifest_path(opts, "./");
 	return opts;
@@ -179,6 +193,87 @@ void mdhim_options_set_num_worker_threads(mdhim_options_t* opts, int num_wthread
 	}
 };
 
+void mdhim_options_set_partition_type(mdhim_options_t* opts, int partition_type)
+{
+	opts->db_partition_type = partition_type;
+};
+
+void mdhim_options_set_hot_key_threshold(mdhim_options_t* opts, int threshold)
+{
+	opts->db_hot_key_threshold = threshold;
+};
+
+void mdhim_options_set_server_placement(mdhim_options_t* opts, int placement)
+{
+	opts->rserver_placement = placement;
+};
+
+void mdhim_options_set_shm_ring_size(mdhim_options_t* opts, int ring_size)
+{
+	opts->shm_ring_size = ring_size;
+};
+
+void mdhim_options_set_max_cursors(mdhim_options_t* opts, int max_cursors)
+{
+	opts->db_max_cursors = max_cursors;
+};
+
+void mdhim_options_set_cursor_timeout(mdhim_options_t* opts, int timeout)
+{
+	opts->db_cursor_timeout = timeout;
+};
+
+void mdhim_options_set_db_snapshot(mdhim_options_t* opts, int snapshot)
+{
+	opts->db_snapshot = snapshot;
+};
+
+void mdhim_options_set_cache_size(mdhim_options_t* opts, uint64_t cache_size)
+{
+	opts->db_cache_size = cache_size;
+};
+
+void mdhim_options_set_write_buffer_size(mdhim_options_t* opts, uint64_t buffer_size)
+{
+	opts->db_write_buffer_size = buffer_size;
+};
+
+void mdhim_options_set_prefix_len(mdhim_options_t* opts, int prefix_len)
+{
+	opts->db_prefix_len = prefix_len;
+};
+
+void mdhim_options_set_num_shards(mdhim_options_t* opts, int num_shards)
+{
+	if (num_shards < 1 || num_shards > MDHIM_MAX_SHARDS) {
+		printf("Invalid number of shards %d, using 1\n", num_shards);
+		num_shards = 1;
+	}
+
+	opts->db_num_shards = num_shards;
+};
+
+void mdhim_options_set_stat_interval(mdhim_options_t* opts, int interval)
+{
+	if (interval < 0) {
+		printf("Invalid stat interval %d, publishing the stats in mdhimStatFlush only\n", 
+		       interval);
+		interval = 0;
+	}
+
+	opts->db_stat_interval = interval;
+};
+
+void mdhim_options_set_stat_threshold(mdhim_options_t* opts, int threshold)
+{
+	if (threshold < 1) {
+		printf("Invalid stat threshold %d, using 1\n", threshold);
+		threshold = 1;
+	}
+
+	opts->db_stat_threshold = threshold;
+};
+
 void mdhim_options_destroy(mdhim_options_t *opts) {
 	int i;
 
@@ -15,6 +15,8 @@ extern "C"
 /* Append option */
 #define MDHIM_DB_OVERWRITE 0
 #define MDHIM_DB_APPEND 1
+/* Most data stores an index can be split into on a range server */
+#define MDHIM_MAX_SHARDS 64
 
 // Options for the database (used when opening a MDHIM dataStore)
 typedef struct mdhim_options_t {
@@ -34,7 +36,7 @@ typedef struct mdhim_options_t {
 	char *db_name;
     
 	//Different types of dataStores
-	//LEVELDB=1 (from data_store.h)
+	//LEVELDB=1, ROCKSDB=4, MEMORYDB=5 (from data_store.h)
 	int db_type;
     
 	//Primary key type
@@ -64,6 +66,59 @@ typedef struct mdhim_options_t {
 	//Number of worker threads per range server
 	int num_wthreads;
 
+	//Partitioning scheme of the primary index
+	//MDHIM_RANGE_PARTITION (default), MDHIM_HASH_PARTITION or MDHIM_SPLITTER_PARTITION
+	//(from partitioner.h)
+	int db_partition_type;
+
+	//Placement of the range servers on the ranks
+	//MDHIM_RANK_PLACEMENT (default) or MDHIM_NODE_PLACEMENT
+	//(from partitioner.h)
+	int rserver_placement;
+
+	//Bytes of messages each shared memory ring between two ranks on a node holds
+	//0 sends the messages between ranks on a node over MPI
+	int shm_ring_size;
+
+	//Number of MDHIM_GET_EQ reads of a key before range servers replicate it
+	//0 (default) disables tracking of hot keys
+	int db_hot_key_threshold;
+
+	//Maximum number of NEXT/PREV scan cursors each range server keeps open
+	//0 reads every page of a scan with a new seek
+	int db_max_cursors;
+
+	//Seconds a scan cursor is kept open without being used
+	int db_cursor_timeout;
+
+	//Whether MEMORYDB data stores are written to a file on close and read back on open
+	//0 (default) keeps them for the life of the job only
+	int db_snapshot;
+
+	//Bytes of the block cache all ROCKSDB data stores of a rank share
+	uint64_t db_cache_size;
+
+	//Bytes of write buffers all ROCKSDB data stores of a rank share before they are flushed
+	uint64_t db_write_buffer_size;
+
+	//Length of the key prefixes ROCKSDB data stores of MDHIM_STRING_KEY indexes filter
+	//lookups by.  0 (default) filters by whole keys only
+	int db_prefix_len;
+
+	//Number of data stores each range server splits the records of an index into by slice
+	//Each has its own memtable and log, so writes to different ones don't wait on each other
+	//1 (default) keeps an index in a single data store
+	int db_num_shards;
+
+	//Milliseconds between the rounds in which a background thread publishes the stats that
+	//changed, so routing doesn't wait for a mdhimStatFlush.  0 (default) publishes them
+	//in mdhimStatFlush only
+	int db_stat_interval;
+
+	//Number of changed stats, summed over all the range servers, a round waits for before
+	//publishing them.  1 (default) publishes any change in the next round
+	int db_stat_threshold;
+
 	//Login Credentials 
 	char *db_host;
 	char *dbs_host;
@@ -88,6 +143,19 @@ void mdhim_options_set_value_append(struct mdhim_options_t* opts, int append);
 void mdhim_options_set_server_factor(struct mdhim_options_t* opts, int server_factor);
 void mdhim_options_set_max_recs_per_slice(struct mdhim_options_t* opts, uint64_t max_recs_per_slice);
 void mdhim_options_set_num_worker_threads(struct mdhim_options_t* opts, int num_wthreads);
+void mdhim_options_set_partition_type(struct mdhim_options_t* opts, int partition_type);
+void mdhim_options_set_hot_key_threshold(struct mdhim_options_t* opts, int threshold);
+void mdhim_options_set_server_placement(struct mdhim_options_t* opts, int placement);
+void mdhim_options_set_shm_ring_size(struct mdhim_options_t* opts, int ring_size);
+void mdhim_options_set_max_cursors(struct mdhim_options_t* opts, int max_cursors);
+void mdhim_options_set_cursor_timeout(struct mdhim_options_t* opts, int timeout);
+void mdhim_options_set_db_snapshot(struct mdhim_options_t* opts, int snapshot);
+void mdhim_options_set_cache_size(struct mdhim_options_t* opts, uint64_t cache_size);
+void mdhim_options_set_write_buffer_size(struct mdhim_options_t* opts, uint64_t buffer_size);
+void mdhim_options_set_prefix_len(struct mdhim_options_t* opts, int prefix_len);
+void mdhim_options_set_num_shards(struct mdhim_options_t* opts, int num_shards);
+void mdhim_options_set_stat_interval(struct mdhim_options_t* opts, int interval);
+void mdhim_options_set_stat_threshold(struct mdhim_options_t* opts, int threshold);
 void set_manifest_path(mdhim_options_t* opts, char *path);
 void mdhim_options_destroy(struct mdhim_options_t *opts);
 #ifdef __cplusplus
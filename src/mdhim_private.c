@@ -1,18 +1,35 @@
 #include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
 #include "mdhim.h"
 #include "client.h"
 #include "local_client.h"
 #include "partitioner.h"
 #include "indexes.h"
+#include "hot_keys.h"
+#include "frozen_index.h"
 
 struct mdhim_rm_t *_put_record(struct mdhim_t *md, struct index_t *index, 
 			       void *key, int key_len, 
-			       void *value, int value_len) {
-	struct mdhim_rm_t *rm = NULL;
+			       void *value, int value_len, int append) {
+	struct mdhim_rm_t *rm = NULL, *rm_head = NULL;
 	rangesrv_list *rl, *rlp;
+	rangesrv_info *owner;
 	int ret;
+	int i;
 	struct mdhim_putm_t *pm;
 	struct index_t *lookup_index, *put_index;
+	uint32_t replicas[MDHIM_HOT_KEY_HOLDERS];
+	int num_replicas;
+	uint32_t epoch;
+
+	//Frozen indexes are read only until they are thawed
+	if (index->frozen) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Can't put a record in frozen index: %d", 
+		     md->mdhim_rank, index->id);
+		return NULL;
+	}
 
 	put_index = index;
 	if (index->type == LOCAL_INDEX) {
@@ -24,6 +41,9 @@ struct mdhim_rm_t *_put_record(struct mdhim_t *md, struct index_t *index,
 		lookup_index = index;
 	}
 
+	//The epoch is read before routing, so range servers check keys routed with an old one
+	epoch = get_routing_epoch(put_index);
+
 	//Get the range server this key will be sent to
 	if (put_index->type == LOCAL_INDEX) {
 		if ((rl = get_range_servers(md, lookup_index, value, value_len)) == 
@@ -33,6 +53,8 @@ struct mdhim_rm_t *_put_record(struct mdhim_t *md, struct index_t *index,
 			     md->mdhim_rank);
 			return NULL;
 		}
+
+		owner = rl->ri;
 	} else {
 		//Get the range server this key will be sent to
 		if ((rl = get_range_servers(md, lookup_index, key, key_len)) == NULL) {
@@ -41,6 +63,13 @@ struct mdhim_rm_t *_put_record(struct mdhim_t *md, struct index_t *index,
 			     md->mdhim_rank);
 			return NULL;
 		}
+
+		//Writes of a hot key go to its replicas as well
+		owner = rl->ri;
+		num_replicas = find_hot_key(put_index, key, key_len, replicas);
+		for (i = 1; i < num_replicas; i++) {
+			_add_to_rangesrv_list(&rl, put_index->rangesrvs_arr[replicas[i] - 1]);
+		}
 	}
 	
 	while (rl) {
@@ -58,9 +87,13 @@ struct mdhim_rm_t *_put_record(struct mdhim_t *md, struct index_t *index,
 		pm->key_len = key_len;
 		pm->value = value;
 		pm->value_len = value_len;
+		pm->append = append;
+		pm->replica = rl->ri != owner;
 		pm->basem.server_rank = rl->ri->rank;
 		pm->basem.index = put_index->id;
 		pm->basem.index_type = put_index->type;
+		pm->basem.routing_epoch = epoch;
+		pm->basem.forwarded = 0;
 
 		//Test if I'm a range server
 		ret = im_range_server(put_index);
@@ -74,12 +107,23 @@ struct mdhim_rm_t *_put_record(struct mdhim_t *md, struct index_t *index,
 			free(pm);
 		}
 
-		rl = rl->next;
+		//Return the first response, with the first error of any range server written to
+		if (!rm_head) {
+			rm_head = rm;
+		} else if (rm) {
+			if (rm->error != MDHIM_SUCCESS) {
+				rm_head->error = rm->error;
+			}
+
+			free(rm);
+		}
+
 		rlp = rl;
+		rl = rl->next;
 		free(rlp);
 	}
 
-	return rm;
+	return rm_head;
 }
 
 /* Creates a linked list of mdhim_rm_t messages */
@@ -118,14 +162,26 @@ void _concat_brm(struct mdhim_brm_t *head, struct mdhim_brm_t *addition) {
 struct mdhim_brm_t *_bput_records(struct mdhim_t *md, struct index_t *index, 
 				  void **keys, int *key_lens, 
 				  void **values, int *value_lens, 
-				  int num_keys) {
+				  int num_keys, int append) {
 	struct mdhim_bputm_t **bpm_list, *lbpm;
 	struct mdhim_bputm_t *bpm;
 	struct mdhim_brm_t *brm, *brm_head;
 	struct mdhim_rm_t *rm;
-	int i;
-	rangesrv_list *rl, *rlp;
+	int i, j, ret;
+	int *rs_idx, *counts;
+	rangesrv_info *ri;
 	struct index_t *lookup_index, *put_index;
+	int *num_replicas, r, flagged;
+	uint32_t *replicas;
+	uint32_t epoch;
+
+	//Frozen indexes are read only until they are thawed
+	if (index->frozen) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Can't put records in frozen index: %d", 
+		     md->mdhim_rank, index->id);
+		return NULL;
+	}
 
 	put_index = index;
 	if (index->type == LOCAL_INDEX) {
@@ -155,70 +211,120 @@ struct mdhim_brm_t *_bput_records(struct mdhim_t *md, struct index_t *index,
 		bpm_list[i] = NULL;
 	}
 
-	/* Go through each of the records to find the range server(s) the record belongs to.
-	   If there is not a bulk message in the array for the range server the key belongs to, 
-	   then it is created.  Otherwise, the data is added to the existing message in the array.*/
-	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
-		//Get the range server this key will be sent to
-		if (put_index->type == LOCAL_INDEX) {
-			if ((rl = get_range_servers(md, lookup_index, values[i], value_lens[i])) == 
-			    NULL) {
-				mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
-				     "Error while determining range server in mdhimBPut", 
-				     md->mdhim_rank);
-				continue;
+	//Get the range server each key will be sent to
+	epoch = get_routing_epoch(put_index);
+	rs_idx = malloc(sizeof(int) * num_keys);
+	if (put_index->type == LOCAL_INDEX) {
+		ret = get_range_servers_batch(md, lookup_index, values, value_lens, 
+					      num_keys, rs_idx);
+	} else {
+		ret = get_range_servers_batch(md, lookup_index, keys, key_lens, 
+					      num_keys, rs_idx);
+	}
+
+	if (ret != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while determining range servers in mdhimBPut", 
+		     md->mdhim_rank);
+		free(rs_idx);
+		free(bpm_list);
+		return NULL;
+	}
+
+	/* First pass: count the records that go to each range server so the messages can be 
+	   allocated with exactly the number of records they will hold */
+	counts = malloc(sizeof(int) * lookup_index->num_rangesrvs);
+	memset(counts, 0, sizeof(int) * lookup_index->num_rangesrvs);
+	for (i = 0; i < num_keys; i++) {
+		if (rs_idx[i] < 0) {
+			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+			     "Error while determining range server in mdhimBPut", 
+			     md->mdhim_rank);
+			continue;
+		}
+
+		counts[rs_idx[i]]++;
+	}
+
+	//Writes of hot keys go to their replicas as well
+	replicas = NULL;
+	flagged = 0;
+	if (put_index->type != LOCAL_INDEX && put_index->hot_keys) {
+		num_replicas = malloc(sizeof(int) * num_keys);
+		replicas = malloc(sizeof(uint32_t) * num_keys * MDHIM_HOT_KEY_HOLDERS);
+		find_hot_keys(put_index, keys, key_lens, num_keys, num_replicas, replicas);
+		for (i = 0; i < num_keys; i++) {
+			for (j = 1; rs_idx[i] >= 0 && j < num_replicas[i]; j++) {
+				counts[replicas[i * MDHIM_HOT_KEY_HOLDERS + j] - 1]++;
+				flagged = 1;
 			}
+		}
+	}
+
+	//Create one message per range server that has records
+	for (i = 0; i < lookup_index->num_rangesrvs; i++) {
+		if (!counts[i]) {
+			continue;
+		}
+
+		ri = lookup_index->rangesrvs_arr[i];
+		bpm = malloc(sizeof(struct mdhim_bputm_t));			       
+		bpm->keys = malloc(sizeof(void *) * counts[i]);
+		bpm->key_lens = malloc(sizeof(int) * counts[i]);
+		bpm->values = malloc(sizeof(void *) * counts[i]);
+		bpm->value_lens = malloc(sizeof(int) * counts[i]);
+		bpm->num_keys = 0;
+		bpm->append = append;
+		//The records sent to replicas are flagged, so range servers keep them apart
+		bpm->replica = flagged ? malloc(sizeof(int) * counts[i]) : NULL;
+		bpm->basem.server_rank = ri->rank;
+		bpm->basem.mtype = MDHIM_BULK_PUT;
+		bpm->basem.index = put_index->id;
+		bpm->basem.index_type = put_index->type;
+		bpm->basem.routing_epoch = epoch;
+		bpm->basem.forwarded = 0;
+		if (ri->rank != md->mdhim_rank) {
+			bpm_list[i] = bpm;
 		} else {
-			if ((rl = get_range_servers(md, lookup_index, keys[i], key_lens[i])) == 
-			    NULL) {
-				mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
-				     "Error while determining range server in mdhimBPut", 
-				     md->mdhim_rank);
-				continue;
-			}
+			lbpm = bpm;
 		}
-       
-		//There could be more than one range server returned in the case of the local index
-		while (rl) {
-			if (rl->ri->rank != md->mdhim_rank) {
-				//Set the message in the list for this range server
-				bpm = bpm_list[rl->ri->rangesrv_num - 1];
-			} else {
-				//Set the local message
-				bpm = lbpm;
-			}
+	}
 
-			//If the message doesn't exist, create one
-			if (!bpm) {
-				bpm = malloc(sizeof(struct mdhim_bputm_t));			       
-				bpm->keys = malloc(sizeof(void *) * MAX_BULK_OPS);
-				bpm->key_lens = malloc(sizeof(int) * MAX_BULK_OPS);
-				bpm->values = malloc(sizeof(void *) * MAX_BULK_OPS);
-				bpm->value_lens = malloc(sizeof(int) * MAX_BULK_OPS);
-				bpm->num_keys = 0;
-				bpm->basem.server_rank = rl->ri->rank;
-				bpm->basem.mtype = MDHIM_BULK_PUT;
-				bpm->basem.index = put_index->id;
-				bpm->basem.index_type = put_index->type;
-				if (rl->ri->rank != md->mdhim_rank) {
-					bpm_list[rl->ri->rangesrv_num - 1] = bpm;
-				} else {
-					lbpm = bpm;
-				}
-			}
-		
-			//Add the key, lengths, and data to the message
+	//Second pass: scatter the records into the messages
+	for (i = 0; i < num_keys; i++) {
+		if (rs_idx[i] < 0) {
+			continue;
+		}
+
+		bpm = bpm_list[rs_idx[i]] ? bpm_list[rs_idx[i]] : lbpm;
+		bpm->keys[bpm->num_keys] = keys[i];
+		bpm->key_lens[bpm->num_keys] = key_lens[i];
+		bpm->values[bpm->num_keys] = values[i];
+		bpm->value_lens[bpm->num_keys] = value_lens[i];
+		if (bpm->replica) {
+			bpm->replica[bpm->num_keys] = 0;
+		}
+
+		bpm->num_keys++;
+		for (j = 1; replicas && j < num_replicas[i]; j++) {
+			r = replicas[i * MDHIM_HOT_KEY_HOLDERS + j] - 1;
+			bpm = bpm_list[r] ? bpm_list[r] : lbpm;
 			bpm->keys[bpm->num_keys] = keys[i];
 			bpm->key_lens[bpm->num_keys] = key_lens[i];
 			bpm->values[bpm->num_keys] = values[i];
 			bpm->value_lens[bpm->num_keys] = value_lens[i];
+			bpm->replica[bpm->num_keys] = 1;
 			bpm->num_keys++;
-			rlp = rl;
-			rl = rl->next;
-			free(rlp);
-		}	
+		}
 	}
 
+	if (replicas) {
+		free(num_replicas);
+		free(replicas);
+	}
+	free(counts);
+	free(rs_idx);
+
 	//Make a list out of the received messages to return
 	brm_head = client_bput(md, put_index, bpm_list);
 	if (lbpm) {
@@ -241,6 +347,7 @@ struct mdhim_brm_t *_bput_records(struct mdhim_t *md, struct index_t *index,
 		free(bpm_list[i]->values);
 		free(bpm_list[i]->key_lens);
 		free(bpm_list[i]->value_lens);
+		free(bpm_list[i]->replica);
 		free(bpm_list[i]);
 	}
 
@@ -257,7 +364,11 @@ struct mdhim_bgetrm_t *_bget_records(struct mdhim_t *md, struct index_t *index,
 	struct mdhim_bgetm_t *bgm, *lbgm;
 	struct mdhim_bgetrm_t *bgrm_head, *lbgrm;
 	int i;
-	rangesrv_list *rl = NULL, *rlp;
+	int *rs_idx, *counts, *flags;
+	int replica;
+	rangesrv_list *rl = NULL, *rlp, batch_rl, **rls;
+	rangesrv_info *ri;
+	uint32_t epoch;
 
 	//The message to be sent to ourselves if necessary
 	lbgm = NULL;
@@ -268,71 +379,164 @@ struct mdhim_bgetrm_t *_bget_records(struct mdhim_t *md, struct index_t *index,
 		bgm_list[i] = NULL;
 	}
 
-	/* Go through each of the records to find the range server the record belongs to.
-	   If there is not a bulk message in the array for the range server the key belongs to, 
-	   then it is created.  Otherwise, the data is added to the existing message in the array.*/
-	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
-		//Get the range server this key will be sent to
-		if ((op == MDHIM_GET_EQ || op == MDHIM_GET_PRIMARY_EQ) && 
-		    index->type != LOCAL_INDEX &&
-		    (rl = get_range_servers(md, index, keys[i], key_lens[i])) == 
-		    NULL) {
+	//Equality lookups on a global index are routed for all the keys at once
+	epoch = get_routing_epoch(index);
+	rs_idx = NULL;
+	flags = NULL;
+	if ((op == MDHIM_GET_EQ || op == MDHIM_GET_PRIMARY_EQ) && 
+	    index->type != LOCAL_INDEX) {
+		rs_idx = malloc(sizeof(int) * num_keys);
+		if (get_range_servers_batch(md, index, keys, key_lens, num_keys, rs_idx) != 
+		    MDHIM_SUCCESS) {
 			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
-			     "Error while determining range server in mdhimBget", 
+			     "Error while determining range servers in mdhimBget", 
 			     md->mdhim_rank);
+			free(rs_idx);
 			free(bgm_list);
 			return NULL;
-		} else if ((index->type == LOCAL_INDEX || 
-			   (op != MDHIM_GET_EQ && op != MDHIM_GET_PRIMARY_EQ)) &&
-			   (rl = get_range_servers_from_stats(md, index, keys[i], key_lens[i], op)) == 
-			   NULL) {
-			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
-			     "Error while determining range server in mdhimBget", 
-			     md->mdhim_rank);
+		}
+
+		//Frozen indexes are read from the range servers' windows without messages
+		if (index->frozen) {
+			bgrm_head = frozen_bget(md, index, keys, key_lens, num_keys, rs_idx);
+			free(rs_idx);
 			free(bgm_list);
-			return NULL;
-		}	   	
+			return bgrm_head;
+		}
 
-		while (rl) {
-			if (rl->ri->rank != md->mdhim_rank) {
-				//Set the message in the list for this range server
-				bgm = bgm_list[rl->ri->rangesrv_num - 1];
-			} else {
-				//Set the local message
-				bgm = lbgm;
+		//Reads of hot keys are spread over the range servers holding them
+		for (i = 0; index->hot_keys && i < num_keys; i++) {
+			if (rs_idx[i] < 0 || 
+			    (replica = get_hot_key_replica(md, index, keys[i], key_lens[i])) < 0 ||
+			    replica == rs_idx[i]) {
+				continue;
 			}
 
-			//If the message doesn't exist, create one
-			if (!bgm) {
-				bgm = malloc(sizeof(struct mdhim_bgetm_t));			       
-				//bgm->keys = malloc(sizeof(void *) * MAX_BULK_OPS);
-				//bgm->key_lens = malloc(sizeof(int) * MAX_BULK_OPS);
-				bgm->keys = malloc(sizeof(void *) * num_keys);
-				bgm->key_lens = malloc(sizeof(int) * num_keys);
-				bgm->num_keys = 0;
-				bgm->num_recs = num_records;
-				bgm->basem.server_rank = rl->ri->rank;
-				bgm->basem.mtype = MDHIM_BULK_GET;
-				bgm->op = (op == MDHIM_GET_PRIMARY_EQ) ? MDHIM_GET_EQ : op;
-				bgm->basem.index = index->id;
-				bgm->basem.index_type = index->type;
-				if (rl->ri->rank != md->mdhim_rank) {
-					bgm_list[rl->ri->rangesrv_num - 1] = bgm;
-				} else {
-					lbgm = bgm;
-				}
+			//Keys read from a replica are flagged, so range servers look up their copies
+			if (!flags) {
+				flags = malloc(sizeof(int) * num_keys);
+				memset(flags, 0, sizeof(int) * num_keys);
+			}
+
+			rs_idx[i] = replica;
+			flags[i] = 1;
+		}
+	}
+
+	//Range servers from the stats are kept for each key until the keys are scattered
+	rls = NULL;
+	if (!rs_idx) {
+		rls = malloc(sizeof(rangesrv_list *) * num_keys);
+		memset(rls, 0, sizeof(rangesrv_list *) * num_keys);
+	}
+
+	/* First pass: find the range servers each record belongs to and count the records 
+	   that go to each range server */
+	counts = malloc(sizeof(int) * index->num_rangesrvs);
+	memset(counts, 0, sizeof(int) * index->num_rangesrvs);
+	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
+		//Get the range server this key will be sent to
+		if (rs_idx && rs_idx[i] >= 0) {
+			counts[rs_idx[i]]++;
+			continue;
+		} else if (!rs_idx && 
+			   (rls[i] = get_range_servers_from_stats(md, index, keys[i], 
+								  key_lens[i], op)) != NULL) {
+			for (rl = rls[i]; rl; rl = rl->next) {
+				counts[rl->ri->rangesrv_num - 1]++;
 			}
-		
-			//Add the key, lengths, and data to the message
+
+			continue;
+		}
+
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while determining range server in mdhimBget", 
+		     md->mdhim_rank);
+		for (i = 0; rls && i < num_keys; i++) {
+			while (rls[i]) {
+				rlp = rls[i];
+				rls[i] = rls[i]->next;
+				free(rlp);
+			}
+		}
+
+		free(rls);
+		free(rs_idx);
+		free(flags);
+		free(counts);
+		free(bgm_list);
+		return NULL;
+	}
+
+	//Create one message per range server that has records
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!counts[i]) {
+			continue;
+		}
+
+		ri = index->rangesrvs_arr[i];
+		bgm = malloc(sizeof(struct mdhim_bgetm_t));			       
+		bgm->keys = malloc(sizeof(void *) * counts[i]);
+		bgm->key_lens = malloc(sizeof(int) * counts[i]);
+		bgm->num_keys = 0;
+		bgm->replica = flags ? malloc(sizeof(int) * counts[i]) : NULL;
+		bgm->num_recs = num_records;
+		bgm->basem.server_rank = ri->rank;
+		bgm->basem.mtype = MDHIM_BULK_GET;
+		bgm->op = (op == MDHIM_GET_PRIMARY_EQ) ? MDHIM_GET_EQ : op;
+		bgm->basem.index = index->id;
+		bgm->basem.index_type = index->type;
+		bgm->basem.routing_epoch = epoch;
+		bgm->basem.forwarded = 0;
+		//Continue from the server cursor the last scan of this index left open
+		bgm->cursor = 0;
+		if (num_keys == 1 && index->scan_cursor && index->scan_cursor_rank == ri->rank &&
+		    index->scan_cursor_op == op) {
+			bgm->cursor = index->scan_cursor;
+		}
+
+		if (ri->rank != md->mdhim_rank) {
+			bgm_list[i] = bgm;
+		} else {
+			lbgm = bgm;
+		}
+	}
+
+	//Second pass: scatter the keys into the messages
+	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
+		if (rs_idx) {
+			batch_rl.ri = index->rangesrvs_arr[rs_idx[i]];
+			batch_rl.next = NULL;
+			rl = &batch_rl;
+		} else {
+			rl = rls[i];
+		}
+
+		while (rl) {
+			bgm = bgm_list[rl->ri->rangesrv_num - 1] ? 
+				bgm_list[rl->ri->rangesrv_num - 1] : lbgm;
+
+			//Add the key and length to the message
 			bgm->keys[bgm->num_keys] = keys[i];
 			bgm->key_lens[bgm->num_keys] = key_lens[i];
+			if (bgm->replica) {
+				bgm->replica[bgm->num_keys] = flags[i];
+			}
+
 			bgm->num_keys++;	
 			rlp = rl;
 			rl = rl->next;
-			free(rlp);
+			if (rlp != &batch_rl) {
+				free(rlp);
+			}
 		}
 	}
 
+	free(rls);
+	free(counts);
+	free(rs_idx);
+	free(flags);
+
 	//Make a list out of the received messages to return
 	bgrm_head = client_bget(md, index, bgm_list);
 	if (lbgm) {
@@ -340,6 +544,19 @@ struct mdhim_bgetrm_t *_bget_records(struct mdhim_t *md, struct index_t *index,
 		lbgrm->next = bgrm_head;
 		bgrm_head = lbgrm;
 	}
+
+	//Remember the cursor a range server kept open so the next page of the scan can use it
+	if (op == MDHIM_GET_NEXT || op == MDHIM_GET_PREV) {
+		index->scan_cursor = 0;
+		for (lbgrm = bgrm_head; lbgrm; lbgrm = lbgrm->next) {
+			if (lbgrm->cursor) {
+				index->scan_cursor = lbgrm->cursor;
+				index->scan_cursor_rank = lbgrm->basem.server_rank;
+				index->scan_cursor_op = op;
+				break;
+			}
+		}
+	}
 	
 	for (i = 0; i < index->num_rangesrvs; i++) {
 		if (!bgm_list[i]) {
@@ -348,6 +565,7 @@ struct mdhim_bgetrm_t *_bget_records(struct mdhim_t *md, struct index_t *index,
 
 		free(bgm_list[i]->keys);
 		free(bgm_list[i]->key_lens);
+		free(bgm_list[i]->replica);
 		free(bgm_list[i]);
 	}
 
@@ -372,8 +590,21 @@ struct mdhim_brm_t *_bdel_records(struct mdhim_t *md, struct index_t *index,
 	struct mdhim_bdelm_t *bdm, *lbdm;
 	struct mdhim_brm_t *brm, *brm_head;
 	struct mdhim_rm_t *rm;
-	int i;
-	rangesrv_list *rl;
+	int i, j;
+	int *rs_idx, *counts;
+	rangesrv_list *rl, *rlp;
+	rangesrv_info *ri;
+	int *num_replicas, r, flagged;
+	uint32_t *replicas;
+	uint32_t epoch;
+
+	//Frozen indexes are read only until they are thawed
+	if (index->frozen) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Can't delete records from frozen index: %d", 
+		     md->mdhim_rank, index->id);
+		return NULL;
+	}
 
 	//The message to be sent to ourselves if necessary
 	lbdm = NULL;
@@ -384,58 +615,123 @@ struct mdhim_brm_t *_bdel_records(struct mdhim_t *md, struct index_t *index,
 		bdm_list[i] = NULL;
 	}
 
-	/* Go through each of the records to find the range server the record belongs to.
-	   If there is not a bulk message in the array for the range server the key belongs to, 
-	   then it is created.  Otherwise, the data is added to the existing message in the array.*/
-	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
-		//Get the range server this key will be sent to
-		if (index->type != LOCAL_INDEX && 
-		    (rl = get_range_servers(md, index, keys[i], key_lens[i])) == 
-		    NULL) {
+	//Get the range server each key will be sent to
+	epoch = get_routing_epoch(index);
+	rs_idx = malloc(sizeof(int) * num_keys);
+	if (index->type != LOCAL_INDEX) {
+		//Keys of a global index are routed all at once
+		if (get_range_servers_batch(md, index, keys, key_lens, num_keys, rs_idx) != 
+		    MDHIM_SUCCESS) {
 			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
-			     "Error while determining range server in mdhimBdel", 
+			     "Error while determining range servers in mdhimBdel", 
 			     md->mdhim_rank);
-			continue;
-		} else if (index->type == LOCAL_INDEX && 
-			   (rl = get_range_servers_from_stats(md, index, keys[i], 
-							      key_lens[i], MDHIM_GET_EQ)) == 
-			   NULL) {
+			free(rs_idx);
+			free(bdm_list);
+			return NULL;
+		}
+	} else {
+		for (i = 0; i < num_keys; i++) {
+			rs_idx[i] = -1;
+			if ((rl = get_range_servers_from_stats(md, index, keys[i], 
+							       key_lens[i], MDHIM_GET_EQ)) == NULL) {
+				continue;
+			}
+
+			rs_idx[i] = rl->ri->rangesrv_num - 1;
+			while (rl) {
+				rlp = rl;
+				rl = rl->next;
+				free(rlp);
+			}
+		}
+	}
+
+	/* First pass: count the records that go to each range server so the messages can be 
+	   allocated with exactly the number of records they will hold */
+	counts = malloc(sizeof(int) * index->num_rangesrvs);
+	memset(counts, 0, sizeof(int) * index->num_rangesrvs);
+	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
+		if (rs_idx[i] < 0) {
 			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
 			     "Error while determining range server in mdhimBdel", 
 			     md->mdhim_rank);
 			continue;
 		}
-       
-		if (rl->ri->rank != md->mdhim_rank) {
-			//Set the message in the list for this range server
-			bdm = bdm_list[rl->ri->rangesrv_num - 1];
-		} else {
-			//Set the local message
-			bdm = lbdm;
-		}
-
-		//If the message doesn't exist, create one
-		if (!bdm) {
-			bdm = malloc(sizeof(struct mdhim_bdelm_t));			       
-			bdm->keys = malloc(sizeof(void *) * MAX_BULK_OPS);
-			bdm->key_lens = malloc(sizeof(int) * MAX_BULK_OPS);
-			bdm->num_keys = 0;
-			bdm->basem.server_rank = rl->ri->rank;
-			bdm->basem.mtype = MDHIM_BULK_DEL;
-			bdm->basem.index = index->id;
-			bdm->basem.index_type = index->type;
-			if (rl->ri->rank != md->mdhim_rank) {
-				bdm_list[rl->ri->rangesrv_num - 1] = bdm;
-			} else {
-				lbdm = bdm;
+
+		counts[rs_idx[i]]++;
+	}
+
+	//Deletes of hot keys go to their replicas as well
+	replicas = NULL;
+	flagged = 0;
+	if (index->type != LOCAL_INDEX && index->hot_keys) {
+		num_replicas = malloc(sizeof(int) * num_keys);
+		replicas = malloc(sizeof(uint32_t) * num_keys * MDHIM_HOT_KEY_HOLDERS);
+		find_hot_keys(index, keys, key_lens, num_keys, num_replicas, replicas);
+		for (i = 0; i < num_keys; i++) {
+			for (j = 1; rs_idx[i] >= 0 && j < num_replicas[i]; j++) {
+				counts[replicas[i * MDHIM_HOT_KEY_HOLDERS + j] - 1]++;
+				flagged = 1;
 			}
 		}
+	}
+
+	//Create one message per range server that has records
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!counts[i]) {
+			continue;
+		}
+
+		ri = index->rangesrvs_arr[i];
+		bdm = malloc(sizeof(struct mdhim_bdelm_t));			       
+		bdm->keys = malloc(sizeof(void *) * counts[i]);
+		bdm->key_lens = malloc(sizeof(int) * counts[i]);
+		bdm->num_keys = 0;
+		//The keys sent to replicas are flagged, so range servers only delete their copies
+		bdm->replica = flagged ? malloc(sizeof(int) * counts[i]) : NULL;
+		bdm->basem.server_rank = ri->rank;
+		bdm->basem.mtype = MDHIM_BULK_DEL;
+		bdm->basem.index = index->id;
+		bdm->basem.index_type = index->type;
+		bdm->basem.routing_epoch = epoch;
+		bdm->basem.forwarded = 0;
+		if (ri->rank != md->mdhim_rank) {
+			bdm_list[i] = bdm;
+		} else {
+			lbdm = bdm;
+		}
+	}
+
+	//Second pass: scatter the keys into the messages
+	for (i = 0; i < num_keys && i < MAX_BULK_OPS; i++) {
+		if (rs_idx[i] < 0) {
+			continue;
+		}
 
-		//Add the key, lengths, and data to the message
+		bdm = bdm_list[rs_idx[i]] ? bdm_list[rs_idx[i]] : lbdm;
 		bdm->keys[bdm->num_keys] = keys[i];
 		bdm->key_lens[bdm->num_keys] = key_lens[i];
+		if (bdm->replica) {
+			bdm->replica[bdm->num_keys] = 0;
+		}
+
 		bdm->num_keys++;		
+		for (j = 1; replicas && j < num_replicas[i]; j++) {
+			r = replicas[i * MDHIM_HOT_KEY_HOLDERS + j] - 1;
+			bdm = bdm_list[r] ? bdm_list[r] : lbdm;
+			bdm->keys[bdm->num_keys] = keys[i];
+			bdm->key_lens[bdm->num_keys] = key_lens[i];
+			bdm->replica[bdm->num_keys] = 1;
+			bdm->num_keys++;
+		}
+	}
+
+	if (replicas) {
+		free(num_replicas);
+		free(replicas);
 	}
+	free(counts);
+	free(rs_idx);
 
 	//Make a list out of the received messages to return
 	brm_head = client_bdelete(md, index, bdm_list);
@@ -459,6 +755,7 @@ struct mdhim_brm_t *_bdel_records(struct mdhim_t *md, struct index_t *index,
 
 		free(bdm_list[i]->keys);
 		free(bdm_list[i]->key_lens);
+		free(bdm_list[i]->replica);
 		free(bdm_list[i]);
 	}
 
@@ -467,3 +764,747 @@ struct mdhim_brm_t *_bdel_records(struct mdhim_t *md, struct index_t *index,
 	//Return the head of the list
 	return brm_head;
 }
+
+/**
+ * Deletes the records between two keys from every range server of the index
+ *
+ * @param md             main MDHIM struct
+ * @param index          the index to delete the records from
+ * @param start_key      the first key to delete, NULL to start at the first key
+ * @param start_key_len  the length of the first key
+ * @param end_key        the last key to delete, NULL to go to the last key
+ * @param end_key_len    the length of the last key
+ * @return mdhim_brm_t * or NULL on error
+ */
+struct mdhim_brm_t *_del_range(struct mdhim_t *md, struct index_t *index,
+			       void *start_key, int start_key_len,
+			       void *end_key, int end_key_len) {
+	struct mdhim_bdelm_t **bdm_list;
+	struct mdhim_bdelm_t *bdm, *lbdm;
+	struct mdhim_brm_t *brm, *brm_head;
+	struct mdhim_rm_t *rm;
+	rangesrv_info *ri;
+	int i;
+
+	//Frozen indexes are read only until they are thawed
+	if (index->frozen) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Can't delete records from frozen index: %d", 
+		     md->mdhim_rank, index->id);
+		return NULL;
+	}
+
+	//Every range server may hold keys of the range
+	lbdm = NULL;
+	bdm_list = malloc(sizeof(struct mdhim_bdelm_t *) * index->num_rangesrvs);
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		bdm_list[i] = NULL;
+		if ((ri = index->rangesrvs_arr[i]) == NULL) {
+			continue;
+		}
+
+		bdm = malloc(sizeof(struct mdhim_bdelm_t));			       
+		bdm->keys = malloc(sizeof(void *) * 2);
+		bdm->key_lens = malloc(sizeof(int) * 2);
+		bdm->keys[0] = start_key;
+		bdm->key_lens[0] = start_key ? start_key_len : 0;
+		bdm->num_keys = 1;
+		if (end_key && end_key_len) {
+			bdm->keys[1] = end_key;
+			bdm->key_lens[1] = end_key_len;
+			bdm->num_keys = 2;
+		}
+
+		bdm->replica = NULL;
+		bdm->basem.server_rank = ri->rank;
+		bdm->basem.mtype = MDHIM_RANGE_DEL;
+		bdm->basem.index = index->id;
+		bdm->basem.index_type = index->type;
+		bdm->basem.routing_epoch = get_routing_epoch(index);
+		bdm->basem.forwarded = 0;
+		if (ri->rank != md->mdhim_rank) {
+			bdm_list[i] = bdm;
+		} else {
+			lbdm = bdm;
+		}
+	}
+
+	//Make a list out of the received messages to return
+	brm_head = client_bdelete(md, index, bdm_list);
+	if (lbdm) {
+		rm = local_client_bdelete(md, lbdm);
+		brm = malloc(sizeof(struct mdhim_brm_t));
+		brm->error = rm->error;
+		brm->basem.mtype = rm->basem.mtype;
+		brm->basem.index = rm->basem.index;
+		brm->basem.index_type = rm->basem.index_type;
+		brm->basem.server_rank = rm->basem.server_rank;
+		brm->next = brm_head;
+		brm_head = brm;
+		free(rm);	
+	}
+	
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!bdm_list[i]) {
+			continue;
+		}
+
+		free(bdm_list[i]->keys);
+		free(bdm_list[i]->key_lens);
+		free(bdm_list[i]);
+	}
+
+	free(bdm_list);
+
+	return brm_head;
+}
+
+/**
+ * _send_slice_records
+ * Bulk puts or deletes records of a migrating slice on the range server that will serve it
+ *
+ * @param md         main MDHIM struct
+ * @param index      the index the slice belongs to
+ * @param dest       the range server the slice is moving to
+ * @param mtype      MDHIM_BULK_PUT or MDHIM_BULK_DEL
+ * @param keys       the keys of the records
+ * @param key_lens   the lengths of the keys
+ * @param values     the values of the records, NULL for deletes
+ * @param value_lens the lengths of the values, NULL for deletes
+ * @param num_keys   the number of records
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+static int _send_slice_records(struct mdhim_t *md, struct index_t *index, rangesrv_info *dest, 
+			       int mtype, void **keys, int *key_lens, void **values, 
+			       int *value_lens, int num_keys) {
+	struct mdhim_bputm_t **bpm_list, *bpm;
+	struct mdhim_bdelm_t **bdm_list, *bdm;
+	struct mdhim_brm_t *brm, *brm_head;
+	int ret;
+
+	//The destination is never ourselves, so the message is packed and the arrays stay ours
+	if (mtype == MDHIM_BULK_PUT) {
+		bpm_list = malloc(sizeof(struct mdhim_bputm_t *) * index->num_rangesrvs);
+		memset(bpm_list, 0, sizeof(struct mdhim_bputm_t *) * index->num_rangesrvs);
+		bpm = malloc(sizeof(struct mdhim_bputm_t));
+		bpm->keys = keys;
+		bpm->key_lens = key_lens;
+		bpm->values = values;
+		bpm->value_lens = value_lens;
+		bpm->num_keys = num_keys;
+		bpm->append = MDHIM_DB_OVERWRITE;
+		bpm->replica = NULL;
+		bpm->basem.server_rank = dest->rank;
+		bpm->basem.mtype = MDHIM_BULK_PUT;
+		bpm->basem.index = index->id;
+		bpm->basem.index_type = index->type;
+		bpm->basem.routing_epoch = get_routing_epoch(index);
+		bpm->basem.forwarded = 0;
+		bpm_list[dest->rangesrv_num - 1] = bpm;
+		brm_head = client_bput(md, index, bpm_list);
+		free(bpm);
+		free(bpm_list);
+	} else {
+		bdm_list = malloc(sizeof(struct mdhim_bdelm_t *) * index->num_rangesrvs);
+		memset(bdm_list, 0, sizeof(struct mdhim_bdelm_t *) * index->num_rangesrvs);
+		bdm = malloc(sizeof(struct mdhim_bdelm_t));
+		bdm->keys = keys;
+		bdm->key_lens = key_lens;
+		bdm->num_keys = num_keys;
+		bdm->replica = NULL;
+		bdm->basem.server_rank = dest->rank;
+		bdm->basem.mtype = MDHIM_BULK_DEL;
+		bdm->basem.index = index->id;
+		bdm->basem.index_type = index->type;
+		bdm->basem.routing_epoch = get_routing_epoch(index);
+		bdm->basem.forwarded = 0;
+		bdm_list[dest->rangesrv_num - 1] = bdm;
+		brm_head = client_bdelete(md, index, bdm_list);
+		free(bdm);
+		free(bdm_list);
+	}
+
+	ret = brm_head ? MDHIM_SUCCESS : MDHIM_ERROR;
+	while (brm_head) {
+		if (brm_head->error != MDHIM_SUCCESS) {
+			ret = MDHIM_ERROR;
+		}
+
+		brm = brm_head->next;
+		free(brm_head);
+		brm_head = brm;
+	}
+
+	return ret;
+}
+
+/**
+ * _drop_slice_stat
+ * Removes the stat of a slice this range server doesn't serve anymore
+ *
+ * @param index      the index the slice belongs to
+ * @param slice      the slice to remove the stat of
+ */
+static void _drop_slice_stat(struct index_t *index, int slice) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	struct mdhim_stat *stat;
+
+	while (pthread_rwlock_wrlock(store->mdhim_store_stats_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	//Keys of the slice the workers counted go with it too
+	merge_stat_accs(index);
+	HASH_FIND_INT(store->mdhim_store_stats, &slice, stat);
+	if (stat) {
+		HASH_DEL(store->mdhim_store_stats, stat);
+		mark_stat_removed(index, slice);
+		free(stat->max);
+		free(stat->min);
+		free(stat);
+	}
+
+	pthread_rwlock_unlock(store->mdhim_store_stats_lock);
+	store->del(store->db_stats, &slice, sizeof(int));
+}
+
+/**
+ * _set_moving_slice
+ * Sets the slice this range server is migrating and forgets the keys written during its copy
+ *
+ * @param index      the index the slice belongs to
+ * @param slice      the moving slice, -1 once the migration is over
+ * @param moving_to  the range server serving the slice, 0 while this range server copies it
+ */
+static void _set_moving_slice(struct index_t *index, int slice, uint32_t moving_to) {
+	slice_key_t *sk, *tmp;
+
+	//Handlers check the moving slice under the routing lock
+	while (pthread_rwlock_wrlock(index->routing_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	index->moving_slice = slice;
+	index->moving_to = moving_to;
+	HASH_ITER(hh, index->moved_keys, sk, tmp) {
+		HASH_DEL(index->moved_keys, sk);
+		free(sk->key);
+		free(sk);
+	}
+
+	pthread_rwlock_unlock(index->routing_lock);
+}
+
+/**
+ * _sweep_slice
+ * Copies every record of a slice in our data store to another range server or, without 
+ * one, deletes them.  A cursor reads the records in key order from the start of the slice 
+ * and stops past its end when the key type orders the keys by slice, the records are 
+ * handled in batches
+ *
+ * @param md         main MDHIM struct
+ * @param index      the index the slice belongs to
+ * @param slice      the slice to sweep
+ * @param dest       the range server the slice is moving to, NULL to delete the slice
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+static int _sweep_slice(struct mdhim_t *md, struct index_t *index, int slice, 
+			rangesrv_info *dest) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	void **keys, **values;
+	int *key_lens, *value_lens;
+	void *key, *value, *cursor;
+	char start[MDHIM_SLICE_START_LEN];
+	int key_len, start_len;
+	int32_t value_len;
+	int num_keys, num_swept;
+	int slice_num, ordered, negative, num_runs, run, done, op;
+	int i, ret;
+
+	if (!store->cursor_open) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Migrating slices needs a data store with cursors", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	//Floats and doubles have a run of negative keys in each slice after the positive one
+	num_runs = index->key_type == MDHIM_FLOAT_KEY || index->key_type == MDHIM_DOUBLE_KEY ? 
+		2 : 1;
+	keys = malloc(sizeof(void *) * MDHIM_MIGRATE_BATCH);
+	key_lens = malloc(sizeof(int) * MDHIM_MIGRATE_BATCH);
+	values = malloc(sizeof(void *) * MDHIM_MIGRATE_BATCH);
+	value_lens = malloc(sizeof(int) * MDHIM_MIGRATE_BATCH);
+	num_keys = 0;
+	num_swept = 0;
+	ret = MDHIM_SUCCESS;
+	for (run = 0; ret == MDHIM_SUCCESS && run < num_runs; run++) {
+		if ((ret = store->cursor_open(store->db_handle, &cursor)) != MDHIM_SUCCESS) {
+			break;
+		}
+
+		//Key types not ordered by slice are read from the first key to the last
+		negative = run == 1;
+		ordered = get_slice_start(index, slice, negative, start, &start_len);
+		if (!ordered) {
+			start_len = 0;
+		}
+
+		//The cursor reads a snapshot, so the deletes don't move it
+		done = store->cursor_seek(cursor, start_len ? start : NULL, start_len, 
+					  MDHIM_GET_NEXT) != MDHIM_SUCCESS;
+		op = MDHIM_GET_EQ;
+		while (!done) {
+			if (store->cursor_get(cursor, op, &key, &key_len, 
+					      &value, &value_len) != MDHIM_SUCCESS) {
+				done = 1;
+			} else if (negative && (index->key_type == MDHIM_FLOAT_KEY ? 
+						*(float *) key >= 0 : *(double *) key >= 0)) {
+				//The positive keys were swept by the first run
+				free(key);
+				free(value);
+				done = 1;
+			} else if ((slice_num = get_slice_num(md, index, key, key_len)) != slice) {
+				//Past the end of the slice the slice numbers only move away from it
+				if (ordered && (negative ? slice_num < slice : slice_num > slice)) {
+					done = 1;
+				}
+
+				free(key);
+				free(value);
+			} else {
+				keys[num_keys] = key;
+				key_lens[num_keys] = key_len;
+				values[num_keys] = value;
+				value_lens[num_keys] = value_len;
+				num_keys++;
+			}
+
+			op = MDHIM_GET_NEXT;
+			if (!num_keys || (num_keys < MDHIM_MIGRATE_BATCH && !done)) {
+				continue;
+			}
+
+			if (dest) {
+				ret = _send_slice_records(md, index, dest, MDHIM_BULK_PUT, keys, 
+							  key_lens, values, value_lens, num_keys);
+			}
+
+			for (i = 0; i < num_keys; i++) {
+				if (ret == MDHIM_SUCCESS && !dest) {
+					store->del(store->db_handle, keys[i], key_lens[i]);
+				}
+
+				free(keys[i]);
+				free(values[i]);
+			}
+
+			num_swept += num_keys;
+			num_keys = 0;
+			if (ret != MDHIM_SUCCESS) {
+				done = 1;
+			}
+		}
+
+		store->cursor_close(cursor);
+	}
+
+	free(keys);
+	free(key_lens);
+	free(values);
+	free(value_lens);
+	if (ret != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error sweeping the records of slice: %d", 
+		     md->mdhim_rank, slice);
+		return ret;
+	}
+
+	if (dest) {
+		mlog(MDHIM_CLIENT_INFO, "MDHIM Rank: %d - Copied %d records of slice: %d to "
+		     "range server: %d", md->mdhim_rank, num_swept, slice, dest->rangesrv_num);
+	} else {
+		_drop_slice_stat(index, slice);
+		mlog(MDHIM_CLIENT_INFO, "MDHIM Rank: %d - Dropped %d records of slice: %d", 
+		     md->mdhim_rank, num_swept, slice);
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * _switch_slice
+ * Sends the records of a copied slice that were written during the copy to the range 
+ * server it is moving to, then forwards the slice to that range server.  No write of the 
+ * slice is applied here in the meantime, as the routing lock is held throughout
+ *
+ * @param md         main MDHIM struct
+ * @param index      the index the slice belongs to
+ * @param slice      the copied slice
+ * @param dest       the range server the slice is moving to
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+static int _switch_slice(struct mdhim_t *md, struct index_t *index, int slice, 
+			 rangesrv_info *dest) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	slice_key_t *sk, *tmp;
+	void **keys, **values, **del_keys;
+	int *key_lens, *value_lens, *del_key_lens;
+	void *value;
+	int32_t value_len;
+	int num_keys, num_del, num_sent;
+	int i, ret;
+
+	keys = malloc(sizeof(void *) * MDHIM_MIGRATE_BATCH);
+	key_lens = malloc(sizeof(int) * MDHIM_MIGRATE_BATCH);
+	values = malloc(sizeof(void *) * MDHIM_MIGRATE_BATCH);
+	value_lens = malloc(sizeof(int) * MDHIM_MIGRATE_BATCH);
+	del_keys = malloc(sizeof(void *) * MDHIM_MIGRATE_BATCH);
+	del_key_lens = malloc(sizeof(int) * MDHIM_MIGRATE_BATCH);
+	while (pthread_rwlock_wrlock(index->routing_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	//The handlers that write the moved keys are held off by the routing lock
+	ret = MDHIM_SUCCESS;
+	num_keys = num_del = num_sent = 0;
+	HASH_ITER(hh, index->moved_keys, sk, tmp) {
+		value = NULL;
+		value_len = 0;
+		if (store->get(store->db_handle, sk->key, sk->key_len, 
+			       &value, &value_len) == MDHIM_SUCCESS && value) {
+			keys[num_keys] = sk->key;
+			key_lens[num_keys] = sk->key_len;
+			values[num_keys] = value;
+			value_lens[num_keys] = value_len;
+			num_keys++;
+		} else {
+			//The key was deleted after it was copied
+			del_keys[num_del] = sk->key;
+			del_key_lens[num_del] = sk->key_len;
+			num_del++;
+		}
+
+		if (num_keys == MDHIM_MIGRATE_BATCH || (!sk->hh.next && num_keys)) {
+			if (_send_slice_records(md, index, dest, MDHIM_BULK_PUT, keys, key_lens, 
+						values, value_lens, num_keys) != MDHIM_SUCCESS) {
+				ret = MDHIM_ERROR;
+			}
+
+			for (i = 0; i < num_keys; i++) {
+				free(values[i]);
+			}
+
+			num_sent += num_keys;
+			num_keys = 0;
+		}
+
+		if (num_del == MDHIM_MIGRATE_BATCH || (!sk->hh.next && num_del)) {
+			if (_send_slice_records(md, index, dest, MDHIM_BULK_DEL, del_keys, 
+						del_key_lens, NULL, NULL, 
+						num_del) != MDHIM_SUCCESS) {
+				ret = MDHIM_ERROR;
+			}
+
+			num_sent += num_del;
+			num_del = 0;
+		}
+
+		if (ret != MDHIM_SUCCESS) {
+			break;
+		}
+	}
+
+	//From now on the slice's requests that reach us are forwarded to the destination
+	if (ret == MDHIM_SUCCESS) {
+		index->moving_to = dest->rangesrv_num;
+		_drop_slice_stat(index, slice);
+	}
+
+	pthread_rwlock_unlock(index->routing_lock);
+	free(keys);
+	free(key_lens);
+	free(values);
+	free(value_lens);
+	free(del_keys);
+	free(del_key_lens);
+	if (ret != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error sending the records written during the copy of slice: %d", 
+		     md->mdhim_rank, slice);
+		return ret;
+	}
+
+	mlog(MDHIM_CLIENT_INFO, "MDHIM Rank: %d - Sent %d records written during the copy of "
+	     "slice: %d", md->mdhim_rank, num_sent, slice);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * _migrate_slice
+ * Moves a slice to another range server and switches every rank's routing to it.
+ * Must be called by every rank, as the routing changes on all of them at once.
+ * The slice is copied while its range server keeps serving it, then the records written 
+ * during the copy are sent again and its range server forwards the slice's requests to 
+ * the new one until every rank routes the slice there.  Requests keep flowing meanwhile
+ *
+ * @param md           main MDHIM struct
+ * @param index        the index the slice belongs to
+ * @param slice        the slice to move
+ * @param rangesrv_num the range server number that will serve the slice
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int _migrate_slice(struct mdhim_t *md, struct index_t *index, int slice, 
+		   uint32_t rangesrv_num) {
+	rangesrv_info *src, *dest;
+	int ret, all_ret;
+
+	if (index->type == LOCAL_INDEX || index->partition_type == MDHIM_HASH_PARTITION) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Slices can only be migrated for range or splitter partitioned global indexes", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	if (index->frozen) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Slices of a frozen index can't be migrated", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	if (slice < 0 || slice >= MDHIM_MAX_SLICES || 
+	    rangesrv_num < 1 || rangesrv_num > index->num_rangesrvs) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Invalid slice: %d or range server: %u given to migrate", 
+		     md->mdhim_rank, slice, rangesrv_num);
+		return MDHIM_ERROR;
+	}
+
+	//Every rank has the same routing, so they all agree on whether there is work to do
+	src = get_range_server_by_slice(md, index, slice);
+	dest = index->rangesrvs_arr[rangesrv_num - 1];
+	if (!src || src == dest) {
+		return MDHIM_SUCCESS;
+	}
+
+	//The destination serves the records of the slice it gets, whatever their epoch
+	if (dest->rank == md->mdhim_rank) {
+		_set_moving_slice(index, slice, rangesrv_num);
+	}
+
+	//The source remembers the keys written while it copies the slice
+	ret = MDHIM_SUCCESS;
+	if (src->rank == md->mdhim_rank) {
+		_set_moving_slice(index, slice, 0);
+		ret = _sweep_slice(md, index, slice, dest);
+	}
+
+	//The source only switches the slice once the destination serves it
+	if (MPI_Allreduce(&ret, &all_ret, 1, MPI_INT, MPI_MIN, 
+			  md->mdhim_client_comm) != MPI_SUCCESS) {
+		all_ret = MDHIM_ERROR;
+	}
+
+	if (all_ret == MDHIM_SUCCESS && src->rank == md->mdhim_rank) {
+		ret = _switch_slice(md, index, slice, dest);
+	}
+
+	if (all_ret == MDHIM_SUCCESS && 
+	    MPI_Allreduce(&ret, &all_ret, 1, MPI_INT, MPI_MIN, 
+			  md->mdhim_client_comm) != MPI_SUCCESS) {
+		all_ret = MDHIM_ERROR;
+	}
+
+	//The source never switched the slice, so the copy is dropped
+	if (all_ret != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error migrating slice: %d, keeping the current routing", 
+		     md->mdhim_rank, slice);
+		if (src->rank == md->mdhim_rank || dest->rank == md->mdhim_rank) {
+			_set_moving_slice(index, -1, 0);
+		}
+
+		if (dest->rank == md->mdhim_rank) {
+			_sweep_slice(md, index, slice, NULL);
+		}
+
+		return MDHIM_ERROR;
+	}
+
+	//Every rank routes the slice to the destination, the source forwards what's in flight
+	while (pthread_rwlock_wrlock(index->routing_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	set_slice_owner(index, slice, rangesrv_num);
+	__atomic_add_fetch(&index->routing_epoch, 1, __ATOMIC_RELEASE);
+	index->moving_slice = -1;
+	index->moving_to = 0;
+	pthread_rwlock_unlock(index->routing_lock);
+	if (src->rank == md->mdhim_rank) {
+		_set_moving_slice(index, -1, 0);
+		if (_sweep_slice(md, index, slice, NULL) != MDHIM_SUCCESS) {
+			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+			     "Error dropping the records of migrated slice: %d", 
+			     md->mdhim_rank, slice);
+		}
+	}
+
+	//The replicas of hot keys follow the owner, so they are picked again on the next replication
+	hot_keys_clear(index);
+
+	//Persist the new routing
+	if (index->myinfo.rangesrv_num == 1) {
+		write_manifest(md, index);
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * _rebalance_index
+ * Uses the per slice load counters of the range servers to move the hottest slice
+ * of the busiest range server to the least busy one, if that lowers the busiest load.
+ * The load counters are reset, so each call looks at the load since the last one.
+ * Must be called by every rank
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to rebalance
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int _rebalance_index(struct mdhim_t *md, struct index_t *index) {
+	struct mdhim_stat *stat, *tmp;
+	uint64_t load[3], *all_loads;
+	uint64_t *hot, *cold, *cur;
+	uint32_t cold_num;
+	int i;
+
+	if (index->type == LOCAL_INDEX || index->partition_type == MDHIM_HASH_PARTITION) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Only range or splitter partitioned global indexes can be rebalanced", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	//Find our total load and our hottest slice: {total load, hottest slice, slice load}
+	memset(load, 0, sizeof(load));
+	if (im_range_server(index) && index->mdhim_store) {
+		while (pthread_rwlock_wrlock(index->mdhim_store->mdhim_store_stats_lock) == EBUSY) {
+			usleep(10);
+		}
+
+		//Slices the workers put keys in since the last merge get their stats
+		merge_stat_accs(index);
+		HASH_ITER(hh, index->mdhim_store->mdhim_store_stats, stat, tmp) {
+			load[0] += stat->load;
+			if (stat->load > load[2]) {
+				load[1] = stat->key;
+				load[2] = stat->load;
+			}
+
+			stat->load = 0;
+		}
+
+		pthread_rwlock_unlock(index->mdhim_store->mdhim_store_stats_lock);
+	}
+
+	all_loads = malloc(sizeof(uint64_t) * 3 * md->mdhim_comm_size);
+	if (MPI_Allgather(load, 3, MPI_UINT64_T, all_loads, 3, MPI_UINT64_T, 
+			  md->mdhim_client_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error while gathering the slice loads", 
+		     md->mdhim_rank);
+		free(all_loads);
+		return MDHIM_ERROR;
+	}
+
+	//Find the busiest and the least busy range servers
+	hot = cold = NULL;
+	cold_num = 0;
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		cur = &all_loads[index->rangesrvs_arr[i]->rank * 3];
+		if (!hot || cur[0] > hot[0]) {
+			hot = cur;
+		}
+		if (!cold || cur[0] < cold[0]) {
+			cold = cur;
+			cold_num = i + 1;
+		}
+	}
+
+	//Moving the hottest slice only helps if its new home ends up less busy than its old one
+	if (!hot || hot == cold || !hot[2] || cold[0] + hot[2] >= hot[0]) {
+		free(all_loads);
+		return MDHIM_SUCCESS;
+	}
+
+	i = hot[1];
+	free(all_loads);
+
+	return _migrate_slice(md, index, i, cold_num);
+}
+
+/**
+ * _init_topology
+ * Finds the node each rank runs on by splitting mdhim_comm into shared memory domains
+ * Nodes are numbered in the order of the lowest rank running on them
+ * The communicator of this rank's node is kept in mdhim_node_comm
+ *
+ * @param md      main MDHIM struct
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int _init_topology(struct mdhim_t *md) {
+	int info[2];
+	int *all_info;
+	int i;
+
+	if (MPI_Comm_split_type(md->mdhim_comm, MPI_COMM_TYPE_SHARED, md->mdhim_rank, 
+				MPI_INFO_NULL, &md->mdhim_node_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while splitting the communicator by node", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	//Each rank contributes the lowest rank on its node and its rank within the node
+	MPI_Comm_rank(md->mdhim_node_comm, &info[1]);
+	if (MPI_Allreduce(&md->mdhim_rank, &info[0], 1, MPI_INT, MPI_MIN, 
+			  md->mdhim_node_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while finding the lowest rank on this node", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	all_info = malloc(sizeof(int) * 2 * md->mdhim_comm_size);
+	if (MPI_Allgather(info, 2, MPI_INT, all_info, 2, MPI_INT, 
+			  md->mdhim_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - " 
+		     "Error while gathering the node topology", 
+		     md->mdhim_rank);
+		free(all_info);
+		return MDHIM_ERROR;
+	}
+
+	md->rank_nodes = malloc(sizeof(int) * md->mdhim_comm_size);
+	md->rank_node_ranks = malloc(sizeof(int) * md->mdhim_comm_size);
+	md->node_sizes = malloc(sizeof(int) * md->mdhim_comm_size);
+	memset(md->node_sizes, 0, sizeof(int) * md->mdhim_comm_size);
+	md->num_nodes = 0;
+	for (i = 0; i < md->mdhim_comm_size; i++) {
+		//The lowest rank of a node is always seen before the node's other ranks
+		if (all_info[i * 2] == i) {
+			md->rank_nodes[i] = md->num_nodes++;
+		} else {
+			md->rank_nodes[i] = md->rank_nodes[all_info[i * 2]];
+		}
+
+		md->rank_node_ranks[i] = all_info[i * 2 + 1];
+		md->node_sizes[md->rank_nodes[i]]++;
+	}
+
+	free(all_info);
+
+	return MDHIM_SUCCESS;
+}
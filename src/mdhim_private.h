@@ -1,16 +1,27 @@
 #include "mdhim.h"
 
+//The number of records sent per message when migrating a slice
+#define MDHIM_MIGRATE_BATCH 1024
+
 struct mdhim_rm_t *_put_record(struct mdhim_t *md, struct index_t *index, 
 			       void *key, int key_len, 
-			       void *value, int value_len);
+			       void *value, int value_len, int append);
 struct mdhim_brm_t *_create_brm(struct mdhim_rm_t *rm);
 void _concat_brm(struct mdhim_brm_t *head, struct mdhim_brm_t *addition);
 struct mdhim_brm_t *_bput_records(struct mdhim_t *md, struct index_t *index, 
 				  void **keys, int *key_lens, 
-				  void **values, int *value_lens, int num_records);
+				  void **values, int *value_lens, int num_records, 
+				  int append);
 struct mdhim_bgetrm_t *_bget_records(struct mdhim_t *md, struct index_t *index,
 				     void **keys, int *key_lens, 
 				     int num_keys, int num_records, int op);
 struct mdhim_brm_t *_bdel_records(struct mdhim_t *md, struct index_t *index,
 				  void **keys, int *key_lens,
 				  int num_records);
+struct mdhim_brm_t *_del_range(struct mdhim_t *md, struct index_t *index,
+			       void *start_key, int start_key_len,
+			       void *end_key, int end_key_len);
+int _migrate_slice(struct mdhim_t *md, struct index_t *index, int slice, 
+		   uint32_t rangesrv_num);
+int _rebalance_index(struct mdhim_t *md, struct index_t *index);
+int _init_topology(struct mdhim_t *md);
@@ -60,6 +60,7 @@ int send_rangesrv_work(struct mdhim_t *md, int dest, void *message) {
 					       &sendsize);
 		break;
 	case MDHIM_BULK_DEL:
+	case MDHIM_RANGE_DEL:
 		return_code = pack_bdel_message(md, (struct mdhim_bdelm_t *)message, &sendbuf, 
 						&sendsize);
 		break;
@@ -81,6 +82,12 @@ int send_rangesrv_work(struct mdhim_t *md, int dest, void *message) {
 		return MDHIM_ERROR;
 	}
 
+	//Range servers on this node get the message through shared memory if it fits
+	if (shm_send(md, dest, MDHIM_SHM_REQUEST, sendbuf, sendsize) == MDHIM_SUCCESS) {
+		free(sendbuf);
+		return MDHIM_SUCCESS;
+	}
+
 	req = malloc(sizeof(MPI_Request));
 	//Send the size of the message
 	pthread_mutex_lock(md->mdhim_comm_lock);
@@ -171,6 +178,7 @@ int send_all_rangesrv_work(struct mdhim_t *md, void **messages, int num_srvs) {
 							&sendsize);
 			break;
 		case MDHIM_BULK_DEL:
+		case MDHIM_RANGE_DEL:
 			return_code = pack_bdel_message(md, (struct mdhim_bdelm_t *)mesg, &sendbuf, 
 							&sendsize);
 			break;
@@ -184,6 +192,12 @@ int send_all_rangesrv_work(struct mdhim_t *md, void **messages, int num_srvs) {
 			ret = MDHIM_ERROR;
                         continue;
 		}
+
+		//Range servers on this node get the message through shared memory if it fits
+		if (shm_send(md, dest, MDHIM_SHM_REQUEST, sendbuf, sendsize) == MDHIM_SUCCESS) {
+			free(sendbuf);
+			continue;
+		}
 				
 		sendbufs[num_msgs] = sendbuf;
 		sizes[num_msgs] = sendsize;
@@ -277,9 +291,83 @@ int send_all_rangesrv_work(struct mdhim_t *md, void **messages, int num_srvs) {
 	return ret;
 }
 
+/**
+ * unpack_work_message
+ * Unpacks a work message received by a range server
+ *
+ * @param md       in   main MDHIM struct
+ * @param recvbuf  in   the packed message
+ * @param recvsize in   the length of the packed message
+ * @param message  out  double pointer for the unpacked message
+ * @return MDHIM_SUCCESS, MDHIM_CLOSE, MDHIM_COMMIT, or MDHIM_ERROR on error
+ */
+static int unpack_work_message(struct mdhim_t *md, void *recvbuf, int recvsize, 
+			       void **message) {
+	int return_code = MPI_SUCCESS;
+	int msg_size;
+	int mtype;
+	struct mdhim_basem_t *bm;
+	int mesg_idx = 0;
+	int ret = MDHIM_SUCCESS;
+
+	*message = NULL;
+	//Unpack buffer to get the message type
+	bm = malloc(sizeof(struct mdhim_basem_t));
+	return_code = MPI_Unpack(recvbuf, recvsize, &mesg_idx, bm, 
+				 sizeof(struct mdhim_basem_t), MPI_CHAR, 
+				 md->mdhim_comm);
+	mtype = bm->mtype;
+	msg_size = bm->size;
+	free(bm);
+        
+        // Checks for valid message, if error inform and ignore message
+        if (msg_size==0 || mtype<MDHIM_PUT || mtype>MDHIM_COMMIT) {
+            mlog(MDHIM_SERVER_CRIT, "Rank: %d - Got empty/invalid message in receive_rangesrv_work.", 
+		     md->mdhim_rank);
+            return MDHIM_ERROR;
+        }
+
+	switch(mtype) {
+	case MDHIM_PUT:
+		return_code = unpack_put_message(md, recvbuf, msg_size, message);
+		break;
+	case MDHIM_BULK_PUT:
+		return_code = unpack_bput_message(md, recvbuf, msg_size, message);
+		break;
+	case MDHIM_BULK_GET:
+		return_code = unpack_bget_message(md, recvbuf, msg_size, message);
+		break;
+	case MDHIM_DEL:
+		return_code = unpack_del_message(md, recvbuf, msg_size, message);
+		break;
+	case MDHIM_BULK_DEL:
+	case MDHIM_RANGE_DEL:
+		return_code = unpack_bdel_message(md, recvbuf, msg_size, message);			
+		break;
+	case MDHIM_COMMIT:
+		ret = MDHIM_COMMIT;
+		break;
+	case MDHIM_CLOSE:
+		ret = MDHIM_CLOSE;
+		break;
+	default:
+		break;
+	}
+
+	if (return_code != MPI_SUCCESS) {
+		mlog(MPI_CRIT, "Rank: %d - " 
+		     "Error unpacking message in receive_rangesrv_work", 
+		     md->mdhim_rank);
+		ret = MDHIM_ERROR;
+	}
+
+	return ret;
+}
+
 /**
  * receive_rangesrv_work message
  * Receives a message from the given source
+ * Work from ranks on this node is taken from the shared memory rings while waiting on MPI
  *
  * @param md      in   main MDHIM struct
  * @param message out  double pointer for message received
@@ -289,13 +377,8 @@ int send_all_rangesrv_work(struct mdhim_t *md, void **messages, int num_srvs) {
 int receive_rangesrv_work(struct mdhim_t *md, int *src, void **message) {
 	MPI_Status status;
 	int return_code;
-	int msg_size;
-	int msg_source;
 	void *recvbuf;
 	int recvsize;
-	int mtype;
-	struct mdhim_basem_t *bm;
-	int mesg_idx = 0;
 	MPI_Request *req;
 	int flag = 0;
 	int ret = MDHIM_SUCCESS;
@@ -303,36 +386,57 @@ int receive_rangesrv_work(struct mdhim_t *md, int *src, void **message) {
 	// Receive a message from any client
 	flag = 0;
 
-	req = malloc(sizeof(MPI_Request));
-	pthread_mutex_lock(md->mdhim_comm_lock);	
-	return_code = MPI_Irecv(&recvsize,1, MPI_INT, MPI_ANY_SOURCE, RANGESRV_WORK_SIZE_MSG, 
-			       md->mdhim_comm, req);
-	pthread_mutex_unlock(md->mdhim_comm_lock);
+	//The size receive stays posted if the last call got its work from shared memory
+	if (!md->mdhim_rs->work_size_req) {
+		req = malloc(sizeof(MPI_Request));
+		pthread_mutex_lock(md->mdhim_comm_lock);	
+		return_code = MPI_Irecv(&md->mdhim_rs->work_size, 1, MPI_INT, MPI_ANY_SOURCE, 
+					RANGESRV_WORK_SIZE_MSG, md->mdhim_comm, req);
+		pthread_mutex_unlock(md->mdhim_comm_lock);
 
-	// If the receive did not succeed then return the error code back
-	if ( return_code != MPI_SUCCESS ) {
-             	mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - Error: %d "
-                     "receive size message failed.", md->mdhim_rank, return_code);
-		free(req);
-		return MDHIM_ERROR;
+		// If the receive did not succeed then return the error code back
+		if ( return_code != MPI_SUCCESS ) {
+			mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - Error: %d "
+			     "receive size message failed.", md->mdhim_rank, return_code);
+			free(req);
+			return MDHIM_ERROR;
+		}
+
+		md->mdhim_rs->work_size_req = req;
 	}
 
+	req = md->mdhim_rs->work_size_req;
 	while (!flag) {
 		if (md->shutdown) {
 			free(req);
+			md->mdhim_rs->work_size_req = NULL;
 			return MDHIM_ERROR;
 		}
 		
 		pthread_mutex_lock(md->mdhim_comm_lock);
 		return_code = MPI_Test(req, &flag, &status);
 		pthread_mutex_unlock(md->mdhim_comm_lock);
+		if (flag) {
+			break;
+		}
+
+		//Work from a rank on this node is unpacked straight out of its ring
+		if (shm_recv(md, -1, MDHIM_SHM_REQUEST, src, &recvbuf, &recvsize)) {
+			ret = unpack_work_message(md, recvbuf, recvsize, message);
+			shm_recv_done(md, *src, MDHIM_SHM_REQUEST);
+			return ret;
+		}
+
 		usleep(100);
 	}
+
+	md->mdhim_rs->work_size_req = NULL;
 	if (return_code == MPI_ERR_IN_STATUS) {
 		mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - Received an error status: %d "
                      " while receiving work message size", md->mdhim_rank, status.MPI_ERROR);		
 	}
 
+	recvsize = md->mdhim_rs->work_size;
 	recvbuf = (void *) malloc(recvsize);	
 	memset(recvbuf, 0, recvsize);
 	flag = 0;
@@ -370,59 +474,8 @@ int receive_rangesrv_work(struct mdhim_t *md, int *src, void **message) {
 		return MDHIM_ERROR;
 	}
 
-	msg_source = status.MPI_SOURCE;
-	*src = msg_source;
-	*message = NULL;
-	//Unpack buffer to get the message type
-	bm = malloc(sizeof(struct mdhim_basem_t));
-	return_code = MPI_Unpack(recvbuf, recvsize, &mesg_idx, bm, 
-				 sizeof(struct mdhim_basem_t), MPI_CHAR, 
-				 md->mdhim_comm);
-	mtype = bm->mtype;
-	msg_size = bm->size;
-	free(bm);
-        
-        // Checks for valid message, if error inform and ignore message
-        if (msg_size==0 || mtype<MDHIM_PUT || mtype>MDHIM_COMMIT) {
-            mlog(MDHIM_SERVER_CRIT, "Rank: %d - Got empty/invalid message in receive_rangesrv_work.", 
-		     md->mdhim_rank);
-            free(recvbuf);
-            return MDHIM_ERROR;
-        }
-
-	switch(mtype) {
-	case MDHIM_PUT:
-		return_code = unpack_put_message(md, recvbuf, msg_size, message);
-		break;
-	case MDHIM_BULK_PUT:
-		return_code = unpack_bput_message(md, recvbuf, msg_size, message);
-		break;
-	case MDHIM_BULK_GET:
-		return_code = unpack_bget_message(md, recvbuf, msg_size, message);
-		break;
-	case MDHIM_DEL:
-		return_code = unpack_del_message(md, recvbuf, msg_size, message);
-		break;
-	case MDHIM_BULK_DEL:
-		return_code = unpack_bdel_message(md, recvbuf, msg_size, message);			
-		break;
-	case MDHIM_COMMIT:
-		ret = MDHIM_COMMIT;
-		break;
-	case MDHIM_CLOSE:
-		ret = MDHIM_CLOSE;
-		break;
-	default:
-		break;
-	}
-
-	if (return_code != MPI_SUCCESS) {
-		mlog(MPI_CRIT, "Rank: %d - " 
-		     "Error unpacking message in receive_rangesrv_work", 
-		     md->mdhim_rank);
-		ret = MDHIM_ERROR;
-	}
-
+	*src = status.MPI_SOURCE;
+	ret = unpack_work_message(md, recvbuf, recvsize, message);
 	free(recvbuf);
 
 	return ret;
@@ -443,6 +496,7 @@ int send_client_response(struct mdhim_t *md, int dest, void *message, int *sizeb
 	int return_code = 0;
 	int mtype;
 	int ret = MDHIM_SUCCESS;
+	int size_tag = CLIENT_RESPONSE_SIZE_MSG, msg_tag = CLIENT_RESPONSE_MSG;
 
 	*size_req = NULL;
 	*msg_req = NULL;
@@ -468,11 +522,28 @@ int send_client_response(struct mdhim_t *md, int dest, void *message, int *sizeb
 		ret = MDHIM_ERROR;
 	}
 
+	//Forwarded messages are answered on their own tags, apart from the clients of the rank
+	if (((struct mdhim_basem_t *) message)->forwarded) {
+		size_tag = FORWARD_RESPONSE_SIZE_MSG;
+		msg_tag = FORWARD_RESPONSE_MSG;
+	} else if (is_shm_peer(md, dest)) {
+		//Clients on this node wait on their shared memory ring for the response
+		if (ret == MDHIM_SUCCESS && 
+		    shm_send(md, dest, MDHIM_SHM_RESPONSE, *sendbuf, *sizebuf) == MDHIM_SUCCESS) {
+			free(*sendbuf);
+			*sendbuf = NULL;
+			return ret;
+		}
+
+		//The response doesn't fit, tell the client to receive it over MPI
+		shm_send(md, dest, MDHIM_SHM_RESPONSE, NULL, 0);
+	}
+
 	//Send the size message
 	*size_req = malloc(sizeof(MPI_Request));
 
 	pthread_mutex_lock(md->mdhim_comm_lock);
-	return_code = MPI_Isend(sizebuf, 1, MPI_INT, dest, CLIENT_RESPONSE_SIZE_MSG, 
+	return_code = MPI_Isend(sizebuf, 1, MPI_INT, dest, size_tag, 
 				md->mdhim_comm, *size_req);
 	pthread_mutex_unlock(md->mdhim_comm_lock);
 
@@ -489,7 +560,7 @@ int send_client_response(struct mdhim_t *md, int dest, void *message, int *sizeb
 	//Send the actual message
 
 	pthread_mutex_lock(md->mdhim_comm_lock);
-	return_code = MPI_Isend(*sendbuf, *sizebuf, MPI_PACKED, dest, CLIENT_RESPONSE_MSG, 
+	return_code = MPI_Isend(*sendbuf, *sizebuf, MPI_PACKED, dest, msg_tag, 
 				md->mdhim_comm, *msg_req);
 	pthread_mutex_unlock(md->mdhim_comm_lock);
 
@@ -507,26 +578,99 @@ int send_client_response(struct mdhim_t *md, int dest, void *message, int *sizeb
 
 
 /**
- * receive_client_response message
- * Receives a message from the given source
+ * unpack_response_message
+ * Unpacks a response message received by a client
+ *
+ * @param md       in   main MDHIM struct
+ * @param recvbuf  in   the packed message
+ * @param recvsize in   the length of the packed message
+ * @param message  out  double pointer for the unpacked message
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+static int unpack_response_message(struct mdhim_t *md, void *recvbuf, int recvsize, 
+				   void **message) {
+	int return_code = MDHIM_ERROR;
+	int msg_size;
+	int mtype;
+	int mesg_idx = 0;
+	struct mdhim_basem_t *bm;
+
+	*message = NULL;
+	bm = malloc(sizeof(struct mdhim_basem_t));
+	//Unpack buffer to get the message type
+	MPI_Unpack(recvbuf, recvsize, &mesg_idx, bm, 
+		   sizeof(struct mdhim_basem_t), MPI_CHAR, 
+		   md->mdhim_comm);
+	mtype = bm->mtype;
+	msg_size = bm->size;
+	free(bm);
+	switch(mtype) {
+	case MDHIM_RECV:
+		return_code = unpack_return_message(md, recvbuf, message);
+		break;
+	case MDHIM_RECV_BULK_GET:
+		return_code = unpack_bgetrm_message(md, recvbuf, msg_size, message);
+		break;
+	default:
+		break;
+	}
+
+	if (return_code != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to unpack "
+                     "the message while receiving from client.", md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * receive_shm_response
+ * Receives a response from a range server on this node through its shared memory ring
  *
  * @param md      in   main MDHIM struct
  * @param src     in   source to receive from 
  * @param message out  double pointer for message received
+ * @param ret     out  MDHIM_SUCCESS or MDHIM_ERROR if the response couldn't be unpacked
+ * @return 1 if the response was received, 0 if it has to be received over MPI
+ */
+static int receive_shm_response(struct mdhim_t *md, int src, void **message, int *ret) {
+	void *recvbuf;
+	int recvsize;
+
+	shm_wait_recv(md, src, MDHIM_SHM_RESPONSE, &recvbuf, &recvsize);
+	if (!recvsize) {
+		shm_recv_done(md, src, MDHIM_SHM_RESPONSE);
+		return 0;
+	}
+
+	*ret = unpack_response_message(md, recvbuf, recvsize, message);
+	shm_recv_done(md, src, MDHIM_SHM_RESPONSE);
+
+	return 1;
+}
+
+/**
+ * receive_mpi_response
+ * Receives a response from the given source over MPI
+ *
+ * @param md       in   main MDHIM struct
+ * @param src      in   source to receive from 
+ * @param size_tag in   the tag of the response's size
+ * @param msg_tag  in   the tag of the response
+ * @param message  out  double pointer for message received
  * @return MDHIM_SUCCESS or MDHIM_ERROR on error
  */
-int receive_client_response(struct mdhim_t *md, int src, void **message) {
+static int receive_mpi_response(struct mdhim_t *md, int src, int size_tag, int msg_tag, 
+				void **message) {
 	int return_code;
 	int msg_size;
-	int mtype;
-	int mesg_idx = 0;
 	void *recvbuf;
-	struct mdhim_basem_t *bm;
 	MPI_Request *req;
 
 	req = malloc(sizeof(MPI_Request));
 	pthread_mutex_lock(md->mdhim_comm_lock);
-	return_code = MPI_Irecv(&msg_size, 1, MPI_INT, src, CLIENT_RESPONSE_SIZE_MSG, 
+	return_code = MPI_Irecv(&msg_size, 1, MPI_INT, src, size_tag, 
 			       md->mdhim_comm, req);
 	pthread_mutex_unlock(md->mdhim_comm_lock);
 	test_req_and_wait(md, req);
@@ -544,7 +688,7 @@ int receive_client_response(struct mdhim_t *md, int src, void **message) {
 	memset(recvbuf, 0, msg_size);
 
 	pthread_mutex_lock(md->mdhim_comm_lock);
-	return_code = MPI_Irecv(recvbuf, msg_size, MPI_PACKED, src, CLIENT_RESPONSE_MSG, 
+	return_code = MPI_Irecv(recvbuf, msg_size, MPI_PACKED, src, msg_tag, 
 			       md->mdhim_comm, req);
 	pthread_mutex_unlock(md->mdhim_comm_lock);
 	test_req_and_wait(md, req);
@@ -559,29 +703,8 @@ int receive_client_response(struct mdhim_t *md, int src, void **message) {
 	}
 
 	//Received the message
-	*message = NULL;
-	bm = malloc(sizeof(struct mdhim_basem_t));
-	//Unpack buffer to get the message type
-	return_code = MPI_Unpack(recvbuf, msg_size, &mesg_idx, bm, 
-				 sizeof(struct mdhim_basem_t), MPI_CHAR, 
-				 md->mdhim_comm);
-	mtype = bm->mtype;
-	msg_size = bm->size;
-	free(bm);
-	switch(mtype) {
-	case MDHIM_RECV:
-		return_code = unpack_return_message(md, recvbuf, message);
-		break;
-	case MDHIM_RECV_BULK_GET:
-		return_code = unpack_bgetrm_message(md, recvbuf, msg_size, message);
-		break;
-	default:
-		break;
-	}
-
+	return_code = unpack_response_message(md, recvbuf, msg_size, message);
 	if (return_code != MDHIM_SUCCESS) {
-		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to unpack "
-                     "the message while receiving from client.", md->mdhim_rank);
 		return MDHIM_ERROR;
 	}
 
@@ -591,8 +714,43 @@ int receive_client_response(struct mdhim_t *md, int src, void **message) {
 }
 
 /**
- * receive_all_client_responses
- * Receives messages from multiple sources sources
+ * receive_client_response message
+ * Receives a message from the given source
+ *
+ * @param md      in   main MDHIM struct
+ * @param src     in   source to receive from 
+ * @param message out  double pointer for message received
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int receive_client_response(struct mdhim_t *md, int src, void **message) {
+	int return_code;
+
+	//Range servers on this node respond through shared memory
+	if (is_shm_peer(md, src) && receive_shm_response(md, src, message, &return_code)) {
+		return return_code;
+	}
+
+	return receive_mpi_response(md, src, CLIENT_RESPONSE_SIZE_MSG, CLIENT_RESPONSE_MSG, 
+				    message);
+}
+
+/**
+ * receive_forward_response
+ * Receives the response to a message this range server forwarded to the given source
+ *
+ * @param md      in   main MDHIM struct
+ * @param src     in   source to receive from 
+ * @param message out  double pointer for message received
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int receive_forward_response(struct mdhim_t *md, int src, void **message) {
+	return receive_mpi_response(md, src, FORWARD_RESPONSE_SIZE_MSG, FORWARD_RESPONSE_MSG, 
+				    message);
+}
+
+/**
+ * receive_all_mpi_responses
+ * Receives messages from multiple sources sources over MPI
  *
  * @param md            in  main MDHIM struct
  * @param srcs          in  sources to receive from 
@@ -600,8 +758,8 @@ int receive_client_response(struct mdhim_t *md, int src, void **message) {
  * @param messages out  array of messages to receive
  * @return MDHIM_SUCCESS or MDHIM_ERROR on error
  */
-int receive_all_client_responses(struct mdhim_t *md, int *srcs, int nsrcs, 
-				 void ***messages) {
+static int receive_all_mpi_responses(struct mdhim_t *md, int *srcs, int nsrcs, 
+				     void ***messages) {
 	MPI_Status status;
 	int return_code;
 	int mtype;
@@ -767,6 +925,69 @@ int receive_all_client_responses(struct mdhim_t *md, int *srcs, int nsrcs,
 	return ret;
 }
 
+/**
+ * receive_all_client_responses
+ * Receives messages from multiple sources sources
+ * Range servers on this node respond through shared memory, the others over MPI
+ *
+ * @param md            in  main MDHIM struct
+ * @param srcs          in  sources to receive from 
+ * @param nsrcs         in  number of sources to receive from 
+ * @param messages out  array of messages to receive
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int receive_all_client_responses(struct mdhim_t *md, int *srcs, int nsrcs, 
+				 void ***messages) {
+	int *mpi_srcs, *mpi_idx;
+	void **mpi_msgs;
+	int num_mpi;
+	int i, ret, shm_ret;
+
+	if (!md->shm) {
+		return receive_all_mpi_responses(md, srcs, nsrcs, messages);
+	}
+
+	ret = MDHIM_SUCCESS;
+	num_mpi = 0;
+	mpi_srcs = malloc(sizeof(int) * nsrcs);
+	mpi_idx = malloc(sizeof(int) * nsrcs);
+	for (i = 0; i < nsrcs; i++) {
+		*(*messages + i) = NULL;
+		shm_ret = MDHIM_SUCCESS;
+		if (is_shm_peer(md, srcs[i]) && 
+		    receive_shm_response(md, srcs[i], (*messages + i), &shm_ret)) {
+			if (shm_ret != MDHIM_SUCCESS) {
+				ret = MDHIM_ERROR;
+			}
+
+			continue;
+		}
+
+		mpi_srcs[num_mpi] = srcs[i];
+		mpi_idx[num_mpi] = i;
+		num_mpi++;
+	}
+
+	//Receive the rest over MPI and put them back in the order of the sources
+	if (num_mpi) {
+		mpi_msgs = malloc(sizeof(void *) * num_mpi);
+		if (receive_all_mpi_responses(md, mpi_srcs, num_mpi, &mpi_msgs) != MDHIM_SUCCESS) {
+			ret = MDHIM_ERROR;
+		}
+
+		for (i = 0; i < num_mpi; i++) {
+			*(*messages + mpi_idx[i]) = mpi_msgs[i];
+		}
+
+		free(mpi_msgs);
+	}
+
+	free(mpi_srcs);
+	free(mpi_idx);
+
+	return ret;
+}
+
 ///------------------------
 
 /**
@@ -867,6 +1088,10 @@ int pack_bput_message(struct mdhim_t *md, struct mdhim_bputm_t *bpm, void **send
         // For the each of the keys and data add enough chars.
         for (i=0; i < bpm->num_keys; i++)
                 m_size += bpm->key_lens[i] + bpm->value_lens[i];
+
+        // The replica flags follow the records if there are any
+        if (bpm->replica)
+                m_size += bpm->num_keys * sizeof(int);
         
         // Is the computed message size of a safe value? (less than a max message size?)
         if (m_size > MDHIM_MAX_MSG_SIZE) {
@@ -900,6 +1125,11 @@ int pack_bput_message(struct mdhim_t *md, struct mdhim_bputm_t *bpm, void **send
 					*sendbuf, mesg_size, &mesg_idx, md->mdhim_comm);
         }
 
+        if (bpm->replica) {
+                return_code += MPI_Pack(bpm->replica, bpm->num_keys, MPI_INT, 
+					*sendbuf, mesg_size, &mesg_idx, md->mdhim_comm);
+        }
+
 	// If the pack did not succeed then log the error and return the error code
 	if ( return_code != MPI_SUCCESS ) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to pack "
@@ -1087,6 +1317,20 @@ int unpack_bput_message(struct mdhim_t *md, void *message, int mesg_size, void *
 					  MPI_CHAR, md->mdhim_comm);
         }
 
+	// The sender's pointer to the replica flags only says whether they follow the records
+	if ((*((struct mdhim_bputm_t **) bput))->replica) {
+		if (((*((struct mdhim_bputm_t **) bput))->replica = 
+		     malloc(num_records * sizeof(int))) == NULL) {
+			mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - Error: unable to allocate "
+			     "memory to unpack bput message.", md->mdhim_rank);
+			return MDHIM_ERROR; 
+		}
+
+		return_code += MPI_Unpack(message, mesg_size, &mesg_idx, 
+					  (*((struct mdhim_bputm_t **) bput))->replica, 
+					  num_records, MPI_INT, md->mdhim_comm);
+	}
+
 	// If the unpack did not succeed then log the error and return the error code
 	if ( return_code != MPI_SUCCESS ) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to unpack "
@@ -1193,6 +1437,10 @@ int pack_bget_message(struct mdhim_t *md, struct mdhim_bgetm_t *bgm, void **send
         // For the each of the keys add the size to the length
         for (i=0; i < bgm->num_keys; i++)
                 m_size += bgm->key_lens[i];
+
+        // The replica flags follow the keys if there are any
+        if (bgm->replica)
+                m_size += bgm->num_keys * sizeof(int);
         
         // Is the computed message size of a safe value? (less than a max message size?)
         if (m_size > MDHIM_MAX_MSG_SIZE) {
@@ -1226,6 +1474,11 @@ int pack_bget_message(struct mdhim_t *md, struct mdhim_bgetm_t *bgm, void **send
                                         &mesg_idx, md->mdhim_comm);
         }
 
+        if (bgm->replica) {
+                return_code += MPI_Pack(bgm->replica, bgm->num_keys, MPI_INT, 
+					*sendbuf, mesg_size, &mesg_idx, md->mdhim_comm);
+        }
+
 	// If the pack did not succeed then log the error and return the error code
 	if ( return_code != MPI_SUCCESS ) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to pack "
@@ -1365,6 +1618,20 @@ int unpack_bget_message(struct mdhim_t *md, void *message, int mesg_size, void *
 					  MPI_CHAR, md->mdhim_comm);            
         }
 
+	// The sender's pointer to the replica flags only says whether they follow the keys
+	if ((*((struct mdhim_bgetm_t **) bgetm))->replica) {
+		if (((*((struct mdhim_bgetm_t **) bgetm))->replica = 
+		     malloc(num_records * sizeof(int))) == NULL) {
+			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to allocate "
+			     "memory to unpack bget message.", md->mdhim_rank);
+			return MDHIM_ERROR; 
+		}
+
+		return_code += MPI_Unpack(message, mesg_size, &mesg_idx, 
+					  (*((struct mdhim_bgetm_t **) bgetm))->replica, 
+					  num_records, MPI_INT, md->mdhim_comm);
+	}
+
 	// If the unpack did not succeed then log the error and return the error code
 	if ( return_code != MPI_SUCCESS ) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to unpack "
@@ -1731,6 +1998,10 @@ int pack_bdel_message(struct mdhim_t *md, struct mdhim_bdelm_t *bdm, void **send
         // For the each of the keys add enough chars.
         for (i=0; i < bdm->num_keys; i++)
                 m_size += bdm->key_lens[i];
+
+        // The replica flags follow the keys if there are any
+        if (bdm->replica)
+                m_size += bdm->num_keys * sizeof(int);
         
         // Is the computed message size of a safe value? (less than a max message size?)
         if (m_size > MDHIM_MAX_MSG_SIZE) {
@@ -1761,6 +2032,11 @@ int pack_bdel_message(struct mdhim_t *md, struct mdhim_bdelm_t *bdm, void **send
 					md->mdhim_comm);
         }
 
+        if (bdm->replica) {
+                return_code += MPI_Pack(bdm->replica, bdm->num_keys, MPI_INT, 
+					*sendbuf, mesg_size, &mesg_idx, md->mdhim_comm);
+        }
+
 	// If the pack did not succeed then log the error and return the error code
 	if ( return_code != MPI_SUCCESS ) {
 		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - Error: unable to pack "
@@ -1896,6 +2172,20 @@ int unpack_bdel_message(struct mdhim_t *md, void *message, int mesg_size, void *
 					  (*((struct mdhim_bdelm_t **) bdelm))->key_lens[i], 
 					  MPI_CHAR, md->mdhim_comm);            
         }
+
+	// The sender's pointer to the replica flags only says whether they follow the keys
+	if ((*((struct mdhim_bdelm_t **) bdelm))->replica) {
+		if (((*((struct mdhim_bdelm_t **) bdelm))->replica = 
+		     malloc(num_records * sizeof(int))) == NULL) {
+			mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - Error: unable to allocate "
+			     "memory to unpack bdel message.", md->mdhim_rank);
+			return MDHIM_ERROR; 
+		}
+
+		return_code += MPI_Unpack(message, mesg_size, &mesg_idx, 
+					  (*((struct mdhim_bdelm_t **) bdelm))->replica, 
+					  num_records, MPI_INT, md->mdhim_comm);
+	}
 	
 	// If the unpack did not succeed then log the error and return the error code
 	if ( return_code != MPI_SUCCESS ) {
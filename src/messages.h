@@ -29,6 +29,9 @@ extern "C"
 #define MDHIM_RECV_BULK_GET 9
 //Commit message
 #define MDHIM_COMMIT 10
+/* Delete the keys from keys[0] up to keys[1] (if given) from the data store
+   Sent in a mdhim_bdelm_t */
+#define MDHIM_RANGE_DEL 11
 
 /* Operations for getting a key/value */
 //Get the value for the specified key
@@ -45,6 +48,9 @@ extern "C"
    from a secondary index and key. */
 //Gets the primary key's value from a secondary key
 #define MDHIM_GET_PRIMARY_EQ 5
+/* Gets the keys and values from the first key not before keys[0] up to keys[1]
+   (if given) from a range server's store.  Used by mdhimScan */
+#define MDHIM_GET_RANGE  6
 
 //Message Types
 #define RANGESRV_WORK_MSG         1
@@ -52,6 +58,9 @@ extern "C"
 #define RANGESRV_INFO             3
 #define CLIENT_RESPONSE_MSG       4
 #define CLIENT_RESPONSE_SIZE_MSG  5
+//Responses to messages a range server forwarded to the range server serving their slices
+#define FORWARD_RESPONSE_MSG      6
+#define FORWARD_RESPONSE_SIZE_MSG 7
 
 //#define MAX_BULK_OPS 1000000
 #define MAX_BULK_OPS 500000
@@ -69,6 +78,10 @@ struct mdhim_basem_t {
 	int index;
 	int index_type;
 	char *index_name;
+	//The routing epoch of the index when the sender routed the message's keys
+	uint32_t routing_epoch;
+	//1 if a range server forwarded the message because its slices moved, 0 otherwise
+	int forwarded;
 };
 typedef struct mdhim_basem_t mdhim_basem_t;
 
@@ -79,6 +92,10 @@ struct mdhim_putm_t {
 	int key_len;
 	void *value;
 	int value_len;
+	//MDHIM_DB_APPEND to append the value to the record or MDHIM_DB_OVERWRITE
+	int append;
+	//1 if the record is sent to a range server replicating the key as a hot key
+	int replica;
 };
 
 /* Bulk put message */
@@ -89,6 +106,10 @@ struct mdhim_bputm_t {
 	void **values;
 	int *value_lens;
 	int num_keys;
+	//MDHIM_DB_APPEND to append the values to the records or MDHIM_DB_OVERWRITE
+	int append;
+	//1 for each record sent to a range server replicating its key, NULL if none were
+	int *replica;
 };
 
 /* Get record message */
@@ -116,6 +137,11 @@ struct mdhim_bgetm_t {
 
         //Number of records to retrieve per key given
 	int num_recs;
+
+	//Server cursor to continue a NEXT/PREV scan from, 0 if none
+	int cursor;
+	//1 for each key sent to a range server replicating it, NULL if none were
+	int *replica;
 };
 
 /* Delete message */
@@ -123,6 +149,8 @@ struct mdhim_delm_t {
 	mdhim_basem_t basem;
 	void *key;
 	int key_len; 
+	//1 if the key is sent to a range server replicating it as a hot key
+	int replica;
 };
 
 /* Bulk delete record message */
@@ -131,6 +159,8 @@ struct mdhim_bdelm_t {
 	void **keys;
 	int *key_lens;
 	int num_keys;
+	//1 for each key sent to a range server replicating it, NULL if none were
+	int *replica;
 };
 
 /* Range server info message */
@@ -154,6 +184,8 @@ struct mdhim_bgetrm_t {
 	void **values;
 	int *value_lens;
 	int num_keys;
+	//Server cursor positioned on the last key returned, 0 if the server closed it
+	int cursor;
 	struct mdhim_bgetrm_t *next;
 };
 
@@ -171,6 +203,7 @@ int receive_rangesrv_work(struct mdhim_t *md, int *src, void **message);
 int send_client_response(struct mdhim_t *md, int dest, void *message, int *sizebuf,
 			 void **sendbuf, MPI_Request **size_req, MPI_Request **msg_req);
 int receive_client_response(struct mdhim_t *md, int src, void **message);
+int receive_forward_response(struct mdhim_t *md, int src, void **message);
 int receive_all_client_responses(struct mdhim_t *md, int *srcs, int nsrcs, 
 				 void ***messages);
 int pack_put_message(struct mdhim_t *md, struct mdhim_putm_t *pm, void **sendbuf, int *sendsize);
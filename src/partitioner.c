@@ -1,6 +1,9 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include "partitioner.h"
 
 //Global hashtable for alphabet used in partitioner algorithm
@@ -216,6 +219,43 @@ int verify_key(struct index_t *index, void *key,
 	return MDHIM_SUCCESS;
 }
 
+/**
+ * compare_keys
+ * Compares two keys of the given type in the order the data stores keep them
+ *
+ * @param key_type  the key type of the index
+ * @param a         pointer to the first key
+ * @param a_len     the length of the first key
+ * @param b         pointer to the second key
+ * @param b_len     the length of the second key
+ * @return less than, equal to or greater than 0 if a sorts before, with or after b
+ */
+int compare_keys(int key_type, void *a, int a_len, void *b, int b_len) {
+	int ret;
+
+	switch(key_type) {
+	case MDHIM_INT_KEY:
+		return (*(uint32_t *) a > *(uint32_t *) b) - (*(uint32_t *) a < *(uint32_t *) b);
+	case MDHIM_LONG_INT_KEY:
+		return (*(uint64_t *) a > *(uint64_t *) b) - (*(uint64_t *) a < *(uint64_t *) b);
+	case MDHIM_FLOAT_KEY:
+		return (*(float *) a > *(float *) b) - (*(float *) a < *(float *) b);
+	case MDHIM_DOUBLE_KEY:
+		return (*(double *) a > *(double *) b) - (*(double *) a < *(double *) b);
+	case MDHIM_STRING_KEY:
+		//Strings sort by their characters, a prefix sorts first
+		ret = strncmp((char *) a, (char *) b, a_len < b_len ? a_len : b_len);
+		return ret ? ret : a_len - b_len;
+	default:
+		//Byte keys sort by length and then by their bytes
+		if (a_len != b_len) {
+			return a_len < b_len ? -1 : 1;
+		}
+
+		return memcmp(a, b, a_len);
+	}
+}
+
 int is_float_key(int type) {
 	int ret = 0;
 
@@ -351,6 +391,117 @@ int get_slice_num(struct mdhim_t *md, struct index_t *index, void *key, int key_
 	return slice_num;
 }
 
+/**
+ * get_slice_start
+ *
+ * Makes the first key of a slice for the key types whose slice numbers follow the order 
+ * of the keys, so the keys of the slice can be read from that key on.  Floats and doubles 
+ * are sliced by their absolute values, so a slice also holds a run of negative keys that 
+ * starts at minus the end of the slice
+ *
+ * @param index     the index the slice belongs to
+ * @param slice     the slice number
+ * @param negative  1 for the start of the negative keys of a float or double slice
+ * @param key       out: MDHIM_SLICE_START_LEN bytes the key is made in
+ * @param key_len   out: the length of the key, 0 if the slice starts at the first key
+ * @return 1 if the keys are ordered by slice, 0 if the slice's keys are anywhere
+ */
+int get_slice_start(struct index_t *index, int slice, int negative, void *key, 
+		    int *key_len) {
+	uint64_t start, end;
+	long double map_num;
+	int i, pos;
+
+	start = (uint64_t) slice * index->mdhim_max_recs_per_slice;
+	end = start + index->mdhim_max_recs_per_slice;
+	switch(index->key_type) {
+	case MDHIM_INT_KEY:
+		*(uint32_t *) key = start > UINT32_MAX ? UINT32_MAX : start;
+		*key_len = sizeof(uint32_t);
+
+		break;
+	case MDHIM_LONG_INT_KEY:
+		*(uint64_t *) key = start;
+		*key_len = sizeof(uint64_t);
+
+		break;
+	case MDHIM_FLOAT_KEY:
+		*(float *) key = negative ? -(float) end : (float) start;
+		*key_len = sizeof(float);
+
+		break;
+	case MDHIM_DOUBLE_KEY:
+		*(double *) key = negative ? -(double) end : (double) start;
+		*key_len = sizeof(double);
+
+		break;
+	case MDHIM_STRING_KEY:
+		/* The inverse of get_str_num: the characters are the digits of the slice's 
+		   fraction of the key space, in the base of the mdhim alphabet */
+		map_num = (long double) slice / MDHIM_MAX_SLICES;
+		for (i = 0; i < MDHIM_SLICE_START_LEN && map_num > 0; i++) {
+			map_num *= 1 << MDHIM_ALPHABET_EXPONENT;
+			pos = (int) map_num;
+			map_num -= pos;
+
+			//No character is past 'z', so no key starts between it and the next digit up
+			if (pos > 61) {
+				pos = 61;
+				map_num = 0;
+			}
+
+			((char *) key)[i] = pos < 10 ? '0' + pos : 
+				(pos < 36 ? 'A' + pos - 10 : 'a' + pos - 36);
+		}
+
+		*key_len = i;
+
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * get_slice_rangesrv
+ *
+ * Finds the range server number that serves a slice.  The routing lock must be held
+ *
+ * @param index     the index the slice belongs to
+ * @param slice     the slice number
+ * @return the range server number serving the slice
+ */
+uint32_t get_slice_rangesrv(struct index_t *index, int slice) {
+	uint32_t rangesrv_num;
+
+	if (index->num_rangesrvs == 1) {
+		rangesrv_num = 1;
+	} else if (index->slice_owners && (rangesrv_num = get_slice_owner(index, slice)) > 0) {
+		//The slice was migrated away from its normal range server
+	} else if (index->splitters) {
+		rangesrv_num = get_splitter_rangesrv(index, slice) + 1;
+	} else {
+		rangesrv_num = slice % index->num_rangesrvs + 1;
+	}
+
+	return rangesrv_num;
+}
+
+/**
+ * get_routing_epoch
+ *
+ * Reads the routing epoch of an index.  Clients read it before routing keys, so a message 
+ * never claims a newer routing than the one its keys were routed with
+ *
+ * @param index     the index to read the routing epoch of
+ * @return the routing epoch
+ */
+uint32_t get_routing_epoch(struct index_t *index) {
+	return __atomic_load_n(&index->routing_epoch, __ATOMIC_ACQUIRE);
+}
+
 /**
  * get_range_server_by_slice
  *
@@ -365,21 +516,117 @@ rangesrv_info *get_range_server_by_slice(struct mdhim_t *md, struct index_t *ind
 	//The range server number that we return
 	rangesrv_info *ret_rp;
 
-	if (index->num_rangesrvs == 1) {
-		rangesrv_num = 1;
-	} else {
-		rangesrv_num = slice % index->num_rangesrvs;
-		rangesrv_num++;
+	//Migrations and new splitters replace the routing while we read it
+	while (pthread_rwlock_rdlock(index->routing_lock) == EBUSY) {
+		usleep(10);
 	}
 
-	//Find the range server number in the hash table
+	rangesrv_num = get_slice_rangesrv(index, slice);
+	pthread_rwlock_unlock(index->routing_lock);
+
+	//Find the range server number in the flat array
 	ret_rp = NULL;
-	HASH_FIND_INT(index->rangesrvs_by_num, &rangesrv_num, ret_rp);
+	if (index->rangesrvs_arr && rangesrv_num <= index->num_rangesrvs) {
+		ret_rp = index->rangesrvs_arr[rangesrv_num - 1];
+	} else {
+		HASH_FIND_INT(index->rangesrvs_by_num, &rangesrv_num, ret_rp);
+	}
 
 	//Return the rank
 	return ret_rp;
 }
 
+/**
+ * get_key_hash
+ *
+ * Hashes a key to a 64 bit number used to place keys of a hash partitioned index
+ * Integer keys are mixed directly, other keys are hashed with FNV-1a before being mixed
+ *
+ * @param index     the index the key belongs to
+ * @param key       pointer to the key to hash
+ * @param key_len   length of the key
+ * @return the hash of the key
+ */
+uint64_t get_key_hash(struct index_t *index, void *key, int key_len) {
+	uint64_t hash;
+	int i;
+
+	if (index->key_type == MDHIM_INT_KEY) {
+		hash = *(uint32_t *) key;
+	} else if (index->key_type == MDHIM_LONG_INT_KEY) {
+		hash = *(uint64_t *) key;
+	} else {
+		hash = 14695981039346656037ULL;
+		for (i = 0; i < key_len; i++) {
+			hash ^= ((unsigned char *) key)[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	//Finalize the hash so that nearby keys end up far apart
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/**
+ * jump_consistent_hash
+ *
+ * Maps a 64 bit hash to a bucket using the jump consistent hash algorithm
+ * Only about 1/num_buckets of the keys move when a bucket is added
+ *
+ * @param key          the hash to map
+ * @param num_buckets  the number of buckets
+ * @return the bucket number, from 0 to num_buckets - 1
+ */
+int jump_consistent_hash(uint64_t key, int num_buckets) {
+	int64_t b = -1, j = 0;
+
+	while (j < num_buckets) {
+		b = j;
+		key = key * 2862933555777941757ULL + 1;
+		j = (b + 1) * ((double) (1LL << 31) / (double) ((key >> 33) + 1));
+	}
+
+	return b;
+}
+
+/**
+ * get_all_range_servers
+ *
+ * gets a list of all the range servers of an index
+ * @param md        main MDHIM struct
+ * @param index     the index to get the range servers of
+ * @return the list of range servers or NULL on error
+ */
+rangesrv_list *get_all_range_servers(struct mdhim_t *md, struct index_t *index) {
+	rangesrv_list *head, *lp, *entry;
+	uint32_t i;
+
+	head = lp = NULL;
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!index->rangesrvs_arr[i]) {
+			continue;
+		}
+
+		entry = malloc(sizeof(rangesrv_list));
+		entry->ri = index->rangesrvs_arr[i];
+		entry->next = NULL;
+		if (!head) {
+			lp = head = entry;
+		} else {
+			lp->next = entry;
+			lp = lp->next;
+		}
+	}
+
+	return head;
+}
+
 /**
  * get_range_servers
  *
@@ -397,11 +644,22 @@ rangesrv_list *get_range_servers(struct mdhim_t *md, struct index_t *index,
 	rangesrv_info *ret_rp;
 	rangesrv_list *rl;
 
-	if ((slice_num = get_slice_num(md, index, key, key_len)) == MDHIM_ERROR) {
-		return NULL;
+	if (index->partition_type == MDHIM_HASH_PARTITION) {
+		//Place the key by its hash
+		if (!key || key_len > MAX_KEY_LEN) {
+			return NULL;
+		}
+
+		ret_rp = index->rangesrvs_arr[jump_consistent_hash(get_key_hash(index, key, key_len), 
+								   index->num_rangesrvs)];
+	} else {
+		if ((slice_num = get_slice_num(md, index, key, key_len)) == MDHIM_ERROR) {
+			return NULL;
+		}
+
+		ret_rp = get_range_server_by_slice(md, index, slice_num);       
 	}
 
-	ret_rp = get_range_server_by_slice(md, index, slice_num);       
 	rl = NULL;
 	_add_to_rangesrv_list(&rl, ret_rp);
 
@@ -409,436 +667,828 @@ rangesrv_list *get_range_servers(struct mdhim_t *md, struct index_t *index,
 	return rl;
 }
 
-struct mdhim_stat *get_next_slice_stat(struct mdhim_t *md, struct index_t *index, 
-				       int slice_num) {
-	struct mdhim_stat *stat, *tmp, *next_slice;
+/**
+ * get_range_servers_batch
+ *
+ * gets the range servers that handle each of the keys given
+ * Integer keys are converted to key numbers in one pass and then divided into slices 
+ * and range servers in a second, branch free pass the compiler can vectorize
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index the keys are routed for
+ * @param keys      array of keys to find the range servers of
+ * @param key_lens  array of the lengths of each key
+ * @param num_keys  the number of keys in keys
+ * @param rs_idx    out: for each key, the range server number - 1 or -1 if the key is invalid
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int get_range_servers_batch(struct mdhim_t *md, struct index_t *index, 
+			    void **keys, int *key_lens, int num_keys, int *rs_idx) {
+	uint64_t *key_nums;
+	uint64_t slice_size, num_rangesrvs;
+	int slice_shift;
+	int slice_num;
+	int owner;
+	int i;
+
+	if (!rs_idx || num_keys <= 0) {
+		return MDHIM_ERROR;
+	}
 
-	next_slice = NULL;
+	slice_size = index->mdhim_max_recs_per_slice;
+	num_rangesrvs = index->num_rangesrvs;
+	if (index->partition_type == MDHIM_HASH_PARTITION) {
+		//Place the keys by their hashes
+		for (i = 0; i < num_keys; i++) {
+			if (!keys[i] || key_lens[i] > MAX_KEY_LEN) {
+				rs_idx[i] = -1;
+				continue;
+			}
 
-	//Iterate through the stat hash entries to find the slice 
-	//number next after the given slice number
-	HASH_ITER(hh, index->stats, stat, tmp) {	
-		if (!stat) {
-			continue;
+			rs_idx[i] = jump_consistent_hash(get_key_hash(index, keys[i], key_lens[i]), 
+							 num_rangesrvs);
 		}
-		
-		if (stat->key > slice_num && !next_slice) {
-			next_slice = stat;
-		} else if (next_slice && stat->key > slice_num && stat->key < next_slice->key) {
-			next_slice = stat;
+
+		return MDHIM_SUCCESS;
+	}
+
+	if (index->key_type != MDHIM_INT_KEY && index->key_type != MDHIM_LONG_INT_KEY) {
+		//Keys that need the alphabet or floating point conversion are routed one at a time
+		for (i = 0; i < num_keys; i++) {
+			if ((slice_num = get_slice_num(md, index, keys[i], key_lens[i])) == 
+			    MDHIM_ERROR) {
+				rs_idx[i] = -1;
+				continue;
+			}
+
+			rs_idx[i] = slice_num;
+		}
+
+		while (pthread_rwlock_rdlock(index->routing_lock) == EBUSY) {
+			usleep(10);
+		}
+
+		for (i = 0; i < num_keys; i++) {
+			if (rs_idx[i] >= 0) {
+				rs_idx[i] = get_slice_rangesrv(index, rs_idx[i]) - 1;
+			}
 		}
+
+		pthread_rwlock_unlock(index->routing_lock);
+
+		return MDHIM_SUCCESS;
 	}
 
-	return next_slice;
-}
+	if ((key_nums = malloc(sizeof(uint64_t) * num_keys)) == NULL) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error allocating memory in get_range_servers_batch", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
 
-struct mdhim_stat *get_prev_slice_stat(struct mdhim_t *md, struct index_t *index, 
-				       int slice_num) {
-	struct mdhim_stat *stat, *tmp, *prev_slice;
+	//Gather the key numbers and mark the keys that can't be routed
+	for (i = 0; i < num_keys; i++) {
+		rs_idx[i] = 0;
+		if (!keys[i] || key_lens[i] > MAX_KEY_LEN) {
+			rs_idx[i] = -1;
+			key_nums[i] = 0;
+		} else if (index->key_type == MDHIM_INT_KEY) {
+			key_nums[i] = *(uint32_t *) keys[i];
+		} else {
+			key_nums[i] = *(uint64_t *) keys[i];
+		}
+	}
 
-	prev_slice = NULL;
+	//Divide into slices, using a shift if the slice size is a power of 2
+	if (slice_size && !(slice_size & (slice_size - 1))) {
+		slice_shift = 0;
+		while ((1ULL << slice_shift) < slice_size) {
+			slice_shift++;
+		}
 
-	//Iterate through the stat hash entries to find the slice 
-	//number next after the given slice number
-	HASH_ITER(hh, index->stats, stat, tmp) {	
-		if (!stat) {
-			continue;
+		for (i = 0; i < num_keys; i++) {
+			key_nums[i] >>= slice_shift;
 		}
-		
-		if (stat->key < slice_num && !prev_slice) {
-			prev_slice = stat;
-		} else if (prev_slice && stat->key < slice_num && stat->key > prev_slice->key) {
-			prev_slice = stat;
+	} else {
+		for (i = 0; i < num_keys; i++) {
+			key_nums[i] /= slice_size;
+		}
+	}
+
+	//Map the slices to range servers with the same splitters and migrated slices for all keys
+	while (pthread_rwlock_rdlock(index->routing_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	if (index->splitters) {
+		for (i = 0; i < num_keys; i++) {
+			if (key_nums[i] >= MDHIM_MAX_SLICES) {
+				rs_idx[i] = -1;
+			} else if (rs_idx[i] == 0) {
+				rs_idx[i] = get_splitter_rangesrv(index, key_nums[i]);
+			}
+		}
+	} else {
+		for (i = 0; i < num_keys; i++) {
+			if (key_nums[i] >= MDHIM_MAX_SLICES) {
+				rs_idx[i] = -1;
+			} else if (rs_idx[i] == 0) {
+				rs_idx[i] = key_nums[i] % num_rangesrvs;
+			}
 		}
 	}
 
-	return prev_slice;
+	//Send the keys of migrated slices to the range servers that now serve them
+	if (index->slice_owners) {
+		for (i = 0; i < num_keys; i++) {
+			if (rs_idx[i] >= 0 && (owner = get_slice_owner(index, key_nums[i])) > 0) {
+				rs_idx[i] = owner - 1;
+			}
+		}
+	}
+
+	pthread_rwlock_unlock(index->routing_lock);
+	free(key_nums);
+
+	return MDHIM_SUCCESS;
 }
 
-struct mdhim_stat *get_last_slice_stat(struct mdhim_t *md, struct index_t *index) {
-	struct mdhim_stat *stat, *tmp, *last_slice;
+/**
+ * get_splitter_rangesrv
+ *
+ * Finds the range server of a slice with a binary search over the index's splitters
+ *
+ * @param index     the index with the splitters
+ * @param slice     the slice number
+ * @return the range server number - 1 that serves the slice
+ */
+int get_splitter_rangesrv(struct index_t *index, int slice) {
+	int low, high, mid;
+
+	//Find the number of splitters that are less than or equal to the slice
+	low = 0;
+	high = index->num_splitters;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (index->splitters[mid] <= slice) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
 
-	last_slice = NULL;
+	return low;
+}
 
-	//Iterate through the stat hash entries to find the slice 
-	//number next after the given slice number
-	HASH_ITER(hh, index->stats, stat, tmp) {	
-		if (!stat) {
-			continue;
+/**
+ * get_slice_owner
+ *
+ * Finds the range server a slice was migrated to
+ *
+ * @param index     the index the slice belongs to
+ * @param slice     the slice number
+ * @return the range server number serving the slice or 0 if the slice wasn't migrated
+ */
+uint32_t get_slice_owner(struct index_t *index, int slice) {
+	slice_owner_t *owner;
+
+	HASH_FIND_INT(index->slice_owners, &slice, owner);
+	if (!owner) {
+		return 0;
+	}
+
+	return owner->rangesrv_num;
+}
+
+/**
+ * set_slice_owner
+ *
+ * Records the range server that serves a slice from now on.  
+ * The entry is dropped if the slice moves back to its normal range server
+ *
+ * @param index        the index the slice belongs to
+ * @param slice        the slice number
+ * @param rangesrv_num the range server number that now serves the slice
+ */
+void set_slice_owner(struct index_t *index, int slice, uint32_t rangesrv_num) {
+	slice_owner_t *owner;
+	uint32_t normal_num;
+
+	if (index->splitters) {
+		normal_num = get_splitter_rangesrv(index, slice) + 1;
+	} else {
+		normal_num = slice % index->num_rangesrvs + 1;
+	}
+
+	HASH_FIND_INT(index->slice_owners, &slice, owner);
+	if (rangesrv_num == normal_num) {
+		if (owner) {
+			HASH_DEL(index->slice_owners, owner);
+			free(owner);
 		}
-		
-		if (!last_slice) {
-			last_slice = stat;
-		} else if (stat->key > last_slice->key) {
-			last_slice = stat;
+
+		return;
+	}
+
+	if (!owner) {
+		owner = malloc(sizeof(slice_owner_t));
+		owner->slice = slice;
+		HASH_ADD_INT(index->slice_owners, slice, owner);
+	}
+
+	owner->rangesrv_num = rangesrv_num;
+}
+
+/**
+ * bcast_slice_owners
+ *
+ * Sends the migrated slices and the routing epoch from the root to every rank
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to send the migrated slices of
+ * @param root      the rank in mdhim_client_comm that has the migrated slices
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int bcast_slice_owners(struct mdhim_t *md, struct index_t *index, int root) {
+	slice_owner_t *owner, *tmp;
+	int header[2];
+	int *owners;
+	int i;
+
+	header[0] = index->routing_epoch;
+	header[1] = HASH_COUNT(index->slice_owners);
+	if (MPI_Bcast(header, 2, MPI_INT, root, md->mdhim_client_comm) != MPI_SUCCESS) {
+		return MDHIM_ERROR;
+	}
+
+	index->routing_epoch = header[0];
+	if (!header[1]) {
+		return MDHIM_SUCCESS;
+	}
+
+	owners = malloc(sizeof(int) * 2 * header[1]);
+	if (md->mdhim_rank == root) {
+		i = 0;
+		HASH_ITER(hh, index->slice_owners, owner, tmp) {
+			owners[i * 2] = owner->slice;
+			owners[i * 2 + 1] = owner->rangesrv_num;
+			i++;
+		}
+	}
+
+	if (MPI_Bcast(owners, header[1] * 2, MPI_INT, root, 
+		      md->mdhim_client_comm) != MPI_SUCCESS) {
+		free(owners);
+		return MDHIM_ERROR;
+	}
+
+	if (md->mdhim_rank != root) {
+		for (i = 0; i < header[1]; i++) {
+			set_slice_owner(index, owners[i * 2], owners[i * 2 + 1]);
 		}
 	}
 
-	return last_slice;
+	free(owners);
+
+	return MDHIM_SUCCESS;
 }
 
-struct mdhim_stat *get_first_slice_stat(struct mdhim_t *md, struct index_t *index) {
-	struct mdhim_stat *stat, *tmp, *first_slice;
+static int cmp_slice_sample(const void *a, const void *b) {
+	const uint64_t *sa = a, *sb = b;
+
+	if (sa[0] < sb[0]) {
+		return -1;
+	} else if (sa[0] > sb[0]) {
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * compute_splitters
+ * Collective call that computes the splitters of an index from a sample of the keys
+ *
+ * Every rank contributes the slices of the keys it passes in.  Range servers that don't 
+ * pass in any keys contribute the slices and record counts from their stats instead.  
+ * The samples are gathered on every rank, which then picks the same splitters so that each 
+ * range server gets about the same number of records.
+ *
+ * Records aren't moved by new splitters, so every slice a range server already holds 
+ * records of stays pinned to it in the migrated slices.  mdhimMigrateSlice and 
+ * mdhimRebalance can move those slices afterwards
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to compute the splitters of
+ * @param keys      sample keys from this rank
+ * @param key_lens  array of the lengths of each key
+ * @param num_keys  the number of keys in keys (may be 0)
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int compute_splitters(struct mdhim_t *md, struct index_t *index, 
+		      void **keys, int *key_lens, int num_keys) {
+	struct mdhim_stat *stat, *tmp;
+	slice_owner_t *owner, *tmp_owner;
+	uint64_t *samples, *all_samples;
+	int num_samples, total_samples;
+	int *recvcounts, *displs;
+	int *splitters;
+	uint64_t total_weight, cur_weight, target;
+	int slice_num;
+	int i, j, k;
+
+	if (index->partition_type != MDHIM_SPLITTER_PARTITION) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Splitters can only be computed for an index" 
+		     " created with MDHIM_SPLITTER_PARTITION", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	/* Each sample is the slice number, the number of records it weighs and the range server 
+	   number holding the records, 0 for the keys passed in */
+	num_samples = 0;
+	samples = NULL;
+	if (num_keys > 0) {
+		samples = malloc(sizeof(uint64_t) * 3 * num_keys);
+		for (i = 0; i < num_keys; i++) {
+			if ((slice_num = get_slice_num(md, index, keys[i], key_lens[i])) == 
+			    MDHIM_ERROR) {
+				continue;
+			}
+
+			samples[num_samples * 3] = slice_num;
+			samples[num_samples * 3 + 1] = 1;
+			samples[num_samples * 3 + 2] = 0;
+			num_samples++;
+		}
+	} 
+
+	if (im_range_server(index) && index->mdhim_store) {
+		/* The slices in our data store, with the keys the workers counted, are pinned to us.
+		   They only weigh in if we didn't pass in keys */
+		while (pthread_rwlock_wrlock(index->mdhim_store->mdhim_store_stats_lock) == EBUSY) {
+			usleep(10);
+		}
+
+		merge_stat_accs(index);
+		samples = realloc(samples, sizeof(uint64_t) * 3 * 
+				  (num_samples + HASH_COUNT(index->mdhim_store->mdhim_store_stats) + 1));
+		HASH_ITER(hh, index->mdhim_store->mdhim_store_stats, stat, tmp) {
+			samples[num_samples * 3] = stat->key;
+			samples[num_samples * 3 + 1] = num_keys > 0 ? 0 : stat->num;
+			samples[num_samples * 3 + 2] = index->myinfo.rangesrv_num;
+			num_samples++;
+		}
+		pthread_rwlock_unlock(index->mdhim_store->mdhim_store_stats_lock);
+	}
+
+	//Get the number of samples every rank has
+	recvcounts = malloc(sizeof(int) * md->mdhim_comm_size);
+	displs = malloc(sizeof(int) * md->mdhim_comm_size);
+	num_samples *= 3;
+	if (MPI_Allgather(&num_samples, 1, MPI_INT, recvcounts, 1, MPI_INT, 
+			  md->mdhim_client_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error while gathering the number of samples", 
+		     md->mdhim_rank);
+		free(samples);
+		free(recvcounts);
+		free(displs);
+		return MDHIM_ERROR;
+	}
+
+	total_samples = 0;
+	for (i = 0; i < md->mdhim_comm_size; i++) {
+		displs[i] = total_samples;
+		total_samples += recvcounts[i];
+	}
 
-	first_slice = NULL;
+	//Gather all the samples
+	all_samples = malloc(sizeof(uint64_t) * (total_samples + 3));
+	if (MPI_Allgatherv(samples, num_samples, MPI_UINT64_T, all_samples, recvcounts, 
+			   displs, MPI_UINT64_T, md->mdhim_client_comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error while gathering the samples", 
+		     md->mdhim_rank);
+		free(samples);
+		free(all_samples);
+		free(recvcounts);
+		free(displs);
+		return MDHIM_ERROR;
+	}
+
+	free(samples);
+	free(recvcounts);
+	free(displs);
+	total_samples /= 3;
+	total_weight = 0;
+	for (i = 0; i < total_samples; i++) {
+		total_weight += all_samples[i * 3 + 1];
+	}
+
+	if (!total_weight) {
+		mlog(MDHIM_CLIENT_INFO, "Rank: %d - No samples were given, keeping the current" 
+		     " placement of slices", 
+		     md->mdhim_rank);
+		free(all_samples);
+		return MDHIM_SUCCESS;
+	}
 
-	//Iterate through the stat hash entries to find the slice 
-	//number next after the given slice number
-	HASH_ITER(hh, index->stats, stat, tmp) {	
-		if (!stat) {
+	//Sort the samples by slice number
+	qsort(all_samples, total_samples, sizeof(uint64_t) * 3, cmp_slice_sample);
+
+	/* Pick the splitters so that each range server gets an equal share of the weight.
+	   A slice goes to the range server its preceding weight falls in and 
+	   splitter k is the first slice served by range server k + 1 or later.
+	   Slices can't be split, so a heavy slice may leave the range servers after it empty */
+	splitters = malloc(sizeof(int) * index->num_rangesrvs);
+	for (k = 0; k < index->num_rangesrvs - 1; k++) {
+		splitters[k] = MDHIM_MAX_SLICES;
+	}
+
+	cur_weight = 0;
+	k = 0;
+	for (j = 0; j < total_samples && k < index->num_rangesrvs - 1; j++) {
+		if (!all_samples[j * 3 + 1]) {
 			continue;
 		}
-		
-		if (!first_slice) {
-			first_slice = stat;
-		} else if (stat->key < first_slice->key) {
-			first_slice = stat;
+
+		target = (cur_weight * index->num_rangesrvs) / total_weight;
+		while (k < index->num_rangesrvs - 1 && target >= k + 1) {
+			splitters[k] = all_samples[j * 3];
+			k++;
 		}
+
+		cur_weight += all_samples[j * 3 + 1];
+	}
+
+	//Replace the old splitters while no rank routes with them
+	while (pthread_rwlock_wrlock(index->routing_lock) == EBUSY) {
+		usleep(10);
 	}
 
-	return first_slice;
+	if (index->splitters) {
+		free(index->splitters);
+	}
+	index->splitters = splitters;
+	index->num_splitters = index->num_rangesrvs - 1;
+
+	//Only the slices with records keep a range server other than the splitters' one
+	HASH_ITER(hh, index->slice_owners, owner, tmp_owner) {
+		HASH_DEL(index->slice_owners, owner);
+		free(owner);
+	}
+
+	for (j = 0; j < total_samples; j++) {
+		if (all_samples[j * 3 + 2]) {
+			set_slice_owner(index, all_samples[j * 3], all_samples[j * 3 + 2]);
+		}
+	}
+
+	__atomic_add_fetch(&index->routing_epoch, 1, __ATOMIC_RELEASE);
+	pthread_rwlock_unlock(index->routing_lock);
+	free(all_samples);
+	mlog(MDHIM_CLIENT_DBG, "Rank: %d - Computed the splitters of index: %d, %u slices" 
+	     " with records stay on their range servers", 
+	     md->mdhim_rank, index->id, HASH_COUNT(index->slice_owners));
+
+	//Persist the splitters right away
+	if (index->myinfo.rangesrv_num == 1) {
+		write_manifest(md, index);
+	}
+
+	return MDHIM_SUCCESS;
 }
 
-int get_slice_from_fstat(struct mdhim_t *md, struct index_t *index, 
-			 int cur_slice, long double fstat, int op) {
-	int slice_num = 0;
-	struct mdhim_stat *cur_stat, *new_stat;
+static int cmp_fence_slice(const void *a, const void *b) {
+	const stat_fence_t *fa = (const stat_fence_t *) a;
+	const stat_fence_t *fb = (const stat_fence_t *) b;
 
-	if (!index->stats) {
-		return 0;
+	if (fa->slice < fb->slice) {
+		return -1;
+	} else if (fa->slice > fb->slice) {
+		return 1;
 	}
 
-	//Get the stat struct for our current slice
-	HASH_FIND_INT(index->stats, &cur_slice, cur_stat);
+	return 0;
+}
 
-	switch(op) {
-	case MDHIM_GET_NEXT:
-		if (cur_stat && *(long double *)cur_stat->max > fstat) {
-			slice_num = cur_slice;
-			goto done;
-		} else {
-			new_stat = get_next_slice_stat(md, index, cur_slice);
-			goto new_stat;
+static int cmp_fence_imin(const void *a, const void *b) {
+	const stat_fence_t *fa = (const stat_fence_t *) a;
+	const stat_fence_t *fb = (const stat_fence_t *) b;
+
+	if (fa->min.i < fb->min.i) {
+		return -1;
+	} else if (fa->min.i > fb->min.i) {
+		return 1;
+	}
+
+	return cmp_fence_slice(a, b);
+}
+
+static int cmp_fence_fmin(const void *a, const void *b) {
+	const stat_fence_t *fa = (const stat_fence_t *) a;
+	const stat_fence_t *fb = (const stat_fence_t *) b;
+
+	if (fa->min.f < fb->min.f) {
+		return -1;
+	} else if (fa->min.f > fb->min.f) {
+		return 1;
+	}
+
+	return cmp_fence_slice(a, b);
+}
+
+/**
+ * build_stat_fences
+ *
+ * Builds the sorted array of fences used for routing from the stats of the last stat flush.
+ * Fences of a global index are sorted by slice.  Fences of an index with stats kept per 
+ * range server are sorted by their minimum key, as the slices of range servers overlap
+ *
+ * @param md        main MDHIM struct
+ * @param index     the index to build the fences of
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int build_stat_fences(struct mdhim_t *md, struct index_t *index) {
+	stat_table_t *table = index->stats;
+	stat_fence_t *fences, *f;
+	int num_fences, float_type, per_rank;
+	int i, j;
+
+	float_type = is_float_key(index->key_type);
+	per_rank = index->type == LOCAL_INDEX || index->partition_type == MDHIM_HASH_PARTITION;
+
+	num_fences = table ? table->num : 0;
+	fences = NULL;
+	if (num_fences && (fences = malloc(sizeof(stat_fence_t) * num_fences)) == NULL) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - Error allocating memory for the stat fences", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	i = 0;
+	for (j = 0; j < num_fences; j++) {
+		if (per_rank && table->nums[j] <= 0) {
+			continue;
 		}
 
-		break;
-	case MDHIM_GET_PREV:
-		if (cur_stat && *(long double *)cur_stat->min < fstat) {
-			slice_num = cur_slice;
-			goto done;
-		} else {
-			new_stat = get_prev_slice_stat(md, index, cur_slice);
-			goto new_stat;
+		f = &fences[i++];
+		f->min = table->mins[j];
+		f->max = table->maxs[j];
+		f->slice = table->slices[j];
+		//The range server of a global index is looked up when routing as slices can migrate
+		f->rangesrv_num = table->rangesrv_nums[j];
+	}
+
+	//The table is already sorted by slice for global indexes
+	if (per_rank) {
+		qsort(fences, i, sizeof(stat_fence_t), float_type ? cmp_fence_fmin : cmp_fence_imin);
+	}
+
+	num_fences = i;
+
+	//Keep the running maximum so searches of overlapping fences can stop early
+	for (i = 0; i < num_fences; i++) {
+		fences[i].max_before = fences[i].max;
+		if (!i) {
+			continue;
 		}
 
-		break;
-	case MDHIM_GET_FIRST:
-		new_stat = get_first_slice_stat(md, index);
-		goto new_stat;
-		break;
-	case MDHIM_GET_LAST:
-		new_stat = get_last_slice_stat(md, index);
-		goto new_stat;
-		break;
-	default:
-		slice_num = 0;
-		break;
+		if (float_type && fences[i - 1].max_before.f > fences[i].max.f) {
+			fences[i].max_before.f = fences[i - 1].max_before.f;
+		} else if (!float_type && fences[i - 1].max_before.i > fences[i].max.i) {
+			fences[i].max_before.i = fences[i - 1].max_before.i;
+		}
 	}
-	
-done:
-	return slice_num;
 
-new_stat:
-	if (new_stat) {
-		return new_stat->key;
-	} else {
-		return 0;
+	if (index->fences) {
+		free(index->fences);
 	}
+	index->fences = fences;
+	index->num_fences = num_fences;
+
+	return MDHIM_SUCCESS;
 }
 
-int get_slice_from_istat(struct mdhim_t *md, struct index_t *index, 
-			 int cur_slice, uint64_t istat, int op) {
-	int slice_num = 0;
-	struct mdhim_stat *cur_stat, *new_stat;
+/* Finds the position of the first fence of a global index with a slice number 
+   greater than or equal to the slice given */
+static int fence_lower_bound(struct index_t *index, int slice) {
+	int low, high, mid;
+
+	low = 0;
+	high = index->num_fences;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (index->fences[mid].slice < slice) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
 
-	if (!index->stats) {
+	return low;
+}
+
+/**
+ * get_slice_from_fences
+ *
+ * Finds the slice of a global index that has the record for the operation given
+ *
+ * @param md          main MDHIM struct
+ * @param index       the index to look in
+ * @param cur_slice   the slice of the key given
+ * @param istat       the key as an integer, for integer keys
+ * @param fstat       the key as a float, for float, string and byte keys
+ * @param float_type  whether the key is a float type
+ * @param op          the operation type
+ * @return the slice number or 0 if there is no slice for the operation
+ */
+static int get_slice_from_fences(struct mdhim_t *md, struct index_t *index, int cur_slice, 
+				 uint64_t istat, long double fstat, int float_type, int op) {
+	stat_fence_t *cur;
+	int pos, num_fences;
+
+	num_fences = index->num_fences;
+	if (!num_fences) {
 		return 0;
 	}
 
-	new_stat = cur_stat = NULL;
-	//Get the stat struct for our current slice
-	HASH_FIND_INT(index->stats, &cur_slice, cur_stat);
+	//Find the fence of our current slice
+	pos = fence_lower_bound(index, cur_slice);
+	cur = (pos < num_fences && index->fences[pos].slice == cur_slice) ? 
+		&index->fences[pos] : NULL;
 
 	switch(op) {
 	case MDHIM_GET_NEXT:
-		if (cur_stat && *(uint64_t *)cur_stat->max > istat && 
-		    *(uint64_t *)cur_stat->min <= istat) {
-			slice_num = cur_slice;
-			goto done;
-		} else {		
-			new_stat = get_next_slice_stat(md, index, cur_slice);
-			goto new_stat;
+		if (cur && float_type && cur->max.f > fstat) {
+			return cur_slice;
+		} else if (cur && !float_type && cur->max.i > istat && cur->min.i <= istat) {
+			return cur_slice;
 		}
 
-		break;
+		//The first slice after ours
+		pos = cur ? pos + 1 : pos;
+		return pos < num_fences ? index->fences[pos].slice : 0;
 	case MDHIM_GET_PREV:
-		if (cur_stat && *(uint64_t *)cur_stat->min < istat && 
-		    *(uint64_t *)cur_stat->max >= istat ) {
-			slice_num = cur_slice;
-			goto done;
-		} else {
-			new_stat = get_prev_slice_stat(md, index, cur_slice);
-			goto new_stat;
+		if (cur && float_type && cur->min.f < fstat) {
+			return cur_slice;
+		} else if (cur && !float_type && cur->min.i < istat && cur->max.i >= istat) {
+			return cur_slice;
 		}
 
-		break;
+		//The last slice before ours
+		return pos > 0 ? index->fences[pos - 1].slice : 0;
 	case MDHIM_GET_FIRST:
-		new_stat = get_first_slice_stat(md, index);
-		goto new_stat;
-		break;
+		return index->fences[0].slice;
 	case MDHIM_GET_LAST:
-		new_stat = get_last_slice_stat(md, index);
-		goto new_stat;
-		break;
+		return index->fences[num_fences - 1].slice;
+	case MDHIM_GET_EQ:
+	case MDHIM_GET_PRIMARY_EQ:
+		return cur_slice;
 	default:
-		slice_num = 0;
 		break;
 	}
-	
-done:
-	return slice_num;
 
-new_stat:
-	if (new_stat) {
-		return new_stat->key;
-	} else {
-		return 0;
-	}
+	return 0;
 }
 
-/* Iterate through the multi-level hash table in index->stats to find the range servers
-   that could have the key */
-rangesrv_list *get_rangesrvs_from_istat(struct mdhim_t *md, struct index_t *index, 
-					uint64_t istat, int op) {
-	struct mdhim_stat *cur_rank, *cur_stat, *tmp, *tmp2;
-	rangesrv_list *head, *lp, *entry;
-	int slice_num = 0;
-	unsigned int num_slices;
-	unsigned int i;
-
-	if (!index->stats) {
-		return 0;
+/* Whether a fence with the minimum key given could hold the record for the operation.
+   Becomes false for every fence after the first one it is false for */
+static int fence_min_matches(stat_bound_t min, int float_type, uint64_t istat, 
+			     long double fstat, int op) {
+	switch(op) {
+	case MDHIM_GET_NEXT:
+		return float_type ? min.f - 1.0L <= fstat : (!min.i || min.i - 1 <= istat);
+	case MDHIM_GET_PREV:
+		return float_type ? min.f < fstat : min.i < istat;
+	default:
+		return float_type ? min.f <= fstat : min.i <= istat;
 	}
+}
 
-	cur_stat = cur_rank = NULL;
-	head = lp = entry = NULL;
-	HASH_ITER(hh, index->stats, cur_rank, tmp) {
-		num_slices = HASH_COUNT(cur_rank->stats);
-		i = 0;
-		HASH_ITER(hh, cur_rank->stats, cur_stat, tmp2) {
-			if (cur_stat->num <= 0) {
-				continue;
-			}
-			
-			slice_num = -1;
-			switch(op) {
-			case MDHIM_GET_NEXT:
-				if (cur_stat && *(uint64_t *)cur_stat->max > istat && 
-				    *(uint64_t *)cur_stat->min - 1 <= istat) {
-					slice_num = cur_stat->key;
-				} 
-
-				break;
-			case MDHIM_GET_PREV:
-				if (cur_stat && *(uint64_t *)cur_stat->min < istat && 
-				    *(uint64_t *)cur_stat->max + 1 >= istat ) {
-					slice_num = cur_stat->key;
-				} 
-				
-				break;
-			case MDHIM_GET_FIRST:
-				if (!i) {
-					slice_num = cur_stat->key;
-				}
-				break;
-			case MDHIM_GET_LAST:
-				if (i == num_slices - 1) {
-					slice_num = cur_stat->key;
-				}
-				break;
-			case MDHIM_GET_EQ:
-				if (cur_stat && *(uint64_t *)cur_stat->max >= istat && 
-				    *(uint64_t *)cur_stat->min <= istat) {
-					slice_num = cur_stat->key;
-				} 
-
-				break;
-			default:
-				slice_num = 0;
-				break;
-			}
-			
-			if (slice_num < 0) {
-				continue;
-			}
-
-			entry = malloc(sizeof(rangesrv_list));
-			memset(entry, 0, sizeof(rangesrv_list));
-			HASH_FIND_INT(index->rangesrvs_by_rank, &cur_rank->key, entry->ri);
-			if (!entry->ri) {
-				free(entry);
-				continue;
-			}
-
-			if (!head) {
-				lp = head = entry;				
-			} else {
-				lp->next = entry;
-				lp = lp->next;
-			}
-
-			break;
-		}
+/* Whether a fence with the maximum key given could hold the record for the operation */
+static int fence_max_matches(stat_bound_t max, int float_type, uint64_t istat, 
+			     long double fstat, int op) {
+	switch(op) {
+	case MDHIM_GET_NEXT:
+		return float_type ? max.f > fstat : max.i > istat;
+	case MDHIM_GET_PREV:
+		return float_type ? max.f + 1.0L >= fstat : (!istat || max.i >= istat - 1);
+	default:
+		return float_type ? max.f >= fstat : max.i >= istat;
 	}
-
-	return head;
 }
 
-/* Iterate through the multi-level hash table in index->stats to find the range servers 
-   that could have the key */
-rangesrv_list *get_rangesrvs_from_fstat(struct mdhim_t *md, struct index_t *index, 
-					long double fstat, int op) {
-	struct mdhim_stat *cur_rank, *cur_stat, *tmp, *tmp2;
-	rangesrv_list *head, *lp, *entry;
-	int slice_num = 0;
-	unsigned int num_slices;
-	unsigned int i;
+/**
+ * get_rangesrvs_from_fences
+ *
+ * Finds the range servers of an index with stats per range server that could have the 
+ * record for the operation given.  The fences whose minimum key could match are found with 
+ * a binary search, then walked back until the running maximum rules out the rest
+ *
+ * @param md          main MDHIM struct
+ * @param index       the index to look in
+ * @param istat       the key as an integer, for integer keys
+ * @param fstat       the key as a float, for float, string and byte keys
+ * @param float_type  whether the key is a float type
+ * @param op          the operation type
+ * @return the list of range servers or NULL if none could have the record
+ */
+static rangesrv_list *get_rangesrvs_from_fences(struct mdhim_t *md, struct index_t *index, 
+						uint64_t istat, long double fstat, 
+						int float_type, int op) {
+	rangesrv_list *head;
+	stat_fence_t *f;
+	char *seen;
+	int low, high, mid;
+	int i;
 
-	if (!index->stats) {
-		return 0;
+	if (!index->num_fences) {
+		return NULL;
 	}
 
-	cur_stat = cur_rank = NULL;
-	head = lp = entry = NULL;
-	HASH_ITER(hh, index->stats, cur_rank, tmp) {
-		num_slices = HASH_COUNT(cur_rank->stats);
-		i = 0;
-		HASH_ITER(hh, cur_rank->stats, cur_stat, tmp2) {
-			if (cur_stat->num <= 0) {
-				continue;
-			}
-			
-			slice_num = -1;
-			switch(op) {
-			case MDHIM_GET_NEXT:
-				if (cur_stat && *(long double *)cur_stat->max > fstat && 
-				    *(long double *)cur_stat->min - 1.0L <= fstat) {
-					slice_num = cur_stat->key;
-				} 
-				break;
-			case MDHIM_GET_PREV:
-				if (cur_stat && *(long double *)cur_stat->min < fstat && 
-				    *(long double *)cur_stat->max + 1.0L >= fstat ) {
-					slice_num = cur_stat->key;
-				} 
-				
-				break;
-			case MDHIM_GET_FIRST:
-				if (!i) {
-					slice_num = cur_stat->key;
-				}
-				break;
-			case MDHIM_GET_LAST:
-				if (i == num_slices - 1) {
-					slice_num = cur_stat->key;
-				}
-				break;
-			case MDHIM_GET_EQ:
-				if (cur_stat && *(long double *)cur_stat->max >= fstat && 
-				    *(long double *)cur_stat->min <= fstat) {
-					slice_num = cur_stat->key;
-				} 
-				
-				break;
-			default:
-				slice_num = 0;
-				break;
-			}
-			
-			if (slice_num < 0) {
-				continue;
+	head = NULL;
+	seen = malloc(index->num_rangesrvs + 1);
+	memset(seen, 0, index->num_rangesrvs + 1);
+	if (op != MDHIM_GET_NEXT && op != MDHIM_GET_PREV && op != MDHIM_GET_EQ) {
+		//Every range server with records could have the first or last record
+		for (i = 0; i < index->num_fences; i++) {
+			f = &index->fences[i];
+			if (!seen[f->rangesrv_num]) {
+				seen[f->rangesrv_num] = 1;
+				_add_to_rangesrv_list(&head, index->rangesrvs_arr[f->rangesrv_num - 1]);
 			}
+		}
 
-			entry = malloc(sizeof(rangesrv_list));
-			HASH_FIND_INT(index->rangesrvs_by_rank, &cur_rank->key, entry->ri);
-			if (!entry->ri) {
-				free(entry);
-				continue;
-			}
+		free(seen);
+		return head;
+	}
 
-			if (!head) {
-				lp = head = entry;				
-			} else {
-				lp->next = entry;
-				lp = lp->next;
-			}
+	//Find the number of fences whose minimum key could match
+	low = 0;
+	high = index->num_fences;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (fence_min_matches(index->fences[mid].min, float_type, istat, fstat, op)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
 
+	for (i = low - 1; i >= 0; i--) {
+		f = &index->fences[i];
+		//None of the fences before this one have a large enough maximum key
+		if (!fence_max_matches(f->max_before, float_type, istat, fstat, op)) {
 			break;
 		}
+
+		if (seen[f->rangesrv_num] || 
+		    !fence_max_matches(f->max, float_type, istat, fstat, op)) {
+			continue;
+		}
+
+		seen[f->rangesrv_num] = 1;
+		_add_to_rangesrv_list(&head, index->rangesrvs_arr[f->rangesrv_num - 1]);
 	}
 
+	free(seen);
+
 	return head;
 }
 
 /**
- * get_range_server_from_stats
+ * get_range_servers_from_fences
  *
- * gets the range server based on the stats acquired from a stat flush
+ * gets the range servers from the fences of the last stat flush.  The caller holds 
+ * the read lock of the stats
  * @param md        main MDHIM struct
  * @param key       pointer to the key to find the range server of
  * @param key_len   length of the key
- * @param op        operation type (
- * @return the rank of the range server or NULL on error
+ * @param istat     the key as an integer, for integer keys
+ * @param fstat     the key as a float, for float, string and byte keys
+ * @param op        operation type
+ * @return the range servers or NULL on error
  */
-rangesrv_list *get_range_servers_from_stats(struct mdhim_t *md, struct index_t *index,
-					    void *key, int key_len, int op) {
+static rangesrv_list *get_range_servers_from_fences(struct mdhim_t *md, struct index_t *index,
+						    void *key, int key_len, uint64_t istat, 
+						    long double fstat, int op) {
 	//The number that maps a key to range server (dependent on key type)
 	int slice_num, cur_slice;
 	//The range server number that we return
 	rangesrv_info *ret_rp;
 	rangesrv_list *rl;
 	int float_type = 0;
-	long double fstat = 0;
-	uint64_t istat = 0;
-
-	if (key && key_len) {
-		//Find the slice based on the operation and key value
-		if (index->key_type == MDHIM_STRING_KEY) {
-			fstat = get_str_num(key, key_len);
-		} else if (index->key_type == MDHIM_FLOAT_KEY) {
-			fstat = *(float *) key;
-		} else if (index->key_type == MDHIM_DOUBLE_KEY) {
-			fstat = *(double *) key;
-		} else if (index->key_type == MDHIM_INT_KEY) {
-			istat = *(uint32_t *) key;
-		} else if (index->key_type == MDHIM_LONG_INT_KEY) {
-			istat = *(uint64_t *) key;
-		} else if (index->key_type == MDHIM_BYTE_KEY) {
-			fstat = get_byte_num(key, key_len);
-		} 
-	}
 
 	//If we don't have any stats info, then return null	
-	if (!index->stats) {
+	if (!index->stats || !index->stats->num) {
 		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - No statistics data available." 
-		     " Perform a mdhimStatFlush first.", 
+		     " Perform a mdhimStatFlush first or wait for the stats to be published.", 
 		     md->mdhim_rank);
 		return NULL;
 	}
 
+	float_type = is_float_key(index->key_type);
 	if (index->type != LOCAL_INDEX) {
 		cur_slice = slice_num = 0;
-		float_type = is_float_key(index->key_type);
 
 		//Get the current slice number of our key
 		if (key && key_len) {
@@ -854,11 +1504,8 @@ rangesrv_list *get_range_servers_from_stats(struct mdhim_t *md, struct index_t *
 			return NULL;
 		}
 		
-		if (float_type) {
-			slice_num = get_slice_from_fstat(md, index, cur_slice, fstat, op);
-		} else {	
-			slice_num = get_slice_from_istat(md, index, cur_slice, istat, op);
-		}
+		slice_num = get_slice_from_fences(md, index, cur_slice, istat, fstat, 
+						  float_type, op);
 
 		if (slice_num == MDHIM_ERROR) {
 			return NULL;
@@ -875,14 +1522,64 @@ rangesrv_list *get_range_servers_from_stats(struct mdhim_t *md, struct index_t *
 		rl = NULL;
 		_add_to_rangesrv_list(&rl, ret_rp);
 	} else {
-		if (float_type) {
-			rl = get_rangesrvs_from_fstat(md, index, fstat, op);
-		} else {	
-			rl = get_rangesrvs_from_istat(md, index, istat, op);
-		}	       
+		rl = get_rangesrvs_from_fences(md, index, istat, fstat, float_type, op);
 	}
 
 	//Return the range server information
 	return rl;
 }
 
+/**
+ * get_range_server_from_stats
+ *
+ * gets the range server based on the stats acquired from a stat flush
+ * @param md        main MDHIM struct
+ * @param key       pointer to the key to find the range server of
+ * @param key_len   length of the key
+ * @param op        operation type (
+ * @return the rank of the range server or NULL on error
+ */
+rangesrv_list *get_range_servers_from_stats(struct mdhim_t *md, struct index_t *index,
+					    void *key, int key_len, int op) {
+	rangesrv_list *rl;
+	long double fstat = 0;
+	uint64_t istat = 0;
+
+	if (key && key_len) {
+		//Find the slice based on the operation and key value
+		if (index->key_type == MDHIM_STRING_KEY) {
+			fstat = get_str_num(key, key_len);
+		} else if (index->key_type == MDHIM_FLOAT_KEY) {
+			fstat = *(float *) key;
+		} else if (index->key_type == MDHIM_DOUBLE_KEY) {
+			fstat = *(double *) key;
+		} else if (index->key_type == MDHIM_INT_KEY) {
+			istat = *(uint32_t *) key;
+		} else if (index->key_type == MDHIM_LONG_INT_KEY) {
+			istat = *(uint64_t *) key;
+		} else if (index->key_type == MDHIM_BYTE_KEY) {
+			fstat = get_byte_num(key, key_len);
+		} 
+	}
+
+	/* Only equality lookups can be placed on a hash partitioned index.
+	   Other operations are sent to every range server */
+	if (index->partition_type == MDHIM_HASH_PARTITION) {
+		if (op == MDHIM_GET_EQ || op == MDHIM_GET_PRIMARY_EQ) {
+			return get_range_servers(md, index, key, key_len);
+		}
+
+		return get_all_range_servers(md, index);
+	}
+
+	//The stats can be replaced by the stat propagation thread while we route with them
+	while (pthread_rwlock_rdlock(index->stats_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	rl = get_range_servers_from_fences(md, index, key, key_len, istat, fstat, op);
+	pthread_rwlock_unlock(index->stats_lock);
+
+	return rl;
+}
+
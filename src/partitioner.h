@@ -29,6 +29,22 @@ extern "C"
 //An arbitrary sized key
 #define MDHIM_BYTE_KEY 6
 
+//Partitioning schemes of a global index
+//Keys are placed by slices of the key space and keep their global ordering
+#define MDHIM_RANGE_PARTITION 1
+//Keys are placed by a hash of the key; ordered operations are sent to all the range servers
+#define MDHIM_HASH_PARTITION 2
+/* Slices are placed by splitters computed from a sample of the keys; keeps global ordering.
+   Until the splitters are computed, slices are placed like MDHIM_RANGE_PARTITION */
+#define MDHIM_SPLITTER_PARTITION 3
+
+//Placement of the range servers of an index
+//Every rserver_factor'th rank of the communicator is a range server
+#define MDHIM_RANK_PLACEMENT 0
+/* Every rserver_factor'th rank of each node is a range server and the range server
+   numbers alternate between the nodes, so consecutive slices land on different nodes */
+#define MDHIM_NODE_PLACEMENT 1
+
 //Maximum length of a key
 #define MAX_KEY_LEN 1048576
 
@@ -39,6 +55,9 @@ extern "C"
 */
 #define MDHIM_ALPHABET_EXPONENT 6  
 
+//Longest key get_slice_start makes
+#define MDHIM_SLICE_START_LEN 16
+
 //Used for hashing strings to the appropriate range server
 struct mdhim_char {
     int id;            /* we'll use this field as the key */
@@ -56,17 +75,35 @@ void partitioner_init();
 void partitioner_release();
 rangesrv_list *get_range_servers(struct mdhim_t *md, struct index_t *index,
 				 void *key, int key_len);
+uint32_t get_slice_rangesrv(struct index_t *index, int slice);
+uint32_t get_routing_epoch(struct index_t *index);
 rangesrv_info *get_range_server_by_slice(struct mdhim_t *md, 
 					 struct index_t *index, int slice);
+int get_range_servers_batch(struct mdhim_t *md, struct index_t *index, 
+			    void **keys, int *key_lens, int num_keys, int *rs_idx);
+uint64_t get_key_hash(struct index_t *index, void *key, int key_len);
+int jump_consistent_hash(uint64_t key, int num_buckets);
+rangesrv_list *get_all_range_servers(struct mdhim_t *md, struct index_t *index);
+void _add_to_rangesrv_list(rangesrv_list **list, rangesrv_info *ri);
+int get_splitter_rangesrv(struct index_t *index, int slice);
+uint32_t get_slice_owner(struct index_t *index, int slice);
+void set_slice_owner(struct index_t *index, int slice, uint32_t rangesrv_num);
+int bcast_slice_owners(struct mdhim_t *md, struct index_t *index, int root);
+int compute_splitters(struct mdhim_t *md, struct index_t *index, 
+		      void **keys, int *key_lens, int num_keys);
 void build_alphabet();
 int verify_key(struct index_t *index, void *key, int key_len, int key_type);
 long double get_str_num(void *key, uint32_t key_len);
   //long double get_byte_num(void *key, uint32_t key_len);
 uint64_t get_byte_num(void *key, uint32_t key_len);
 int get_slice_num(struct mdhim_t *md, struct index_t *index, void *key, int key_len);
+int get_slice_start(struct index_t *index, int slice, int negative, void *key, 
+		    int *key_len);
 int is_float_key(int type);
+int compare_keys(int key_type, void *a, int a_len, void *b, int b_len);
 rangesrv_list *get_range_servers_from_stats(struct mdhim_t *md, struct index_t *index, 
 					    void *key, int key_len, int op);
+int build_stat_fences(struct mdhim_t *md, struct index_t *index);
 
 #ifdef __cplusplus
 }
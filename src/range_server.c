@@ -18,6 +18,7 @@
 #include "range_server.h"
 #include "partitioner.h"
 #include "mdhim_options.h"
+#include "hot_keys.h"
 
 void add_timing(struct timeval start, struct timeval end, int num, 
 		struct mdhim_t *md, int mtype) {
@@ -166,6 +167,30 @@ work_item *get_work(struct mdhim_t *md) {
 	return item;
 }
 
+/**
+ * close_cursor
+ * Closes a scan cursor that is not in the cursor table
+ *
+ * @param cur       the cursor to close
+ */
+static void close_cursor(rs_cursor_t *cur) {
+	int i;
+
+	cur->store->cursor_close(cur->cursor);
+	for (i = cur->ahead_pos; i < cur->num_ahead; i++) {
+		free(cur->ahead_keys[i]);
+		free(cur->ahead_values[i]);
+	}
+
+	free(cur->ahead_keys);
+	free(cur->ahead_key_lens);
+	free(cur->ahead_values);
+	free(cur->ahead_value_lens);
+	free(cur->end_key);
+	free(cur->key);
+	free(cur);
+}
+
 /**
  * range_server_stop
  * Stop the range server (i.e., stops the threads and frees the relevant data in md)
@@ -176,6 +201,7 @@ work_item *get_work(struct mdhim_t *md) {
 int range_server_stop(struct mdhim_t *md) {
 	int i, ret;
 	work_item *head, *temp_item;
+	rs_cursor_t *cur, *tmp_cur;
 
 	//Signal to the listener thread that it needs to shutdown
 	md->shutdown = 1;
@@ -213,6 +239,22 @@ int range_server_stop(struct mdhim_t *md) {
 	}
 	free(md->mdhim_rs->out_req_mutex);
 		
+	//Close the scan cursors before the indexes' data stores are closed
+	HASH_ITER(hh, md->mdhim_rs->cursors, cur, tmp_cur) {
+		HASH_DEL(md->mdhim_rs->cursors, cur);
+		close_cursor(cur);
+	}
+	if ((ret = pthread_mutex_destroy(md->mdhim_rs->cursors_lock)) != 0) {
+	  mlog(MDHIM_SERVER_DBG, "Rank: %d - Error destroying cursors mutex", 
+	       md->mdhim_rank);
+	}
+	free(md->mdhim_rs->cursors_lock);
+	if ((ret = pthread_mutex_destroy(md->mdhim_rs->forward_lock)) != 0) {
+	  mlog(MDHIM_SERVER_DBG, "Rank: %d - Error destroying forward mutex", 
+	       md->mdhim_rank);
+	}
+	free(md->mdhim_rs->forward_lock);
+
 	//Free the work queue
 	head = md->mdhim_rs->work_queue->head;
 	while (head) {
@@ -234,6 +276,316 @@ int range_server_stop(struct mdhim_t *md) {
 	return MDHIM_SUCCESS;
 }
 
+/**
+ * lock_routing
+ * Read locks the routing of an index while a message is handled, so the slices of the 
+ * message can't move to another range server before the message is applied
+ *
+ * @param index     the index of the message
+ * @param msg       the message to handle
+ * @return 1 if the keys of the message have to be checked against the routing, 0 otherwise
+ */
+static int lock_routing(struct index_t *index, struct mdhim_basem_t *msg) {
+	while (pthread_rwlock_rdlock(index->routing_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	//Forwarded messages were checked by the range server that forwarded them
+	if (index->type == LOCAL_INDEX || index->partition_type == MDHIM_HASH_PARTITION || 
+	    msg->forwarded) {
+		return 0;
+	}
+
+	//Keys routed with our routing are ours, unless one of our slices is moving
+	return msg->routing_epoch != index->routing_epoch || index->moving_slice >= 0;
+}
+
+/**
+ * get_serving_rangesrv
+ * Finds the range server serving a key.  The routing lock must be held
+ *
+ * @param md        Pointer to the main MDHIM struct
+ * @param index     the index of the key
+ * @param key       the key
+ * @param key_len   the length of the key
+ * @return the range server number serving the key, 0 if it is this range server
+ */
+static uint32_t get_serving_rangesrv(struct mdhim_t *md, struct index_t *index, 
+				     void *key, int key_len) {
+	int slice;
+	uint32_t rangesrv_num;
+
+	if ((slice = get_slice_num(md, index, key, key_len)) < 0) {
+		return 0;
+	}
+
+	//The source of a moving slice serves it until it switched the slice to the destination
+	if (slice == index->moving_slice) {
+		rangesrv_num = index->moving_to;
+	} else {
+		rangesrv_num = get_slice_rangesrv(index, slice);
+	}
+
+	if (rangesrv_num == index->myinfo.rangesrv_num) {
+		return 0;
+	}
+
+	return rangesrv_num;
+}
+
+/**
+ * find_forwarded_keys
+ * Finds the keys of a message served by other range servers.  The routing lock must be held
+ *
+ * @param md        Pointer to the main MDHIM struct
+ * @param index     the index of the keys
+ * @param keys      the keys of the message
+ * @param key_lens  the lengths of the keys
+ * @param num_keys  the number of keys
+ * @param targets   out  the range server number serving each key, 0 for this range server
+ * @return the number of keys served by other range servers
+ */
+static int find_forwarded_keys(struct mdhim_t *md, struct index_t *index, void **keys, 
+			       int *key_lens, int num_keys, uint32_t *targets) {
+	int i, num_forwarded;
+
+	num_forwarded = 0;
+	for (i = 0; i < num_keys; i++) {
+		if ((targets[i] = get_serving_rangesrv(md, index, keys[i], key_lens[i])) != 0) {
+			num_forwarded++;
+		}
+	}
+
+	return num_forwarded;
+}
+
+/**
+ * get_owner_rangesrv
+ * Finds the range server owning a key sent here as the copy of a hot key.  The routing 
+ * lock must be held
+ *
+ * @param md        Pointer to the main MDHIM struct
+ * @param index     the index of the key
+ * @param key       the key
+ * @param key_len   the length of the key
+ * @return the range server number owning the key, 0 if it is this range server
+ */
+static uint32_t get_owner_rangesrv(struct mdhim_t *md, struct index_t *index, 
+				   void *key, int key_len) {
+	rangesrv_list *rl, *rlp;
+	uint32_t rangesrv_num;
+
+	if (index->partition_type != MDHIM_HASH_PARTITION) {
+		return get_serving_rangesrv(md, index, key, key_len);
+	}
+
+	rangesrv_num = 0;
+	rl = get_range_servers(md, index, key, key_len);
+	if (rl && rl->ri->rangesrv_num != index->myinfo.rangesrv_num) {
+		rangesrv_num = rl->ri->rangesrv_num;
+	}
+
+	while (rl) {
+		rlp = rl;
+		rl = rl->next;
+		free(rlp);
+	}
+
+	return rangesrv_num;
+}
+
+/**
+ * mark_moved_keys
+ * Remembers the keys of the slice this range server is copying that were written, so they 
+ * are sent again when the slice switches to its new range server.  The routing lock must 
+ * be held
+ *
+ * @param md        Pointer to the main MDHIM struct
+ * @param index     the index of the keys
+ * @param keys      the written keys
+ * @param key_lens  the lengths of the keys
+ * @param num_keys  the number of keys
+ */
+static void mark_moved_keys(struct mdhim_t *md, struct index_t *index, void **keys, 
+			    int *key_lens, int num_keys) {
+	slice_key_t *sk;
+	int i;
+
+	//Only the source copies the slice and it stops once the slice switched
+	if (index->moving_slice < 0 || index->moving_to) {
+		return;
+	}
+
+	pthread_mutex_lock(index->moved_keys_lock);
+	for (i = 0; i < num_keys; i++) {
+		if (get_slice_num(md, index, keys[i], key_lens[i]) != index->moving_slice) {
+			continue;
+		}
+
+		HASH_FIND(hh, index->moved_keys, keys[i], key_lens[i], sk);
+		if (sk) {
+			continue;
+		}
+
+		sk = malloc(sizeof(slice_key_t));
+		sk->key = malloc(key_lens[i]);
+		memcpy(sk->key, keys[i], key_lens[i]);
+		sk->key_len = key_lens[i];
+		HASH_ADD_KEYPTR(hh, index->moved_keys, sk->key, sk->key_len, sk);
+	}
+
+	pthread_mutex_unlock(index->moved_keys_lock);
+}
+
+/**
+ * forward_records
+ * Sends the records of a message served by other range servers to them and waits for 
+ * their responses.  The values of forwarded gets are filled in
+ *
+ * @param md         Pointer to the main MDHIM struct
+ * @param index      the index of the records
+ * @param mtype      MDHIM_BULK_PUT, MDHIM_BULK_GET or MDHIM_BULK_DEL
+ * @param targets    the range server number serving each record, 0 for this range server
+ * @param keys       the keys of the records
+ * @param key_lens   the lengths of the keys
+ * @param values     the values of puts, the values read for gets or NULL for deletes
+ * @param value_lens the lengths of the values
+ * @param num_keys   the number of records
+ * @param append     how puts write the values
+ * @return MDHIM_SUCCESS or the first error of the range servers
+ */
+static int forward_records(struct mdhim_t *md, struct index_t *index, int mtype, 
+			   uint32_t *targets, void **keys, int *key_lens, 
+			   void **values, int *value_lens, int num_keys, int append) {
+	struct mdhim_basem_t *msg;
+	struct mdhim_bputm_t *bpm;
+	struct mdhim_bgetm_t *bgm;
+	struct mdhim_bdelm_t *bdm;
+	struct mdhim_rm_t *rm;
+	struct mdhim_bgetrm_t *bgrm;
+	void *response;
+	void **fkeys, **fvalues;
+	int *fkey_lens, *fvalue_lens, *pos, *sent;
+	rangesrv_info *ri;
+	int i, j, num, ret, error;
+
+	fkeys = malloc(sizeof(void *) * num_keys);
+	fkey_lens = malloc(sizeof(int) * num_keys);
+	fvalues = malloc(sizeof(void *) * num_keys);
+	fvalue_lens = malloc(sizeof(int) * num_keys);
+	pos = malloc(sizeof(int) * num_keys);
+	sent = malloc(sizeof(int) * num_keys);
+	memset(sent, 0, sizeof(int) * num_keys);
+	error = MDHIM_SUCCESS;
+	for (i = 0; i < num_keys; i++) {
+		if (!targets[i] || sent[i]) {
+			continue;
+		}
+
+		//Gather the records served by the range server of this one
+		for (j = i, num = 0; j < num_keys; j++) {
+			if (targets[j] != targets[i]) {
+				continue;
+			}
+
+			fkeys[num] = keys[j];
+			fkey_lens[num] = key_lens[j];
+			if (mtype == MDHIM_BULK_PUT) {
+				fvalues[num] = values[j];
+				fvalue_lens[num] = value_lens[j];
+			}
+
+			pos[num++] = j;
+			sent[j] = 1;
+		}
+
+		if (mtype == MDHIM_BULK_PUT) {
+			bpm = malloc(sizeof(struct mdhim_bputm_t));
+			bpm->keys = fkeys;
+			bpm->key_lens = fkey_lens;
+			bpm->values = fvalues;
+			bpm->value_lens = fvalue_lens;
+			bpm->num_keys = num;
+			bpm->append = append;
+			bpm->replica = NULL;
+			msg = (struct mdhim_basem_t *) bpm;
+		} else if (mtype == MDHIM_BULK_GET) {
+			bgm = malloc(sizeof(struct mdhim_bgetm_t));
+			bgm->keys = fkeys;
+			bgm->key_lens = fkey_lens;
+			bgm->num_keys = num;
+			bgm->num_recs = 1;
+			bgm->op = MDHIM_GET_EQ;
+			bgm->cursor = 0;
+			bgm->replica = NULL;
+			msg = (struct mdhim_basem_t *) bgm;
+		} else {
+			bdm = malloc(sizeof(struct mdhim_bdelm_t));
+			bdm->keys = fkeys;
+			bdm->key_lens = fkey_lens;
+			bdm->num_keys = num;
+			bdm->replica = NULL;
+			msg = (struct mdhim_basem_t *) bdm;
+		}
+
+		ri = index->rangesrvs_arr[targets[i] - 1];
+		msg->mtype = mtype;
+		msg->server_rank = ri->rank;
+		msg->index = index->id;
+		msg->index_type = index->type;
+		msg->routing_epoch = index->routing_epoch;
+		msg->forwarded = 1;
+
+		//One forward at a time, so each response is the one of the message just sent
+		response = NULL;
+		pthread_mutex_lock(md->mdhim_rs->forward_lock);
+		ret = send_rangesrv_work(md, ri->rank, msg);
+		if (ret == MDHIM_SUCCESS) {
+			ret = receive_forward_response(md, ri->rank, &response);
+		}
+
+		pthread_mutex_unlock(md->mdhim_rs->forward_lock);
+		free(msg);
+		if (ret != MDHIM_SUCCESS || !response) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error forwarding %d records to range server: %d", 
+			     md->mdhim_rank, num, ri->rangesrv_num);
+			error = MDHIM_ERROR;
+			continue;
+		}
+
+		if (mtype == MDHIM_BULK_GET) {
+			//Keep the values the range server read for our response
+			bgrm = (struct mdhim_bgetrm_t *) response;
+			for (j = 0; j < num && j < bgrm->num_keys; j++) {
+				values[pos[j]] = bgrm->values[j];
+				value_lens[pos[j]] = bgrm->value_lens[j];
+				bgrm->values[j] = NULL;
+				bgrm->value_lens[j] = 0;
+			}
+
+			ret = bgrm->error;
+		} else {
+			rm = (struct mdhim_rm_t *) response;
+			ret = rm->error;
+		}
+
+		if (ret != MDHIM_SUCCESS && error == MDHIM_SUCCESS) {
+			error = ret;
+		}
+
+		mdhim_full_release_msg(response);
+	}
+
+	free(fkeys);
+	free(fkey_lens);
+	free(fvalues);
+	free(fvalue_lens);
+	free(pos);
+	free(sent);
+
+	return error;
+}
+
 /**
  * range_server_put
  * Handles the put message and puts data in the database
@@ -257,6 +609,8 @@ int range_server_put(struct mdhim_t *md, struct mdhim_putm_t *im, int source) {
 	struct timeval start, end;
 	int inserted = 0;
 	struct index_t *index;
+	int check;
+	uint32_t target;
 
 	value = malloc(sizeof(void *));
 	*value = NULL;
@@ -272,6 +626,9 @@ int range_server_put(struct mdhim_t *md, struct mdhim_putm_t *im, int source) {
 		goto done;
 	}
 
+	//The slice can't move away until the record is written
+	check = lock_routing(index, (struct mdhim_basem_t *) im);
+
 	gettimeofday(&start, NULL);
        //Check for the key's existence
 /*	index->mdhim_store->get(index->mdhim_store->db_handle, 
@@ -284,7 +641,7 @@ int range_server_put(struct mdhim_t *md, struct mdhim_putm_t *im, int source) {
 	}
 
         //If the option to append was specified and there is old data, concat the old and new
-	if (exists &&  md->db_opts->db_value_append == MDHIM_DB_APPEND) {
+	if (exists && im->append == MDHIM_DB_APPEND) {
 		old_value = *value;
 		old_value_len = *value_len;
 		new_value_len = old_value_len + im->value_len;
@@ -301,6 +658,29 @@ int range_server_put(struct mdhim_t *md, struct mdhim_putm_t *im, int source) {
 	}
 	free(value);
 	free(value_len);
+
+	/* Copies of hot keys are kept apart from the data store.  A copy this range server 
+	   doesn't replicate (anymore) is dropped, the owner got the record too */
+	if (im->replica) {
+		if (!update_replica(md, index, im->key, im->key_len, im->value, im->value_len,
+				    im->append)) {
+			mlog(MDHIM_SERVER_DBG, "Rank: %d - Dropping the copy of a key that isn't "
+			     "replicated here", md->mdhim_rank);
+		}
+
+		goto done;
+	}
+
+	//Count the operation towards the slice's load
+	update_slice_load(md, index, &im->key, &im->key_len, 1);
+
+	//A record of a slice another range server serves now is forwarded to it
+	if (check && (target = get_serving_rangesrv(md, index, im->key, im->key_len)) != 0) {
+		error = forward_records(md, index, MDHIM_BULK_PUT, &target, &im->key, &im->key_len, 
+					&im->value, &im->value_len, 1, im->append);
+		goto done;
+	}
+
         //Put the record in the database
 	if ((ret = 
 	     index->mdhim_store->put(index->mdhim_store->db_handle, 
@@ -317,10 +697,18 @@ int range_server_put(struct mdhim_t *md, struct mdhim_putm_t *im, int source) {
 		update_stat(md, index, im->key, im->key_len);
 	}
 
+	if (check) {
+		mark_moved_keys(md, index, &im->key, &im->key_len, 1);
+	}
+
 	gettimeofday(&end, NULL);
 	add_timing(start, end, inserted, md, MDHIM_PUT);
 
 done:
+	if (index) {
+		pthread_rwlock_unlock(index->routing_lock);
+	}
+
 	//Create the response message
 	rm = malloc(sizeof(struct mdhim_rm_t));
 	//Set the type
@@ -329,12 +717,14 @@ done:
 	rm->error = error;
 	//Set the server's rank
 	rm->basem.server_rank = md->mdhim_rank;
+	//Answer forwarded messages on the forward tags
+	rm->basem.forwarded = im->basem.forwarded;
 	
 	//Send response
 	ret = send_locally_or_remote(md, source, rm);
 
 	//Free memory
-	if (exists && md->db_opts->db_value_append == MDHIM_DB_APPEND) {
+	if (exists && im->append == MDHIM_DB_APPEND) {
 		free(new_value);
 	}
 	if (source != md->mdhim_rank) {
@@ -373,6 +763,9 @@ int range_server_bput(struct mdhim_t *md, struct mdhim_bputm_t *bim, int source)
 	struct timeval start, end;
 	int num_put = 0;
 	struct index_t *index;
+	int append, blind;
+	int check, j;
+	uint32_t *targets;
 
 	gettimeofday(&start, NULL);
 	exists = malloc(bim->num_keys * sizeof(int));
@@ -390,56 +783,143 @@ int range_server_bput(struct mdhim_t *md, struct mdhim_bputm_t *bim, int source)
 		goto done;
 	}
 
-	//Iterate through the arrays and insert each record
-	for (i = 0; i < bim->num_keys && i < MAX_BULK_OPS; i++) {	
-		*value = NULL;
-		*value_len = 0;
+	//The slices can't move away until the records are written
+	check = lock_routing(index, (struct mdhim_basem_t *) bim);
+
+	/* Copies of hot keys are kept apart from the data store.  Copies this range server 
+	   doesn't replicate (anymore) are dropped, their owners got the records too */
+	for (i = j = 0; bim->replica && i < bim->num_keys; i++) {
+		if (!bim->replica[i]) {
+			bim->keys[j] = bim->keys[i];
+			bim->key_lens[j] = bim->key_lens[i];
+			bim->values[j] = bim->values[i];
+			bim->value_lens[j] = bim->value_lens[i];
+			j++;
+			continue;
+		}
 
-                //Check for the key's existence
-		index->mdhim_store->get(index->mdhim_store->db_handle, 
-					       bim->keys[i], bim->key_lens[i], value, 
-					       value_len);
-		//The key already exists
-		if (*value && *value_len) {
-			exists[i] = 1;
-		} else {
-			exists[i] = 0;
+		if (!update_replica(md, index, bim->keys[i], bim->key_lens[i], 
+				    bim->values[i], bim->value_lens[i], bim->append)) {
+			mlog(MDHIM_SERVER_DBG, "Rank: %d - Dropping the copy of a key that isn't "
+			     "replicated here", md->mdhim_rank);
 		}
 
-		//If the option to append was specified and there is old data, concat the old and new
-		if (exists[i] && md->db_opts->db_value_append == MDHIM_DB_APPEND) {
-			old_value = *value;
-			old_value_len = *value_len;
-			new_value_len = old_value_len + bim->value_lens[i];
-			new_value = malloc(new_value_len);
-			memcpy(new_value, old_value, old_value_len);
-			memcpy(new_value + old_value_len, bim->values[i], bim->value_lens[i]);		
-			if (exists[i] && source != md->mdhim_rank) {
-				free(bim->values[i]);
+		if (source != md->mdhim_rank) {
+			free(bim->keys[i]);
+			free(bim->values[i]);
+		} 
+	}
+
+	if (bim->replica) {
+		bim->num_keys = j;
+	}
+
+	//Count the operations towards the slices' loads
+	update_slice_load(md, index, bim->keys, bim->key_lens, bim->num_keys);
+
+	//Records of slices other range servers serve now are forwarded to them
+	targets = check ? malloc(sizeof(uint32_t) * bim->num_keys) : NULL;
+	if (check && find_forwarded_keys(md, index, bim->keys, bim->key_lens, 
+					 bim->num_keys, targets)) {
+		error = forward_records(md, index, MDHIM_BULK_PUT, targets, bim->keys, 
+					bim->key_lens, bim->values, bim->value_lens, 
+					bim->num_keys, bim->append);
+		for (i = j = 0; i < bim->num_keys; i++) {
+			if (targets[i]) {
+				if (source != md->mdhim_rank) {
+					free(bim->keys[i]);
+					free(bim->values[i]);
+				}
+
+				continue;
 			}
 
-			new_values[i] = new_value;
-			new_value_lens[i] = new_value_len;
+			bim->keys[j] = bim->keys[i];
+			bim->key_lens[j] = bim->key_lens[i];
+			bim->values[j] = bim->values[i];
+			bim->value_lens[j] = bim->value_lens[i];
+			j++;
+		}
+
+		bim->num_keys = j;
+	}
+
+	free(targets);
+
+	/* Only keys that may already be in the data store are read, for their old values when 
+	   appending and so that overwrites aren't counted as new keys in the stats */
+	find_new_keys(md, index, bim->keys, bim->key_lens, bim->num_keys, exists);
+
+	//Appends are written without reading the records if the data store can fold them in later
+	append = bim->append == MDHIM_DB_APPEND;
+	blind = append && index->mdhim_store->batch_append;
+	if (blind) {
+		if ((ret = 
+		     index->mdhim_store->batch_append(index->mdhim_store->db_handle, 
+						      bim->keys, bim->key_lens, bim->values, 
+						      bim->value_lens, exists, 
+						      bim->num_keys)) != MDHIM_SUCCESS) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error batch appending records", 
+			     md->mdhim_rank);
+			error = ret;
 		} else {
+			num_put = bim->num_keys;
+		}
+	} else {
+		//Iterate through the arrays and insert each record
+		for (i = 0; i < bim->num_keys && i < MAX_BULK_OPS; i++) {	
 			new_values[i] = bim->values[i];
 			new_value_lens[i] = bim->value_lens[i];
-		}
+			if (!exists[i]) {
+				continue;
+			}
+
+			*value = NULL;
+			*value_len = 0;
+
+			//Check for the key's existence
+			index->mdhim_store->get(index->mdhim_store->db_handle, 
+						       bim->keys[i], bim->key_lens[i], value, 
+						       value_len);
+			//The key already exists
+			if (*value && *value_len) {
+				exists[i] = 1;
+			} else {
+				exists[i] = 0;
+			}
+
+			//If the option to append was specified and there is old data, concat the old and new
+			if (exists[i] && append) {
+				old_value = *value;
+				old_value_len = *value_len;
+				new_value_len = old_value_len + bim->value_lens[i];
+				new_value = malloc(new_value_len);
+				memcpy(new_value, old_value, old_value_len);
+				memcpy(new_value + old_value_len, bim->values[i], bim->value_lens[i]);		
+				new_values[i] = new_value;
+				new_value_lens[i] = new_value_len;
+			}
 		
-		if (*value) {
-			free(*value);
-		}	
+			if (*value) {
+				free(*value);
+			}	
+		}
+
+		//Put the record in the database
+		if ((ret = 
+		     index->mdhim_store->batch_put(index->mdhim_store->db_handle, 
+						   bim->keys, bim->key_lens, new_values, 
+						   new_value_lens, bim->num_keys)) != MDHIM_SUCCESS) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error batch putting records", 
+			     md->mdhim_rank);
+			error = ret;
+		} else {
+			num_put = bim->num_keys;
+		}
 	}
 
-	//Put the record in the database
-	if ((ret = 
-	     index->mdhim_store->batch_put(index->mdhim_store->db_handle, 
-					   bim->keys, bim->key_lens, new_values, 
-					   new_value_lens, bim->num_keys)) != MDHIM_SUCCESS) {
-		mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error batch putting records", 
-		     md->mdhim_rank);
-		error = ret;
-	} else {
-		num_put = bim->num_keys;
+	if (check) {
+		mark_moved_keys(md, index, bim->keys, bim->key_lens, bim->num_keys);
 	}
 
 	for (i = 0; i < bim->num_keys && i < MAX_BULK_OPS; i++) {
@@ -448,7 +928,7 @@ int range_server_bput(struct mdhim_t *md, struct mdhim_bputm_t *bim, int source)
 			update_stat(md, index, bim->keys[i], bim->key_lens[i]);
 		}
 	       
-		if (exists[i] && md->db_opts->db_value_append == MDHIM_DB_APPEND) {
+		if (exists[i] && append && !blind) {
 			//Release the value created for appending the new and old value
 			free(new_values[i]);
 		}		
@@ -469,6 +949,10 @@ int range_server_bput(struct mdhim_t *md, struct mdhim_bputm_t *bim, int source)
 	add_timing(start, end, num_put, md, MDHIM_BULK_PUT);
 
  done:
+	if (index) {
+		pthread_rwlock_unlock(index->routing_lock);
+	}
+
 	//Create the response message
 	brm = malloc(sizeof(struct mdhim_rm_t));
 	//Set the type
@@ -477,12 +961,15 @@ int range_server_bput(struct mdhim_t *md, struct mdhim_bputm_t *bim, int source)
 	brm->error = error;
 	//Set the server's rank
 	brm->basem.server_rank = md->mdhim_rank;
+	//Answer forwarded messages on the forward tags
+	brm->basem.forwarded = bim->basem.forwarded;
 
 	//Release the internals of the bput message
 	free(bim->keys);
 	free(bim->key_lens);
 	free(bim->values);
 	free(bim->value_lens);
+	free(bim->replica);
 	free(bim);
 
 	//Send response
@@ -504,6 +991,8 @@ int range_server_del(struct mdhim_t *md, struct mdhim_delm_t *dm, int source) {
 	int ret = MDHIM_ERROR;
 	struct mdhim_rm_t *rm;
 	struct index_t *index;
+	int check;
+	uint32_t target;
 
 	//Get the index referenced the message
 	index = find_index(md, (struct mdhim_basem_t *) dm);
@@ -514,6 +1003,22 @@ int range_server_del(struct mdhim_t *md, struct mdhim_delm_t *dm, int source) {
 		goto done;
 	}
 
+	//A record of a slice another range server serves now is deleted there
+	check = lock_routing(index, (struct mdhim_basem_t *) dm);
+
+	//Copies of hot keys are kept apart from the data store, the owner deletes the record
+	if (dm->replica) {
+		delete_replica(index, dm->key, dm->key_len);
+		ret = MDHIM_SUCCESS;
+		goto done;
+	}
+
+	if (check && (target = get_serving_rangesrv(md, index, dm->key, dm->key_len)) != 0) {
+		ret = forward_records(md, index, MDHIM_BULK_DEL, &target, &dm->key, &dm->key_len, 
+				      NULL, NULL, 1, 0);
+		goto done;
+	}
+
 	//Put the record in the database
 	if ((ret = 
 	     index->mdhim_store->del(index->mdhim_store->db_handle, 
@@ -522,7 +1027,15 @@ int range_server_del(struct mdhim_t *md, struct mdhim_delm_t *dm, int source) {
 		     md->mdhim_rank);
 	}
 
+	if (check) {
+		mark_moved_keys(md, index, &dm->key, &dm->key_len, 1);
+	}
+
  done:
+	if (index) {
+		pthread_rwlock_unlock(index->routing_lock);
+	}
+
 	//Create the response message
 	rm = malloc(sizeof(struct mdhim_rm_t));
 	//Set the type
@@ -531,6 +1044,8 @@ int range_server_del(struct mdhim_t *md, struct mdhim_delm_t *dm, int source) {
 	rm->error = ret;
 	//Set the server's rank
 	rm->basem.server_rank = md->mdhim_rank;
+	//Answer forwarded messages on the forward tags
+	rm->basem.forwarded = dm->basem.forwarded;
 
 	//Send response
 	ret = send_locally_or_remote(md, source, rm);
@@ -554,6 +1069,14 @@ int range_server_bdel(struct mdhim_t *md, struct mdhim_bdelm_t *bdm, int source)
 	int error = 0;
 	struct mdhim_rm_t *brm;
 	struct index_t *index;
+	void **del_keys;
+	int32_t *del_key_lens;
+	int *found;
+	int num_del, num_found;
+	void *value;
+	int32_t value_len;
+	int check;
+	uint32_t *targets;
 
 	//Get the index referenced the message
 	index = find_index(md, (struct mdhim_basem_t *) bdm);
@@ -564,20 +1087,251 @@ int range_server_bdel(struct mdhim_t *md, struct mdhim_bdelm_t *bdm, int source)
 		goto done;
 	}
 
-	//Iterate through the arrays and delete each record
+	//The slices can't move away until the records are deleted
+	check = lock_routing(index, (struct mdhim_basem_t *) bdm);
+
+	del_keys = malloc(sizeof(void *) * bdm->num_keys);
+	del_key_lens = malloc(sizeof(int32_t) * bdm->num_keys);
+	found = malloc(sizeof(int) * bdm->num_keys);
+	num_del = 0;
 	for (i = 0; i < bdm->num_keys && i < MAX_BULK_OPS; i++) {
-		//Put the record in the database
-		if ((ret = 
-		     index->mdhim_store->del(index->mdhim_store->db_handle, 
-					     bdm->keys[i], bdm->key_lens[i])) 
+		//Copies of hot keys are kept apart from the data store, the owners delete the records
+		if (bdm->replica && bdm->replica[i]) {
+			delete_replica(index, bdm->keys[i], bdm->key_lens[i]);
+			continue;
+		}
+
+		del_keys[num_del] = bdm->keys[i];
+		del_key_lens[num_del] = bdm->key_lens[i];
+		num_del++;
+	}
+
+	//Records of slices other range servers serve now are deleted there
+	targets = check ? malloc(sizeof(uint32_t) * num_del) : NULL;
+	if (check && find_forwarded_keys(md, index, del_keys, del_key_lens, num_del, targets)) {
+		error = forward_records(md, index, MDHIM_BULK_DEL, targets, del_keys, 
+					del_key_lens, NULL, NULL, num_del, 0);
+		for (i = num_found = 0; i < num_del; i++) {
+			if (!targets[i]) {
+				del_keys[num_found] = del_keys[i];
+				del_key_lens[num_found] = del_key_lens[i];
+				num_found++;
+			}
+		}
+
+		num_del = num_found;
+	}
+
+	free(targets);
+
+	//Delete the records from the database with one write if the store can
+	if (index->mdhim_store->batch_del) {
+		if (num_del && (ret = index->mdhim_store->batch_del(index->mdhim_store->db_handle, 
+								    del_keys, del_key_lens, 
+								    found, num_del)) 
 		    != MDHIM_SUCCESS) {
-			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error deleting record", 
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error deleting records", 
+			     md->mdhim_rank);
+			error = ret;
+			num_del = 0;
+		}
+	} else {
+		for (i = 0; i < num_del; i++) {
+			found[i] = index->mdhim_store->get(index->mdhim_store->db_handle, 
+							   del_keys[i], del_key_lens[i], 
+							   &value, &value_len) == MDHIM_SUCCESS;
+			if (found[i]) {
+				free(value);
+			}
+
+			if ((ret = 
+			     index->mdhim_store->del(index->mdhim_store->db_handle, 
+						     del_keys[i], del_key_lens[i])) 
+			    != MDHIM_SUCCESS) {
+				mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error deleting record", 
+				     md->mdhim_rank);
+				error = ret;
+				found[i] = 0;
+			}
+		}
+	}
+
+	if (check) {
+		mark_moved_keys(md, index, del_keys, del_key_lens, num_del);
+	}
+
+	//Only the keys that were there come out of the stats
+	for (i = num_found = 0; i < num_del; i++) {
+		if (found[i]) {
+			del_keys[num_found] = del_keys[i];
+			del_key_lens[num_found] = del_key_lens[i];
+			num_found++;
+		}
+	}
+
+	remove_stats(md, index, del_keys, del_key_lens, num_found);
+	free(del_keys);
+	free(del_key_lens);
+	free(found);
+
+done:
+	if (index) {
+		pthread_rwlock_unlock(index->routing_lock);
+	}
+
+	//Create the response message
+	brm = malloc(sizeof(struct mdhim_rm_t));
+	//Set the type
+	brm->basem.mtype = MDHIM_RECV;
+	//Set the operation return code as the error
+	brm->error = error;
+	//Set the server's rank
+	brm->basem.server_rank = md->mdhim_rank;
+	//Answer forwarded messages on the forward tags
+	brm->basem.forwarded = bdm->basem.forwarded;
+
+	//Send response
+	ret = send_locally_or_remote(md, source, brm);
+	free(bdm->keys);
+	free(bdm->key_lens);
+	free(bdm->replica);
+	free(bdm);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * range_server_del_range
+ * Handles the range delete message and deletes the records between two keys 
+ * with one sweep of a cursor
+ *
+ * @param md        Pointer to the main MDHIM struct
+ * @param bdm       pointer to the delete message with the first key and the optional last key
+ * @param source    source of the message
+ * @return    MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int range_server_del_range(struct mdhim_t *md, struct mdhim_bdelm_t *bdm, int source) {
+	int i, ret;
+	int error = 0;
+	struct mdhim_rm_t *brm;
+	struct index_t *index;
+	struct mdhim_store_t *store;
+	void *cursor, *end_key;
+	void **keys;
+	int32_t *key_lens;
+	void *value;
+	int32_t value_len;
+	int end_key_len, num, num_found, num_deleted, done, op;
+	int check;
+	int *found;
+
+	//Get the index referenced the message
+	index = find_index(md, (struct mdhim_basem_t *) bdm);
+	if (!index) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error retrieving index for id: %d", 
+		     md->mdhim_rank, bdm->basem.index);
+		error = MDHIM_ERROR;
+		goto done;
+	}
+
+	//The range goes to every range server, so only the copy of a moving slice is tracked
+	check = lock_routing(index, (struct mdhim_basem_t *) bdm);
+	store = index->mdhim_store;
+	if (!store->cursor_open || !store->batch_del) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - Range deletes need a data store with cursors", 
+		     md->mdhim_rank);
+		error = MDHIM_ERROR;
+		goto done;
+	}
+
+	end_key = NULL;
+	end_key_len = 0;
+	if (bdm->num_keys > 1 && bdm->key_lens[1]) {
+		end_key = bdm->keys[1];
+		end_key_len = bdm->key_lens[1];
+	}
+
+	delete_replica_range(index, bdm->key_lens[0] ? bdm->keys[0] : NULL, bdm->key_lens[0],
+			     end_key, end_key_len);
+	if ((ret = store->cursor_open(store->db_handle, &cursor)) != MDHIM_SUCCESS) {
+		error = ret;
+		goto done;
+	}
+
+	//The cursor reads a snapshot, so the deletes don't move it
+	keys = malloc(sizeof(void *) * MDHIM_DEL_RANGE_BATCH);
+	key_lens = malloc(sizeof(int32_t) * MDHIM_DEL_RANGE_BATCH);
+	found = malloc(sizeof(int) * MDHIM_DEL_RANGE_BATCH);
+	done = store->cursor_seek(cursor, bdm->keys[0], bdm->key_lens[0], 
+				  MDHIM_GET_NEXT) != MDHIM_SUCCESS;
+	op = MDHIM_GET_EQ;
+	num_deleted = 0;
+	while (!done) {
+		for (num = 0; num < MDHIM_DEL_RANGE_BATCH; num++) {
+			if (store->cursor_get(cursor, op, &keys[num], &key_lens[num], 
+					      &value, &value_len) != MDHIM_SUCCESS) {
+				done = 1;
+				break;
+			}
+
+			op = MDHIM_GET_NEXT;
+			free(value);
+			if (end_key && compare_keys(index->key_type, keys[num], key_lens[num], 
+						    end_key, end_key_len) > 0) {
+				free(keys[num]);
+				done = 1;
+				break;
+			}
+		}
+
+		//Delete the keys swept so far with one write
+		if (num && (ret = store->batch_del(store->db_handle, keys, key_lens, 
+						   found, num)) != MDHIM_SUCCESS) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error deleting records", 
 			     md->mdhim_rank);
 			error = ret;
+			done = 1;
+			for (i = num_found = 0; i < num; i++) {
+				free(keys[i]);
+			}
+		} else {
+			/* The snapshot may still have keys another request deleted since, 
+			   so only the keys that were there come out of the stats */
+			for (i = num_found = 0; i < num; i++) {
+				if (found[i]) {
+					keys[num_found] = keys[i];
+					key_lens[num_found] = key_lens[i];
+					num_found++;
+				} else {
+					free(keys[i]);
+				}
+			}
+
+			remove_stats(md, index, keys, key_lens, num_found);
+			num_deleted += num_found;
+		}
+
+		if (check) {
+			mark_moved_keys(md, index, keys, key_lens, num_found);
+		}
+
+		for (i = 0; i < num_found; i++) {
+			free(keys[i]);
 		}
 	}
 
+	store->cursor_close(cursor);
+	free(keys);
+	free(key_lens);
+	free(found);
+	mlog(MDHIM_SERVER_INFO, "Rank: %d - Deleted %d records in a range delete", 
+	     md->mdhim_rank, num_deleted);
+
 done:
+	if (index) {
+		pthread_rwlock_unlock(index->routing_lock);
+	}
+
 	//Create the response message
 	brm = malloc(sizeof(struct mdhim_rm_t));
 	//Set the type
@@ -586,6 +1340,7 @@ done:
 	brm->error = error;
 	//Set the server's rank
 	brm->basem.server_rank = md->mdhim_rank;
+	brm->basem.forwarded = 0;
 
 	//Send response
 	ret = send_locally_or_remote(md, source, brm);
@@ -636,6 +1391,7 @@ int range_server_commit(struct mdhim_t *md, struct mdhim_basem_t *im, int source
 	rm->error = ret;
 	//Set the server's rank
 	rm->basem.server_rank = md->mdhim_rank;
+	rm->basem.forwarded = 0;
 
 	//Send response
 	ret = send_locally_or_remote(md, source, rm);
@@ -663,6 +1419,12 @@ int range_server_bget(struct mdhim_t *md, struct mdhim_bgetm_t *bgm, int source)
 	struct timeval start, end;
 	int num_retrieved = 0;
 	struct index_t *index;
+	int *batch_pos = NULL;
+	int num_batch = 0;
+	void **batch_keys, **batch_values;
+	int32_t *batch_key_lens, *batch_value_lens;
+	uint32_t *targets = NULL;
+	int num_forwarded = 0;
 
 	gettimeofday(&start, NULL);
 	values = malloc(sizeof(void *) * bgm->num_keys);
@@ -678,11 +1440,68 @@ int range_server_bget(struct mdhim_t *md, struct mdhim_bgetm_t *bgm, int source)
 		goto done;
 	}
 
+	//Keys of slices other range servers serve now are read from them
+	if (lock_routing(index, (struct mdhim_basem_t *) bgm) && bgm->op == MDHIM_GET_EQ) {
+		targets = malloc(sizeof(uint32_t) * bgm->num_keys);
+		num_forwarded = find_forwarded_keys(md, index, bgm->keys, bgm->key_lens, 
+						    bgm->num_keys, targets);
+	} else if (bgm->replica && bgm->op == MDHIM_GET_EQ) {
+		//Copies of hot keys not replicated here are read from their owners
+		targets = malloc(sizeof(uint32_t) * bgm->num_keys);
+		memset(targets, 0, sizeof(uint32_t) * bgm->num_keys);
+	}
+
+	//Count the operations towards the slices' loads
+	update_slice_load(md, index, bgm->keys, bgm->key_lens, bgm->num_keys);
+
+	//Equality lookups are read from the store together if it can
+	if (bgm->op == MDHIM_GET_EQ && index->mdhim_store->batch_get) {
+		batch_pos = malloc(sizeof(int) * bgm->num_keys);
+	}
+
 	//Iterate through the arrays and get each record
 	for (i = 0; i < bgm->num_keys && i < MAX_BULK_OPS; i++) {
 		switch(bgm->op) {
 			// Gets the value for the given key
 		case MDHIM_GET_EQ:
+			//Hot keys replicated here are served from their copies
+			if (bgm->replica && bgm->replica[i] &&
+			    get_replica_value(index, bgm->keys[i], bgm->key_lens[i], 
+					      &values[i], &value_lens[i])) {
+				if (targets) {
+					targets[i] = 0;
+				}
+
+				if (!values[i]) {
+					error = MDHIM_DB_ERROR;
+					value_lens[i] = 0;
+					continue;
+				}
+
+				break;
+			}
+
+			/* A copy this range server doesn't replicate (yet or anymore) is read from 
+			   the owner of the key */
+			if (bgm->replica && bgm->replica[i] && !targets[i] &&
+			    (targets[i] = get_owner_rangesrv(md, index, bgm->keys[i], 
+							     bgm->key_lens[i])) != 0) {
+				num_forwarded++;
+			}
+
+			if (num_forwarded && targets[i]) {
+				values[i] = NULL;
+				value_lens[i] = 0;
+				continue;
+			}
+
+			if (batch_pos) {
+				values[i] = NULL;
+				value_lens[i] = 0;
+				batch_pos[num_batch++] = i;
+				continue;
+			}
+
 			//Get records from the database
 			if ((ret = 
 			     index->mdhim_store->get(index->mdhim_store->db_handle, 
@@ -761,10 +1580,68 @@ int range_server_bget(struct mdhim_t *md, struct mdhim_bgetm_t *bgm, int source)
 		num_retrieved++;			
 	}
 
+	if (num_batch) {
+		batch_keys = malloc(sizeof(void *) * num_batch);
+		batch_key_lens = malloc(sizeof(int32_t) * num_batch);
+		batch_values = malloc(sizeof(void *) * num_batch);
+		batch_value_lens = malloc(sizeof(int32_t) * num_batch);
+		for (i = 0; i < num_batch; i++) {
+			batch_keys[i] = bgm->keys[batch_pos[i]];
+			batch_key_lens[i] = bgm->key_lens[batch_pos[i]];
+		}
+
+		if ((ret = index->mdhim_store->batch_get(index->mdhim_store->db_handle, 
+							 batch_keys, batch_key_lens, 
+							 batch_values, batch_value_lens, 
+							 num_batch)) != MDHIM_SUCCESS) {
+			error = ret;
+		}
+
+		for (i = 0; i < num_batch; i++) {
+			values[batch_pos[i]] = batch_values[i];
+			value_lens[batch_pos[i]] = batch_value_lens[i];
+			if (batch_values[i]) {
+				num_retrieved++;
+			}
+		}
+
+		free(batch_keys);
+		free(batch_key_lens);
+		free(batch_values);
+		free(batch_value_lens);
+	}
+
+	free(batch_pos);
+
+	if (num_forwarded) {
+		if ((ret = forward_records(md, index, MDHIM_BULK_GET, targets, bgm->keys, 
+					   bgm->key_lens, values, value_lens, bgm->num_keys, 
+					   0)) != MDHIM_SUCCESS) {
+			error = ret;
+		}
+
+		for (i = 0; i < bgm->num_keys; i++) {
+			if (targets[i] && values[i]) {
+				num_retrieved++;
+			}
+		}
+	}
+
+	free(targets);
+
+	//Count the reads to find hot keys
+	if (bgm->op == MDHIM_GET_EQ) {
+		record_key_reads(md, index, bgm->keys, bgm->key_lens, bgm->num_keys);
+	}
+
 	gettimeofday(&end, NULL);
 	add_timing(start, end, num_retrieved, md, MDHIM_BULK_GET);
 
 done:
+	if (index) {
+		pthread_rwlock_unlock(index->routing_lock);
+	}
+
 	//Create the response message
 	bgrm = malloc(sizeof(struct mdhim_bgetrm_t));
 	//Set the type
@@ -773,6 +1650,8 @@ done:
 	bgrm->error = error;
 	//Set the server's rank
 	bgrm->basem.server_rank = md->mdhim_rank;
+	//Answer forwarded messages on the forward tags
+	bgrm->basem.forwarded = bgm->basem.forwarded;
 	//Set the key and value
 	if (source == md->mdhim_rank) {
 		//If this message is coming from myself, copy the keys
@@ -794,6 +1673,7 @@ done:
 	bgrm->values = values;
 	bgrm->value_lens = value_lens;
 	bgrm->num_keys = bgm->num_keys;
+	bgrm->cursor = 0;
 	bgrm->basem.index = index->id;
 	bgrm->basem.index_type = index->type;
 
@@ -801,11 +1681,362 @@ done:
 	ret = send_locally_or_remote(md, source, bgrm);
 
 	//Release the bget message
+	free(bgm->replica);
 	free(bgm);
 
 	return MDHIM_SUCCESS;
 }
 
+/**
+ * take_cursor
+ * Removes a scan cursor from the cursor table so only the calling worker uses it
+ *
+ * @param md        Pointer to the main MDHIM struct
+ * @param id        the id of the cursor the client sent
+ * @param source    the rank that sent the scan
+ * @param index_id  the index being scanned
+ * @param op        the operation of the scan
+ * @return    the cursor or NULL if there is no matching open cursor
+ */
+static rs_cursor_t *take_cursor(struct mdhim_t *md, int id, int source, int index_id, int op) {
+	rs_cursor_t *cur;
+
+	pthread_mutex_lock(md->mdhim_rs->cursors_lock);
+	HASH_FIND_INT(md->mdhim_rs->cursors, &id, cur);
+	if (cur && (cur->source != source || cur->index_id != index_id || cur->op != op)) {
+		cur = NULL;
+	} else if (cur) {
+		HASH_DEL(md->mdhim_rs->cursors, cur);
+	}
+	pthread_mutex_unlock(md->mdhim_rs->cursors_lock);
+
+	return cur;
+}
+
+/**
+ * put_cursor
+ * Returns a scan cursor to the cursor table, closing idle cursors and the least 
+ * recently used ones if there are more than db_max_cursors
+ *
+ * @param md        Pointer to the main MDHIM struct
+ * @param cur       the cursor to return
+ */
+static void put_cursor(struct mdhim_t *md, rs_cursor_t *cur) {
+	rs_cursor_t *old, *tmp;
+	time_t now;
+
+	now = time(NULL);
+	cur->last_used = now;
+	pthread_mutex_lock(md->mdhim_rs->cursors_lock);
+	if (!cur->id) {
+		if (++md->mdhim_rs->next_cursor_id <= 0) {
+			md->mdhim_rs->next_cursor_id = 1;
+		}
+		cur->id = md->mdhim_rs->next_cursor_id;
+	}
+
+	HASH_ITER(hh, md->mdhim_rs->cursors, old, tmp) {
+		if (HASH_COUNT(md->mdhim_rs->cursors) < md->db_opts->db_max_cursors &&
+		    now - old->last_used <= md->db_opts->db_cursor_timeout) {
+			break;
+		}
+
+		HASH_DEL(md->mdhim_rs->cursors, old);
+		close_cursor(old);
+	}
+
+	HASH_ADD_INT(md->mdhim_rs->cursors, id, cur);
+	pthread_mutex_unlock(md->mdhim_rs->cursors_lock);
+}
+
+/**
+ * range_server_cursor_scan
+ * Reads a page of a NEXT/PREV scan from a cursor that stays open for the next page
+ * 
+ * @param md        Pointer to the main MDHIM struct
+ * @param index     the index to scan
+ * @param bgm       pointer to the get message with a single key
+ * @param source    source of the message
+ * @param op        MDHIM_GET_NEXT or MDHIM_GET_PREV
+ * @param keys      out the keys read
+ * @param key_lens  out the lengths of the keys read
+ * @param values    out the values read
+ * @param value_lens out the lengths of the values read
+ * @param num_records out the number of records read
+ * @param cursor_id out the id of the cursor left open, 0 if it was closed
+ * @return    MDHIM_SUCCESS or the error of the data store if fewer records than asked were read
+ */
+static int range_server_cursor_scan(struct mdhim_t *md, struct index_t *index, 
+				    struct mdhim_bgetm_t *bgm, int source, int op,
+				    void **keys, int32_t *key_lens, void **values, 
+				    int32_t *value_lens, int *num_records, int *cursor_id) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	rs_cursor_t *cur = NULL;
+	int ret = MDHIM_SUCCESS;
+	int j;
+
+	*num_records = 0;
+	*cursor_id = 0;
+	if (bgm->cursor) {
+		cur = take_cursor(md, bgm->cursor, source, index->id, op);
+	}
+
+	//A cursor only continues the scan if it is on the key the client continues from
+	if (cur && (cur->key_len != bgm->key_lens[0] || 
+		    memcmp(cur->key, bgm->keys[0], cur->key_len))) {
+		close_cursor(cur);
+		cur = NULL;
+	}
+
+	if (!cur) {
+		cur = malloc(sizeof(rs_cursor_t));
+		memset(cur, 0, sizeof(rs_cursor_t));
+		cur->index_id = index->id;
+		cur->source = source;
+		cur->op = op;
+		cur->store = store;
+		if ((ret = store->cursor_open(store->db_handle, &cur->cursor)) != MDHIM_SUCCESS) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error opening a cursor", 
+			     md->mdhim_rank);
+			free(cur);
+			return ret;
+		}
+
+		if ((ret = store->cursor_seek(cur->cursor, bgm->keys[0], bgm->key_lens[0], 
+						 MDHIM_GET_EQ)) 
+		    != MDHIM_SUCCESS) {
+			close_cursor(cur);
+			return ret;
+		}
+	}
+
+	//The first record is the key itself, like the scan without a cursor
+	for (j = 0; j < bgm->num_recs; j++) {
+		if ((ret = store->cursor_get(cur->cursor, j ? op : MDHIM_GET_EQ, 
+					     &keys[j], &key_lens[j], 
+					     &values[j], &value_lens[j])) != MDHIM_SUCCESS) {
+			mlog(MDHIM_SERVER_DBG, "Rank: %d - Couldn't get %s record", 
+			     md->mdhim_rank, op == MDHIM_GET_NEXT ? "next" : "prev");
+			break;
+		}
+
+		(*num_records)++;
+	}
+
+	//Keep the cursor open only if the scan can go on from it
+	if (ret != MDHIM_SUCCESS) {
+		close_cursor(cur);
+		return ret;
+	}
+
+	free(cur->key);
+	cur->key = malloc(key_lens[j - 1]);
+	memcpy(cur->key, keys[j - 1], key_lens[j - 1]);
+	cur->key_len = key_lens[j - 1];
+	put_cursor(md, cur);
+	*cursor_id = cur->id;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * cursor_read_store
+ * Reads the records of a MDHIM_GET_RANGE scan from the store's cursor, up to the end key
+ *
+ * @param cur        the cursor of the scan
+ * @param keys       out the keys read
+ * @param key_lens   out the lengths of the keys read
+ * @param values     out the values read
+ * @param value_lens out the lengths of the values read
+ * @param max        the maximum number of records to read
+ * @return    the number of records read
+ */
+static int cursor_read_store(rs_cursor_t *cur, void **keys, int32_t *key_lens, 
+			     void **values, int32_t *value_lens, int max) {
+	int num = 0;
+	int ret;
+
+	while (num < max && !cur->done) {
+		ret = cur->store->cursor_get(cur->cursor, 
+					     cur->positioned ? MDHIM_GET_EQ : MDHIM_GET_NEXT,
+					     &keys[num], &key_lens[num], 
+					     &values[num], &value_lens[num]);
+		cur->positioned = 0;
+		if (ret != MDHIM_SUCCESS) {
+			cur->done = 1;
+			break;
+		}
+
+		//Stop at the first key after the end of the scan
+		if (cur->end_key && compare_keys(cur->key_type, keys[num], key_lens[num], 
+						 cur->end_key, cur->end_key_len) > 0) {
+			free(keys[num]);
+			free(values[num]);
+			keys[num] = values[num] = NULL;
+			key_lens[num] = value_lens[num] = 0;
+			cur->done = 1;
+			break;
+		}
+
+		num++;
+	}
+
+	return num;
+}
+
+/**
+ * range_server_range_scan
+ * Reads a page of a MDHIM_GET_RANGE scan, continuing from the scan's cursor if it is open
+ * 
+ * @param md        Pointer to the main MDHIM struct
+ * @param index     the index to scan
+ * @param bgm       pointer to the get message with the start key and the optional end key
+ * @param source    source of the message
+ * @param keys      out the keys read
+ * @param key_lens  out the lengths of the keys read
+ * @param values    out the values read
+ * @param value_lens out the lengths of the values read
+ * @param num_records out the number of records read
+ * @param cursor_id out the id of the cursor left open, 0 if the scan is done
+ * @return    MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+static int range_server_range_scan(struct mdhim_t *md, struct index_t *index, 
+				   struct mdhim_bgetm_t *bgm, int source,
+				   void **keys, int32_t *key_lens, void **values, 
+				   int32_t *value_lens, int *num_records, int *cursor_id) {
+	struct mdhim_store_t *store = index->mdhim_store;
+	rs_cursor_t *cur = NULL;
+	int ret, num;
+
+	*num_records = 0;
+	*cursor_id = 0;
+	if (!store->cursor_open) {
+		mlog(MDHIM_SERVER_CRIT, "Rank: %d - Scans need a data store with cursors", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	if (bgm->cursor) {
+		cur = take_cursor(md, bgm->cursor, source, index->id, MDHIM_GET_RANGE);
+	}
+
+	//A cursor only continues the scan if it is on the key the client continues from
+	if (cur && (!cur->key || cur->key_len != bgm->key_lens[0] || 
+		    memcmp(cur->key, bgm->keys[0], cur->key_len))) {
+		close_cursor(cur);
+		cur = NULL;
+	}
+
+	if (!cur) {
+		cur = malloc(sizeof(rs_cursor_t));
+		memset(cur, 0, sizeof(rs_cursor_t));
+		cur->index_id = index->id;
+		cur->source = source;
+		cur->op = MDHIM_GET_RANGE;
+		cur->store = store;
+		cur->key_type = index->key_type;
+		if ((ret = store->cursor_open(store->db_handle, &cur->cursor)) != MDHIM_SUCCESS) {
+			mlog(MDHIM_SERVER_CRIT, "Rank: %d - Error opening a cursor", 
+			     md->mdhim_rank);
+			free(cur);
+			return ret;
+		}
+
+		if (bgm->num_keys > 1 && bgm->key_lens[1]) {
+			cur->end_key = malloc(bgm->key_lens[1]);
+			memcpy(cur->end_key, bgm->keys[1], bgm->key_lens[1]);
+			cur->end_key_len = bgm->key_lens[1];
+		}
+
+		//An empty start key starts the scan at the first key
+		cur->positioned = 1;
+		if (store->cursor_seek(cur->cursor, bgm->keys[0], bgm->key_lens[0], 
+				       MDHIM_GET_NEXT) != MDHIM_SUCCESS) {
+			cur->done = 1;
+		}
+	}
+
+	//The records read ahead after the last page come first
+	num = 0;
+	while (num < bgm->num_recs && cur->ahead_pos < cur->num_ahead) {
+		keys[num] = cur->ahead_keys[cur->ahead_pos];
+		key_lens[num] = cur->ahead_key_lens[cur->ahead_pos];
+		values[num] = cur->ahead_values[cur->ahead_pos];
+		value_lens[num] = cur->ahead_value_lens[cur->ahead_pos];
+		cur->ahead_pos++;
+		num++;
+	}
+
+	if (cur->ahead_pos == cur->num_ahead) {
+		free(cur->ahead_keys);
+		free(cur->ahead_key_lens);
+		free(cur->ahead_values);
+		free(cur->ahead_value_lens);
+		cur->ahead_keys = cur->ahead_values = NULL;
+		cur->ahead_key_lens = cur->ahead_value_lens = NULL;
+		cur->num_ahead = cur->ahead_pos = 0;
+	}
+
+	num += cursor_read_store(cur, keys + num, key_lens + num, values + num, 
+				 value_lens + num, bgm->num_recs - num);
+	*num_records = num;
+
+	//Keep the cursor open only if the scan can go on from it
+	if (cur->done && !cur->num_ahead) {
+		close_cursor(cur);
+		return MDHIM_SUCCESS;
+	}
+
+	free(cur->key);
+	cur->key = malloc(key_lens[num - 1]);
+	memcpy(cur->key, keys[num - 1], key_lens[num - 1]);
+	cur->key_len = key_lens[num - 1];
+	put_cursor(md, cur);
+	*cursor_id = cur->id;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * range_server_read_ahead
+ * Reads the next page of a MDHIM_GET_RANGE scan while the client works on the last one
+ * 
+ * @param md        Pointer to the main MDHIM struct
+ * @param index     the index being scanned
+ * @param cursor_id the id of the scan's cursor
+ * @param source    the rank that scans
+ * @param num_recs  the number of records to read
+ */
+static void range_server_read_ahead(struct mdhim_t *md, struct index_t *index, 
+				    int cursor_id, int source, int num_recs) {
+	rs_cursor_t *cur;
+
+	if ((cur = take_cursor(md, cursor_id, source, index->id, MDHIM_GET_RANGE)) == NULL) {
+		return;
+	}
+
+	if (!cur->num_ahead && !cur->done) {
+		cur->ahead_keys = malloc(sizeof(void *) * num_recs);
+		cur->ahead_key_lens = malloc(sizeof(int32_t) * num_recs);
+		cur->ahead_values = malloc(sizeof(void *) * num_recs);
+		cur->ahead_value_lens = malloc(sizeof(int32_t) * num_recs);
+		cur->ahead_pos = 0;
+		cur->num_ahead = cursor_read_store(cur, cur->ahead_keys, cur->ahead_key_lens,
+						   cur->ahead_values, cur->ahead_value_lens, 
+						   num_recs);
+		if (!cur->num_ahead) {
+			free(cur->ahead_keys);
+			free(cur->ahead_key_lens);
+			free(cur->ahead_values);
+			free(cur->ahead_value_lens);
+			cur->ahead_keys = cur->ahead_values = NULL;
+			cur->ahead_key_lens = cur->ahead_value_lens = NULL;
+		}
+	}
+
+	put_cursor(md, cur);
+}
+
 /**
  * range_server_bget_op
  * Handles the get message given an op and number of records greater than 1
@@ -832,6 +2063,7 @@ int range_server_bget_op(struct mdhim_t *md, struct mdhim_bgetm_t *bgm, int sour
 	int num_records;
 	struct timeval start, end;
 	struct index_t *index;
+	int cursor_id = 0;
 
 	//Initialize pointers and lengths
 	values = malloc(sizeof(void *) * bgm->num_keys * bgm->num_recs);
@@ -865,9 +2097,30 @@ int range_server_bget_op(struct mdhim_t *md, struct mdhim_bgetm_t *bgm, int sour
 		goto respond;
 	}
 
+	//Count the operations towards the slices' loads
+	if (op != MDHIM_GET_RANGE) {
+		update_slice_load(md, index, bgm->keys, bgm->key_lens, bgm->num_keys);
+	}
+
 	mlog(MDHIM_SERVER_CRIT, "Rank: %d - Num keys is: %d and num recs is: %d", 
 	     md->mdhim_rank, bgm->num_keys, bgm->num_recs);
 	gettimeofday(&start, NULL);
+	if (op == MDHIM_GET_RANGE) {
+		error = range_server_range_scan(md, index, bgm, source, keys, key_lens,
+						values, value_lens, &num_records, &cursor_id);
+		goto respond;
+	}
+
+	//A scan from a single key continues from a cursor instead of seeking for every record
+	if ((op == MDHIM_GET_NEXT || op == MDHIM_GET_PREV) && bgm->num_keys == 1 &&
+	    bgm->num_recs > 0 &&
+	    bgm->key_lens[0] && bgm->keys[0] && index->mdhim_store->cursor_open &&
+	    md->db_opts->db_max_cursors > 0) {
+		error = range_server_cursor_scan(md, index, bgm, source, op, keys, key_lens,
+						 values, value_lens, &num_records, &cursor_id);
+		goto respond;
+	}
+
 	//Iterate through the arrays and get each record
 	for (i = 0; i < bgm->num_keys; i++) {
 		for (j = 0; j < bgm->num_recs; j++) {
@@ -977,18 +2230,25 @@ respond:
 	bgrm->error = error;
 	//Set the server's rank
 	bgrm->basem.server_rank = md->mdhim_rank;
+	bgrm->basem.forwarded = 0;
 	//Set the keys and values
 	bgrm->keys = keys;
 	bgrm->key_lens = key_lens;
 	bgrm->values = values;
 	bgrm->value_lens = value_lens;
 	bgrm->num_keys = num_records;
+	bgrm->cursor = cursor_id;
 	bgrm->basem.index = index->id;
 	bgrm->basem.index_type = index->type;
        
 	//Send response
 	ret = send_locally_or_remote(md, source, bgrm);
 
+	//Read the next page of a scan before the client asks for it
+	if (op == MDHIM_GET_RANGE && cursor_id) {
+		range_server_read_ahead(md, index, cursor_id, source, bgm->num_recs);
+	}
+
 	//Free stuff
 	if (source == md->mdhim_rank) {
 		/* If this message is not coming from myself, 
@@ -1116,7 +2376,7 @@ void *worker_thread(void *data) {
 				num_records = ((struct mdhim_bgetm_t *) item->message)->num_recs;
 				num_keys = ((struct mdhim_bgetm_t *) item->message)->num_keys;
 				//The client is sending one key, but requesting the retrieval of more than one
-				if (num_records > 1 && num_keys == 1) {
+				if ((num_records > 1 && num_keys == 1) || op == MDHIM_GET_RANGE) {
 					range_server_bget_op(md, 
 							     item->message, 
 							     item->source, op);
@@ -1133,6 +2393,9 @@ void *worker_thread(void *data) {
 			case MDHIM_BULK_DEL:
 				range_server_bdel(md, item->message, item->source);
 				break;
+			case MDHIM_RANGE_DEL:
+				range_server_del_range(md, item->message, item->source);
+				break;
 			case MDHIM_COMMIT:
 				range_server_commit(md, item->message, item->source);
 				break;		
@@ -1265,6 +2528,37 @@ int range_server_init(struct mdhim_t *md) {
 
 	//Initialize the outstanding request list
 	md->mdhim_rs->out_req_list = NULL;
+	md->mdhim_rs->work_size_req = NULL;
+
+	//Initialize the scan cursors
+	md->mdhim_rs->cursors = NULL;
+	md->mdhim_rs->next_cursor_id = 0;
+	md->mdhim_rs->cursors_lock = malloc(sizeof(pthread_mutex_t));
+	if (!md->mdhim_rs->cursors_lock) {
+		mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - " 
+		     "Error while allocating memory for range server", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+	if ((ret = pthread_mutex_init(md->mdhim_rs->cursors_lock, NULL)) != 0) {    
+		mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - " 
+		     "Error while initializing cursors mutex", md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+
+	//Initialize the mutex of forwarded messages
+	md->mdhim_rs->forward_lock = malloc(sizeof(pthread_mutex_t));
+	if (!md->mdhim_rs->forward_lock) {
+		mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - " 
+		     "Error while allocating memory for range server", 
+		     md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
+	if ((ret = pthread_mutex_init(md->mdhim_rs->forward_lock, NULL)) != 0) {    
+		mlog(MDHIM_SERVER_CRIT, "MDHIM Rank: %d - " 
+		     "Error while initializing forward mutex", md->mdhim_rank);
+		return MDHIM_ERROR;
+	}
 
 	//Initialize work queue mutex
 	md->mdhim_rs->work_queue_mutex = malloc(sizeof(pthread_mutex_t));
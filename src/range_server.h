@@ -2,6 +2,7 @@
 #define      __RANGESRV_H
 
 #include <pthread.h>
+#include <time.h>
 #include <mpi.h>
 #include "data_store.h"
 #include "messages.h"
@@ -31,6 +32,35 @@ struct out_req {
 	MPI_Request *message;
 };
 
+/* A data store cursor kept open between the pages of a NEXT/PREV scan */
+typedef struct rs_cursor_t {
+	int id;                      //Key for the hash table, sent to the client
+	int index_id;                //The index the cursor reads
+	int source;                  //The rank that scans with the cursor
+	int op;                      //MDHIM_GET_NEXT, MDHIM_GET_PREV or MDHIM_GET_RANGE
+	struct mdhim_store_t *store; //The data store the cursor was opened on
+	void *cursor;                //The data store's cursor
+	void *key;                   //The last key returned, where the next page starts
+	int key_len;
+	time_t last_used;
+	int key_type;                //The key type of the index
+	void *end_key;               //The last key of a MDHIM_GET_RANGE scan, NULL if unbounded
+	int end_key_len;
+	int positioned;              //Whether the store's cursor is on a record not read yet
+	int done;                    //Whether the store's cursor passed the last record of the scan
+	//Records of a MDHIM_GET_RANGE scan read ahead of the client's next page
+	void **ahead_keys;
+	int32_t *ahead_key_lens;
+	void **ahead_values;
+	int32_t *ahead_value_lens;
+	int num_ahead;
+	int ahead_pos;
+	UT_hash_handle hh;
+} rs_cursor_t;
+
+//Number of keys a range delete removes with each write
+#define MDHIM_DEL_RANGE_BATCH 10000
+
 /* Range server specific data */
 typedef struct mdhim_rs_t {
 	work_queue_t *work_queue;
@@ -48,6 +78,16 @@ typedef struct mdhim_rs_t {
 	long num_get;
 	out_req *out_req_list;
 	pthread_mutex_t *out_req_mutex;
+	//The receive of the next work size, kept across calls while work arrives in shared memory
+	MPI_Request *work_size_req;
+	int work_size;
+	/* Open scan cursors that are not in use by a worker.  Key is the cursor id
+	   Cursors are added at the end when released, so the head is the least recently used */
+	rs_cursor_t *cursors;
+	pthread_mutex_t *cursors_lock;
+	int next_cursor_id;
+	//Lock held while forwarding a message, so the responses of forwards can't cross
+	pthread_mutex_t *forward_lock;
 } mdhim_rs_t;
 
 int range_server_add_work(struct mdhim_t *md, work_item *item);
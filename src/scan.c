@@ -0,0 +1,347 @@
+/*
+ * MDHIM TNG
+ *
+ * Key range scans across range servers
+ *
+ * A scan asks every range server of the index for a page of its records from the start
+ * key on (MDHIM_GET_RANGE) and merges the pages in key order.  When the records of a range
+ * server's page are used up, the next page is asked for with the last key returned from
+ * it and the cursor id the range server sent back.  The range server keeps its cursor
+ * open between pages and reads the next page ahead while the client works on the last one.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "scan.h"
+#include "client.h"
+#include "local_client.h"
+#include "partitioner.h"
+
+/**
+ * scan_request
+ * Asks the range servers whose pages are used up for their next pages
+ *
+ * @param md        main MDHIM struct
+ * @param scan      the scan
+ * @param needs     whether each range server needs a new page.  Indexed by range server number - 1
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+static int scan_request(struct mdhim_t *md, struct mdhim_scan_t *scan, int *needs) {
+	struct index_t *index = scan->index;
+	struct mdhim_bgetm_t **bgm_list;
+	struct mdhim_bgetm_t *bgm, *lbgm;
+	struct mdhim_bgetrm_t *bgrm_head, *bgrm, *next;
+	scan_stream_t *stream;
+	rangesrv_info *ri;
+	int *requested;
+	int i;
+
+	lbgm = NULL;
+	bgm_list = malloc(sizeof(struct mdhim_bgetm_t *) * index->num_rangesrvs);
+	memset(bgm_list, 0, sizeof(struct mdhim_bgetm_t *) * index->num_rangesrvs);
+	requested = malloc(sizeof(int) * index->num_rangesrvs);
+	memset(requested, 0, sizeof(int) * index->num_rangesrvs);
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!needs[i]) {
+			continue;
+		}
+
+		stream = &scan->streams[i];
+		bgm = malloc(sizeof(struct mdhim_bgetm_t));
+		memset(bgm, 0, sizeof(struct mdhim_bgetm_t));
+		bgm->keys = malloc(sizeof(void *) * 2);
+		bgm->key_lens = malloc(sizeof(int) * 2);
+
+		/* A next page starts at the last key returned, which the range server sends
+		   again if it is still there, so one more record is asked for */
+		if (stream->last_key) {
+			bgm->keys[0] = stream->last_key;
+			bgm->key_lens[0] = stream->last_key_len;
+			bgm->num_recs = scan->page_size + 1;
+		} else {
+			bgm->keys[0] = scan->start_key;
+			bgm->key_lens[0] = scan->start_key_len;
+			bgm->num_recs = scan->page_size;
+		}
+
+		bgm->num_keys = 1;
+		if (scan->end_key) {
+			bgm->keys[1] = scan->end_key;
+			bgm->key_lens[1] = scan->end_key_len;
+			bgm->num_keys = 2;
+		}
+
+		requested[i] = bgm->num_recs;
+		bgm->cursor = stream->cursor;
+		bgm->op = MDHIM_GET_RANGE;
+		bgm->basem.mtype = MDHIM_BULK_GET;
+		bgm->basem.server_rank = stream->ri->rank;
+		bgm->basem.index = index->id;
+		bgm->basem.index_type = index->type;
+		bgm->basem.routing_epoch = get_routing_epoch(index);
+		bgm->basem.forwarded = 0;
+		if (stream->ri->rank != md->mdhim_rank) {
+			bgm_list[i] = bgm;
+		} else {
+			lbgm = bgm;
+		}
+	}
+
+	bgrm_head = client_bget(md, index, bgm_list);
+	if (lbgm) {
+		bgrm = local_client_bget(md, lbgm);
+		if (bgrm) {
+			bgrm->next = bgrm_head;
+			bgrm_head = bgrm;
+		}
+	}
+
+	//Give each range server its page
+	for (bgrm = bgrm_head; bgrm; bgrm = next) {
+		next = bgrm->next;
+		bgrm->next = NULL;
+		HASH_FIND_INT(index->rangesrvs_by_rank, &bgrm->basem.server_rank, ri);
+		if (!ri || !needs[ri->rangesrv_num - 1]) {
+			mdhim_full_release_msg(bgrm);
+			continue;
+		}
+
+		stream = &scan->streams[ri->rangesrv_num - 1];
+		needs[ri->rangesrv_num - 1] = 0;
+		mdhim_full_release_msg(stream->page);
+		stream->page = bgrm;
+		stream->pos = 0;
+		stream->cursor = bgrm->cursor;
+		stream->last_page = bgrm->num_keys < requested[ri->rangesrv_num - 1];
+		if (bgrm->error != MDHIM_SUCCESS) {
+			mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+			     "Error: %d from range server: %d while scanning",
+			     md->mdhim_rank, bgrm->error, ri->rank);
+			scan->error = MDHIM_ERROR;
+			stream->last_page = 1;
+		}
+
+		//Skip the last key returned if the range server sent it again
+		if (stream->last_key && bgrm->num_keys &&
+		    bgrm->key_lens[0] == stream->last_key_len &&
+		    !memcmp(bgrm->keys[0], stream->last_key, stream->last_key_len)) {
+			stream->pos = 1;
+		}
+	}
+
+	//Range servers that didn't answer are not asked again
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!needs[i]) {
+			continue;
+		}
+
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Error: did not receive a scan page from range server: %d",
+		     md->mdhim_rank, scan->streams[i].ri->rank);
+		scan->error = MDHIM_ERROR;
+		scan->streams[i].last_page = 1;
+	}
+
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		if (!bgm_list[i]) {
+			continue;
+		}
+
+		free(bgm_list[i]->keys);
+		free(bgm_list[i]->key_lens);
+		free(bgm_list[i]);
+	}
+
+	free(bgm_list);
+	free(requested);
+
+	return scan->error;
+}
+
+/**
+ * scan_open
+ * Starts a scan of the records from the first key not before the start key
+ * up to the end key and asks the range servers for their first pages
+ *
+ * @param md            main MDHIM struct
+ * @param index         the index to scan
+ * @param start_key     the first key of the scan, NULL to start at the first key
+ * @param start_key_len the length of the start key
+ * @param end_key       the last key of the scan, NULL to go to the last key
+ * @param end_key_len   the length of the end key
+ * @param limit         the maximum number of records to return, 0 for no limit
+ * @return the scan or NULL on error
+ */
+struct mdhim_scan_t *scan_open(struct mdhim_t *md, struct index_t *index,
+			       void *start_key, int start_key_len,
+			       void *end_key, int end_key_len, int limit) {
+	struct mdhim_scan_t *scan;
+	int *needs;
+	int i;
+
+	scan = malloc(sizeof(struct mdhim_scan_t));
+	memset(scan, 0, sizeof(struct mdhim_scan_t));
+	scan->index = index;
+	scan->limit = limit;
+	scan->page_size = limit > 0 && limit < MDHIM_SCAN_PAGE_SIZE ?
+		limit : MDHIM_SCAN_PAGE_SIZE;
+	if (start_key && start_key_len) {
+		scan->start_key = malloc(start_key_len);
+		memcpy(scan->start_key, start_key, start_key_len);
+		scan->start_key_len = start_key_len;
+	}
+	if (end_key && end_key_len) {
+		scan->end_key = malloc(end_key_len);
+		memcpy(scan->end_key, end_key, end_key_len);
+		scan->end_key_len = end_key_len;
+	}
+
+	scan->streams = malloc(sizeof(scan_stream_t) * index->num_rangesrvs);
+	memset(scan->streams, 0, sizeof(scan_stream_t) * index->num_rangesrvs);
+	needs = malloc(sizeof(int) * index->num_rangesrvs);
+	for (i = 0; i < index->num_rangesrvs; i++) {
+		scan->streams[i].ri = index->rangesrvs_arr[i];
+		needs[i] = scan->streams[i].ri != NULL;
+		scan->streams[i].last_page = !needs[i];
+	}
+
+	if (scan_request(md, scan, needs) != MDHIM_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Error while starting the scan", md->mdhim_rank);
+		free(needs);
+		scan_close(md, scan);
+		return NULL;
+	}
+
+	free(needs);
+
+	return scan;
+}
+
+/**
+ * scan_next
+ * Gets the next page of records of the scan in key order
+ *
+ * @param md        main MDHIM struct
+ * @param scan      the scan
+ * @return the records in a mdhim_bgetrm_t or NULL if the scan is done or on error
+ */
+struct mdhim_bgetrm_t *scan_next(struct mdhim_t *md, struct mdhim_scan_t *scan) {
+	struct index_t *index = scan->index;
+	struct mdhim_bgetrm_t *bgrm;
+	scan_stream_t *stream, *min;
+	int *needs;
+	int num, max, need, i;
+
+	if (scan->error != MDHIM_SUCCESS) {
+		return NULL;
+	}
+
+	max = scan->page_size;
+	if (scan->limit > 0 && scan->limit - scan->returned < max) {
+		max = scan->limit - scan->returned;
+	}
+	if (max <= 0) {
+		return NULL;
+	}
+
+	bgrm = malloc(sizeof(struct mdhim_bgetrm_t));
+	memset(bgrm, 0, sizeof(struct mdhim_bgetrm_t));
+	bgrm->basem.mtype = MDHIM_RECV_BULK_GET;
+	bgrm->basem.server_rank = md->mdhim_rank;
+	bgrm->basem.index = index->id;
+	bgrm->basem.index_type = index->type;
+	bgrm->keys = malloc(sizeof(void *) * max);
+	bgrm->key_lens = malloc(sizeof(int) * max);
+	bgrm->values = malloc(sizeof(void *) * max);
+	bgrm->value_lens = malloc(sizeof(int) * max);
+
+	needs = malloc(sizeof(int) * index->num_rangesrvs);
+	num = 0;
+	while (num < max) {
+		//Every range server needs a record to merge on, unless it has none left
+		need = 0;
+		for (i = 0; i < index->num_rangesrvs; i++) {
+			stream = &scan->streams[i];
+			needs[i] = !stream->last_page &&
+				(!stream->page || stream->pos >= stream->page->num_keys);
+			need |= needs[i];
+		}
+
+		if (need && scan_request(md, scan, needs) != MDHIM_SUCCESS) {
+			break;
+		}
+
+		//Take the smallest key of the range servers' pages
+		min = NULL;
+		for (i = 0; i < index->num_rangesrvs; i++) {
+			stream = &scan->streams[i];
+			if (!stream->page || stream->pos >= stream->page->num_keys) {
+				continue;
+			}
+
+			if (!min || compare_keys(index->key_type,
+						 stream->page->keys[stream->pos],
+						 stream->page->key_lens[stream->pos],
+						 min->page->keys[min->pos],
+						 min->page->key_lens[min->pos]) < 0) {
+				min = stream;
+			}
+		}
+
+		if (!min) {
+			break;
+		}
+
+		bgrm->keys[num] = min->page->keys[min->pos];
+		bgrm->key_lens[num] = min->page->key_lens[min->pos];
+		bgrm->values[num] = min->page->values[min->pos];
+		bgrm->value_lens[num] = min->page->value_lens[min->pos];
+		min->page->keys[min->pos] = NULL;
+		min->page->values[min->pos] = NULL;
+		min->pos++;
+
+		free(min->last_key);
+		min->last_key = malloc(bgrm->key_lens[num]);
+		memcpy(min->last_key, bgrm->keys[num], bgrm->key_lens[num]);
+		min->last_key_len = bgrm->key_lens[num];
+		num++;
+	}
+
+	free(needs);
+	scan->returned += num;
+	bgrm->num_keys = num;
+	bgrm->error = scan->error;
+	if (!num) {
+		mdhim_full_release_msg(bgrm);
+		return NULL;
+	}
+
+	return bgrm;
+}
+
+/**
+ * scan_close
+ * Ends a scan and frees it
+ *
+ * @param md        main MDHIM struct
+ * @param scan      the scan
+ */
+void scan_close(struct mdhim_t *md, struct mdhim_scan_t *scan) {
+	int i;
+
+	if (!scan) {
+		return;
+	}
+
+	//The range servers close the cursors of the scan when they time out
+	for (i = 0; i < scan->index->num_rangesrvs; i++) {
+		mdhim_full_release_msg(scan->streams[i].page);
+		free(scan->streams[i].last_key);
+	}
+
+	free(scan->streams);
+	free(scan->start_key);
+	free(scan->end_key);
+	free(scan);
+}
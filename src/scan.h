@@ -0,0 +1,47 @@
+/*
+ * MDHIM TNG
+ *
+ * Key range scans across range servers
+ */
+
+#ifndef      __SCAN_H
+#define      __SCAN_H
+
+#include "mdhim.h"
+#include "indexes.h"
+
+//Maximum number of records a scan reads from a range server at a time
+#define MDHIM_SCAN_PAGE_SIZE 1024
+
+/* The pages read from one range server during a scan */
+typedef struct scan_stream_t {
+	rangesrv_info *ri;
+	struct mdhim_bgetrm_t *page; //The last page received from the range server
+	int pos;                     //The next record of the page to return
+	int cursor;                  //The range server's cursor for the scan, 0 if none
+	int last_page;               //Whether the page is the last one the range server has
+	void *last_key;              //The last key returned from this range server
+	int last_key_len;
+} scan_stream_t;
+
+/* A scan of the records of an index between two keys, in key order */
+struct mdhim_scan_t {
+	struct index_t *index;
+	void *start_key;
+	int start_key_len;
+	void *end_key;               //NULL if the scan goes to the last key
+	int end_key_len;
+	int limit;                   //Maximum number of records to return, 0 for no limit
+	int returned;                //Number of records returned so far
+	int page_size;
+	int error;
+	scan_stream_t *streams;      //Indexed by range server number - 1
+};
+
+struct mdhim_scan_t *scan_open(struct mdhim_t *md, struct index_t *index,
+			       void *start_key, int start_key_len,
+			       void *end_key, int end_key_len, int limit);
+struct mdhim_bgetrm_t *scan_next(struct mdhim_t *md, struct mdhim_scan_t *scan);
+void scan_close(struct mdhim_t *md, struct mdhim_scan_t *scan);
+
+#endif
@@ -0,0 +1,362 @@
+/*
+ * MDHIM TNG
+ *
+ * Shared memory transport between clients and range servers on the same node
+ *
+ * The ranks of a node allocate an MPI-3 shared memory window.  Each rank's segment holds,
+ * for every other rank of the node, a request ring it reads work from when it is a range
+ * server and a response ring it reads replies from when it is a client.  A ring has one
+ * producing rank and one consuming rank, so head and tail are advanced with plain atomic
+ * loads and stores instead of locks or MPI calls.  Packed messages are copied straight
+ * into the ring and unpacked from it by the consumer.
+ *
+ * Messages that don't fit in a ring still go over MPI.  A range server that can't fit a
+ * response writes an empty record instead, which tells the client to receive it over MPI.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mdhim.h"
+#include "shm_transport.h"
+
+//Bytes of the header in front of every record: the length of the message and padding
+#define SHM_RECORD_HEADER 8
+//Length of the record that marks the unused end of the ring before it wraps
+#define SHM_RECORD_SKIP -1
+//Number of times a ring is polled before sleeping
+#define SHM_SPIN_COUNT 1000
+
+#define SHM_ALIGN(x) (((uint64_t) (x) + 7) & ~((uint64_t) 7))
+
+/**
+ * get_ring
+ * Gets the ring a producer writes to and a consumer reads from
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param consumer  The rank reading from the ring
+ * @param producer  The rank writing to the ring
+ * @param ring_type MDHIM_SHM_REQUEST or MDHIM_SHM_RESPONSE
+ * @return the ring
+ */
+static shm_ring_t *get_ring(struct mdhim_t *md, int consumer, int producer, int ring_type) {
+	mdhim_shm_t *shm = md->shm;
+
+	return (shm_ring_t *) (shm->bases[md->rank_node_ranks[consumer]] +
+			       (ring_type * shm->node_size + md->rank_node_ranks[producer]) *
+			       shm->ring_bytes);
+}
+
+/**
+ * ring_peek
+ * Gets the oldest record of a ring without removing it
+ *
+ * @param shm       The shared memory transport
+ * @param ring      The ring to look at
+ * @param buf       out: the message in the ring
+ * @param size      out: the length of the message
+ * @return 1 if the ring had a record, 0 if it was empty
+ */
+static int ring_peek(mdhim_shm_t *shm, shm_ring_t *ring, void **buf, int *size) {
+	char *data = (char *) ring + sizeof(shm_ring_t);
+	uint64_t head, tail, off;
+	int32_t len;
+
+	tail = ring->tail;
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	while (tail != head) {
+		off = tail % shm->ring_size;
+		len = *(int32_t *) (data + off);
+		if (len != SHM_RECORD_SKIP) {
+			*buf = data + off + SHM_RECORD_HEADER;
+			*size = len;
+			return 1;
+		}
+
+		//Skip the end of the ring the producer couldn't fit a record in
+		tail += shm->ring_size - off;
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	return 0;
+}
+
+/**
+ * shm_init
+ * Allocates the shared memory window and the rings of the ranks on this node - collective call
+ * The transport stays off if it is disabled, if this rank is alone on its node,
+ * or if the MPI library can't give plain loads and stores to the window
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int shm_init(struct mdhim_t *md) {
+	mdhim_shm_t *shm;
+	MPI_Info info;
+	MPI_Aint seg_size;
+	uint64_t win_size;
+	int disp_unit, flag, i;
+	int *model;
+	char *base;
+
+	md->shm = NULL;
+	if (md->db_opts->shm_ring_size <= 0 ||
+	    md->node_sizes[md->rank_nodes[md->mdhim_rank]] < 2) {
+		return MDHIM_SUCCESS;
+	}
+
+	shm = malloc(sizeof(mdhim_shm_t));
+	memset(shm, 0, sizeof(mdhim_shm_t));
+	shm->node_size = md->node_sizes[md->rank_nodes[md->mdhim_rank]];
+	shm->ring_size = SHM_ALIGN(md->db_opts->shm_ring_size);
+	shm->ring_bytes = sizeof(shm_ring_t) + shm->ring_size;
+	win_size = 2 * shm->node_size * shm->ring_bytes;
+
+	//Each rank's rings are only written by the ranks of the node, so keep them apart
+	MPI_Info_create(&info);
+	MPI_Info_set(info, "alloc_shared_noncontig", "true");
+	if (MPI_Win_allocate_shared(win_size, 1, info, md->mdhim_node_comm,
+				    &base, &shm->win) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "MDHIM Rank: %d - "
+		     "Error while allocating the shared memory window",
+		     md->mdhim_rank);
+		MPI_Info_free(&info);
+		free(shm);
+		return MDHIM_ERROR;
+	}
+	MPI_Info_free(&info);
+
+	//The rings are accessed with loads and stores which needs the unified memory model
+	if (MPI_Win_get_attr(shm->win, MPI_WIN_MODEL, &model, &flag) != MPI_SUCCESS ||
+	    !flag || *model != MPI_WIN_UNIFIED) {
+		mlog(MDHIM_CLIENT_DBG, "MDHIM Rank: %d - "
+		     "The shared memory window isn't unified, using MPI on the node",
+		     md->mdhim_rank);
+		MPI_Win_free(&shm->win);
+		free(shm);
+		return MDHIM_SUCCESS;
+	}
+
+	memset(base, 0, win_size);
+	shm->bases = malloc(sizeof(char *) * shm->node_size);
+	for (i = 0; i < shm->node_size; i++) {
+		MPI_Win_shared_query(shm->win, i, &seg_size, &disp_unit, &shm->bases[i]);
+	}
+
+	shm->node_ranks = malloc(sizeof(int) * shm->node_size);
+	for (i = 0; i < md->mdhim_comm_size; i++) {
+		if (md->rank_nodes[i] == md->rank_nodes[md->mdhim_rank]) {
+			shm->node_ranks[md->rank_node_ranks[i]] = i;
+		}
+	}
+
+	shm->send_locks = malloc(sizeof(pthread_mutex_t) * 2 * shm->node_size);
+	for (i = 0; i < 2 * shm->node_size; i++) {
+		pthread_mutex_init(&shm->send_locks[i], NULL);
+	}
+
+	//Every rank's rings have to be zeroed before any rank of the node writes to them
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, shm->win);
+	MPI_Win_sync(shm->win);
+	MPI_Barrier(md->mdhim_node_comm);
+	MPI_Win_sync(shm->win);
+	md->shm = shm;
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * shm_release
+ * Frees the shared memory window - collective call
+ *
+ * @param md        Pointer to the main MDHIM structure
+ */
+void shm_release(struct mdhim_t *md) {
+	mdhim_shm_t *shm = md->shm;
+	int i;
+
+	if (!shm) {
+		return;
+	}
+
+	MPI_Win_unlock_all(shm->win);
+	MPI_Win_free(&shm->win);
+	for (i = 0; i < 2 * shm->node_size; i++) {
+		pthread_mutex_destroy(&shm->send_locks[i]);
+	}
+
+	free(shm->send_locks);
+	free(shm->node_ranks);
+	free(shm->bases);
+	free(shm);
+	md->shm = NULL;
+}
+
+/**
+ * is_shm_peer
+ * Tests whether messages to and from a rank go through the shared memory rings
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param rank      The rank to test
+ * @return 1 if the rank is another rank on this node and the transport is on, 0 otherwise
+ */
+int is_shm_peer(struct mdhim_t *md, int rank) {
+	return md->shm && rank != md->mdhim_rank &&
+		md->rank_nodes[rank] == md->rank_nodes[md->mdhim_rank];
+}
+
+/**
+ * shm_send
+ * Copies a packed message into the ring of a rank on this node
+ * Waits for the consumer to make room if the ring is full
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param dest      The rank to send to
+ * @param ring_type MDHIM_SHM_REQUEST or MDHIM_SHM_RESPONSE
+ * @param buf       The packed message
+ * @param size      The length of the message, 0 tells the consumer to receive over MPI
+ * @return MDHIM_SUCCESS or MDHIM_ERROR if the message has to be sent over MPI
+ */
+int shm_send(struct mdhim_t *md, int dest, int ring_type, void *buf, int size) {
+	mdhim_shm_t *shm = md->shm;
+	shm_ring_t *ring;
+	pthread_mutex_t *lock;
+	char *data;
+	uint64_t head, tail, off, need, skip;
+
+	if (!is_shm_peer(md, dest)) {
+		return MDHIM_ERROR;
+	}
+
+	//Keeping records to half of the ring means one always fits after a wrap
+	need = SHM_RECORD_HEADER + SHM_ALIGN(size);
+	if (need > shm->ring_size / 2) {
+		return MDHIM_ERROR;
+	}
+
+	ring = get_ring(md, dest, md->mdhim_rank, ring_type);
+	data = (char *) ring + sizeof(shm_ring_t);
+	lock = &shm->send_locks[ring_type * shm->node_size + md->rank_node_ranks[dest]];
+	pthread_mutex_lock(lock);
+	head = ring->head;
+	off = head % shm->ring_size;
+	skip = off + need > shm->ring_size ? shm->ring_size - off : 0;
+	while (1) {
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		if (shm->ring_size - (head - tail) >= skip + need) {
+			break;
+		}
+
+		if (md->shutdown) {
+			pthread_mutex_unlock(lock);
+			return MDHIM_ERROR;
+		}
+
+		usleep(10);
+	}
+
+	if (skip) {
+		*(int32_t *) (data + off) = SHM_RECORD_SKIP;
+		head += skip;
+		off = 0;
+	}
+
+	*(int32_t *) (data + off) = size;
+	if (size) {
+		memcpy(data + off + SHM_RECORD_HEADER, buf, size);
+	}
+
+	//Publish the record once it is completely written
+	__atomic_store_n(&ring->head, head + need, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(lock);
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * shm_recv
+ * Gets the oldest message sent to this rank through a ring without waiting
+ * The message stays in the ring until shm_recv_done is called
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param src       The rank to receive from or -1 for any rank of the node
+ * @param ring_type MDHIM_SHM_REQUEST or MDHIM_SHM_RESPONSE
+ * @param source    out: the rank the message came from
+ * @param buf       out: the packed message in the ring
+ * @param size      out: the length of the message, 0 if it has to be received over MPI
+ * @return 1 if a message was received, 0 otherwise
+ */
+int shm_recv(struct mdhim_t *md, int src, int ring_type, int *source,
+	     void **buf, int *size) {
+	mdhim_shm_t *shm = md->shm;
+	int i, peer;
+
+	if (!shm) {
+		return 0;
+	}
+
+	if (src >= 0) {
+		*source = src;
+		return ring_peek(shm, get_ring(md, md->mdhim_rank, src, ring_type), buf, size);
+	}
+
+	//Start after the last rank a message was received from, so every rank gets a turn
+	for (i = 0; i < shm->node_size; i++) {
+		peer = shm->node_ranks[(shm->next_peer + i) % shm->node_size];
+		if (peer == md->mdhim_rank) {
+			continue;
+		}
+
+		if (ring_peek(shm, get_ring(md, md->mdhim_rank, peer, ring_type), buf, size)) {
+			shm->next_peer = (md->rank_node_ranks[peer] + 1) % shm->node_size;
+			*source = peer;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * shm_wait_recv
+ * Waits for a message from a rank of the node
+ * The message stays in the ring until shm_recv_done is called
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param src       The rank to receive from
+ * @param ring_type MDHIM_SHM_REQUEST or MDHIM_SHM_RESPONSE
+ * @param buf       out: the packed message in the ring
+ * @param size      out: the length of the message, 0 if it has to be received over MPI
+ */
+void shm_wait_recv(struct mdhim_t *md, int src, int ring_type, void **buf, int *size) {
+	int spins = 0;
+	int source;
+
+	while (!shm_recv(md, src, ring_type, &source, buf, size)) {
+		if (++spins > SHM_SPIN_COUNT) {
+			usleep(10);
+		}
+	}
+}
+
+/**
+ * shm_recv_done
+ * Removes the oldest message from a ring once it has been unpacked
+ *
+ * @param md        Pointer to the main MDHIM structure
+ * @param src       The rank the message came from
+ * @param ring_type MDHIM_SHM_REQUEST or MDHIM_SHM_RESPONSE
+ */
+void shm_recv_done(struct mdhim_t *md, int src, int ring_type) {
+	shm_ring_t *ring;
+	char *data;
+	uint64_t tail;
+	int32_t len;
+
+	ring = get_ring(md, md->mdhim_rank, src, ring_type);
+	data = (char *) ring + sizeof(shm_ring_t);
+	tail = ring->tail;
+	len = *(int32_t *) (data + tail % md->shm->ring_size);
+	__atomic_store_n(&ring->tail, tail + SHM_RECORD_HEADER + SHM_ALIGN(len),
+			 __ATOMIC_RELEASE);
+}
@@ -0,0 +1,55 @@
+/*
+ * MDHIM TNG
+ *
+ * Shared memory transport between clients and range servers on the same node
+ */
+
+#ifndef      __SHM_TRANSPORT_H
+#define      __SHM_TRANSPORT_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <mpi.h>
+
+struct mdhim_t;
+
+//Ring of work messages consumed by a range server
+#define MDHIM_SHM_REQUEST 0
+//Ring of response messages consumed by a client
+#define MDHIM_SHM_RESPONSE 1
+
+//Default number of bytes of messages each ring holds
+#define MDHIM_SHM_RING_SIZE 65536
+
+/* Header of a ring with a single producing rank and a single consuming rank
+   head and tail are byte counts that only grow, the data follows the header */
+typedef struct shm_ring_t {
+	volatile uint64_t head; //Only written by the producer
+	char head_pad[56];
+	volatile uint64_t tail; //Only written by the consumer
+	char tail_pad[56];
+} shm_ring_t;
+
+/* Every rank of a node holds two rings for each other rank of the node in its segment
+   of the shared window: one for requests it serves and one for responses it waits on */
+typedef struct mdhim_shm_t {
+	MPI_Win win;
+	int node_size;
+	uint64_t ring_size;  //Bytes of messages in each ring
+	uint64_t ring_bytes; //Bytes of each ring including its header
+	char **bases;        //The window segment of each rank of the node
+	int *node_ranks;     //The rank in mdhim_comm of each rank of the node
+	pthread_mutex_t *send_locks; //Serializes the threads of this rank writing to a ring
+	int next_peer;       //The rank of the node whose requests are looked at first
+} mdhim_shm_t;
+
+int shm_init(struct mdhim_t *md);
+void shm_release(struct mdhim_t *md);
+int is_shm_peer(struct mdhim_t *md, int rank);
+int shm_send(struct mdhim_t *md, int dest, int ring_type, void *buf, int size);
+int shm_recv(struct mdhim_t *md, int src, int ring_type, int *source,
+	     void **buf, int *size);
+void shm_wait_recv(struct mdhim_t *md, int src, int ring_type, void **buf, int *size);
+void shm_recv_done(struct mdhim_t *md, int src, int ring_type);
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * MDHIM TNG
+ *
+ * Background propagation of the slice stats
+ *
+ * Every interval, the thread of each rank agrees with the others on a round: whether one
+ * of them is stopping, which indexes all of them have and whether all of them are in a
+ * mdhimStatFlush.  The stats of each of those indexes are then published with nonblocking
+ * collectives on the communicator of the threads, once the range servers have enough
+ * changed stats between them or right away for a mdhimStatFlush.  Routing is never more
+ * than a round and the threshold of changed stats behind the range servers.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "mdhim.h"
+#include "stat_sync.h"
+
+/**
+ * stat_sync_wait
+ * Waits for the next round: the end of the interval, a request or a stop.  A request 
+ * the last round didn't serve, because other ranks weren't asking yet, doesn't end the 
+ * wait, so the rank doesn't start rounds back to back until the others ask
+ *
+ * @param sync       the stat propagation of the rank
+ * @param pending    1 if the last round had a request of this rank but didn't serve it
+ * @param stop       out  1 if the rank is stopping
+ * @param requested  out  1 if a mdhimStatFlush is waiting for a round
+ * @return the number of requests made before the round
+ */
+static uint64_t stat_sync_wait(struct mdhim_stat_sync_t *sync, int pending, int *stop, 
+			       int *requested) {
+	struct timeval now;
+	struct timespec deadline;
+	uint64_t serving;
+
+	gettimeofday(&now, NULL);
+	deadline.tv_sec = now.tv_sec + sync->interval / 1000;
+	deadline.tv_nsec = now.tv_usec * 1000 + (long) (sync->interval % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&sync->lock);
+	while (!sync->stop && (pending || sync->requested == sync->served)) {
+		if (pthread_cond_timedwait(&sync->cond, &sync->lock, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+
+	*stop = sync->stop;
+	*requested = sync->requested != sync->served;
+	serving = sync->requested;
+	pthread_mutex_unlock(&sync->lock);
+
+	return serving;
+}
+
+/**
+ * stat_sync_thread
+ * Publishes the stats of every index in rounds until mdhimClose is called
+ *
+ * @param data    main MDHIM struct
+ * @return NULL
+ */
+static void *stat_sync_thread(void *data) {
+	struct mdhim_t *md = (struct mdhim_t *) data;
+	struct mdhim_stat_sync_t *sync = md->stat_sync;
+	struct index_t *index;
+	MPI_Request req;
+	MPI_Status status;
+	int local[3], round[3];
+	int id, flag, ret, pending;
+	uint64_t serving;
+
+	pending = 0;
+	while (1) {
+		serving = stat_sync_wait(sync, pending, &local[0], &local[1]);
+
+		/* The indexes are read after the request, so a round every rank asked for has
+		   the indexes made before the mdhimStatFlush */
+		while (pthread_rwlock_rdlock(md->indexes_lock) == EBUSY) {
+			usleep(10);
+		}
+		local[2] = HASH_COUNT(md->indexes);
+		pthread_rwlock_unlock(md->indexes_lock);
+
+		//Any rank stops the round, all the ranks have to ask for it, the fewest indexes count
+		local[1] = -local[1];
+		local[2] = -local[2];
+		ret = MPI_Iallreduce(local, round, 3, MPI_INT, MPI_MAX, sync->comm, &req);
+		flag = 0;
+		while (ret == MPI_SUCCESS && !flag) {
+			ret = MPI_Test(&req, &flag, &status);
+			if (!flag) {
+				usleep(100);
+			}
+		}
+
+		if (ret != MPI_SUCCESS) {
+			mlog(MDHIM_CLIENT_CRIT, "Rank: %d - "
+			     "Error while starting a round of stat propagation",
+			     md->mdhim_rank);
+			break;
+		}
+
+		if (round[0]) {
+			break;
+		}
+
+		//Indexes have the same ids on every rank
+		for (id = 0; id < -round[2]; id++) {
+			if (!(index = get_index(md, id))) {
+				continue;
+			}
+
+			if (publish_stats(md, index, sync->comm, NULL,
+					  round[1] == -1 ? 0 : sync->threshold) != MDHIM_SUCCESS) {
+				mlog(MDHIM_CLIENT_CRIT, "Rank: %d - "
+				     "Error while publishing the stats of index: %d",
+				     md->mdhim_rank, id);
+			}
+		}
+
+		//A request the other ranks didn't make yet waits for the next interval
+		pending = local[1] == -1 && round[1] != -1;
+
+		//Wake the mdhimStatFlush calls the round was for
+		if (round[1] == -1) {
+			pthread_mutex_lock(&sync->lock);
+			sync->served = serving;
+			pthread_cond_broadcast(&sync->cond);
+			pthread_mutex_unlock(&sync->lock);
+		}
+	}
+
+	pthread_mutex_lock(&sync->lock);
+	sync->stopped = 1;
+	pthread_cond_broadcast(&sync->cond);
+	pthread_mutex_unlock(&sync->lock);
+
+	return NULL;
+}
+
+/**
+ * stat_sync_start
+ * Starts publishing the stats in the background if a stat interval was set - collective call
+ *
+ * @param md      main MDHIM struct
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int stat_sync_start(struct mdhim_t *md) {
+	struct mdhim_stat_sync_t *sync;
+
+	md->stat_sync = NULL;
+	if (md->db_opts->db_stat_interval <= 0) {
+		return MDHIM_SUCCESS;
+	}
+
+	sync = malloc(sizeof(struct mdhim_stat_sync_t));
+	memset(sync, 0, sizeof(struct mdhim_stat_sync_t));
+	sync->interval = md->db_opts->db_stat_interval;
+	sync->threshold = md->db_opts->db_stat_threshold;
+	if (MPI_Comm_dup(md->mdhim_comm, &sync->comm) != MPI_SUCCESS) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - "
+		     "Error while creating the stat propagation communicator",
+		     md->mdhim_rank);
+		free(sync);
+		return MDHIM_ERROR;
+	}
+
+	pthread_mutex_init(&sync->lock, NULL);
+	pthread_cond_init(&sync->cond, NULL);
+	md->stat_sync = sync;
+	if (pthread_create(&sync->thread, NULL, stat_sync_thread, (void *) md) != 0) {
+		mlog(MDHIM_CLIENT_CRIT, "Rank: %d - "
+		     "Error while starting the stat propagation thread",
+		     md->mdhim_rank);
+		md->stat_sync = NULL;
+		pthread_cond_destroy(&sync->cond);
+		pthread_mutex_destroy(&sync->lock);
+		MPI_Comm_free(&sync->comm);
+		free(sync);
+		return MDHIM_ERROR;
+	}
+
+	return MDHIM_SUCCESS;
+}
+
+/**
+ * stat_sync_stop
+ * Stops publishing the stats in the background - collective call
+ *
+ * @param md      main MDHIM struct
+ */
+void stat_sync_stop(struct mdhim_t *md) {
+	struct mdhim_stat_sync_t *sync = md->stat_sync;
+
+	if (!sync) {
+		return;
+	}
+
+	pthread_mutex_lock(&sync->lock);
+	sync->stop = 1;
+	pthread_cond_broadcast(&sync->cond);
+	pthread_mutex_unlock(&sync->lock);
+	pthread_join(sync->thread, NULL);
+
+	md->stat_sync = NULL;
+	pthread_cond_destroy(&sync->cond);
+	pthread_mutex_destroy(&sync->lock);
+	MPI_Comm_free(&sync->comm);
+	free(sync);
+}
+
+/**
+ * stat_sync_flush
+ * Waits for a round that publishes the stats of every index made before all the ranks
+ * called it - collective call
+ *
+ * @param md      main MDHIM struct
+ * @return MDHIM_SUCCESS or MDHIM_ERROR on error
+ */
+int stat_sync_flush(struct mdhim_t *md) {
+	struct mdhim_stat_sync_t *sync = md->stat_sync;
+	uint64_t ticket;
+	int ret;
+
+	pthread_mutex_lock(&sync->lock);
+	ticket = ++sync->requested;
+	pthread_cond_broadcast(&sync->cond);
+	while (sync->served < ticket && !sync->stopped) {
+		pthread_cond_wait(&sync->cond, &sync->lock);
+	}
+
+	ret = sync->served >= ticket ? MDHIM_SUCCESS : MDHIM_ERROR;
+	pthread_mutex_unlock(&sync->lock);
+
+	return ret;
+}
@@ -0,0 +1,35 @@
+/*
+ * MDHIM TNG
+ *
+ * Background propagation of the slice stats
+ */
+
+#ifndef      __STAT_SYNC_H
+#define      __STAT_SYNC_H
+
+#include <pthread.h>
+#include <mpi.h>
+#include <stdint.h>
+
+struct mdhim_t;
+
+/* The thread of a rank that publishes the stats of every index in rounds.  All the ranks
+   take part in every round, on a communicator of their own so the rounds don't wait on
+   the other collectives of MDHIM */
+struct mdhim_stat_sync_t {
+	pthread_t thread;
+	MPI_Comm comm;
+	pthread_mutex_t lock;        //Lock for the fields below
+	pthread_cond_t cond;         //Signaled when there is a request, a stop or a finished round
+	uint64_t requested;          //Number of rounds requested by mdhimStatFlush
+	uint64_t served;             //Number of the requests the rounds finished so far served
+	int stop;                    //1 once mdhimClose was called
+	int stopped;                 //1 once the thread returned
+	int interval;                //Milliseconds between two rounds
+	int threshold;               //Changed stats a round waits for before publishing them
+};
+
+int stat_sync_start(struct mdhim_t *md);
+void stat_sync_stop(struct mdhim_t *md);
+int stat_sync_flush(struct mdhim_t *md);
+#endif
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "mpi.h"
+#include "mdhim.h"
+
+#define KEYS 100
+
+/* Counts the keys in the stats of the last stat flush */
+static uint64_t stat_count(struct index_t *index) {
+	uint64_t count = 0;
+	int i;
+
+	for (i = 0; index->stats && i < index->stats->num; i++) {
+		count += index->stats->nums[i];
+	}
+
+	return count;
+}
+
+/* Returns 1 if the key is in MDHIM */
+static int key_exists(struct mdhim_t *md, int key) {
+	struct mdhim_bgetrm_t *bgrm;
+	int found;
+
+	bgrm = mdhimGet(md, md->primary_index, &key, sizeof(int), MDHIM_GET_EQ);
+	found = bgrm && !bgrm->error && bgrm->num_keys && bgrm->values[0];
+	mdhim_full_release_msg(bgrm);
+
+	return found;
+}
+
+int main(int argc, char **argv) {
+	int ret;
+	int provided = 0;
+	struct mdhim_t *md;
+	int **keys;
+	int key_lens[KEYS];
+	int **values;
+	int value_lens[KEYS];
+	struct mdhim_brm_t *brm, *brmp;
+	int i, key, start, end, errors;
+	int num_keys;
+	uint64_t count, expected;
+	char     *db_path = "./";
+	char     *db_name = "mdhimTstDB";
+	int      dbug = MLOG_CRIT;
+	mdhim_options_t *db_opts; // Local variable for db create options to be passed
+	int db_type = LEVELDB; //(data_store.h)
+	MPI_Comm comm;
+
+	// Create options for DB initialization
+	db_opts = mdhim_options_init();
+	mdhim_options_set_db_path(db_opts, db_path);
+	mdhim_options_set_db_name(db_opts, db_name);
+	mdhim_options_set_db_type(db_opts, db_type);
+	mdhim_options_set_key_type(db_opts, MDHIM_INT_KEY);
+	mdhim_options_set_debug_level(db_opts, dbug);
+	ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	if (ret != MPI_SUCCESS) {
+		printf("Error initializing MPI with threads\n");
+		exit(1);
+	}
+
+	if (provided != MPI_THREAD_MULTIPLE) {
+                printf("Not able to enable MPI_THREAD_MULTIPLE mode\n");
+                exit(1);
+        }
+
+	comm = MPI_COMM_WORLD;
+	md = mdhimInit(&comm, db_opts);
+	if (!md) {
+		printf("Error initializing MDHIM\n");
+		exit(1);
+	}
+
+	//Each rank puts a contiguous run of keys, so the ranks' keys cover [0, KEYS * size)
+	keys = malloc(sizeof(int *) * KEYS);
+	values = malloc(sizeof(int *) * KEYS);
+	for (i = 0; i < KEYS; i++) {
+		keys[i] = malloc(sizeof(int));
+		*keys[i] = KEYS * md->mdhim_rank + i;
+		key_lens[i] = sizeof(int);
+		values[i] = malloc(sizeof(int));
+		*values[i] = md->mdhim_rank;
+		value_lens[i] = sizeof(int);
+	}
+
+	brm = mdhimBPut(md, (void **) keys, key_lens, (void **) values, value_lens, KEYS,
+			NULL, NULL);
+	errors = 0;
+	for (brmp = brm; brmp; brmp = brm) {
+		if (brmp->error < 0) {
+			printf("Rank: %d - Error inserting keys/values into MDHIM\n", md->mdhim_rank);
+			errors++;
+		}
+
+		brm = brmp->next;
+		mdhim_full_release_msg(brmp);
+	}
+
+	mdhimCommit(md, md->primary_index);
+	mdhimStatFlush(md, md->primary_index);
+	expected = (uint64_t) KEYS * md->mdhim_comm_size;
+	if ((count = stat_count(md->primary_index)) != expected) {
+		printf("Rank: %d - Stats have %llu keys before the range delete, expected %llu\n",
+		       md->mdhim_rank, (unsigned long long) count, (unsigned long long) expected);
+		errors++;
+	}
+
+	//Rank 0 deletes a few keys of the range itself, then the range that spans every rank
+	start = KEYS / 2;
+	end = KEYS * md->mdhim_comm_size - KEYS / 2 - 1;
+	if (md->mdhim_rank == 0) {
+		num_keys = 0;
+		for (key = start; key <= end && num_keys < KEYS; key += 7) {
+			*keys[num_keys] = key;
+			num_keys++;
+		}
+
+		brm = mdhimBDelete(md, md->primary_index, (void **) keys, key_lens, num_keys);
+		for (brmp = brm; brmp; brmp = brm) {
+			brm = brmp->next;
+			mdhim_full_release_msg(brmp);
+		}
+
+		brm = mdhimDeleteRange(md, md->primary_index, &start, sizeof(int),
+				       &end, sizeof(int));
+		if (!brm) {
+			printf("Rank: %d - Error deleting the range [%d, %d]\n",
+			       md->mdhim_rank, start, end);
+			errors++;
+		}
+
+		for (brmp = brm; brmp; brmp = brm) {
+			if (brmp->error < 0) {
+				printf("Rank: %d - Error from a range server in the range delete\n",
+				       md->mdhim_rank);
+				errors++;
+			}
+
+			brm = brmp->next;
+			mdhim_full_release_msg(brmp);
+		}
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	//Only the keys that were there come out of the stats, even those deleted twice
+	mdhimCommit(md, md->primary_index);
+	mdhimStatFlush(md, md->primary_index);
+	expected = (uint64_t) KEYS * md->mdhim_comm_size - (end - start + 1);
+	if ((count = stat_count(md->primary_index)) != expected) {
+		printf("Rank: %d - Stats have %llu keys after the range delete, expected %llu\n",
+		       md->mdhim_rank, (unsigned long long) count, (unsigned long long) expected);
+		errors++;
+	}
+
+	//The keys of the range are gone and the keys around it are still there
+	for (i = 0; i < KEYS; i++) {
+		key = KEYS * md->mdhim_rank + i;
+		if (key_exists(md, key) != (key < start || key > end)) {
+			printf("Rank: %d - Key: %d is %s after the range delete\n", md->mdhim_rank,
+			       key, key < start || key > end ? "missing" : "still there");
+			errors++;
+		}
+	}
+
+	for (i = 0; i < KEYS; i++) {
+		free(keys[i]);
+		free(values[i]);
+	}
+
+	free(keys);
+	free(values);
+	ret = mdhimClose(md);
+	mdhim_options_destroy(db_opts);
+	if (ret != MDHIM_SUCCESS) {
+		printf("Error closing MDHIM\n");
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	if (errors) {
+		printf("Range delete test failed with %d errors\n", errors);
+		return 1;
+	}
+
+	printf("Range delete test passed\n");
+
+	return 0;
+}
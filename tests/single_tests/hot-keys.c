@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "mpi.h"
+#include "mdhim.h"
+
+#define KEYS 100
+//Keys every rank reads often enough to be replicated
+#define HOT 10
+#define THRESHOLD 5
+#define READS 10
+
+/* Counts the keys in the stats of the index */
+static uint64_t stat_count(struct index_t *index) {
+	uint64_t count = 0;
+	int i;
+
+	while (pthread_rwlock_rdlock(index->stats_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	for (i = 0; index->stats && i < index->stats->num; i++) {
+		count += index->stats->nums[i];
+	}
+
+	pthread_rwlock_unlock(index->stats_lock);
+
+	return count;
+}
+
+/* Puts the keys with their values.  Returns the number of errors */
+static int put_keys(struct mdhim_t *md, int **keys, int **values, int num_keys) {
+	struct mdhim_brm_t *brm, *brmp;
+	int key_lens[KEYS], value_lens[KEYS];
+	int i, errors = 0;
+
+	for (i = 0; i < num_keys; i++) {
+		key_lens[i] = sizeof(int);
+		value_lens[i] = sizeof(int);
+	}
+
+	brm = mdhimBPut(md, (void **) keys, key_lens, (void **) values, value_lens, num_keys,
+			NULL, NULL);
+	for (brmp = brm; brmp; brmp = brm) {
+		if (brmp->error < 0) {
+			printf("Rank: %d - Error inserting keys/values into MDHIM\n", md->mdhim_rank);
+			errors++;
+		}
+
+		brm = brmp->next;
+		mdhim_full_release_msg(brmp);
+	}
+
+	return errors;
+}
+
+/* Reads the hot keys and checks their values are the keys plus a difference.
+   Returns the number of errors */
+static int check_hot_keys(struct mdhim_t *md, int **keys, int diff) {
+	struct mdhim_bgetrm_t *bgrm, *bgrmp;
+	int key_lens[HOT];
+	int i, found, errors = 0;
+
+	for (i = 0; i < HOT; i++) {
+		key_lens[i] = sizeof(int);
+	}
+
+	found = 0;
+	bgrm = mdhimBGet(md, md->primary_index, (void **) keys, key_lens, HOT, MDHIM_GET_EQ);
+	for (bgrmp = bgrm; bgrmp; bgrmp = bgrmp->next) {
+		if (bgrmp->error < 0) {
+			printf("Rank: %d - Error getting the hot keys\n", md->mdhim_rank);
+			errors++;
+			continue;
+		}
+
+		for (i = 0; i < bgrmp->num_keys; i++) {
+			if (!bgrmp->values[i] ||
+			    *(int *) bgrmp->values[i] != *(int *) bgrmp->keys[i] + diff) {
+				printf("Rank: %d - Hot key: %d doesn't have value %d\n", md->mdhim_rank,
+				       *(int *) bgrmp->keys[i], *(int *) bgrmp->keys[i] + diff);
+				errors++;
+				continue;
+			}
+
+			found++;
+		}
+	}
+
+	mdhim_full_release_msg(bgrm);
+	if (found != HOT) {
+		printf("Rank: %d - Found %d hot keys, expected %d\n", md->mdhim_rank, found, HOT);
+		errors++;
+	}
+
+	return errors;
+}
+
+/* Scans every key and checks that each one comes back once.  Returns the number of errors */
+static int check_scan(struct mdhim_t *md, int total) {
+	struct mdhim_scan_t *scan;
+	struct mdhim_bgetrm_t *bgrm;
+	int i, last, num, errors = 0;
+
+	scan = mdhimScan(md, md->primary_index, NULL, 0, NULL, 0, 0);
+	if (!scan) {
+		printf("Rank: %d - Error opening a scan\n", md->mdhim_rank);
+		return 1;
+	}
+
+	last = -1;
+	num = 0;
+	while ((bgrm = mdhimScanNext(md, scan))) {
+		for (i = 0; i < bgrm->num_keys; i++, num++) {
+			if (*(int *) bgrm->keys[i] <= last) {
+				printf("Rank: %d - Scan gave key %d after key %d\n",
+				       md->mdhim_rank, *(int *) bgrm->keys[i], last);
+				errors++;
+			}
+
+			last = *(int *) bgrm->keys[i];
+		}
+
+		mdhim_full_release_msg(bgrm);
+	}
+
+	mdhimScanClose(md, scan);
+	if (num != total) {
+		printf("Rank: %d - Scan gave %d keys, expected %d\n", md->mdhim_rank, num, total);
+		errors++;
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	int ret;
+	int provided = 0;
+	struct mdhim_t *md;
+	int **keys;
+	int **values;
+	int key_lens[KEYS];
+	struct mdhim_bgetrm_t *bgrm;
+	struct mdhim_brm_t *brm;
+	int i, total, errors;
+	uint64_t count;
+	char     *db_path = "./";
+	char     *db_name = "mdhimTstDB";
+	int      dbug = MLOG_CRIT;
+	mdhim_options_t *db_opts; // Local variable for db create options to be passed
+	int db_type = LEVELDB; //(data_store.h)
+	MPI_Comm comm;
+
+	// Create options for DB initialization
+	db_opts = mdhim_options_init();
+	mdhim_options_set_db_path(db_opts, db_path);
+	mdhim_options_set_db_name(db_opts, db_name);
+	mdhim_options_set_db_type(db_opts, db_type);
+	mdhim_options_set_key_type(db_opts, MDHIM_INT_KEY);
+	mdhim_options_set_debug_level(db_opts, dbug);
+	mdhim_options_set_server_factor(db_opts, 1);
+	mdhim_options_set_hot_key_threshold(db_opts, THRESHOLD);
+	ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	if (ret != MPI_SUCCESS) {
+		printf("Error initializing MPI with threads\n");
+		exit(1);
+	}
+
+	if (provided != MPI_THREAD_MULTIPLE) {
+                printf("Not able to enable MPI_THREAD_MULTIPLE mode\n");
+                exit(1);
+        }
+
+	comm = MPI_COMM_WORLD;
+	md = mdhimInit(&comm, db_opts);
+	if (!md) {
+		printf("Error initializing MDHIM\n");
+		exit(1);
+	}
+
+	//Each key's value is the key to start with
+	keys = malloc(sizeof(int *) * KEYS);
+	values = malloc(sizeof(int *) * KEYS);
+	for (i = 0; i < KEYS; i++) {
+		keys[i] = malloc(sizeof(int));
+		*keys[i] = i * md->mdhim_comm_size + md->mdhim_rank;
+		key_lens[i] = sizeof(int);
+		values[i] = malloc(sizeof(int));
+		*values[i] = *keys[i];
+	}
+
+	errors = put_keys(md, keys, values, KEYS);
+	mdhimCommit(md, md->primary_index);
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	//Every rank reads the same keys until they are hot, then they are replicated
+	for (i = 0; i < HOT; i++) {
+		*keys[i] = i;
+	}
+
+	for (i = 0; i < READS; i++) {
+		errors += check_hot_keys(md, keys, 0);
+	}
+
+	if (mdhimReplicateHotKeys(md, NULL) != MDHIM_SUCCESS) {
+		printf("Rank: %d - Error replicating the hot keys\n", md->mdhim_rank);
+		errors++;
+	}
+
+	//Writes of the hot keys go to their replicas too, which keep them apart from their stores
+	if (md->mdhim_rank == 0) {
+		for (i = 0; i < HOT; i++) {
+			*values[i] = *keys[i] + KEYS;
+		}
+
+		errors += put_keys(md, keys, values, HOT);
+	}
+
+	mdhimCommit(md, md->primary_index);
+	MPI_Barrier(MPI_COMM_WORLD);
+	errors += check_hot_keys(md, keys, KEYS);
+
+	//Deleting a hot key removes the copies and the record of the owner
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (md->mdhim_rank == 0) {
+		brm = mdhimDelete(md, md->primary_index, keys[0], key_lens[0]);
+		if (!brm || brm->error) {
+			printf("Rank: %d - Error deleting hot key: %d\n", md->mdhim_rank, *keys[0]);
+			errors++;
+		}
+
+		mdhim_full_release_msg(brm);
+	}
+
+	mdhimCommit(md, md->primary_index);
+	MPI_Barrier(MPI_COMM_WORLD);
+	bgrm = mdhimGet(md, md->primary_index, keys[0], key_lens[0], MDHIM_GET_EQ);
+	if (bgrm && !bgrm->error && bgrm->num_keys && bgrm->values[0]) {
+		printf("Rank: %d - Deleted hot key: %d was found\n", md->mdhim_rank, *keys[0]);
+		errors++;
+	}
+
+	mdhim_full_release_msg(bgrm);
+
+	//Only the owners stored the hot keys, so no key is counted or scanned twice
+	MPI_Barrier(MPI_COMM_WORLD);
+	total = KEYS * md->mdhim_comm_size - 1;
+	errors += check_scan(md, total);
+	mdhimStatFlush(md, md->primary_index);
+	if ((count = stat_count(md->primary_index)) != (uint64_t) total) {
+		printf("Rank: %d - Stats have %llu keys, expected %d\n",
+		       md->mdhim_rank, (unsigned long long) count, total);
+		errors++;
+	}
+
+	for (i = 0; i < KEYS; i++) {
+		free(keys[i]);
+		free(values[i]);
+	}
+
+	free(keys);
+	free(values);
+	ret = mdhimClose(md);
+	mdhim_options_destroy(db_opts);
+	if (ret != MDHIM_SUCCESS) {
+		printf("Error closing MDHIM\n");
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	if (errors) {
+		printf("Hot key test failed with %d errors\n", errors);
+		return 1;
+	}
+
+	printf("Hot key test passed\n");
+
+	return 0;
+}
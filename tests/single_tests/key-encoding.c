@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "mpi.h"
+#include "mdhim.h"
+
+#define MAX_KEYS 8
+
+/* Puts the keys, given in key order, in a new index of the key type and checks that a
+   scan gives them back in that order with the lengths they were put with */
+static int check_keys(struct mdhim_t *md, int key_type, char *name,
+		      void **keys, int *key_lens, int num_keys) {
+	struct index_t *index;
+	struct mdhim_brm_t *brm, *brmp;
+	struct mdhim_bgetrm_t *bgrm;
+	struct mdhim_scan_t *scan;
+	int *values[MAX_KEYS];
+	int value_lens[MAX_KEYS];
+	int i, found, errors;
+
+	//Hashed, so negative numbers can be keys too
+	index = create_global_index(md, 1, 100, LEVELDB, key_type, MDHIM_HASH_PARTITION, name);
+	if (!index) {
+		printf("Rank: %d - Error creating the %s index\n", md->mdhim_rank, name);
+		return 1;
+	}
+
+	errors = 0;
+	if (md->mdhim_rank == 0) {
+		for (i = 0; i < num_keys; i++) {
+			values[i] = malloc(sizeof(int));
+			*values[i] = i;
+			value_lens[i] = sizeof(int);
+		}
+
+		brm = mdhimBPutOp(md, index, keys, key_lens, (void **) values, value_lens,
+				  num_keys, MDHIM_DB_OVERWRITE);
+		for (brmp = brm; brmp; brmp = brm) {
+			if (brmp->error < 0) {
+				printf("Rank: %d - Error inserting %s\n", md->mdhim_rank, name);
+				errors++;
+			}
+
+			brm = brmp->next;
+			mdhim_full_release_msg(brmp);
+		}
+
+		for (i = 0; i < num_keys; i++) {
+			free(values[i]);
+		}
+	}
+
+	mdhimCommit(md, index);
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (md->mdhim_rank != 0) {
+		return errors;
+	}
+
+	//The keys come back decoded from the range servers' databases
+	found = 0;
+	scan = mdhimScan(md, index, NULL, 0, NULL, 0, 0);
+	while (scan && (bgrm = mdhimScanNext(md, scan))) {
+		for (i = 0; i < bgrm->num_keys; i++, found++) {
+			if (found >= num_keys) {
+				printf("Rank: %d - Scan of %s gave more keys than were put\n",
+				       md->mdhim_rank, name);
+				errors++;
+				break;
+			}
+
+			if (bgrm->key_lens[i] != key_lens[found] ||
+			    memcmp(bgrm->keys[i], keys[found], key_lens[found]) ||
+			    bgrm->value_lens[i] != sizeof(int) || *(int *) bgrm->values[i] != found) {
+				printf("Rank: %d - Key %d of %s came back as a different key of "
+				       "length %d\n", md->mdhim_rank, found, name, bgrm->key_lens[i]);
+				errors++;
+			}
+		}
+
+		mdhim_full_release_msg(bgrm);
+	}
+
+	if (!scan) {
+		printf("Rank: %d - Error scanning %s\n", md->mdhim_rank, name);
+		errors++;
+	} else {
+		mdhimScanClose(md, scan);
+	}
+
+	if (found != num_keys) {
+		printf("Rank: %d - Scan of %s gave %d keys, expected %d\n",
+		       md->mdhim_rank, name, found, num_keys);
+		errors++;
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	int ret;
+	int provided = 0;
+	struct mdhim_t *md;
+	uint32_t ikeys[] = {0, 1, 255, 256, 65536, 16777216};
+	uint64_t lkeys[] = {0, 1, 256, 1ULL << 32, 1ULL << 40};
+	float fkeys[] = {-1000.5, -1, -0.25, 0, 0.25, 1, 1000.5};
+	double dkeys[] = {-1e300, -1000.5, -0.25, 0, 0.25, 1000.5, 1e300};
+	//Strings with and without their null characters are different keys
+	char *skeys[] = {"a", "a", "ab", "ab", "b"};
+	int slens[] = {1, 2, 2, 3, 2};
+	//Byte keys sort by their length first
+	char *bkeys[] = {"\xff", "\x00\x01", "\x01\x00", "\x00\x00\x00"};
+	int blens[] = {1, 2, 2, 3};
+	void *keys[MAX_KEYS];
+	int key_lens[MAX_KEYS];
+	int i, errors;
+	char     *db_path = "./";
+	char     *db_name = "mdhimTstDB";
+	int      dbug = MLOG_CRIT;
+	mdhim_options_t *db_opts; // Local variable for db create options to be passed
+	int db_type = LEVELDB; //(data_store.h)
+	MPI_Comm comm;
+
+	// Create options for DB initialization
+	db_opts = mdhim_options_init();
+	mdhim_options_set_db_path(db_opts, db_path);
+	mdhim_options_set_db_name(db_opts, db_name);
+	mdhim_options_set_db_type(db_opts, db_type);
+	mdhim_options_set_key_type(db_opts, MDHIM_INT_KEY);
+	mdhim_options_set_debug_level(db_opts, dbug);
+	ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	if (ret != MPI_SUCCESS) {
+		printf("Error initializing MPI with threads\n");
+		exit(1);
+	}
+
+	if (provided != MPI_THREAD_MULTIPLE) {
+                printf("Not able to enable MPI_THREAD_MULTIPLE mode\n");
+                exit(1);
+        }
+
+	comm = MPI_COMM_WORLD;
+	md = mdhimInit(&comm, db_opts);
+	if (!md) {
+		printf("Error initializing MDHIM\n");
+		exit(1);
+	}
+
+	errors = 0;
+	for (i = 0; i < (int) (sizeof(ikeys) / sizeof(ikeys[0])); i++) {
+		keys[i] = &ikeys[i];
+		key_lens[i] = sizeof(uint32_t);
+	}
+	errors += check_keys(md, MDHIM_INT_KEY, "int_keys", keys, key_lens, i);
+
+	for (i = 0; i < (int) (sizeof(lkeys) / sizeof(lkeys[0])); i++) {
+		keys[i] = &lkeys[i];
+		key_lens[i] = sizeof(uint64_t);
+	}
+	errors += check_keys(md, MDHIM_LONG_INT_KEY, "long_keys", keys, key_lens, i);
+
+	for (i = 0; i < (int) (sizeof(fkeys) / sizeof(fkeys[0])); i++) {
+		keys[i] = &fkeys[i];
+		key_lens[i] = sizeof(float);
+	}
+	errors += check_keys(md, MDHIM_FLOAT_KEY, "float_keys", keys, key_lens, i);
+
+	for (i = 0; i < (int) (sizeof(dkeys) / sizeof(dkeys[0])); i++) {
+		keys[i] = &dkeys[i];
+		key_lens[i] = sizeof(double);
+	}
+	errors += check_keys(md, MDHIM_DOUBLE_KEY, "double_keys", keys, key_lens, i);
+
+	for (i = 0; i < (int) (sizeof(skeys) / sizeof(skeys[0])); i++) {
+		keys[i] = skeys[i];
+		key_lens[i] = slens[i];
+	}
+	errors += check_keys(md, MDHIM_STRING_KEY, "string_keys", keys, key_lens, i);
+
+	for (i = 0; i < (int) (sizeof(bkeys) / sizeof(bkeys[0])); i++) {
+		keys[i] = bkeys[i];
+		key_lens[i] = blens[i];
+	}
+	errors += check_keys(md, MDHIM_BYTE_KEY, "byte_keys", keys, key_lens, i);
+
+	ret = mdhimClose(md);
+	mdhim_options_destroy(db_opts);
+	if (ret != MDHIM_SUCCESS) {
+		printf("Error closing MDHIM\n");
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	if (errors) {
+		printf("Key encoding test failed with %d errors\n", errors);
+		return 1;
+	}
+
+	printf("Key encoding test passed\n");
+
+	return 0;
+}
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "mpi.h"
+#include "mdhim.h"
+
+#define KEYS 400
+#define SLICE_SIZE 100
+//Reads of the hot slice and of another slice of its range server before a rebalance
+#define HOT_READS 50
+#define WARM_READS 10
+
+/* Counts the keys in the stats of the last stat flush */
+static uint64_t stat_count(struct index_t *index) {
+	uint64_t count = 0;
+	int i;
+
+	for (i = 0; index->stats && i < index->stats->num; i++) {
+		count += index->stats->nums[i];
+	}
+
+	return count;
+}
+
+/* Returns the value of a key or -1 if the key is not in MDHIM */
+static int get_value(struct mdhim_t *md, int key) {
+	struct mdhim_bgetrm_t *bgrm;
+	int value = -1;
+
+	bgrm = mdhimGet(md, md->primary_index, &key, sizeof(int), MDHIM_GET_EQ);
+	if (bgrm && !bgrm->error && bgrm->num_keys && bgrm->values[0]) {
+		value = *(int *) bgrm->values[0];
+	}
+
+	mdhim_full_release_msg(bgrm);
+
+	return value;
+}
+
+/* Checks that every rank routes the slice to the same range server and that
+   the routing epochs agree.  Returns the number of errors */
+static int check_routing(struct mdhim_t *md, int slice, uint32_t expected) {
+	struct index_t *index = md->primary_index;
+	unsigned int mine[2], mins[2], maxs[2];
+	int errors = 0;
+
+	mine[0] = get_slice_rangesrv(index, slice);
+	mine[1] = get_routing_epoch(index);
+	MPI_Allreduce(mine, mins, 2, MPI_UNSIGNED, MPI_MIN, MPI_COMM_WORLD);
+	MPI_Allreduce(mine, maxs, 2, MPI_UNSIGNED, MPI_MAX, MPI_COMM_WORLD);
+	if (mins[0] != maxs[0] || mins[1] != maxs[1]) {
+		printf("Rank: %d - Ranks route slice %d to range servers %u-%u with epochs %u-%u\n",
+		       md->mdhim_rank, slice, mins[0], maxs[0], mins[1], maxs[1]);
+		errors++;
+	}
+
+	if (expected && mine[0] != expected) {
+		printf("Rank: %d - Slice %d is served by range server %u, expected %u\n",
+		       md->mdhim_rank, slice, mine[0], expected);
+		errors++;
+	}
+
+	return errors;
+}
+
+/* Checks that this rank's keys have their values, except a deleted key.
+   Returns the number of errors */
+static int check_keys(struct mdhim_t *md, int deleted) {
+	int i, key, value, errors = 0;
+
+	for (i = 0; i < KEYS; i++) {
+		key = i * md->mdhim_comm_size + md->mdhim_rank;
+		value = get_value(md, key);
+		if (value != (key == deleted ? -1 : key)) {
+			printf("Rank: %d - Key: %d has value %d\n", md->mdhim_rank, key, value);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	int ret;
+	int provided = 0;
+	struct mdhim_t *md;
+	struct index_t *index;
+	int **keys;
+	int key_lens[KEYS];
+	int **values;
+	int value_lens[KEYS];
+	struct mdhim_brm_t *brm, *brmp;
+	int i, key, value, total, slice, warm_slice, errors;
+	uint32_t src, dest;
+	uint64_t count;
+	char     *db_path = "./";
+	char     *db_name = "mdhimTstDB";
+	int      dbug = MLOG_CRIT;
+	mdhim_options_t *db_opts; // Local variable for db create options to be passed
+	int db_type = LEVELDB; //(data_store.h)
+	MPI_Comm comm;
+
+	// Create options for DB initialization
+	db_opts = mdhim_options_init();
+	mdhim_options_set_db_path(db_opts, db_path);
+	mdhim_options_set_db_name(db_opts, db_name);
+	mdhim_options_set_db_type(db_opts, db_type);
+	mdhim_options_set_key_type(db_opts, MDHIM_INT_KEY);
+	mdhim_options_set_debug_level(db_opts, dbug);
+	mdhim_options_set_server_factor(db_opts, 1);
+	mdhim_options_set_max_recs_per_slice(db_opts, SLICE_SIZE);
+	ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	if (ret != MPI_SUCCESS) {
+		printf("Error initializing MPI with threads\n");
+		exit(1);
+	}
+
+	if (provided != MPI_THREAD_MULTIPLE) {
+                printf("Not able to enable MPI_THREAD_MULTIPLE mode\n");
+                exit(1);
+        }
+
+	comm = MPI_COMM_WORLD;
+	md = mdhimInit(&comm, db_opts);
+	if (!md) {
+		printf("Error initializing MDHIM\n");
+		exit(1);
+	}
+
+	index = md->primary_index;
+	if (index->num_rangesrvs < 2) {
+		printf("Migration test needs at least 2 range servers, skipped\n");
+		mdhimClose(md);
+		mdhim_options_destroy(db_opts);
+		MPI_Finalize();
+		return 0;
+	}
+
+	//Each key's value is the key, so values show which keys the slices still have
+	keys = malloc(sizeof(int *) * KEYS);
+	values = malloc(sizeof(int *) * KEYS);
+	for (i = 0; i < KEYS; i++) {
+		keys[i] = malloc(sizeof(int));
+		*keys[i] = i * md->mdhim_comm_size + md->mdhim_rank;
+		key_lens[i] = sizeof(int);
+		values[i] = malloc(sizeof(int));
+		*values[i] = *keys[i];
+		value_lens[i] = sizeof(int);
+	}
+
+	brm = mdhimBPut(md, (void **) keys, key_lens, (void **) values, value_lens, KEYS,
+			NULL, NULL);
+	errors = 0;
+	for (brmp = brm; brmp; brmp = brm) {
+		if (brmp->error < 0) {
+			printf("Rank: %d - Error inserting keys/values into MDHIM\n", md->mdhim_rank);
+			errors++;
+		}
+
+		brm = brmp->next;
+		mdhim_full_release_msg(brmp);
+	}
+
+	mdhimCommit(md, index);
+	MPI_Barrier(MPI_COMM_WORLD);
+	total = KEYS * md->mdhim_comm_size;
+
+	//Move the first slice to the next range server
+	slice = 0;
+	src = get_slice_rangesrv(index, slice);
+	dest = src % index->num_rangesrvs + 1;
+	if (mdhimMigrateSlice(md, index, slice, dest) != MDHIM_SUCCESS) {
+		printf("Rank: %d - Error migrating slice %d\n", md->mdhim_rank, slice);
+		errors++;
+	}
+
+	errors += check_routing(md, slice, dest);
+	errors += check_keys(md, -1);
+
+	//Writes of the slice go to its new range server
+	key = 1;
+	value = total;
+	MPI_Barrier(MPI_COMM_WORLD);
+	if (md->mdhim_rank == 0) {
+		brm = mdhimPut(md, &key, sizeof(int), &value, sizeof(int), NULL, NULL);
+		if (!brm || brm->error) {
+			printf("Rank: %d - Error putting key %d after the migration\n",
+			       md->mdhim_rank, key);
+			errors++;
+		}
+
+		mdhim_full_release_msg(brm);
+		if (get_value(md, key) != value) {
+			printf("Rank: %d - Key %d doesn't have the value put after the migration\n",
+			       md->mdhim_rank, key);
+			errors++;
+		}
+
+		brm = mdhimDelete(md, index, &key, sizeof(int));
+		mdhim_full_release_msg(brm);
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	errors += check_keys(md, key);
+
+	//The slice's stat moved with it and the deleted key is out of it
+	mdhimCommit(md, index);
+	mdhimStatFlush(md, index);
+	if ((count = stat_count(index)) != (uint64_t) total - 1) {
+		printf("Rank: %d - Stats have %llu keys after the migration, expected %d\n",
+		       md->mdhim_rank, (unsigned long long) count, total - 1);
+		errors++;
+	}
+
+	//Start the load counters over, then make the migrated slice the hottest one
+	mdhimRebalance(md, index);
+	src = get_slice_rangesrv(index, slice);
+	for (warm_slice = slice + 1; warm_slice < total / SLICE_SIZE; warm_slice++) {
+		if (get_slice_rangesrv(index, warm_slice) == src) {
+			break;
+		}
+	}
+
+	for (i = 0; i < HOT_READS; i++) {
+		get_value(md, slice * SLICE_SIZE + i % SLICE_SIZE);
+	}
+
+	//A second slice keeps the range server busier than the others after the move
+	for (i = 0; i < WARM_READS && warm_slice < total / SLICE_SIZE; i++) {
+		get_value(md, warm_slice * SLICE_SIZE + i % SLICE_SIZE);
+	}
+
+	if (mdhimRebalance(md, index) != MDHIM_SUCCESS) {
+		printf("Rank: %d - Error rebalancing\n", md->mdhim_rank);
+		errors++;
+	}
+
+	errors += check_routing(md, slice, 0);
+	if (warm_slice < total / SLICE_SIZE && get_slice_rangesrv(index, slice) == src) {
+		printf("Rank: %d - The hot slice %d stayed on range server %u\n",
+		       md->mdhim_rank, slice, src);
+		errors++;
+	}
+
+	errors += check_keys(md, key);
+	for (i = 0; i < KEYS; i++) {
+		free(keys[i]);
+		free(values[i]);
+	}
+
+	free(keys);
+	free(values);
+	ret = mdhimClose(md);
+	mdhim_options_destroy(db_opts);
+	if (ret != MDHIM_SUCCESS) {
+		printf("Error closing MDHIM\n");
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	if (errors) {
+		printf("Migration test failed with %d errors\n", errors);
+		return 1;
+	}
+
+	printf("Migration test passed\n");
+
+	return 0;
+}
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "mpi.h"
+#include "mdhim.h"
+#include "scan.h"
+
+//More keys than fit in a page, so the range servers' pages run out at different keys
+#define KEYS 1500
+#define SLICE_SIZE 100
+
+/* Scans [start, end] and checks that the keys come back in order from first with no gaps,
+   count of them, in pages of at most MDHIM_SCAN_PAGE_SIZE.  Returns the number of errors */
+static int check_scan(struct mdhim_t *md, int *start, int *end, int limit,
+		      int first, int count, int *pages) {
+	struct mdhim_scan_t *scan;
+	struct mdhim_bgetrm_t *bgrm;
+	int i, key, errors;
+
+	errors = 0;
+	key = first;
+	*pages = 0;
+	scan = mdhimScan(md, md->primary_index, start, start ? sizeof(int) : 0,
+			 end, end ? sizeof(int) : 0, limit);
+	if (!scan) {
+		printf("Rank: %d - Error opening a scan\n", md->mdhim_rank);
+		return 1;
+	}
+
+	while ((bgrm = mdhimScanNext(md, scan))) {
+		(*pages)++;
+		if (bgrm->error < 0 || bgrm->num_keys > MDHIM_SCAN_PAGE_SIZE) {
+			printf("Rank: %d - Scan page %d has error %d and %d keys\n",
+			       md->mdhim_rank, *pages, bgrm->error, bgrm->num_keys);
+			errors++;
+		}
+
+		for (i = 0; i < bgrm->num_keys; i++, key++) {
+			if (*(int *) bgrm->keys[i] != key ||
+			    *(int *) bgrm->values[i] != key % md->mdhim_comm_size) {
+				printf("Rank: %d - Scan gave key %d where %d was expected\n",
+				       md->mdhim_rank, *(int *) bgrm->keys[i], key);
+				errors++;
+				key = *(int *) bgrm->keys[i];
+			}
+		}
+
+		mdhim_full_release_msg(bgrm);
+	}
+
+	mdhimScanClose(md, scan);
+	if (key - first != count) {
+		printf("Rank: %d - Scan gave %d keys, expected %d\n",
+		       md->mdhim_rank, key - first, count);
+		errors++;
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	int ret;
+	int provided = 0;
+	struct mdhim_t *md;
+	int **keys;
+	int key_lens[KEYS];
+	int **values;
+	int value_lens[KEYS];
+	struct mdhim_brm_t *brm, *brmp;
+	int i, total, start, end, pages, errors;
+	char     *db_path = "./";
+	char     *db_name = "mdhimTstDB";
+	int      dbug = MLOG_CRIT;
+	mdhim_options_t *db_opts; // Local variable for db create options to be passed
+	int db_type = LEVELDB; //(data_store.h)
+	MPI_Comm comm;
+
+	// Create options for DB initialization
+	db_opts = mdhim_options_init();
+	mdhim_options_set_db_path(db_opts, db_path);
+	mdhim_options_set_db_name(db_opts, db_name);
+	mdhim_options_set_db_type(db_opts, db_type);
+	mdhim_options_set_key_type(db_opts, MDHIM_INT_KEY);
+	mdhim_options_set_debug_level(db_opts, dbug);
+	mdhim_options_set_server_factor(db_opts, 1);
+	mdhim_options_set_max_recs_per_slice(db_opts, SLICE_SIZE);
+	ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	if (ret != MPI_SUCCESS) {
+		printf("Error initializing MPI with threads\n");
+		exit(1);
+	}
+
+	if (provided != MPI_THREAD_MULTIPLE) {
+                printf("Not able to enable MPI_THREAD_MULTIPLE mode\n");
+                exit(1);
+        }
+
+	comm = MPI_COMM_WORLD;
+	md = mdhimInit(&comm, db_opts);
+	if (!md) {
+		printf("Error initializing MDHIM\n");
+		exit(1);
+	}
+
+	//The ranks' keys interleave, so every range server's slices hold keys of every rank
+	keys = malloc(sizeof(int *) * KEYS);
+	values = malloc(sizeof(int *) * KEYS);
+	for (i = 0; i < KEYS; i++) {
+		keys[i] = malloc(sizeof(int));
+		*keys[i] = i * md->mdhim_comm_size + md->mdhim_rank;
+		key_lens[i] = sizeof(int);
+		values[i] = malloc(sizeof(int));
+		*values[i] = md->mdhim_rank;
+		value_lens[i] = sizeof(int);
+	}
+
+	brm = mdhimBPut(md, (void **) keys, key_lens, (void **) values, value_lens, KEYS,
+			NULL, NULL);
+	errors = 0;
+	for (brmp = brm; brmp; brmp = brm) {
+		if (brmp->error < 0) {
+			printf("Rank: %d - Error inserting keys/values into MDHIM\n", md->mdhim_rank);
+			errors++;
+		}
+
+		brm = brmp->next;
+		mdhim_full_release_msg(brmp);
+	}
+
+	mdhimCommit(md, md->primary_index);
+	MPI_Barrier(MPI_COMM_WORLD);
+	total = KEYS * md->mdhim_comm_size;
+
+	//Every key, over several pages
+	errors += check_scan(md, NULL, NULL, 0, 0, total, &pages);
+	if (pages != (total + MDHIM_SCAN_PAGE_SIZE - 1) / MDHIM_SCAN_PAGE_SIZE) {
+		printf("Rank: %d - Scan of %d keys took %d pages\n", md->mdhim_rank, total, pages);
+		errors++;
+	}
+
+	//A range that starts and ends inside slices and ends on a page boundary
+	start = SLICE_SIZE / 2 + md->mdhim_rank;
+	end = start + MDHIM_SCAN_PAGE_SIZE - 1;
+	if (end < total) {
+		errors += check_scan(md, &start, &end, 0, start, end - start + 1, &pages);
+	}
+
+	//The end key is inclusive, and an end key past the last key ends the scan at the last key
+	start = total / 3;
+	end = total + SLICE_SIZE;
+	errors += check_scan(md, &start, &end, 0, start, total - start, &pages);
+	end = start;
+	errors += check_scan(md, &start, &end, 0, start, 1, &pages);
+
+	//A limit stops the scan in the middle of the range servers' pages
+	start = 7;
+	errors += check_scan(md, &start, NULL, MDHIM_SCAN_PAGE_SIZE + 3, start,
+			     MDHIM_SCAN_PAGE_SIZE + 3 < total - start ?
+			     MDHIM_SCAN_PAGE_SIZE + 3 : total - start, &pages);
+
+	//A range with no keys
+	start = total;
+	end = total + SLICE_SIZE;
+	errors += check_scan(md, &start, &end, 0, start, 0, &pages);
+
+	for (i = 0; i < KEYS; i++) {
+		free(keys[i]);
+		free(values[i]);
+	}
+
+	free(keys);
+	free(values);
+	ret = mdhimClose(md);
+	mdhim_options_destroy(db_opts);
+	if (ret != MDHIM_SUCCESS) {
+		printf("Error closing MDHIM\n");
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	if (errors) {
+		printf("Scan test failed with %d errors\n", errors);
+		return 1;
+	}
+
+	printf("Scan test passed\n");
+
+	return 0;
+}
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "mpi.h"
+#include "mdhim.h"
+
+#define KEYS 200
+//Small slices, so each range server's keys are spread over all of its shards
+#define SLICE_SIZE 10
+#define SHARDS 4
+#define PAGE 50
+
+/* Gets the key next to a key, over the messages of every range server asked.
+   Returns the key or -1 if no range server has one */
+static int get_adjacent(struct mdhim_t *md, int key, int op, int *errors) {
+	struct mdhim_bgetrm_t *bgrm, *bgrmp;
+	int i, found = -1;
+
+	bgrm = mdhimBGetOp(md, md->primary_index, &key, sizeof(int), 1, op);
+	for (bgrmp = bgrm; bgrmp; bgrmp = bgrmp->next) {
+		for (i = 0; !bgrmp->error && i < bgrmp->num_keys; i++) {
+			if (!bgrmp->keys[i] || !bgrmp->values[i]) {
+				continue;
+			}
+
+			if (*(int *) bgrmp->values[i] != *(int *) bgrmp->keys[i]) {
+				printf("Rank: %d - Key: %d has value %d\n", md->mdhim_rank,
+				       *(int *) bgrmp->keys[i], *(int *) bgrmp->values[i]);
+				(*errors)++;
+			}
+
+			//Keep the closest key
+			if (found < 0 ||
+			    (op == MDHIM_GET_NEXT ? *(int *) bgrmp->keys[i] < found :
+			     *(int *) bgrmp->keys[i] > found)) {
+				found = *(int *) bgrmp->keys[i];
+			}
+		}
+	}
+
+	mdhim_full_release_msg(bgrm);
+
+	return found;
+}
+
+/* Checks that a page of records from a key is in key order with no gaps.
+   Returns the number of errors */
+static int check_page(struct mdhim_t *md, int key, int total) {
+	struct mdhim_bgetrm_t *bgrm, *bgrmp;
+	int i, expected, errors = 0;
+
+	bgrm = mdhimBGetOp(md, md->primary_index, &key, sizeof(int), PAGE, MDHIM_GET_NEXT);
+	if (!bgrm) {
+		printf("Rank: %d - Error getting the records from key %d\n", md->mdhim_rank, key);
+		return 1;
+	}
+
+	for (bgrmp = bgrm; bgrmp; bgrmp = bgrmp->next) {
+		if (bgrmp->error < 0 || !bgrmp->num_keys) {
+			continue;
+		}
+
+		//A range server's records come back merged from its shards in key order
+		expected = *(int *) bgrmp->keys[0];
+		if (expected < key || expected >= total) {
+			printf("Rank: %d - The records from key %d start at key %d\n",
+			       md->mdhim_rank, key, expected);
+			errors++;
+		}
+
+		for (i = 0; i < bgrmp->num_keys; i++) {
+			if (*(int *) bgrmp->keys[i] < expected ||
+			    *(int *) bgrmp->values[i] != *(int *) bgrmp->keys[i]) {
+				printf("Rank: %d - Record %d from key %d is key %d with value %d\n",
+				       md->mdhim_rank, i, key, *(int *) bgrmp->keys[i],
+				       *(int *) bgrmp->values[i]);
+				errors++;
+			}
+
+			expected = *(int *) bgrmp->keys[i] + 1;
+		}
+	}
+
+	mdhim_full_release_msg(bgrm);
+
+	return errors;
+}
+
+/* Scans every key and checks that they come back in order with no gaps.
+   Returns the number of errors */
+static int check_scan(struct mdhim_t *md, int total) {
+	struct mdhim_scan_t *scan;
+	struct mdhim_bgetrm_t *bgrm;
+	int i, key, errors = 0;
+
+	scan = mdhimScan(md, md->primary_index, NULL, 0, NULL, 0, 0);
+	if (!scan) {
+		printf("Rank: %d - Error opening a scan\n", md->mdhim_rank);
+		return 1;
+	}
+
+	key = 0;
+	while ((bgrm = mdhimScanNext(md, scan))) {
+		for (i = 0; i < bgrm->num_keys; i++, key++) {
+			if (*(int *) bgrm->keys[i] != key || *(int *) bgrm->values[i] != key) {
+				printf("Rank: %d - Scan gave key %d where %d was expected\n",
+				       md->mdhim_rank, *(int *) bgrm->keys[i], key);
+				errors++;
+				key = *(int *) bgrm->keys[i];
+			}
+		}
+
+		mdhim_full_release_msg(bgrm);
+	}
+
+	mdhimScanClose(md, scan);
+	if (key != total) {
+		printf("Rank: %d - Scan gave %d keys, expected %d\n", md->mdhim_rank, key, total);
+		errors++;
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	int ret;
+	int provided = 0;
+	struct mdhim_t *md;
+	int **keys;
+	int key_lens[KEYS];
+	int **values;
+	int value_lens[KEYS];
+	struct mdhim_brm_t *brm, *brmp;
+	int i, key, found, total, errors;
+	char     *db_path = "./";
+	char     *db_name = "mdhimTstDB";
+	int      dbug = MLOG_CRIT;
+	mdhim_options_t *db_opts; // Local variable for db create options to be passed
+	int db_type = LEVELDB; //(data_store.h)
+	MPI_Comm comm;
+
+	// Create options for DB initialization
+	db_opts = mdhim_options_init();
+	mdhim_options_set_db_path(db_opts, db_path);
+	mdhim_options_set_db_name(db_opts, db_name);
+	mdhim_options_set_db_type(db_opts, db_type);
+	mdhim_options_set_key_type(db_opts, MDHIM_INT_KEY);
+	mdhim_options_set_debug_level(db_opts, dbug);
+	mdhim_options_set_server_factor(db_opts, 1);
+	mdhim_options_set_max_recs_per_slice(db_opts, SLICE_SIZE);
+	mdhim_options_set_num_shards(db_opts, SHARDS);
+	ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	if (ret != MPI_SUCCESS) {
+		printf("Error initializing MPI with threads\n");
+		exit(1);
+	}
+
+	if (provided != MPI_THREAD_MULTIPLE) {
+                printf("Not able to enable MPI_THREAD_MULTIPLE mode\n");
+                exit(1);
+        }
+
+	comm = MPI_COMM_WORLD;
+	md = mdhimInit(&comm, db_opts);
+	if (!md) {
+		printf("Error initializing MDHIM\n");
+		exit(1);
+	}
+
+	//Each key's value is the key, so a value read from the wrong shard shows up
+	keys = malloc(sizeof(int *) * KEYS);
+	values = malloc(sizeof(int *) * KEYS);
+	for (i = 0; i < KEYS; i++) {
+		keys[i] = malloc(sizeof(int));
+		*keys[i] = i * md->mdhim_comm_size + md->mdhim_rank;
+		key_lens[i] = sizeof(int);
+		values[i] = malloc(sizeof(int));
+		*values[i] = *keys[i];
+		value_lens[i] = sizeof(int);
+	}
+
+	brm = mdhimBPut(md, (void **) keys, key_lens, (void **) values, value_lens, KEYS,
+			NULL, NULL);
+	errors = 0;
+	for (brmp = brm; brmp; brmp = brm) {
+		if (brmp->error < 0) {
+			printf("Rank: %d - Error inserting keys/values into MDHIM\n", md->mdhim_rank);
+			errors++;
+		}
+
+		brm = brmp->next;
+		mdhim_full_release_msg(brmp);
+	}
+
+	mdhimCommit(md, md->primary_index);
+	MPI_Barrier(MPI_COMM_WORLD);
+	mdhimStatFlush(md, md->primary_index);
+	total = KEYS * md->mdhim_comm_size;
+
+	//Consecutive keys are in different slices, so the next and previous keys are in other shards
+	for (i = 0; i < KEYS; i++) {
+		key = *keys[i];
+		found = get_adjacent(md, key - 1, MDHIM_GET_NEXT, &errors);
+		if (key > 0 && found != key) {
+			printf("Rank: %d - The key after %d is %d\n", md->mdhim_rank, key - 1, found);
+			errors++;
+		}
+
+		found = get_adjacent(md, key + 1, MDHIM_GET_PREV, &errors);
+		if (key < total - 1 && found != key) {
+			printf("Rank: %d - The key before %d is %d\n", md->mdhim_rank, key + 1, found);
+			errors++;
+		}
+	}
+
+	//Past the last key there is nothing
+	if ((found = get_adjacent(md, total - 1, MDHIM_GET_NEXT, &errors)) >= 0) {
+		printf("Rank: %d - The key after the last key is %d\n", md->mdhim_rank, found);
+		errors++;
+	}
+
+	//Pages of records and a scan are merged from the shards by their cursors
+	for (key = md->mdhim_rank; key < total; key += SLICE_SIZE * md->mdhim_comm_size + 1) {
+		errors += check_page(md, key, total);
+	}
+
+	errors += check_scan(md, total);
+	for (i = 0; i < KEYS; i++) {
+		free(keys[i]);
+		free(values[i]);
+	}
+
+	free(keys);
+	free(values);
+	ret = mdhimClose(md);
+	mdhim_options_destroy(db_opts);
+	if (ret != MDHIM_SUCCESS) {
+		printf("Error closing MDHIM\n");
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	if (errors) {
+		printf("Shard test failed with %d errors\n", errors);
+		return 1;
+	}
+
+	printf("Shard test passed\n");
+
+	return 0;
+}
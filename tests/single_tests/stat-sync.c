@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "mpi.h"
+#include "mdhim.h"
+
+#define KEYS 200
+#define SLICE_SIZE 10
+//Milliseconds between the rounds of the stat propagation thread
+#define INTERVAL 20
+//Changed slice stats a round waits for, more than one slice and fewer than all of them
+#define THRESHOLD 4
+//Milliseconds to wait for the thread to publish the stats
+#define TIMEOUT 10000
+
+/* Counts the keys in the stats the stat propagation thread published */
+static uint64_t stat_count(struct index_t *index) {
+	uint64_t count = 0;
+	int i;
+
+	while (pthread_rwlock_rdlock(index->stats_lock) == EBUSY) {
+		usleep(10);
+	}
+
+	for (i = 0; index->stats && i < index->stats->num; i++) {
+		count += index->stats->nums[i];
+	}
+
+	pthread_rwlock_unlock(index->stats_lock);
+
+	return count;
+}
+
+/* Waits for the published stats to have the number of keys given.
+   Returns the number of keys they had when the wait ended */
+static uint64_t wait_stat_count(struct index_t *index, uint64_t expected) {
+	uint64_t count;
+	int waited;
+
+	for (waited = 0; (count = stat_count(index)) != expected && waited < TIMEOUT;
+	     waited += INTERVAL) {
+		usleep(INTERVAL * 1000);
+	}
+
+	return count;
+}
+
+/* Puts the keys, each with itself as its value.  Returns the number of errors */
+static int put_keys(struct mdhim_t *md, int **keys, int num_keys) {
+	struct mdhim_brm_t *brm, *brmp;
+	int key_lens[KEYS], value_lens[KEYS];
+	int i, errors = 0;
+
+	for (i = 0; i < num_keys; i++) {
+		key_lens[i] = sizeof(int);
+		value_lens[i] = sizeof(int);
+	}
+
+	brm = mdhimBPut(md, (void **) keys, key_lens, (void **) keys, value_lens, num_keys,
+			NULL, NULL);
+	for (brmp = brm; brmp; brmp = brm) {
+		if (brmp->error < 0) {
+			printf("Rank: %d - Error inserting keys/values into MDHIM\n", md->mdhim_rank);
+			errors++;
+		}
+
+		brm = brmp->next;
+		mdhim_full_release_msg(brmp);
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	int ret;
+	int provided = 0;
+	struct mdhim_t *md;
+	struct index_t *index;
+	int **keys;
+	int key_lens[KEYS];
+	struct mdhim_brm_t *brm, *brmp;
+	int i, num_keys, total, errors;
+	uint64_t count, expected;
+	char     *db_path = "./";
+	char     *db_name = "mdhimTstDB";
+	int      dbug = MLOG_CRIT;
+	mdhim_options_t *db_opts; // Local variable for db create options to be passed
+	int db_type = LEVELDB; //(data_store.h)
+	MPI_Comm comm;
+
+	// Create options for DB initialization
+	db_opts = mdhim_options_init();
+	mdhim_options_set_db_path(db_opts, db_path);
+	mdhim_options_set_db_name(db_opts, db_name);
+	mdhim_options_set_db_type(db_opts, db_type);
+	mdhim_options_set_key_type(db_opts, MDHIM_INT_KEY);
+	mdhim_options_set_debug_level(db_opts, dbug);
+	mdhim_options_set_max_recs_per_slice(db_opts, SLICE_SIZE);
+	mdhim_options_set_stat_interval(db_opts, INTERVAL);
+	mdhim_options_set_stat_threshold(db_opts, THRESHOLD);
+	ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+	if (ret != MPI_SUCCESS) {
+		printf("Error initializing MPI with threads\n");
+		exit(1);
+	}
+
+	if (provided != MPI_THREAD_MULTIPLE) {
+                printf("Not able to enable MPI_THREAD_MULTIPLE mode\n");
+                exit(1);
+        }
+
+	comm = MPI_COMM_WORLD;
+	md = mdhimInit(&comm, db_opts);
+	if (!md) {
+		printf("Error initializing MDHIM\n");
+		exit(1);
+	}
+
+	index = md->primary_index;
+	keys = malloc(sizeof(int *) * KEYS);
+	for (i = 0; i < KEYS; i++) {
+		keys[i] = malloc(sizeof(int));
+		key_lens[i] = sizeof(int);
+	}
+
+	//Every rank has the stats of the empty index, so the next rounds only send changes
+	errors = 0;
+	if (mdhimStatFlush(md, index) != MDHIM_SUCCESS) {
+		printf("Rank: %d - Error flushing the stats\n", md->mdhim_rank);
+		errors++;
+	}
+
+	//Keys of a single slice change fewer stats than the threshold, so they aren't published
+	if (md->mdhim_rank == 0) {
+		for (i = 0; i < SLICE_SIZE; i++) {
+			*keys[i] = i;
+		}
+
+		errors += put_keys(md, keys, SLICE_SIZE);
+	}
+
+	mdhimCommit(md, index);
+	MPI_Barrier(MPI_COMM_WORLD);
+	usleep(INTERVAL * 1000 * 10);
+	if ((count = stat_count(index)) != 0) {
+		printf("Rank: %d - Stats of %llu keys were published below the threshold\n",
+		       md->mdhim_rank, (unsigned long long) count);
+		errors++;
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	//Keys of every rank change enough slices, so the thread publishes them without a flush
+	for (i = 0; i < KEYS; i++) {
+		*keys[i] = SLICE_SIZE + i * md->mdhim_comm_size + md->mdhim_rank;
+	}
+
+	errors += put_keys(md, keys, KEYS);
+	mdhimCommit(md, index);
+	total = SLICE_SIZE + KEYS * md->mdhim_comm_size;
+	if ((count = wait_stat_count(index, total)) != (uint64_t) total) {
+		printf("Rank: %d - Stats have %llu keys after waiting for the stat propagation, "
+		       "expected %d\n", md->mdhim_rank, (unsigned long long) count, total);
+		errors++;
+	}
+
+	//A flush with the thread running publishes changes below the threshold right away
+	MPI_Barrier(MPI_COMM_WORLD);
+	num_keys = 0;
+	if (md->mdhim_rank == 0) {
+		for (i = 0; i < SLICE_SIZE / 2; i++) {
+			*keys[num_keys++] = i;
+		}
+
+		brm = mdhimBDelete(md, index, (void **) keys, key_lens, num_keys);
+		for (brmp = brm; brmp; brmp = brm) {
+			if (brmp->error < 0) {
+				printf("Rank: %d - Error deleting keys from MDHIM\n", md->mdhim_rank);
+				errors++;
+			}
+
+			brm = brmp->next;
+			mdhim_full_release_msg(brmp);
+		}
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	mdhimCommit(md, index);
+	if (mdhimStatFlush(md, index) != MDHIM_SUCCESS) {
+		printf("Rank: %d - Error flushing the stats\n", md->mdhim_rank);
+		errors++;
+	}
+
+	expected = (uint64_t) total - SLICE_SIZE / 2;
+	if ((count = stat_count(index)) != expected) {
+		printf("Rank: %d - Stats have %llu keys after the flush, expected %llu\n",
+		       md->mdhim_rank, (unsigned long long) count, (unsigned long long) expected);
+		errors++;
+	}
+
+	for (i = 0; i < KEYS; i++) {
+		free(keys[i]);
+	}
+
+	free(keys);
+	ret = mdhimClose(md);
+	mdhim_options_destroy(db_opts);
+	if (ret != MDHIM_SUCCESS) {
+		printf("Error closing MDHIM\n");
+	}
+
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Finalize();
+	if (errors) {
+		printf("Stat propagation test failed with %d errors\n", errors);
+		return 1;
+	}
+
+	printf("Stat propagation test passed\n");
+
+	return 0;
+}